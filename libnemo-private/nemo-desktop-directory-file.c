@@ -383,7 +383,7 @@ desktop_directory_file_get_item_count (NemoFile *file,
 							    count_unreadable);
 
 	if (count) {
-		*count += g_list_length (file->details->directory->details->file_list);
+		*count += nemo_file_table_get_length (file->details->directory->details->file_table);
 	}
 	
 	return got_count;
@@ -411,7 +411,7 @@ desktop_directory_file_get_deep_counts (NemoFile *file,
 						TRUE);
 
 	if (file_count) {
-		*file_count += g_list_length (file->details->directory->details->file_list);
+		*file_count += nemo_file_table_get_length (file->details->directory->details->file_table);
 	}
 	
 	return status;
@@ -199,7 +199,7 @@ desktop_call_when_ready (NemoDirectory *directory,
 
 
 	merged_callback->merged_file_list = g_list_concat (NULL,
-							   nemo_file_list_copy (directory->details->file_list));
+							   nemo_file_list_ref (nemo_file_table_get_list (directory->details->file_table)));
 
 	/* Put it in the hash table. */
 	g_hash_table_insert (desktop->details->callbacks,
@@ -321,7 +321,7 @@ desktop_monitor_add (NemoDirectory *directory,
 	
 	/* Handle the desktop part */
 	merged_callback_list = g_list_concat (merged_callback_list,
-					      nemo_file_list_copy (directory->details->file_list));
+					      nemo_file_list_ref (nemo_file_table_get_list (directory->details->file_table)));
 
 	
 	if (callback != NULL) {
@@ -385,7 +385,7 @@ desktop_is_not_empty (NemoDirectory *directory)
 		return TRUE;
 	}
 
-	return directory->details->file_list != NULL;
+	return nemo_file_table_get_length (directory->details->file_table) > 0;
 }
 
 static GList *
@@ -37,6 +37,7 @@
 #include <libxml/parser.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* turn this on to see messages about each load_directory call: */
 #if 0
@@ -55,8 +56,114 @@
 
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 
-/* Keep async. jobs down to this number for all directories. */
-#define MAX_ASYNC_JOBS 10
+/* The file list is enumerated in batches that start small, so the
+ * first screenful shows up quickly, and grow while each batch comes
+ * back within DIRECTORY_LOAD_BATCH_TARGET_USEC.
+ */
+#define DIRECTORY_LOAD_FIRST_BATCH 64
+#define DIRECTORY_LOAD_MAX_BATCH 4096
+#define DIRECTORY_LOAD_BATCH_TARGET_USEC 50000
+
+/* Loaded files are turned into NemoFiles and announced in slices
+ * that take about this long, so we leave room for drawing a frame
+ * between slices.
+ */
+#define DEQUEUE_PENDING_SLICE_USEC 8000
+#define DEQUEUE_PENDING_MIN_ITEMS 64
+#define DEQUEUE_PENDING_MAX_ITEMS 8192
+
+/* Upper bound for async. jobs of all directories together; within
+ * it, each filesystem is held to its own budget (see below).
+ */
+#define MAX_ASYNC_JOBS 24
+
+/* Thumbnails that are loaded at the same time for one directory, as
+ * far as the thumbnail share of the filesystem's budget allows.
+ */
+#define MAX_THUMBNAIL_LOADS 8
+
+/* How far down its queue a directory looks for more files to request
+ * info or counts for, while the file at the head is being worked on.
+ */
+#define INFO_LOOK_AHEAD_FILES 64
+
+/* Files whose info came back are announced together, at most this
+ * long after the first of them.
+ */
+#define PENDING_CHANGES_BATCH_MSEC 30
+
+/* Each filesystem gets its own share of the async. jobs; the share
+ * starts out at ASYNC_JOB_BUDGET_INITIAL and is adjusted between
+ * ASYNC_JOB_BUDGET_MIN and ASYNC_JOB_BUDGET_MAX from the observed
+ * latency of short requests (times are in microseconds).
+ */
+#define ASYNC_JOB_BUDGET_INITIAL 4
+#define ASYNC_JOB_BUDGET_MIN 1
+#define ASYNC_JOB_BUDGET_MAX 16
+#define ASYNC_JOB_MIN_BASE_LATENCY 1000
+#define ASYNC_JOB_SLOW_LATENCY 50000
+
+typedef enum {
+	ASYNC_JOB_FILE_LIST,
+	ASYNC_JOB_FILE_INFO,
+	ASYNC_JOB_LINK_INFO,
+	ASYNC_JOB_EXTENSION_INFO,
+	ASYNC_JOB_MOUNT,
+	ASYNC_JOB_FILESYSTEM_INFO,
+	ASYNC_JOB_DIRECTORY_COUNT,
+	ASYNC_JOB_MIME_LIST,
+	ASYNC_JOB_THUMBNAIL,
+	ASYNC_JOB_DEEP_COUNT,
+	ASYNC_JOB_TYPE_LAST
+} AsyncJobType;
+
+typedef struct {
+	const char *name;
+	AsyncJobPriority priority;
+	/* Short, uniform requests whose latency tells us how loaded
+	 * the filesystem is.
+	 */
+	gboolean latency_probe;
+} AsyncJobTypeInfo;
+
+static const AsyncJobTypeInfo async_job_types[ASYNC_JOB_TYPE_LAST] = {
+	{ "file list",        ASYNC_JOB_PRIORITY_FILE_LIST,  FALSE },
+	{ "file info",        ASYNC_JOB_PRIORITY_FILE_INFO,  TRUE },
+	{ "link info",        ASYNC_JOB_PRIORITY_FILE_INFO,  TRUE },
+	{ "extension info",   ASYNC_JOB_PRIORITY_FILE_INFO,  FALSE },
+	{ "mount",            ASYNC_JOB_PRIORITY_FILE_INFO,  TRUE },
+	{ "filesystem info",  ASYNC_JOB_PRIORITY_FILE_INFO,  TRUE },
+	{ "directory count",  ASYNC_JOB_PRIORITY_FILE_INFO,  FALSE },
+	{ "MIME list",        ASYNC_JOB_PRIORITY_FILE_INFO,  FALSE },
+	{ "thumbnail",        ASYNC_JOB_PRIORITY_THUMBNAIL,  FALSE },
+	{ "deep count",       ASYNC_JOB_PRIORITY_DEEP_COUNT, FALSE },
+};
+
+/* The async. jobs share of one filesystem (or remote host). */
+typedef struct {
+	char *key;
+	int ref_count;
+	int running;
+	int limit;
+	gint64 average_latency;
+	gint64 base_latency;
+} AsyncJobBudget;
+
+struct AsyncJobState {
+	AsyncJobBudget *budget;
+	int running;
+	/* The directory was cancelled while jobs were still running,
+	 * free this once the last of them ends.
+	 */
+	gboolean cancelled;
+	gint64 start_time[ASYNC_JOB_TYPE_LAST];
+
+	/* Link in async_job_waiting[waiting_priority], or NULL. */
+	GList *waiting_link;
+	AsyncJobPriority waiting_priority;
+	gint64 wait_start;
+	guint wake_serial;
+};
 
 struct LinkInfoReadState {
 	NemoDirectory *directory;
@@ -68,7 +175,9 @@ struct ThumbnailState {
 	NemoDirectory *directory;
 	GCancellable *cancellable;
 	NemoFile *file;
-	gboolean trying_original;
+	/* Only these are used by the loading thread */
+	GFile *original_location;
+	char *thumbnail_path;
 	gboolean tried_original;
 };
 
@@ -91,6 +200,8 @@ struct DirectoryLoadState {
 	GHashTable *load_mime_list_hash;
 	NemoFile *load_directory_file;
 	int load_file_count;
+	int batch_size;
+	gint64 batch_start_time;
 };
 
 struct MimeListState {
@@ -103,7 +214,10 @@ struct MimeListState {
 
 struct GetInfoState {
 	NemoDirectory *directory;
+	NemoFile *file;
 	GCancellable *cancellable;
+	/* Several of these run at once, so each keeps its own */
+	gint64 start_time;
 };
 
 struct NewFilesState {
@@ -118,6 +232,7 @@ struct DirectoryCountState {
 	GCancellable *cancellable;
 	GFileEnumerator *enumerator;
 	int file_count;
+	gint64 start_time;
 };
 
 struct DeepCountState {
@@ -166,7 +281,9 @@ typedef gboolean (* FileCheck) (NemoFile *);
 
 /* Current number of async. jobs. */
 static int async_job_count;
-static GHashTable *waiting_directories;
+static GHashTable *async_job_budgets;
+static GQueue async_job_waiting[ASYNC_JOB_PRIORITY_LAST];
+static AsyncJobStats async_job_stats[ASYNC_JOB_PRIORITY_LAST];
 #ifdef DEBUG_ASYNC_JOBS
 static GHashTable *async_jobs;
 #endif
@@ -336,34 +453,313 @@ nemo_directory_verify_request_counts (NemoDirectory *directory)
 }
 #endif
 
+/* Find the budget that jobs for this directory are charged to. We
+ * key on the filesystem id when we know it, so that each mount gets
+ * its own share, and fall back to the scheme and host of the URI.
+ */
+static AsyncJobBudget *
+async_job_get_budget (NemoDirectory *directory)
+{
+	AsyncJobBudget *budget;
+	NemoFile *file;
+	char *key, *uri, *p;
+
+	key = NULL;
+	file = nemo_directory_get_existing_corresponding_file (directory);
+	if (file != NULL) {
+		if (file->details->filesystem_id != NULL) {
+			key = g_strdup (file->details->filesystem_id);
+		}
+		nemo_file_unref (file);
+	}
+
+	if (key == NULL) {
+		uri = nemo_directory_get_uri (directory);
+		p = strstr (uri, "://");
+		if (p != NULL) {
+			p = strchr (p + 3, '/');
+			if (p != NULL) {
+				*p = '\0';
+			}
+		}
+		key = uri;
+	}
+
+	if (async_job_budgets == NULL) {
+		async_job_budgets = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+
+	budget = g_hash_table_lookup (async_job_budgets, key);
+	if (budget == NULL) {
+		budget = g_new0 (AsyncJobBudget, 1);
+		budget->key = key;
+		budget->limit = ASYNC_JOB_BUDGET_INITIAL;
+		g_hash_table_insert (async_job_budgets, budget->key, budget);
+	} else {
+		g_free (key);
+	}
+
+	budget->ref_count += 1;
+	return budget;
+}
+
+static void
+async_job_budget_unref (AsyncJobBudget *budget)
+{
+	g_assert (budget->ref_count > 0);
+
+	budget->ref_count -= 1;
+	if (budget->ref_count > 0) {
+		return;
+	}
+
+	g_assert (budget->running == 0);
+
+	g_hash_table_remove (async_job_budgets, budget->key);
+	if (g_hash_table_size (async_job_budgets) == 0) {
+		g_hash_table_destroy (async_job_budgets);
+		async_job_budgets = NULL;
+	}
+	g_free (budget->key);
+	g_free (budget);
+}
+
+static AsyncJobState *
+async_job_get_state (NemoDirectory *directory)
+{
+	AsyncJobState *state;
+
+	state = directory->details->async_job_state;
+	if (state == NULL) {
+		state = g_new0 (AsyncJobState, 1);
+		directory->details->async_job_state = state;
+	}
+	state->cancelled = FALSE;
+
+	/* Only move to another budget while we have nothing charged
+	 * to the current one.
+	 */
+	if (state->running == 0) {
+		if (state->budget != NULL) {
+			async_job_budget_unref (state->budget);
+		}
+		state->budget = async_job_get_budget (directory);
+	}
+
+	return state;
+}
+
+static void
+async_job_state_free (NemoDirectory *directory)
+{
+	AsyncJobState *state;
+
+	state = directory->details->async_job_state;
+	g_assert (state->running == 0);
+	g_assert (state->waiting_link == NULL);
+
+	if (state->budget != NULL) {
+		async_job_budget_unref (state->budget);
+	}
+	g_free (state);
+	directory->details->async_job_state = NULL;
+}
+
+/* Lower priorities get a smaller part of each limit, so that deep
+ * counts and thumbnails can never take every slot away from loading
+ * the file list and file info.
+ */
+static int
+async_job_get_share (int limit,
+		     AsyncJobPriority priority)
+{
+	int share;
+
+	share = (limit * (ASYNC_JOB_PRIORITY_LAST - priority) + ASYNC_JOB_PRIORITY_LAST - 1)
+		/ ASYNC_JOB_PRIORITY_LAST;
+	return MAX (share, 1);
+}
+
+/* Whether the jobs charged to a budget used all of the share of a
+ * priority.
+ */
+static gboolean
+async_job_budget_is_saturated (AsyncJobBudget *budget,
+			       AsyncJobPriority priority)
+{
+	return budget->running >= async_job_get_share (budget->limit, priority);
+}
+
+static gboolean
+async_job_has_room (AsyncJobState *state,
+		    AsyncJobPriority priority)
+{
+	int limit;
+
+	if (async_job_count >= async_job_get_share (MAX_ASYNC_JOBS, priority)) {
+		return FALSE;
+	}
+
+	/* Loading a file list may always go one over, so a folder
+	 * being opened is never stuck behind background work on the
+	 * same filesystem.
+	 */
+	limit = state->budget->limit;
+	if (priority == ASYNC_JOB_PRIORITY_FILE_LIST) {
+		limit += 1;
+	}
+
+	return state->budget->running < async_job_get_share (limit, priority);
+}
+
+static void
+async_job_stop_waiting (NemoDirectory *directory)
+{
+	AsyncJobState *state;
+
+	state = directory->details->async_job_state;
+	if (state == NULL || state->waiting_link == NULL) {
+		return;
+	}
+
+	g_queue_delete_link (&async_job_waiting[state->waiting_priority],
+			     state->waiting_link);
+	state->waiting_link = NULL;
+}
+
+static void
+async_job_wait (NemoDirectory *directory,
+		AsyncJobState *state,
+		AsyncJobPriority priority)
+{
+	GQueue *queue;
+
+	if (state->waiting_link != NULL) {
+		if (state->waiting_priority <= priority) {
+			return;
+		}
+		/* Something more urgent is blocked now, move up. */
+		g_queue_delete_link (&async_job_waiting[state->waiting_priority],
+				     state->waiting_link);
+	} else {
+		state->wait_start = g_get_monotonic_time ();
+	}
+
+	queue = &async_job_waiting[priority];
+	g_queue_push_tail (queue, directory);
+	state->waiting_link = queue->tail;
+	state->waiting_priority = priority;
+}
+
+/* Adjust the limit of a budget when a job ends. Latency that climbs
+ * well above the best we have seen means the filesystem is congested,
+ * so we back off; steady latency while the job's priority had used
+ * all of its share means we can afford more parallelism. Jobs that
+ * aren't latency probes pass a latency of -1 and only get to raise
+ * the limit, going by what the probes measured.
+ */
+static void
+async_job_budget_adapt (AsyncJobBudget *budget,
+			gint64 latency,
+			gboolean saturated)
+{
+	if (latency < 0) {
+		if (budget->average_latency == 0) {
+			return;
+		}
+	} else if (budget->average_latency == 0) {
+		budget->average_latency = MAX (latency, 1);
+		budget->base_latency = budget->average_latency;
+	} else {
+		budget->average_latency += (latency - budget->average_latency) / 8;
+		if (latency < budget->base_latency) {
+			budget->base_latency = latency;
+		} else {
+			/* Slowly forget old minimums. */
+			budget->base_latency += (budget->average_latency - budget->base_latency) / 64;
+		}
+	}
+
+	if (latency >= 0 &&
+	    budget->average_latency > ASYNC_JOB_SLOW_LATENCY &&
+	    budget->average_latency > 4 * MAX (budget->base_latency, ASYNC_JOB_MIN_BASE_LATENCY)) {
+		if (budget->limit > ASYNC_JOB_BUDGET_MIN) {
+			budget->limit -= 1;
+		}
+	} else if (saturated &&
+		   budget->average_latency < 2 * MAX (budget->base_latency, ASYNC_JOB_MIN_BASE_LATENCY)) {
+		if (budget->limit < ASYNC_JOB_BUDGET_MAX) {
+			budget->limit += 1;
+		}
+	}
+}
+
+#ifdef DEBUG_ASYNC_JOBS
+/* Feed a budget the jobs of a fast filesystem, then of a slow one,
+ * and check that the limit follows.
+ */
+static void
+async_job_budget_check_adapt (void)
+{
+	AsyncJobBudget budget = { 0 };
+	int i;
+
+	budget.limit = ASYNC_JOB_BUDGET_INITIAL;
+
+	/* File info requests alone, all slots of their share busy. */
+	for (i = 0; i < 2 * ASYNC_JOB_BUDGET_MAX; i++) {
+		budget.running = async_job_get_share (budget.limit, ASYNC_JOB_PRIORITY_FILE_INFO);
+		async_job_budget_adapt (&budget, 200,
+					async_job_budget_is_saturated (&budget, ASYNC_JOB_PRIORITY_FILE_INFO));
+	}
+	g_assert_cmpint (budget.limit, ==, ASYNC_JOB_BUDGET_MAX);
+	g_assert_cmpint (async_job_get_share (budget.limit, ASYNC_JOB_PRIORITY_FILE_INFO), >=, 8);
+
+	/* Thumbnails alone grow it too, going by the probes. */
+	budget.limit = ASYNC_JOB_BUDGET_INITIAL;
+	for (i = 0; i < 2 * ASYNC_JOB_BUDGET_MAX; i++) {
+		budget.running = async_job_get_share (budget.limit, ASYNC_JOB_PRIORITY_THUMBNAIL);
+		async_job_budget_adapt (&budget, -1,
+					async_job_budget_is_saturated (&budget, ASYNC_JOB_PRIORITY_THUMBNAIL));
+	}
+	g_assert_cmpint (budget.limit, ==, ASYNC_JOB_BUDGET_MAX);
+
+	/* Latency climbing far above the base backs off. */
+	for (i = 0; i < 8 * ASYNC_JOB_BUDGET_MAX; i++) {
+		async_job_budget_adapt (&budget, 20 * ASYNC_JOB_SLOW_LATENCY, TRUE);
+	}
+	g_assert_cmpint (budget.limit, ==, ASYNC_JOB_BUDGET_MIN);
+}
+#endif
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
- * number of requests is unbounded.
+ * number of requests is unbounded. If there is no room, the directory
+ * is queued at the priority of the job and woken up in FIFO order
+ * once a slot frees up.
  */
 static gboolean
 async_job_start (NemoDirectory *directory,
-		 const char *job)
+		 AsyncJobType job)
 {
+	AsyncJobState *state;
+	AsyncJobPriority priority;
 #ifdef DEBUG_ASYNC_JOBS
 	char *key;
 #endif
 
 #ifdef DEBUG_START_STOP
-	g_message ("starting %s in %p", job, directory->details->location);
+	g_message ("starting %s in %p", async_job_types[job].name, directory->details->location);
 #endif
 
 	g_assert (async_job_count >= 0);
 	g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-	if (async_job_count >= MAX_ASYNC_JOBS) {
-		if (waiting_directories == NULL) {
-			waiting_directories = g_hash_table_new (NULL, NULL);
-		}
+	priority = async_job_types[job].priority;
+	state = async_job_get_state (directory);
 
-		g_hash_table_insert (waiting_directories,
-				     directory,
-				     directory);
-		
+	if (!async_job_has_room (state, priority)) {
+		async_job_wait (directory, state, priority);
 		return FALSE;
 	}
 
@@ -372,12 +768,13 @@ async_job_start (NemoDirectory *directory,
 		char *uri;
 		if (async_jobs == NULL) {
 			async_jobs = g_hash_table_new (g_str_hash, g_str_equal);
+			async_job_budget_check_adapt ();
 		}
 		uri = nemo_directory_get_uri (directory);
-		key = g_strconcat (uri, ": ", job, NULL);
+		key = g_strconcat (uri, ": ", async_job_types[job].name, NULL);
 		if (g_hash_table_lookup (async_jobs, key) != NULL) {
 			g_warning ("same job twice: %s in %s",
-				   job, uri);
+				   async_job_types[job].name, uri);
 		}
 		g_free (uri);
 		g_hash_table_insert (async_jobs, key, directory);
@@ -385,21 +782,36 @@ async_job_start (NemoDirectory *directory,
 #endif	
 
 	async_job_count += 1;
+	state->running += 1;
+	state->budget->running += 1;
+	state->start_time[job] = g_get_monotonic_time ();
+
+	async_job_stats[priority].running += 1;
+	async_job_stats[priority].started += 1;
+
 	return TRUE;
 }
 
-/* End a job. */
+/* End a job that started at start_time. Jobs that can run more than
+ * once per directory at a time keep their own start time and end
+ * through here, async_job_end() is for the others.
+ */
 static void
-async_job_end (NemoDirectory *directory,
-	       const char *job)
-{
+async_job_end_started_at (NemoDirectory *directory,
+			  AsyncJobType job,
+			  gint64 start_time)
+{
+	AsyncJobState *state;
+	AsyncJobBudget *budget;
+	AsyncJobPriority priority;
+	gboolean saturated;
 #ifdef DEBUG_ASYNC_JOBS
 	char *key;
 	gpointer table_key, value;
 #endif
 
 #ifdef DEBUG_START_STOP
-	g_message ("stopping %s in %p", job, directory->details->location);
+	g_message ("stopping %s in %p", async_job_types[job].name, directory->details->location);
 #endif
 
 	g_assert (async_job_count > 0);
@@ -409,10 +821,10 @@ async_job_end (NemoDirectory *directory,
 		char *uri;
 		uri = nemo_directory_get_uri (directory);
 		g_assert (async_jobs != NULL);
-		key = g_strconcat (uri, ": ", job, NULL);
+		key = g_strconcat (uri, ": ", async_job_types[job].name, NULL);
 		if (!g_hash_table_lookup_extended (async_jobs, key, &table_key, &value)) {
 			g_warning ("ending job we didn't start: %s in %s",
-				   job, uri);
+				   async_job_types[job].name, uri);
 		} else {
 			g_hash_table_remove (async_jobs, key);
 			g_free (table_key);
@@ -422,40 +834,57 @@ async_job_end (NemoDirectory *directory,
 	}
 #endif
 
+	state = directory->details->async_job_state;
+	g_assert (state != NULL);
+	g_assert (state->running > 0);
+
+	budget = state->budget;
+	priority = async_job_types[job].priority;
+	saturated = async_job_budget_is_saturated (budget, priority);
+
 	async_job_count -= 1;
-}
+	state->running -= 1;
+	budget->running -= 1;
+	async_job_stats[priority].running -= 1;
 
-/* Helper to get one value from a hash table. */
-static void
-get_one_value_callback (gpointer key, gpointer value, gpointer callback_data)
-{
-	gpointer *returned_value;
+	async_job_budget_adapt (budget,
+				async_job_types[job].latency_probe ?
+				g_get_monotonic_time () - start_time : -1,
+				saturated);
 
-	returned_value = callback_data;
-	*returned_value = value;
+	if (state->running == 0 && state->cancelled) {
+		async_job_state_free (directory);
+	}
 }
 
-/* return a single value from a hash table. */
-static gpointer
-get_one_value (GHashTable *table)
+/* End a job. */
+static void
+async_job_end (NemoDirectory *directory,
+	       AsyncJobType job)
 {
-	gpointer value;
+	AsyncJobState *state;
 
-	value = NULL;
-	if (table != NULL) {
-		g_hash_table_foreach (table, get_one_value_callback, &value);
-	}
-	return value;
+	state = directory->details->async_job_state;
+	g_assert (state != NULL);
+
+	async_job_end_started_at (directory, job, state->start_time[job]);
 }
 
 /* Wake up directories that are "blocked" as long as there are job
- * slots available.
+ * slots available, most urgent priority first and in the order they
+ * started waiting within a priority.
  */
 static void
 async_job_wake_up (void)
 {
 	static gboolean already_waking_up = FALSE;
-	gpointer value;
+	static guint wake_serial = 0;
+	NemoDirectory *directory;
+	AsyncJobState *state;
+	AsyncJobStats *stats;
+	GList *node;
+	gint64 wait_time;
+	int priority;
 
 	g_assert (async_job_count >= 0);
 	g_assert (async_job_count <= MAX_ASYNC_JOBS);
@@ -465,23 +894,185 @@ async_job_wake_up (void)
 	}
 	
 	already_waking_up = TRUE;
-	while (async_job_count < MAX_ASYNC_JOBS) {
-		value = get_one_value (waiting_directories);
-		if (value == NULL) {
-			break;
+	wake_serial += 1;
+	for (priority = 0; priority < ASYNC_JOB_PRIORITY_LAST; priority++) {
+		/* Waking a directory can change the queues, so start over
+		 * from the head each time; the serial makes sure we try
+		 * each directory only once per pass.
+		 */
+		node = async_job_waiting[priority].head;
+		while (node != NULL && async_job_count < MAX_ASYNC_JOBS) {
+			directory = node->data;
+			state = directory->details->async_job_state;
+
+			if (state->wake_serial == wake_serial ||
+			    !async_job_has_room (state, priority)) {
+				node = node->next;
+				continue;
+			}
+
+			state->wake_serial = wake_serial;
+			async_job_stop_waiting (directory);
+
+			wait_time = g_get_monotonic_time () - state->wait_start;
+			stats = &async_job_stats[priority];
+			stats->delayed += 1;
+			stats->wait_time += wait_time;
+			stats->max_wait_time = MAX (stats->max_wait_time, wait_time);
+
+			nemo_directory_async_state_changed (directory);
+
+			node = async_job_waiting[priority].head;
 		}
-		g_hash_table_remove (waiting_directories, value);
-		nemo_directory_async_state_changed
-			(NEMO_DIRECTORY (value));
 	}
 	already_waking_up = FALSE;
 }
 
+void
+nemo_directory_get_async_job_stats (AsyncJobStats stats[ASYNC_JOB_PRIORITY_LAST])
+{
+	int priority;
+
+	for (priority = 0; priority < ASYNC_JOB_PRIORITY_LAST; priority++) {
+		stats[priority] = async_job_stats[priority];
+		stats[priority].waiting = g_queue_get_length (&async_job_waiting[priority]);
+	}
+}
+
+/* Info and count requests that may be in flight for one directory */
+static guint info_requests_window = 0;
+
+static void
+info_requests_window_changed (void)
+{
+	info_requests_window = g_settings_get_int (nemo_preferences,
+						   NEMO_PREFERENCES_INFO_REQUESTS_PER_FOLDER);
+}
+
+static guint
+get_info_requests_window (void)
+{
+	if (info_requests_window == 0) {
+		g_signal_connect_swapped (nemo_preferences,
+					  "changed::" NEMO_PREFERENCES_INFO_REQUESTS_PER_FOLDER,
+					  G_CALLBACK (info_requests_window_changed), NULL);
+		info_requests_window_changed ();
+	}
+
+	return MAX (info_requests_window, 1);
+}
+
+static void
+emit_pending_file_changes (NemoDirectory *directory)
+{
+	GHashTable *pending;
+	GList *files, *same_directory, *node;
+	NemoFile *file;
+
+	if (directory->details->pending_changed_files_id != 0) {
+		g_source_remove (directory->details->pending_changed_files_id);
+		directory->details->pending_changed_files_id = 0;
+	}
+
+	pending = directory->details->pending_changed_files;
+	directory->details->pending_changed_files = NULL;
+	if (pending == NULL) {
+		return;
+	}
+
+	files = directory->details->pending_changed_queue.head;
+	g_queue_init (&directory->details->pending_changed_queue);
+
+	/* Files may have moved on to another directory meanwhile */
+	same_directory = NULL;
+	for (node = files; node != NULL; node = node->next) {
+		file = node->data;
+		if (file->details->directory == directory &&
+		    !nemo_file_is_self_owned (file)) {
+			same_directory = g_list_prepend (same_directory, file);
+		} else {
+			nemo_file_changed (file);
+		}
+	}
+
+	if (same_directory != NULL) {
+		same_directory = g_list_reverse (same_directory);
+		nemo_directory_emit_change_signals (directory, same_directory);
+		g_list_free (same_directory);
+	}
+
+	g_list_free_full (files, (GDestroyNotify) nemo_file_unref);
+	g_hash_table_destroy (pending);
+}
+
+static gboolean
+emit_pending_file_changes_timeout (gpointer data)
+{
+	NemoDirectory *directory;
+
+	directory = NEMO_DIRECTORY (data);
+	directory->details->pending_changed_files_id = 0;
+
+	emit_pending_file_changes (directory);
+
+	return FALSE;
+}
+
+/* Like nemo_file_changed(), but the signals for files whose info or
+ * count came back at about the same time go out in one batch. They
+ * are sent right away once nothing is in flight anymore.
+ */
+static void
+file_changed_in_batch (NemoDirectory *directory,
+		       NemoFile *file)
+{
+	if (directory->details->pending_changed_files == NULL) {
+		directory->details->pending_changed_files =
+			g_hash_table_new (NULL, NULL);
+	}
+	if (!g_hash_table_contains (directory->details->pending_changed_files, file)) {
+		g_hash_table_add (directory->details->pending_changed_files, file);
+		g_queue_push_tail (&directory->details->pending_changed_queue,
+				   nemo_file_ref (file));
+	}
+
+	if (directory->details->n_get_info_states == 0 &&
+	    directory->details->n_count_states == 0) {
+		emit_pending_file_changes (directory);
+	} else if (directory->details->pending_changed_files_id == 0) {
+		directory->details->pending_changed_files_id =
+			g_timeout_add (PENDING_CHANGES_BATCH_MSEC,
+				       emit_pending_file_changes_timeout, directory);
+	}
+}
+
+static DirectoryCountState *
+directory_count_state_for_file (NemoDirectory *directory,
+				NemoFile *file)
+{
+	DirectoryCountState *state;
+	GList *l;
+
+	for (l = directory->details->count_states; l != NULL; l = l->next) {
+		state = l->data;
+		if (state->count_file == file) {
+			return state;
+		}
+	}
+
+	return NULL;
+}
+
 static void
 directory_count_cancel (NemoDirectory *directory)
 {
-	if (directory->details->count_in_progress != NULL) {
-		g_cancellable_cancel (directory->details->count_in_progress->cancellable);
+	DirectoryCountState *state;
+	GList *l;
+
+	/* The states go away in their callbacks */
+	for (l = directory->details->count_states; l != NULL; l = l->next) {
+		state = l->data;
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -499,7 +1090,7 @@ deep_count_cancel (NemoDirectory *directory)
 		directory->details->deep_count_in_progress = NULL;
 		directory->details->deep_count_file = NULL;
 
-		async_job_end (directory, "deep count");
+		async_job_end (directory, ASYNC_JOB_DEEP_COUNT);
 	}
 }
 
@@ -518,21 +1109,57 @@ link_info_cancel (NemoDirectory *directory)
 		g_cancellable_cancel (directory->details->link_info_read_state->cancellable);
 		directory->details->link_info_read_state->directory = NULL;
 		directory->details->link_info_read_state = NULL;
-		async_job_end (directory, "link info");
+		async_job_end (directory, ASYNC_JOB_LINK_INFO);
 	}
 }
 
+static void
+thumbnail_state_remove (NemoDirectory *directory,
+			ThumbnailState *state)
+{
+	directory->details->thumbnail_states =
+		g_list_remove (directory->details->thumbnail_states, state);
+	directory->details->n_thumbnail_states--;
+}
+
+static void
+thumbnail_state_cancel (ThumbnailState *state)
+{
+	NemoDirectory *directory;
+
+	directory = state->directory;
+
+	g_cancellable_cancel (state->cancellable);
+	thumbnail_state_remove (directory, state);
+	state->directory = NULL;
+	async_job_end (directory, ASYNC_JOB_THUMBNAIL);
+}
+
 static void
 thumbnail_cancel (NemoDirectory *directory)
 {
-	if (directory->details->thumbnail_state != NULL) {
-		g_cancellable_cancel (directory->details->thumbnail_state->cancellable);
-		directory->details->thumbnail_state->directory = NULL;
-		directory->details->thumbnail_state = NULL;
-		async_job_end (directory, "thumbnail");
+	while (directory->details->thumbnail_states != NULL) {
+		thumbnail_state_cancel (directory->details->thumbnail_states->data);
 	}
 }
 
+static ThumbnailState *
+thumbnail_state_for_file (NemoDirectory *directory,
+			  NemoFile *file)
+{
+	ThumbnailState *state;
+	GList *l;
+
+	for (l = directory->details->thumbnail_states; l != NULL; l = l->next) {
+		state = l->data;
+		if (state->file == file) {
+			return state;
+		}
+	}
+
+	return NULL;
+}
+
 static void
 mount_cancel (NemoDirectory *directory)
 {
@@ -540,20 +1167,56 @@ mount_cancel (NemoDirectory *directory)
 		g_cancellable_cancel (directory->details->mount_state->cancellable);
 		directory->details->mount_state->directory = NULL;
 		directory->details->mount_state = NULL;
-		async_job_end (directory, "mount");
+		async_job_end (directory, ASYNC_JOB_MOUNT);
 	}
 }
 
+static GetInfoState *
+get_info_state_for_file (NemoDirectory *directory,
+			 NemoFile *file)
+{
+	GetInfoState *state;
+	GList *l;
+
+	for (l = directory->details->get_info_states; l != NULL; l = l->next) {
+		state = l->data;
+		if (state->file == file) {
+			return state;
+		}
+	}
+
+	return NULL;
+}
+
 static void
-file_info_cancel (NemoDirectory *directory)
+get_info_state_remove (NemoDirectory *directory,
+		       GetInfoState *state)
 {
-	if (directory->details->get_info_in_progress != NULL) {
-		g_cancellable_cancel (directory->details->get_info_in_progress->cancellable);
-		directory->details->get_info_in_progress->directory = NULL;
-		directory->details->get_info_in_progress = NULL;
-		directory->details->get_info_file = NULL;
+	directory->details->get_info_states =
+		g_list_remove (directory->details->get_info_states, state);
+	directory->details->n_get_info_states--;
+}
 
-		async_job_end (directory, "file info");
+static void
+get_info_state_cancel (GetInfoState *state)
+{
+	NemoDirectory *directory;
+
+	directory = state->directory;
+
+	g_cancellable_cancel (state->cancellable);
+	get_info_state_remove (directory, state);
+	state->directory = NULL;
+	state->file = NULL;
+
+	async_job_end_started_at (directory, ASYNC_JOB_FILE_INFO, state->start_time);
+}
+
+static void
+file_info_cancel (NemoDirectory *directory)
+{
+	while (directory->details->get_info_states != NULL) {
+		get_info_state_cancel (directory->details->get_info_states->data);
 	}
 }
 
@@ -775,16 +1438,20 @@ static void
 set_file_unconfirmed (NemoFile *file, gboolean unconfirmed)
 {
 	NemoDirectory *directory;
+	NemoFileTable *table;
 
 	g_assert (NEMO_IS_FILE (file));
 	g_assert (unconfirmed == FALSE || unconfirmed == TRUE);
 
-	if (file->details->unconfirmed == unconfirmed) {
+	directory = file->details->directory;
+	table = directory->details->file_table;
+	if (nemo_file_table_get_flag (table, file->details->file_table_index,
+				      NEMO_FILE_TABLE_FLAG_UNCONFIRMED) == unconfirmed) {
 		return;
 	}
-	file->details->unconfirmed = unconfirmed;
+	nemo_file_table_set_flag (table, file->details->file_table_index,
+				  NEMO_FILE_TABLE_FLAG_UNCONFIRMED, unconfirmed);
 
-	directory = file->details->directory;
 	if (unconfirmed) {
 		directory->details->confirmed_file_count--;
 	} else {
@@ -830,17 +1497,54 @@ should_skip_file (NemoDirectory *directory, GFileInfo *info)
 	return FALSE;
 }
 
+/* Average cost of turning one GFileInfo into a NemoFile, in
+ * nanoseconds. Shared by all directories since it mostly depends on
+ * the machine we run on.
+ */
+static gint64 dequeue_pending_item_cost;
+
+static guint
+dequeue_pending_get_slice_size (void)
+{
+	gint64 items;
+
+	if (dequeue_pending_item_cost == 0) {
+		return DEQUEUE_PENDING_MIN_ITEMS;
+	}
+
+	items = DEQUEUE_PENDING_SLICE_USEC * 1000 / dequeue_pending_item_cost;
+	return CLAMP (items, DEQUEUE_PENDING_MIN_ITEMS, DEQUEUE_PENDING_MAX_ITEMS);
+}
+
+static void
+dequeue_pending_update_item_cost (gint64 elapsed,
+				  guint items)
+{
+	gint64 cost;
+
+	if (items == 0) {
+		return;
+	}
+
+	cost = MAX (elapsed * 1000 / items, 1);
+	if (dequeue_pending_item_cost == 0) {
+		dequeue_pending_item_cost = cost;
+	} else {
+		dequeue_pending_item_cost += (cost - dequeue_pending_item_cost) / 4;
+	}
+}
+
 static gboolean
 dequeue_pending_idle_callback (gpointer callback_data)
 {
 	NemoDirectory *directory;
-	GList *pending_file_info;
-	GList *node, *next;
+	int index;
 	NemoFile *file;
 	GList *changed_files, *added_files;
 	GFileInfo *file_info;
-	const char *mimetype, *name;
-	DirectoryLoadState *dir_load_state;
+	const char *name;
+	guint slice_size, count;
+	gint64 slice_start;
 
 	directory = NEMO_DIRECTORY (callback_data);
 
@@ -848,10 +1552,6 @@ dequeue_pending_idle_callback (gpointer callback_data)
 
 	directory->details->dequeue_pending_idle_id = 0;
 
-	/* Handle the files in the order we saw them. */
-	pending_file_info = g_list_reverse (directory->details->pending_file_info);
-	directory->details->pending_file_info = NULL;
-
 	/* If we are no longer monitoring, then throw away these. */
 	if (!nemo_directory_is_file_list_monitored (directory)) {
 		nemo_directory_async_state_changed (directory);
@@ -861,46 +1561,34 @@ dequeue_pending_idle_callback (gpointer callback_data)
 	added_files = NULL;
 	changed_files = NULL;
 
-	dir_load_state = directory->details->directory_load_in_progress;
-	
+	/* Handle the files in the order we saw them, but only one
+	 * slice at a time so huge directories don't block the UI.
+	 */
+	slice_size = dequeue_pending_get_slice_size ();
+	slice_start = g_get_monotonic_time ();
+
 	/* Build a list of NemoFile objects. */
-	for (node = pending_file_info; node != NULL; node = node->next) {
-		file_info = node->data;
+	for (count = 0; count < slice_size; count++) {
+		file_info = g_queue_pop_head (&directory->details->pending_file_info);
+		if (file_info == NULL) {
+			break;
+		}
 
 		name = g_file_info_get_name (file_info);
 		
-		/* Update the file count. */
-		/* FIXME bugzilla.gnome.org 45063: This could count a
-		 * file twice if we get it from both load_directory
-		 * and from new_files_callback. Not too hard to fix by
-		 * moving this into the actual callback instead of
-		 * waiting for the idle function.
-		 */
-		if (dir_load_state &&
-		    !should_skip_file (directory, file_info)) {
-			dir_load_state->load_file_count += 1;
-
-			/* Add the MIME type to the set. */
-			mimetype = g_file_info_get_content_type (file_info);
-			if (mimetype != NULL) {
-				istr_set_insert (dir_load_state->load_mime_list_hash,
-						 mimetype);
-			}
-		}
-		
 		/* check if the file already exists */
 		file = nemo_directory_find_file_by_name (directory, name);
 		if (file != NULL) {
 			/* file already exists in dir, check if we still need to
 			 *  emit file_added or if it changed */
 			set_file_unconfirmed (file, FALSE);
-			if (!file->details->is_added) {
+			if (!nemo_directory_file_is_added (directory, file)) {
 				/* We consider this newly added even if its in the list.
 				 * This can happen if someone called nemo_file_get_by_uri()
 				 * on a file in the folder before the add signal was
 				 * emitted */
 				nemo_file_ref (file);
-				file->details->is_added = TRUE;
+				nemo_directory_set_file_is_added (directory, file);
 				added_files = g_list_prepend (added_files, file);
 			} else if (nemo_file_update_info (file, file_info)) {
 				/* File changed, notify about the change. */
@@ -911,26 +1599,32 @@ dequeue_pending_idle_callback (gpointer callback_data)
 			/* new file, create a nemo file object and add it to the list */
 			file = nemo_file_new_from_info (directory, file_info);
 			nemo_directory_add_file (directory, file);			
-			file->details->is_added = TRUE;
+			nemo_directory_set_file_is_added (directory, file);
 			added_files = g_list_prepend (added_files, file);
 		}
+
+		g_object_unref (file_info);
 	}
 
+	dequeue_pending_update_item_cost (g_get_monotonic_time () - slice_start, count);
+
 	/* If we are done loading, then we assume that any unconfirmed
-         * files are gone.
+         * files are gone. Only do this once everything we got from
+         * the enumerator has been handled.
 	 */
-	if (directory->details->directory_loaded) {
-		for (node = directory->details->file_list;
-		     node != NULL; node = next) {
-			file = NEMO_FILE (node->data);
-			next = node->next;
-
-			if (file->details->unconfirmed) {
-				nemo_file_ref (file);
-				changed_files = g_list_prepend (changed_files, file);
-				
-				nemo_file_mark_gone (file);
-			}
+	if (directory->details->directory_loaded &&
+	    g_queue_is_empty (&directory->details->pending_file_info)) {
+		for (index = nemo_file_table_find_flag (directory->details->file_table,
+							NEMO_FILE_TABLE_FLAG_UNCONFIRMED, 0);
+		     index >= 0;
+		     index = nemo_file_table_find_flag (directory->details->file_table,
+							NEMO_FILE_TABLE_FLAG_UNCONFIRMED, index + 1)) {
+			file = nemo_file_table_get (directory->details->file_table, index);
+
+			nemo_file_ref (file);
+			changed_files = g_list_prepend (changed_files, file);
+
+			nemo_file_mark_gone (file);
 		}
 	}
 
@@ -940,34 +1634,27 @@ dequeue_pending_idle_callback (gpointer callback_data)
 	nemo_directory_emit_files_added (directory, added_files);
 	nemo_file_list_free (added_files);
 
-	if (directory->details->directory_loaded &&
-	    !directory->details->directory_loaded_sent_notification) {
+	if (!g_queue_is_empty (&directory->details->pending_file_info)) {
+		/* Come back for the next slice. */
+		if (nemo_directory_is_file_list_monitored (directory)) {
+			nemo_directory_schedule_dequeue_pending (directory);
+		}
+	} else if (directory->details->directory_loaded &&
+		   !directory->details->directory_loaded_sent_notification) {
 		/* Send the done_loading signal. */
 		nemo_directory_emit_done_loading (directory);
 
-		if (dir_load_state) {
-			file = dir_load_state->load_directory_file;
-			
-			file->details->directory_count = dir_load_state->load_file_count;
-			file->details->directory_count_is_up_to_date = TRUE;
-			file->details->got_directory_count = TRUE;
-
-			file->details->got_mime_list = TRUE;
-			file->details->mime_list_is_up_to_date = TRUE;
-			g_list_free_full (file->details->mime_list, g_free);
-			file->details->mime_list = istr_set_get_as_list
-				(dir_load_state->load_mime_list_hash);
-
-			nemo_file_changed (file);
-		}
-		
 		nemo_directory_async_state_changed (directory);
 
 		directory->details->directory_loaded_sent_notification = TRUE;
 	}
 
  drain:
-	g_list_free_full (pending_file_info, g_object_unref);
+	if (!nemo_directory_is_file_list_monitored (directory)) {
+		g_queue_foreach (&directory->details->pending_file_info,
+				 (GFunc) g_object_unref, NULL);
+		g_queue_clear (&directory->details->pending_file_info);
+	}
 
 	/* Get the state machine running again. */
 	nemo_directory_async_state_changed (directory);
@@ -1004,9 +1691,8 @@ directory_load_one (NemoDirectory *directory,
 	}
 	
 	/* Arrange for the "loading" part of the work. */
-	g_object_ref (info);
-	directory->details->pending_file_info
-		= g_list_prepend (directory->details->pending_file_info, info);
+	g_queue_push_tail (&directory->details->pending_file_info,
+			   g_object_ref (info));
 	nemo_directory_schedule_dequeue_pending (directory);
 }
 
@@ -1027,7 +1713,7 @@ directory_load_cancel (NemoDirectory *directory)
 		g_cancellable_cancel (state->cancellable);
 		state->directory = NULL;
 		directory->details->directory_load_in_progress = NULL;
-		async_job_end (directory, "file list");
+		async_job_end (directory, ASYNC_JOB_FILE_LIST);
 	}
 }
 
@@ -1041,10 +1727,9 @@ file_list_cancel (NemoDirectory *directory)
 		directory->details->dequeue_pending_idle_id = 0;
 	}
 
-	if (directory->details->pending_file_info != NULL) {
-		g_list_free_full (directory->details->pending_file_info, g_object_unref);
-		directory->details->pending_file_info = NULL;
-	}
+	g_queue_foreach (&directory->details->pending_file_info,
+			 (GFunc) g_object_unref, NULL);
+	g_queue_clear (&directory->details->pending_file_info);
 
 	if (directory->details->hidden_file_hash) {
 		g_hash_table_remove_all (directory->details->hidden_file_hash);
@@ -1055,7 +1740,8 @@ static void
 directory_load_done (NemoDirectory *directory,
 		     GError *error)
 {
-	GList *node;
+	DirectoryLoadState *state;
+	NemoFile *file;
 
 	directory->details->directory_loaded = TRUE;
 	directory->details->directory_loaded_sent_notification = FALSE;
@@ -1067,17 +1753,37 @@ directory_load_done (NemoDirectory *directory,
 		 * they won't be marked "gone" later -- we don't know enough
 		 * about them to know whether they are really gone.
 		 */
-		for (node = directory->details->file_list;
-		     node != NULL; node = node->next) {
-			set_file_unconfirmed (NEMO_FILE (node->data), FALSE);
-		}
+		directory->details->confirmed_file_count +=
+			nemo_file_table_set_flag_all (directory->details->file_table,
+						      NEMO_FILE_TABLE_FLAG_UNCONFIRMED, FALSE);
 
 		nemo_directory_emit_load_error (directory, error);
 	}
 
+	/* The enumerator has told us about every file by now, so the
+	 * counts are final even if some files are still pending.
+	 */
+	state = directory->details->directory_load_in_progress;
+	if (state != NULL) {
+		file = state->load_directory_file;
+
+		file->details->directory_count = state->load_file_count;
+		file->details->directory_count_is_up_to_date = TRUE;
+		file->details->got_directory_count = TRUE;
+
+		file->details->got_mime_list = TRUE;
+		file->details->mime_list_is_up_to_date = TRUE;
+		g_list_free_full (file->details->mime_list, g_free);
+		file->details->mime_list = istr_set_get_as_list
+			(state->load_mime_list_hash);
+
+		nemo_file_changed (file);
+	}
+
 	/* Call the idle function right away. */
 	if (directory->details->dequeue_pending_idle_id != 0) {
 		g_source_remove (directory->details->dequeue_pending_idle_id);
+		directory->details->dequeue_pending_idle_id = 0;
 	}
 	dequeue_pending_idle_callback (directory);
 
@@ -1493,6 +2199,9 @@ nemo_async_destroying_file (NemoFile *file)
 	GList *node, *next;
 	ReadyCallback *callback;
 	Monitor *monitor;
+	ThumbnailState *thumbnail_state;
+	DirectoryCountState *count_state;
+	GetInfoState *get_info_state;
 
 	directory = file->details->directory;
 	changed = FALSE;
@@ -1528,10 +2237,12 @@ nemo_async_destroying_file (NemoFile *file)
 	/* Check if it's a file that's currently being worked on.
 	 * If so, make that NULL so it gets canceled right away.
 	 */
-	if (directory->details->count_in_progress != NULL &&
-	    directory->details->count_in_progress->count_file == file) {
-		directory->details->count_in_progress->count_file = NULL;
-		changed = TRUE;
+	for (node = directory->details->count_states; node != NULL; node = node->next) {
+		count_state = node->data;
+		if (count_state->count_file == file) {
+			count_state->count_file = NULL;
+			changed = TRUE;
+		}
 	}
 	if (directory->details->deep_count_file == file) {
 		directory->details->deep_count_file = NULL;
@@ -1542,9 +2253,12 @@ nemo_async_destroying_file (NemoFile *file)
 		directory->details->mime_list_in_progress->mime_list_file = NULL;
 		changed = TRUE;
 	}
-	if (directory->details->get_info_file == file) {
-		directory->details->get_info_file = NULL;
-		changed = TRUE;
+	for (node = directory->details->get_info_states; node != NULL; node = node->next) {
+		get_info_state = node->data;
+		if (get_info_state->file == file) {
+			get_info_state->file = NULL;
+			changed = TRUE;
+		}
 	}
 	if (directory->details->link_info_read_state != NULL &&
 	    directory->details->link_info_read_state->file == file) {
@@ -1556,10 +2270,12 @@ nemo_async_destroying_file (NemoFile *file)
 		changed = TRUE;
 	}
 
-	if (directory->details->thumbnail_state != NULL &&
-	    directory->details->thumbnail_state->file ==  file) {
-		directory->details->thumbnail_state->file = NULL;
-		changed = TRUE;
+	for (node = directory->details->thumbnail_states; node != NULL; node = node->next) {
+		thumbnail_state = node->data;
+		if (thumbnail_state->file == file) {
+			thumbnail_state->file = NULL;
+			changed = TRUE;
+		}
 	}
 	
 	if (directory->details->mount_state != NULL &&
@@ -1678,14 +2394,18 @@ lacks_mount (NemoFile *file)
 static gboolean
 has_problem (NemoDirectory *directory, NemoFile *file, FileCheck problem)
 {
-	GList *node;
+	NemoFileTable *table;
+	NemoFile *other;
+	guint i;
 
 	if (file != NULL) {
 		return (* problem) (file);
 	}
 
-	for (node = directory->details->file_list; node != NULL; node = node->next) {
-		if ((* problem) (node->data)) {
+	table = directory->details->file_table;
+	for (i = 0; i < nemo_file_table_get_size (table); i++) {
+		other = nemo_file_table_get (table, i);
+		if (other != NULL && (* problem) (other)) {
 			return TRUE;
 		}
 	}
@@ -1893,13 +2613,9 @@ nemo_directory_is_file_list_monitored (NemoDirectory *directory)
 static void
 mark_all_files_unconfirmed (NemoDirectory *directory)
 {
-	GList *node;
-	NemoFile *file;
-
-	for (node = directory->details->file_list; node != NULL; node = node->next) {
-		file = node->data;
-		set_file_unconfirmed (file, TRUE);
-	}
+	directory->details->confirmed_file_count -=
+		nemo_file_table_set_flag_all (directory->details->file_table,
+					      NEMO_FILE_TABLE_FLAG_UNCONFIRMED, TRUE);
 }
 
 static void
@@ -1993,6 +2709,57 @@ directory_load_state_free (DirectoryLoadState *state)
 	g_free (state);
 }
 
+static void more_files_callback (GObject      *source_object,
+				 GAsyncResult *res,
+				 gpointer      user_data);
+
+static void
+directory_load_count_one (DirectoryLoadState *state,
+			  GFileInfo *info)
+{
+	const char *mimetype;
+
+	if (g_file_info_get_name (info) == NULL ||
+	    should_skip_file (state->directory, info)) {
+		return;
+	}
+
+	state->load_file_count += 1;
+
+	/* Add the MIME type to the set. */
+	mimetype = g_file_info_get_content_type (info);
+	if (mimetype != NULL) {
+		istr_set_insert (state->load_mime_list_hash, mimetype);
+	}
+}
+
+/* Ask for the next batch of files, doubling the batch size while
+ * batches come back quickly and halving it when they get slow.
+ */
+static void
+directory_load_next_batch (DirectoryLoadState *state)
+{
+	gint64 now, elapsed;
+
+	now = g_get_monotonic_time ();
+	if (state->batch_start_time != 0) {
+		elapsed = now - state->batch_start_time;
+		if (elapsed < DIRECTORY_LOAD_BATCH_TARGET_USEC) {
+			state->batch_size = MIN (state->batch_size * 2, DIRECTORY_LOAD_MAX_BATCH);
+		} else if (elapsed > 2 * DIRECTORY_LOAD_BATCH_TARGET_USEC) {
+			state->batch_size = MAX (state->batch_size / 2, DIRECTORY_LOAD_FIRST_BATCH);
+		}
+	}
+	state->batch_start_time = now;
+
+	g_file_enumerator_next_files_async (state->enumerator,
+					    state->batch_size,
+					    G_PRIORITY_DEFAULT,
+					    state->cancellable,
+					    more_files_callback,
+					    state);
+}
+
 static void
 more_files_callback (GObject *source_object,
 		     GAsyncResult *res,
@@ -2023,6 +2790,7 @@ more_files_callback (GObject *source_object,
 
 	for (l = files; l != NULL; l = l->next) {
 		info = l->data;
+		directory_load_count_one (state, info);
 		directory_load_one (directory, info);
 		g_object_unref (info);
 	}
@@ -2031,12 +2799,7 @@ more_files_callback (GObject *source_object,
 		directory_load_done (directory, error);
 		directory_load_state_free (state);
 	} else {
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_DEFAULT,
-						    state->cancellable,
-						    more_files_callback,
-						    state);
+		directory_load_next_batch (state);
 	}
 
 	nemo_directory_unref (directory);
@@ -2076,12 +2839,7 @@ enumerate_children_callback (GObject *source_object,
 		return;
 	} else {
 		state->enumerator = enumerator;
-		g_file_enumerator_next_files_async (state->enumerator,
-						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-						    G_PRIORITY_DEFAULT,
-						    state->cancellable,
-						    more_files_callback,
-						    state);
+		directory_load_next_batch (state);
 	}
 }
 
@@ -2095,7 +2853,8 @@ start_monitoring_file_list (NemoDirectory *directory)
 	if (!directory->details->file_list_monitored) {
 		g_assert (!directory->details->directory_load_in_progress);
 		directory->details->file_list_monitored = TRUE;
-		nemo_file_list_ref (directory->details->file_list);
+		nemo_file_table_foreach (directory->details->file_table,
+					 (GFunc) nemo_file_ref, NULL);
 	}
 
 	if (directory->details->directory_loaded  ||
@@ -2103,7 +2862,7 @@ start_monitoring_file_list (NemoDirectory *directory)
 		return;
 	}
 
-	if (!async_job_start (directory, "file list")) {
+	if (!async_job_start (directory, ASYNC_JOB_FILE_LIST)) {
 		return;
 	}
 
@@ -2114,6 +2873,7 @@ start_monitoring_file_list (NemoDirectory *directory)
 	state->cancellable = g_cancellable_new ();
 	state->load_mime_list_hash = istr_set_new ();
 	state->load_file_count = 0;
+	state->batch_size = DIRECTORY_LOAD_FIRST_BATCH;
 	
 	g_assert (directory->details->location != NULL);
         state->load_directory_file =
@@ -2163,7 +2923,8 @@ nemo_directory_stop_monitoring_file_list (NemoDirectory *directory)
 
 	directory->details->file_list_monitored = FALSE;
 	file_list_cancel (directory);
-	nemo_file_list_unref (directory->details->file_list);
+	nemo_file_table_foreach (directory->details->file_table,
+				 (GFunc) nemo_file_unref, NULL);
 	directory->details->directory_loaded = FALSE;
 }
 
@@ -2212,13 +2973,18 @@ static void
 nemo_directory_invalidate_file_attributes (NemoDirectory      *directory,
 					       NemoFileAttributes  file_attributes)
 {
-	GList *node;
+	NemoFileTable *table;
+	NemoFile *file;
+	guint i;
 
 	cancel_loading_attributes (directory, file_attributes);
 
-	for (node = directory->details->file_list; node != NULL; node = node->next) {
-		nemo_file_invalidate_attributes_internal (NEMO_FILE (node->data),
-							      file_attributes);
+	table = directory->details->file_table;
+	for (i = 0; i < nemo_file_table_get_size (table); i++) {
+		file = nemo_file_table_get (table, i);
+		if (file != NULL) {
+			nemo_file_invalidate_attributes_internal (file, file_attributes);
+		}
 	}
 
 	if (directory->details->as_file != NULL) {
@@ -2312,22 +3078,26 @@ is_needy (NemoFile *file,
 static void
 directory_count_stop (NemoDirectory *directory)
 {
+	DirectoryCountState *state;
 	NemoFile *file;
+	GList *node;
+
+	for (node = directory->details->count_states; node != NULL; node = node->next) {
+		state = node->data;
+		file = state->count_file;
 
-	if (directory->details->count_in_progress != NULL) {
-		file = directory->details->count_in_progress->count_file;
 		if (file != NULL) {
 			g_assert (NEMO_IS_FILE (file));
 			g_assert (file->details->directory == directory);
 			if (is_needy (file,
 				      should_get_directory_count_now,
 				      REQUEST_DIRECTORY_COUNT)) {
-				return;
+				continue;
 			}
 		}
 
 		/* The count is not wanted, so stop it. */
-		directory_count_cancel (directory);
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -2349,11 +3119,24 @@ count_non_skipped_files (GList *list)
 }
 
 static void
-count_children_done (NemoDirectory *directory,
-		     NemoFile *count_file,
+directory_count_state_remove (NemoDirectory *directory,
+			      DirectoryCountState *state)
+{
+	directory->details->count_states =
+		g_list_remove (directory->details->count_states, state);
+	directory->details->n_count_states--;
+}
+
+static void
+count_children_done (DirectoryCountState *state,
 		     gboolean succeeded,
 		     int count)
 {
+	NemoDirectory *directory;
+	NemoFile *count_file;
+
+	directory = state->directory;
+	count_file = state->count_file;
 	g_assert (NEMO_IS_FILE (count_file));
 
 	count_file->details->directory_count_is_up_to_date = TRUE;
@@ -2368,15 +3151,15 @@ count_children_done (NemoDirectory *directory,
 		count_file->details->got_directory_count = TRUE;
 		count_file->details->directory_count = count;
 	}
-	directory->details->count_in_progress = NULL;
+	directory_count_state_remove (directory, state);
 
 	/* Send file-changed even if count failed, so interested parties can
 	 * distinguish between unknowable and not-yet-known cases.
 	 */
-	nemo_file_changed (count_file);
+	file_changed_in_batch (directory, count_file);
 
 	/* Start up the next one. */
-	async_job_end (directory, "directory count");
+	async_job_end_started_at (directory, ASYNC_JOB_DIRECTORY_COUNT, state->start_time);
 	nemo_directory_async_state_changed (directory);
 }
 
@@ -2410,9 +3193,9 @@ count_more_files_callback (GObject *source_object,
 	
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
-		directory->details->count_in_progress = NULL;
+		directory_count_state_remove (directory, state);
 
-		async_job_end (directory, "directory count");
+		async_job_end_started_at (directory, ASYNC_JOB_DIRECTORY_COUNT, state->start_time);
 		nemo_directory_async_state_changed (directory);
 		
 		directory_count_state_free (state);
@@ -2420,8 +3203,7 @@ count_more_files_callback (GObject *source_object,
 		return;
 	}
 
-	g_assert (directory->details->count_in_progress != NULL);
-	g_assert (directory->details->count_in_progress == state);
+	g_assert (g_list_find (directory->details->count_states, state) != NULL);
 
 	error = NULL;
 	files = g_file_enumerator_next_files_finish (state->enumerator,
@@ -2430,8 +3212,7 @@ count_more_files_callback (GObject *source_object,
 	state->file_count += count_non_skipped_files (files);
 	
 	if (files == NULL) {
-		count_children_done (directory, state->count_file,
-				     TRUE, state->file_count);
+		count_children_done (state, TRUE, state->file_count);
 		directory_count_state_free (state);
 	} else {
 		g_file_enumerator_next_files_async (state->enumerator,
@@ -2464,9 +3245,9 @@ count_children_callback (GObject *source_object,
 	if (g_cancellable_is_cancelled (state->cancellable)) {
 		/* Operation was cancelled. Bail out */
 		directory = state->directory;
-		directory->details->count_in_progress = NULL;
+		directory_count_state_remove (directory, state);
 
-		async_job_end (directory, "directory count");
+		async_job_end_started_at (directory, ASYNC_JOB_DIRECTORY_COUNT, state->start_time);
 		nemo_directory_async_state_changed (directory);
 		
 		directory_count_state_free (state);
@@ -2479,9 +3260,7 @@ count_children_callback (GObject *source_object,
 							res, &error);
 
 	if (enumerator == NULL) {
-		count_children_done (state->directory,
-				     state->count_file,
-				     FALSE, 0);
+		count_children_done (state, FALSE, 0);
 		g_error_free (error);
 		directory_count_state_free (state);
 		return;
@@ -2497,45 +3276,22 @@ count_children_callback (GObject *source_object,
 }
 
 static void
-directory_count_start (NemoDirectory *directory,
-		       NemoFile *file,
-		       gboolean *doing_io)
+directory_count_state_start (NemoDirectory *directory,
+			     NemoFile *file)
 {
 	DirectoryCountState *state;
 	GFile *location;
 
-	if (directory->details->count_in_progress != NULL) {
-		*doing_io = TRUE;
-		return;
-	}
-
-	if (!is_needy (file, 
-		       should_get_directory_count_now,
-		       REQUEST_DIRECTORY_COUNT)) {
-		return;
-	}
-	*doing_io = TRUE;
-
-	if (!nemo_file_is_directory (file)) {
-		file->details->directory_count_is_up_to_date = TRUE;
-		file->details->directory_count_failed = FALSE;
-		file->details->got_directory_count = FALSE;
-		
-		nemo_directory_async_state_changed (directory);
-		return;
-	}
-
-	if (!async_job_start (directory, "directory count")) {
-		return;
-	}
-
 	/* Start counting. */
 	state = g_new0 (DirectoryCountState, 1);
 	state->count_file = file;
 	state->directory = nemo_directory_ref (directory);
 	state->cancellable = g_cancellable_new ();
+	state->start_time = g_get_monotonic_time ();
 	
-	directory->details->count_in_progress = state;
+	directory->details->count_states =
+		g_list_prepend (directory->details->count_states, state);
+	directory->details->n_count_states++;
 	
 	location = nemo_file_get_location (file);
 #ifdef DEBUG_LOAD_DIRECTORY		
@@ -2559,6 +3315,80 @@ directory_count_start (NemoDirectory *directory,
 	g_object_unref (location);
 }
 
+static void
+directory_count_start (NemoDirectory *directory,
+		       NemoFile *file,
+		       gboolean *doing_io)
+{
+	if (directory_count_state_for_file (directory, file) != NULL) {
+		*doing_io = TRUE;
+		return;
+	}
+
+	if (!is_needy (file, 
+		       should_get_directory_count_now,
+		       REQUEST_DIRECTORY_COUNT)) {
+		return;
+	}
+	*doing_io = TRUE;
+
+	if (!nemo_file_is_directory (file)) {
+		file->details->directory_count_is_up_to_date = TRUE;
+		file->details->directory_count_failed = FALSE;
+		file->details->got_directory_count = FALSE;
+		
+		nemo_directory_async_state_changed (directory);
+		return;
+	}
+
+	if (directory->details->n_count_states >= get_info_requests_window ()) {
+		return;
+	}
+
+	if (!async_job_start (directory, ASYNC_JOB_DIRECTORY_COUNT)) {
+		return;
+	}
+
+	directory_count_state_start (directory, file);
+}
+
+/* While the file at the head of the queue waits for its count, fill
+ * the rest of the window with the folders behind it, so that a slow
+ * filesystem works on several counts at once.
+ */
+static void
+directory_count_start_ahead (NemoDirectory *directory,
+			     NemoFile *file)
+{
+	NemoFile *next;
+	guint window, looked_at;
+
+	window = get_info_requests_window ();
+	looked_at = 0;
+
+	for (next = nemo_file_queue_next (directory->details->low_priority_queue, file);
+	     next != NULL && looked_at < INFO_LOOK_AHEAD_FILES;
+	     next = nemo_file_queue_next (directory->details->low_priority_queue, next), looked_at++) {
+		if (directory->details->n_count_states >= window) {
+			return;
+		}
+
+		if (!nemo_file_is_directory (next) ||
+		    directory_count_state_for_file (directory, next) != NULL ||
+		    !is_needy (next,
+			       should_get_directory_count_now,
+			       REQUEST_DIRECTORY_COUNT)) {
+			continue;
+		}
+
+		if (!async_job_start (directory, ASYNC_JOB_DIRECTORY_COUNT)) {
+			return;
+		}
+
+		directory_count_state_start (directory, next);
+	}
+}
+
 static inline gboolean
 seen_inode (DeepCountState *state,
 	    GFileInfo *info)
@@ -2695,7 +3525,7 @@ deep_count_next_dir (DeepCountState *state)
 
 	if (done) {
 		nemo_file_changed (file);
-		async_job_end (directory, "deep count");
+		async_job_end (directory, ASYNC_JOB_DEEP_COUNT);
 		nemo_directory_async_state_changed (directory);
 	}
 }
@@ -2882,7 +3712,7 @@ deep_count_start (NemoDirectory *directory,
 		return;
 	}
 
-	if (!async_job_start (directory, "deep count")) {
+	if (!async_job_start (directory, ASYNC_JOB_DEEP_COUNT)) {
 		return;
 	}
 
@@ -2982,7 +3812,7 @@ mime_list_done (MimeListState *state, gboolean success)
 	nemo_file_changed (file);
 
 	/* Start up the next one. */
-	async_job_end (directory, "MIME list");
+	async_job_end (directory, ASYNC_JOB_MIME_LIST);
 	nemo_directory_async_state_changed (directory);
 }
 
@@ -3021,7 +3851,7 @@ mime_list_callback (GObject *source_object,
 		/* Operation was cancelled. Bail out */
 		directory->details->mime_list_in_progress = NULL;
 
-		async_job_end (directory, "MIME list");
+		async_job_end (directory, ASYNC_JOB_MIME_LIST);
 		nemo_directory_async_state_changed (directory);
 		
 		mime_list_state_free (state);
@@ -3078,7 +3908,7 @@ list_mime_enum_callback (GObject *source_object,
 		directory = state->directory;
 		directory->details->mime_list_in_progress = NULL;
 
-		async_job_end (directory, "MIME list");
+		async_job_end (directory, ASYNC_JOB_MIME_LIST);
 		nemo_directory_async_state_changed (directory);
 		
 		mime_list_state_free (state);
@@ -3139,7 +3969,7 @@ mime_list_start (NemoDirectory *directory,
 		return;
 	}
 
-	if (!async_job_start (directory, "MIME list")) {
+	if (!async_job_start (directory, ASYNC_JOB_MIME_LIST)) {
 		return;
 	}
 
@@ -3200,11 +4030,10 @@ query_info_callback (GObject *source_object,
 	
 	directory = nemo_directory_ref (state->directory);
 
-	get_info_file = directory->details->get_info_file;
+	get_info_file = state->file;
 	g_assert (NEMO_IS_FILE (get_info_file));
 
-	directory->details->get_info_file = NULL;
-	directory->details->get_info_in_progress = NULL;
+	get_info_state_remove (directory, state);
 	
 	/* ref here because we might be removing the last ref when we
 	 * mark the file gone below, but we need to keep a ref at
@@ -3229,10 +4058,10 @@ query_info_callback (GObject *source_object,
 		g_object_unref (info);
 	}
 
-	nemo_file_changed (get_info_file);
+	file_changed_in_batch (directory, get_info_file);
 	nemo_file_unref (get_info_file);
 
-	async_job_end (directory, "file info");
+	async_job_end_started_at (directory, ASYNC_JOB_FILE_INFO, state->start_time);
 	nemo_directory_async_state_changed (directory);
 
 	nemo_directory_unref (directory);
@@ -3243,48 +4072,35 @@ query_info_callback (GObject *source_object,
 static void
 file_info_stop (NemoDirectory *directory)
 {
+	GetInfoState *state;
 	NemoFile *file;
+	GList *node, *next;
+
+	for (node = directory->details->get_info_states; node != NULL; node = next) {
+		next = node->next;
+		state = node->data;
+		file = state->file;
 
-	if (directory->details->get_info_in_progress != NULL) {
-		file = directory->details->get_info_file;
 		if (file != NULL) {
 			g_assert (NEMO_IS_FILE (file));
 			g_assert (file->details->directory == directory);
 			if (is_needy (file, lacks_info, REQUEST_FILE_INFO)) {
-				return;
+				continue;
 			}
 		}
 
 		/* The info is not wanted, so stop it. */
-		file_info_cancel (directory);
+		get_info_state_cancel (state);
 	}
 }
 
 static void
-file_info_start (NemoDirectory *directory,
-		 NemoFile *file,
-		 gboolean *doing_io)
+get_info_state_start (NemoDirectory *directory,
+		      NemoFile *file)
 {
 	GFile *location;
 	GetInfoState *state;
-	
-	file_info_stop (directory);
-
-	if (directory->details->get_info_in_progress != NULL) {
-		*doing_io = TRUE;
-		return;
-	}
-
-	if (!is_needy (file, lacks_info, REQUEST_FILE_INFO)) {
-		return;
-	}
-	*doing_io = TRUE;
-
-	if (!async_job_start (directory, "file info")) {
-		return;
-	}
 
-	directory->details->get_info_file = file;
 	file->details->get_info_failed = FALSE;
 	if (file->details->get_info_error) {
 		g_error_free (file->details->get_info_error);
@@ -3293,9 +4109,13 @@ file_info_start (NemoDirectory *directory,
 
 	state = g_new (GetInfoState, 1);
 	state->directory = directory;
+	state->file = file;
 	state->cancellable = g_cancellable_new ();
+	state->start_time = g_get_monotonic_time ();
 
-	directory->details->get_info_in_progress = state;
+	directory->details->get_info_states =
+		g_list_prepend (directory->details->get_info_states, state);
+	directory->details->n_get_info_states++;
 	
 	location = nemo_file_get_location (file);
 	g_file_query_info_async (location,
@@ -3306,6 +4126,67 @@ file_info_start (NemoDirectory *directory,
 	g_object_unref (location);
 }
 
+static void
+file_info_start (NemoDirectory *directory,
+		 NemoFile *file,
+		 gboolean *doing_io)
+{
+	file_info_stop (directory);
+
+	if (get_info_state_for_file (directory, file) != NULL) {
+		*doing_io = TRUE;
+		return;
+	}
+
+	if (!is_needy (file, lacks_info, REQUEST_FILE_INFO)) {
+		return;
+	}
+	*doing_io = TRUE;
+
+	if (directory->details->n_get_info_states >= get_info_requests_window ()) {
+		return;
+	}
+
+	if (!async_job_start (directory, ASYNC_JOB_FILE_INFO)) {
+		return;
+	}
+
+	get_info_state_start (directory, file);
+}
+
+/* Like directory_count_start_ahead(), for the info of the files
+ * behind the head of the high priority queue.
+ */
+static void
+file_info_start_ahead (NemoDirectory *directory,
+		       NemoFile *file)
+{
+	NemoFile *next;
+	guint window, looked_at;
+
+	window = get_info_requests_window ();
+	looked_at = 0;
+
+	for (next = nemo_file_queue_next (directory->details->high_priority_queue, file);
+	     next != NULL && looked_at < INFO_LOOK_AHEAD_FILES;
+	     next = nemo_file_queue_next (directory->details->high_priority_queue, next), looked_at++) {
+		if (directory->details->n_get_info_states >= window) {
+			return;
+		}
+
+		if (get_info_state_for_file (directory, next) != NULL ||
+		    !is_needy (next, lacks_info, REQUEST_FILE_INFO)) {
+			continue;
+		}
+
+		if (!async_job_start (directory, ASYNC_JOB_FILE_INFO)) {
+			return;
+		}
+
+		get_info_state_start (directory, next);
+	}
+}
+
 static gboolean
 is_link_trusted (NemoFile *file,
 		 gboolean is_launcher)
@@ -3474,7 +4355,7 @@ link_info_nemo_link_read_callback (GObject *source_object,
 					      NULL, NULL);
 
 	state->directory->details->link_info_read_state = NULL;
-	async_job_end (state->directory, "link info");
+	async_job_end (state->directory, ASYNC_JOB_LINK_INFO);
 	
 	link_info_got_data (state->directory, state->file, result, file_size, file_contents);
 
@@ -3516,7 +4397,7 @@ link_info_start (NemoDirectory *directory,
 	if (!nemo_style_link) {
 		link_info_done (directory, file, NULL, NULL, NULL, FALSE, FALSE);
 	} else {
-		if (!async_job_start (directory, "link info")) {
+		if (!async_job_start (directory, ASYNC_JOB_LINK_INFO)) {
 			g_object_unref (location);
 			return;
 		}
@@ -3584,10 +4465,14 @@ thumbnail_done (NemoDirectory *directory,
 static void
 thumbnail_stop (NemoDirectory *directory)
 {
+	ThumbnailState *state;
 	NemoFile *file;
+	GList *node, *next;
 
-	if (directory->details->thumbnail_state != NULL) {
-		file = directory->details->thumbnail_state->file;
+	for (node = directory->details->thumbnail_states; node != NULL; node = next) {
+		next = node->next;
+		state = node->data;
+		file = state->file;
 
 		if (file != NULL) {
 			g_assert (NEMO_IS_FILE (file));
@@ -3595,12 +4480,12 @@ thumbnail_stop (NemoDirectory *directory)
 			if (is_needy (file,
 				      lacks_thumbnail,
 				      REQUEST_THUMBNAIL)) {
-				return;
+				continue;
 			}
 		}
 
-		/* The link info is not wanted, so stop it. */
-		thumbnail_cancel (directory);
+		/* The thumbnail is not wanted, so stop it. */
+		thumbnail_state_cancel (state);
 	}
 }
 
@@ -3628,6 +4513,8 @@ static void
 thumbnail_state_free (ThumbnailState *state)
 {
 	g_object_unref (state->cancellable);
+	g_clear_object (&state->original_location);
+	g_free (state->thumbnail_path);
 	g_free (state);
 }
 
@@ -3700,58 +4587,94 @@ get_pixbuf_for_content (goffset file_len,
 }
 
 
+static GdkPixbuf *
+thumbnail_load_pixbuf (GFile *location,
+		       GCancellable *cancellable)
+{
+	GdkPixbuf *pixbuf;
+	char *file_contents;
+	gsize file_size;
+
+	pixbuf = NULL;
+	if (g_file_load_contents (location, cancellable,
+				  &file_contents, &file_size,
+				  NULL, NULL)) {
+		pixbuf = get_pixbuf_for_content (file_size, file_contents);
+		g_free (file_contents);
+	}
+
+	return pixbuf;
+}
+
+/* Runs in a GTask worker thread, so reading, decoding and scaling
+ * down the image doesn't hold up the main loop. Only touches the
+ * parts of the state that don't change while it is loading.
+ */
+static void
+thumbnail_load_thread_func (GTask *task,
+			    gpointer source_object,
+			    gpointer task_data,
+			    GCancellable *cancellable)
+{
+	ThumbnailState *state;
+	GdkPixbuf *pixbuf;
+	GFile *location;
+
+	state = task_data;
+	pixbuf = NULL;
+
+	if (state->original_location != NULL) {
+		pixbuf = thumbnail_load_pixbuf (state->original_location, cancellable);
+	}
+
+	if (pixbuf == NULL && state->thumbnail_path != NULL &&
+	    !g_cancellable_is_cancelled (cancellable)) {
+		location = g_file_new_for_path (state->thumbnail_path);
+		pixbuf = thumbnail_load_pixbuf (location, cancellable);
+		g_object_unref (location);
+	}
+
+	g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
 static void
-thumbnail_read_callback (GObject *source_object,
+thumbnail_load_callback (GObject *source_object,
 			 GAsyncResult *res,
 			 gpointer user_data)
 {
 	ThumbnailState *state;
-	gsize file_size;
-	char *file_contents;
-	gboolean result;
 	NemoDirectory *directory;
 	GdkPixbuf *pixbuf;
-	GFile *location;
 
 	state = user_data;
+	pixbuf = g_task_propagate_pointer (G_TASK (res), NULL);
 
 	if (state->directory == NULL) {
 		/* Operation was cancelled. Bail out */
+		if (pixbuf != NULL) {
+			g_object_unref (pixbuf);
+		}
 		thumbnail_state_free (state);
 		return;
 	}
 
 	directory = nemo_directory_ref (state->directory);
 
-	result = g_file_load_contents_finish (G_FILE (source_object),
-					      res,
-					      &file_contents, &file_size,
-					      NULL, NULL);
-
-	pixbuf = NULL;
-	if (result) {
-		pixbuf = get_pixbuf_for_content (file_size, file_contents);
-		g_free (file_contents);
-	}
-	
-	if (pixbuf == NULL && state->trying_original) {
-		state->trying_original = FALSE;
+	thumbnail_state_remove (directory, state);
+	async_job_end (directory, ASYNC_JOB_THUMBNAIL);
 
-		location = g_file_new_for_path (state->file->details->thumbnail_path);
-		g_file_load_contents_async (location,
-					    state->cancellable,
-					    thumbnail_read_callback,
-					    state);
-		g_object_unref (location);
+	if (state->file != NULL) {
+		thumbnail_got_pixbuf (directory, state->file, pixbuf, state->tried_original);
 	} else {
-		state->directory->details->thumbnail_state = NULL;
-		async_job_end (state->directory, "thumbnail");
-		
-		thumbnail_got_pixbuf (state->directory, state->file, pixbuf, state->tried_original);
-	
-		thumbnail_state_free (state);
+		/* The file went away while we were loading */
+		if (pixbuf != NULL) {
+			g_object_unref (pixbuf);
+		}
+		nemo_directory_async_state_changed (directory);
 	}
-	
+
+	thumbnail_state_free (state);
+
 	nemo_directory_unref (directory);
 }
 
@@ -3760,11 +4683,11 @@ thumbnail_start (NemoDirectory *directory,
 		 NemoFile *file,
 		 gboolean *doing_io)
 {
-	GFile *location;
 	ThumbnailState *state;
+	GTask *task;
 
-	if (directory->details->thumbnail_state != NULL) {
-		*doing_io = TRUE;
+	if (thumbnail_state_for_file (directory, file) != NULL) {
+		/* Already on its way, go on with the next file. */
 		return;
 	}
 
@@ -3773,9 +4696,14 @@ thumbnail_start (NemoDirectory *directory,
 		       REQUEST_THUMBNAIL)) {
 		return;
 	}
-	*doing_io = TRUE;
 
-	if (!async_job_start (directory, "thumbnail")) {
+	if (directory->details->n_thumbnail_states >= MAX_THUMBNAIL_LOADS) {
+		*doing_io = TRUE;
+		return;
+	}
+
+	if (!async_job_start (directory, ASYNC_JOB_THUMBNAIL)) {
+		*doing_io = TRUE;
 		return;
 	}
 	
@@ -3783,22 +4711,24 @@ thumbnail_start (NemoDirectory *directory,
 	state->directory = directory;
 	state->file = file;
 	state->cancellable = g_cancellable_new ();
+	state->thumbnail_path = g_strdup (file->details->thumbnail_path);
 
 	if (file->details->thumbnail_wants_original) {
 		state->tried_original = TRUE;
-		state->trying_original = TRUE;
-		location = nemo_file_get_location (file);
-	} else {
-		location = g_file_new_for_path (file->details->thumbnail_path);
+		state->original_location = nemo_file_get_location (file);
 	}
 	
-	directory->details->thumbnail_state = state;
+	directory->details->thumbnail_states =
+		g_list_prepend (directory->details->thumbnail_states, state);
+	directory->details->n_thumbnail_states++;
 
-	g_file_load_contents_async (location,
-				    state->cancellable,
-				    thumbnail_read_callback,
-				    state);
-	g_object_unref (location);
+	/* Unlike the other attributes we don't wait for the thumbnail
+	 * before moving on, so that several load at the same time.
+	 */
+	task = g_task_new (NULL, state->cancellable, thumbnail_load_callback, state);
+	g_task_set_task_data (task, state, NULL);
+	g_task_run_in_thread (task, thumbnail_load_thread_func);
+	g_object_unref (task);
 }
 
 static void
@@ -3840,7 +4770,7 @@ got_mount (MountState *state, GMount *mount)
 	directory = nemo_directory_ref (state->directory);
 
 	state->directory->details->mount_state = NULL;
-	async_job_end (state->directory, "mount");
+	async_job_end (state->directory, ASYNC_JOB_MOUNT);
 	
 	file = nemo_file_ref (state->file);
 
@@ -3950,7 +4880,7 @@ mount_start (NemoDirectory *directory,
 	}
 	*doing_io = TRUE;
 
-	if (!async_job_start (directory, "mount")) {
+	if (!async_job_start (directory, ASYNC_JOB_MOUNT)) {
 		return;
 	}
 	
@@ -3996,7 +4926,7 @@ filesystem_info_cancel (NemoDirectory *directory)
 		g_cancellable_cancel (directory->details->filesystem_info_state->cancellable);
 		directory->details->filesystem_info_state->directory = NULL;
 		directory->details->filesystem_info_state = NULL;
-		async_job_end (directory, "filesystem info");
+		async_job_end (directory, ASYNC_JOB_FILESYSTEM_INFO);
 	}
 }
 
@@ -4041,7 +4971,7 @@ got_filesystem_info (FilesystemInfoState *state, GFileInfo *info)
 	directory = nemo_directory_ref (state->directory);
 
 	state->directory->details->filesystem_info_state = NULL;
-	async_job_end (state->directory, "filesystem info");
+	async_job_end (state->directory, ASYNC_JOB_FILESYSTEM_INFO);
 	
 	file = nemo_file_ref (state->file);
 
@@ -4107,7 +5037,7 @@ filesystem_info_start (NemoDirectory *directory,
 	}
 	*doing_io = TRUE;
 
-	if (!async_job_start (directory, "filesystem info")) {
+	if (!async_job_start (directory, ASYNC_JOB_FILESYSTEM_INFO)) {
 		return;
 	}
 	
@@ -4147,7 +5077,7 @@ extension_info_cancel (NemoDirectory *directory)
 		directory->details->extension_info_provider = NULL;
 		directory->details->extension_info_idle = 0;
 
-		async_job_end (directory, "extension info");
+		async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
 	}
 }
 	
@@ -4203,7 +5133,7 @@ info_provider_idle_callback (gpointer user_data)
 		g_warning ("Unexpected plugin response.  This probably indicates a bug in a Nemo extension: handle=%p", response->handle);
 	} else {
 		NemoFile *file;
-		async_job_end (directory, "extension info");
+		async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
 
 		file = directory->details->extension_info_file;
 
@@ -4258,7 +5188,7 @@ extension_info_start (NemoDirectory *directory,
 	}
 	*doing_io = TRUE;
 
-	if (!async_job_start (directory, "extension info")) {
+	if (!async_job_start (directory, ASYNC_JOB_EXTENSION_INFO)) {
 		return;
 	}
 
@@ -4281,7 +5211,7 @@ extension_info_start (NemoDirectory *directory,
 	if (result == NEMO_OPERATION_COMPLETE ||
 	    result == NEMO_OPERATION_FAILED) {
 		finish_info_provider (directory, file, provider);
-		async_job_end (directory, "extension info");
+		async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
 	} else {
 		directory->details->extension_info_in_progress = handle;
 		directory->details->extension_info_provider = provider;
@@ -4319,6 +5249,7 @@ start_or_stop_io (NemoDirectory *directory)
 		link_info_start (directory, file, &doing_io);
 
 		if (doing_io) {
+			file_info_start_ahead (directory, file);
 			return;
 		}
 
@@ -4338,6 +5269,7 @@ start_or_stop_io (NemoDirectory *directory)
 		filesystem_info_start (directory, file, &doing_io);
 
 		if (doing_io) {
+			directory_count_start_ahead (directory, file);
 			return;
 		}
 
@@ -4408,9 +5340,29 @@ nemo_directory_cancel (NemoDirectory *directory)
 	mount_cancel (directory);
 	filesystem_info_cancel (directory);
 
-	/* We aren't waiting for anything any more. */
-	if (waiting_directories != NULL) {
-		g_hash_table_remove (waiting_directories, directory);
+	if (directory->details->pending_changed_files_id != 0) {
+		g_source_remove (directory->details->pending_changed_files_id);
+		directory->details->pending_changed_files_id = 0;
+	}
+	if (directory->details->pending_changed_files != NULL) {
+		g_hash_table_destroy (directory->details->pending_changed_files);
+		directory->details->pending_changed_files = NULL;
+		g_queue_foreach (&directory->details->pending_changed_queue,
+				 (GFunc) nemo_file_unref, NULL);
+		g_queue_clear (&directory->details->pending_changed_queue);
+	}
+
+	/* We aren't waiting for anything any more. Jobs that only
+	 * end in their callbacks free the state when the last one is
+	 * done.
+	 */
+	async_job_stop_waiting (directory);
+	if (directory->details->async_job_state != NULL) {
+		if (directory->details->async_job_state->running == 0) {
+			async_job_state_free (directory);
+		} else {
+			directory->details->async_job_state->cancelled = TRUE;
+		}
 	}
 
 	/* Check if any directories should wake up. */
@@ -4421,9 +5373,11 @@ static void
 cancel_directory_count_for_file (NemoDirectory *directory,
 				 NemoFile      *file)
 {
-	if (directory->details->count_in_progress != NULL &&
-	    directory->details->count_in_progress->count_file == file) {
-		directory_count_cancel (directory);
+	DirectoryCountState *state;
+
+	state = directory_count_state_for_file (directory, file);
+	if (state != NULL) {
+		g_cancellable_cancel (state->cancellable);
 	}
 }
 
@@ -4450,8 +5404,11 @@ static void
 cancel_file_info_for_file (NemoDirectory *directory,
 			   NemoFile      *file)
 {
-	if (directory->details->get_info_file == file) {
-		file_info_cancel (directory);
+	GetInfoState *state;
+
+	state = get_info_state_for_file (directory, file);
+	if (state != NULL) {
+		get_info_state_cancel (state);
 	}
 }
 
@@ -4459,9 +5416,11 @@ static void
 cancel_thumbnail_for_file (NemoDirectory *directory,
 			   NemoFile      *file)
 {
-	if (directory->details->thumbnail_state != NULL &&
-	    directory->details->thumbnail_state->file == file) {
-		thumbnail_cancel (directory);
+	ThumbnailState *state;
+
+	state = thumbnail_state_for_file (directory, file);
+	if (state != NULL) {
+		thumbnail_state_cancel (state);
 	}
 }
 
@@ -4591,13 +5550,16 @@ nemo_directory_add_file_to_work_queue (NemoDirectory *directory,
 static void
 add_all_files_to_work_queue (NemoDirectory *directory)
 {
-	GList *node;
+	NemoFileTable *table;
 	NemoFile *file;
+	guint i;
 	
-	for (node = directory->details->file_list; node != NULL; node = node->next) {
-		file = NEMO_FILE (node->data);
-
-		nemo_directory_add_file_to_work_queue (directory, file);
+	table = directory->details->file_table;
+	for (i = 0; i < nemo_file_table_get_size (table); i++) {
+		file = nemo_file_table_get (table, i);
+		if (file != NULL) {
+			nemo_directory_add_file_to_work_queue (directory, file);
+		}
 	}
 }
 
@@ -26,6 +26,7 @@
 #include <eel/eel-vfs-extensions.h>
 #include <libnemo-private/nemo-directory.h>
 #include <libnemo-private/nemo-file-queue.h>
+#include <libnemo-private/nemo-file-table.h>
 #include <libnemo-private/nemo-file.h>
 #include <libnemo-private/nemo-monitor.h>
 #include <libnemo-extension/nemo-info-provider.h>
@@ -42,6 +43,7 @@ typedef struct MimeListState MimeListState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct AsyncJobState AsyncJobState;
 
 typedef enum {
 	REQUEST_LINK_INFO,
@@ -64,6 +66,24 @@ typedef gint32 RequestCounter[REQUEST_TYPE_LAST];
 #define REQUEST_WANTS_TYPE(request, type) ((request) & (1<<(type)))
 #define REQUEST_SET_TYPE(request, type) (request) |= (1<<(type))
 
+/* Priority classes for async. jobs, most urgent first. */
+typedef enum {
+	ASYNC_JOB_PRIORITY_FILE_LIST,
+	ASYNC_JOB_PRIORITY_FILE_INFO,
+	ASYNC_JOB_PRIORITY_THUMBNAIL,
+	ASYNC_JOB_PRIORITY_DEEP_COUNT,
+	ASYNC_JOB_PRIORITY_LAST
+} AsyncJobPriority;
+
+typedef struct {
+	guint running;
+	guint waiting;        /* directories queued for a slot */
+	guint64 started;
+	guint64 delayed;      /* times a waiting directory was woken up */
+	gint64 wait_time;     /* total time spent waiting, in microseconds */
+	gint64 max_wait_time;
+} AsyncJobStats;
+
 struct NemoDirectoryDetails
 {
 	/* The location. */
@@ -71,8 +91,8 @@ struct NemoDirectoryDetails
 
 	/* The file objects. */
 	NemoFile *as_file;
-	GList *file_list;
-	GHashTable *file_hash;
+	NemoFileTable *file_table;
+	GHashTable *file_hash; /* name -> NemoFile */
 
 	/* Queues of files needing some I/O done. */
 	NemoFileQueue *high_priority_queue;
@@ -99,28 +119,35 @@ struct NemoDirectoryDetails
 	gboolean directory_loaded_sent_notification;
 	DirectoryLoadState *directory_load_in_progress;
 
-	GList *pending_file_info; /* list of GnomeVFSFileInfo's that are pending */
+	GQueue pending_file_info; /* GFileInfos that are pending, in the order we got them */
 	int confirmed_file_count;
         guint dequeue_pending_idle_id;
 
 	GList *new_files_in_progress; /* list of NewFilesState * */
 
-	DirectoryCountState *count_in_progress;
+	GList *count_states; /* list of DirectoryCountState * */
+	guint n_count_states;
 
 	NemoFile *deep_count_file;
 	DeepCountState *deep_count_in_progress;
 
 	MimeListState *mime_list_in_progress;
 
-	NemoFile *get_info_file;
-	GetInfoState *get_info_in_progress;
+	GList *get_info_states; /* list of GetInfoState * */
+	guint n_get_info_states;
+
+	/* Files whose info or count came back, to be announced together */
+	GHashTable *pending_changed_files; /* set of NemoFile * */
+	GQueue pending_changed_queue; /* ref'ed NemoFile *, in the order they changed */
+	guint pending_changed_files_id;
 
 	NemoFile *extension_info_file;
 	NemoInfoProvider *extension_info_provider;
 	NemoOperationHandle *extension_info_in_progress;
 	guint extension_info_idle;
 
-	ThumbnailState *thumbnail_state;
+	GList *thumbnail_states; /* list of ThumbnailState * */
+	guint n_thumbnail_states;
 
 	MountState *mount_state;
 
@@ -130,6 +157,8 @@ struct NemoDirectoryDetails
 
 	GList *file_operations_in_progress; /* list of FileOperation * */
 
+	AsyncJobState *async_job_state;
+
 	GHashTable *hidden_file_hash;
 };
 
@@ -216,11 +245,15 @@ void               nemo_directory_add_file_monitors               (NemoDirectory
 								       FileMonitors              *monitors);
 void               nemo_directory_add_file                        (NemoDirectory         *directory,
 								       NemoFile              *file);
-GList *            nemo_directory_begin_file_name_change          (NemoDirectory         *directory,
+gboolean           nemo_directory_begin_file_name_change          (NemoDirectory         *directory,
 								       NemoFile              *file);
 void               nemo_directory_end_file_name_change            (NemoDirectory         *directory,
 								       NemoFile              *file,
-								       GList                     *node);
+								       gboolean                   in_hash);
+gboolean           nemo_directory_file_is_added                   (NemoDirectory         *directory,
+								       NemoFile              *file);
+void               nemo_directory_set_file_is_added               (NemoDirectory         *directory,
+								       NemoFile              *file);
 void               nemo_directory_moved                           (const char                *from_uri,
 								       const char                *to_uri);
 /* Interface to the work queue. */
@@ -236,3 +269,4 @@ void               nemo_set_kde_trash_name                        (const char *t
 
 /* debugging functions */
 int                nemo_directory_number_outstanding              (void);
+void               nemo_directory_get_async_job_stats             (AsyncJobStats              stats[ASYNC_JOB_PRIORITY_LAST]);
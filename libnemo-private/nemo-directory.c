@@ -30,6 +30,7 @@
 #include "nemo-file-private.h"
 #include "nemo-file-utilities.h"
 #include "nemo-search-directory.h"
+#include "nemo-search-engine-index.h"
 #include "nemo-global-preferences.h"
 #include "nemo-lib-self-check-functions.h"
 #include "nemo-metadata.h"
@@ -112,6 +113,7 @@ static void
 nemo_directory_init (NemoDirectory *directory)
 {
 	directory->details = G_TYPE_INSTANCE_GET_PRIVATE ((directory), NEMO_TYPE_DIRECTORY, NemoDirectoryDetails);
+	directory->details->file_table = nemo_file_table_new ();
 	directory->details->file_hash = g_hash_table_new (g_str_hash, g_str_equal);
 	directory->details->high_priority_queue = nemo_file_queue_new ();
 	directory->details->low_priority_queue = nemo_file_queue_new ();
@@ -153,7 +155,7 @@ nemo_directory_finalize (GObject *object)
 	g_hash_table_remove (directories, directory->details->location);
 
 	nemo_directory_cancel (directory);
-	g_assert (directory->details->count_in_progress == NULL);
+	g_assert (directory->details->count_states == NULL);
 
 	if (directory->details->monitor_list != NULL) {
 		g_warning ("destroying a NemoDirectory while it's being monitored");
@@ -176,7 +178,8 @@ nemo_directory_finalize (GObject *object)
 		g_object_unref (directory->details->location);
 	}
 
-	g_assert (directory->details->file_list == NULL);
+	g_assert (nemo_file_table_get_length (directory->details->file_table) == 0);
+	nemo_file_table_destroy (directory->details->file_table);
 	g_hash_table_destroy (directory->details->file_hash);
 
 	if (directory->details->hidden_file_hash) {
@@ -187,9 +190,11 @@ nemo_directory_finalize (GObject *object)
 	nemo_file_queue_destroy (directory->details->low_priority_queue);
 	nemo_file_queue_destroy (directory->details->extension_queue);
 	g_assert (directory->details->directory_load_in_progress == NULL);
-	g_assert (directory->details->count_in_progress == NULL);
+	g_assert (directory->details->count_states == NULL);
 	g_assert (directory->details->dequeue_pending_idle_id == 0);
-	g_list_free_full (directory->details->pending_file_info, g_object_unref);
+	g_queue_foreach (&directory->details->pending_file_info,
+			 (GFunc) g_object_unref, NULL);
+	g_queue_clear (&directory->details->pending_file_info);
 
 	G_OBJECT_CLASS (nemo_directory_parent_class)->finalize (object);
 }
@@ -224,7 +229,7 @@ emit_change_signals_for_all_files (NemoDirectory *directory)
 {
 	GList *files;
 
-	files = g_list_copy (directory->details->file_list);
+	files = nemo_file_table_get_list (directory->details->file_table);
 	if (directory->details->as_file != NULL) {
 		files = g_list_prepend (files, directory->details->as_file);
 	}
@@ -558,52 +563,45 @@ nemo_directory_are_all_files_seen (NemoDirectory *directory)
 }
 
 static void
-add_to_hash_table (NemoDirectory *directory, NemoFile *file, GList *node)
+add_to_hash_table (NemoDirectory *directory, NemoFile *file)
 {
 	const char *name;
 
 	name = eel_ref_str_peek (file->details->name);
 
-	g_assert (node != NULL);
 	g_assert (g_hash_table_lookup (directory->details->file_hash,
 				       name) == NULL);
-	g_hash_table_insert (directory->details->file_hash, (char *) name, node);
+	g_hash_table_insert (directory->details->file_hash, (char *) name, file);
 }
 
-static GList *
+static gboolean
 extract_from_hash_table (NemoDirectory *directory, NemoFile *file)
 {
 	const char *name;
-	GList *node;
 
 	name = eel_ref_str_peek (file->details->name);
 	if (name == NULL) {
-		return NULL;
+		return FALSE;
 	}
 
-	/* Find the list node in the hash table. */
-	node = g_hash_table_lookup (directory->details->file_hash, name);
-	g_hash_table_remove (directory->details->file_hash, name);
-
-	return node;
+	return g_hash_table_remove (directory->details->file_hash, name);
 }
 
 void
 nemo_directory_add_file (NemoDirectory *directory, NemoFile *file)
 {
-	GList *node;
 	gboolean add_to_work_queue;
 
 	g_assert (NEMO_IS_DIRECTORY (directory));
 	g_assert (NEMO_IS_FILE (file));
 	g_assert (file->details->name != NULL);
 
-	/* Add to list. */
-	node = g_list_prepend (directory->details->file_list, file);
-	directory->details->file_list = node;
+	/* Add to the table. */
+	file->details->file_table_index =
+		nemo_file_table_add (directory->details->file_table, file);
 
 	/* Add to hash table. */
-	add_to_hash_table (directory, file, node);
+	add_to_hash_table (directory, file);
 
 	directory->details->confirmed_file_count++;
 
@@ -627,65 +625,90 @@ nemo_directory_add_file (NemoDirectory *directory, NemoFile *file)
 void
 nemo_directory_remove_file (NemoDirectory *directory, NemoFile *file)
 {
-	GList *node;
+	guint index;
+	gboolean in_hash;
 
 	g_assert (NEMO_IS_DIRECTORY (directory));
 	g_assert (NEMO_IS_FILE (file));
 	g_assert (file->details->name != NULL);
 
-	/* Find the list node in the hash table. */
-	node = extract_from_hash_table (directory, file);
-	g_assert (node != NULL);
-	g_assert (node->data == file);
+	index = file->details->file_table_index;
+	g_assert (nemo_file_table_get (directory->details->file_table, index) == file);
 
-	/* Remove the item from the list. */
-	directory->details->file_list = g_list_remove_link
-		(directory->details->file_list, node);
-	g_list_free_1 (node);
+	in_hash = extract_from_hash_table (directory, file);
+	g_assert (in_hash);
 
 	nemo_directory_remove_file_from_work_queue (directory, file);
 
-	if (!file->details->unconfirmed) {
+	if (!nemo_file_table_get_flag (directory->details->file_table, index,
+				       NEMO_FILE_TABLE_FLAG_UNCONFIRMED)) {
 		directory->details->confirmed_file_count--;
 	}
 
+	/* Remove the item from the table. */
+	nemo_file_table_remove (directory->details->file_table, index);
+
 	/* Unref if we are monitoring. */
 	if (nemo_directory_is_file_list_monitored (directory)) {
 		nemo_file_unref (file);
 	}
 }
 
-GList *
+gboolean
 nemo_directory_begin_file_name_change (NemoDirectory *directory,
 					   NemoFile *file)
 {
-	/* Find the list node in the hash table. */
+	/* Take the file out of the hash table, its key is changing. */
 	return extract_from_hash_table (directory, file);
 }
 
 void
 nemo_directory_end_file_name_change (NemoDirectory *directory,
 					 NemoFile *file,
-					 GList *node)
+					 gboolean in_hash)
 {
-	/* Add the list node to the hash table. */
-	if (node != NULL) {
-		add_to_hash_table (directory, file, node);
+	/* Put the file back in the hash table under its new name. */
+	if (in_hash) {
+		add_to_hash_table (directory, file);
 	}
 }
 
+/* Whether files_added was emitted for the file yet, so we add it only once. */
+gboolean
+nemo_directory_file_is_added (NemoDirectory *directory,
+				  NemoFile *file)
+{
+	/* The directory-as-file is not in the table, and never added. */
+	if (nemo_file_table_get (directory->details->file_table,
+				 file->details->file_table_index) != file) {
+		return FALSE;
+	}
+
+	return nemo_file_table_get_flag (directory->details->file_table,
+					 file->details->file_table_index,
+					 NEMO_FILE_TABLE_FLAG_ADDED);
+}
+
+void
+nemo_directory_set_file_is_added (NemoDirectory *directory,
+				      NemoFile *file)
+{
+	g_return_if_fail (nemo_file_table_get (directory->details->file_table,
+					       file->details->file_table_index) == file);
+
+	nemo_file_table_set_flag (directory->details->file_table,
+				  file->details->file_table_index,
+				  NEMO_FILE_TABLE_FLAG_ADDED, TRUE);
+}
+
 NemoFile *
 nemo_directory_find_file_by_name (NemoDirectory *directory,
 				      const char *name)
 {
-	GList *node;
-
 	g_return_val_if_fail (NEMO_IS_DIRECTORY (directory), NULL);
 	g_return_val_if_fail (name != NULL, NULL);
 
-	node = g_hash_table_lookup (directory->details->file_hash,
-				    name);
-	return node == NULL ? NULL : NEMO_FILE (node->data);
+	return g_hash_table_lookup (directory->details->file_hash, name);
 }
 
 /* "." for the directory-as-file, otherwise the filename */
@@ -902,6 +925,8 @@ nemo_directory_notify_files_added (GList *files)
 	NemoFile *file;
 	GFile *location, *parent;
 
+	nemo_search_engine_index_invalidate (files);
+
 	/* Make a list of added files in each directory. */
 	added_lists = g_hash_table_new (NULL, NULL);
 
@@ -948,7 +973,7 @@ nemo_directory_notify_files_added (GList *files)
 		 * to the directory by a nemo_file_get() but not gotten 
 		 * files_added emitted
 		 */
-		if (file && file->details->is_added) {
+		if (file && nemo_directory_file_is_added (file->details->directory, file)) {
 			/* A file already exists, it was probably renamed.
 			 * If it was renamed this could be ignored, but 
 			 * queue a change just in case */
@@ -1067,6 +1092,8 @@ nemo_directory_notify_files_removed (GList *files)
 	NemoFile *file;
 	GFile *location;
 
+	nemo_search_engine_index_invalidate_removed (files);
+
 	/* Make a list of changed files in each directory. */
 	changed_lists = g_hash_table_new (NULL, NULL);
 
@@ -1218,7 +1245,7 @@ nemo_directory_moved_internal (GFile *old_location,
 			}
 			affected_files = g_list_concat
 				(affected_files,
-				 nemo_file_list_copy (directory->details->file_list));
+				 nemo_file_list_ref (nemo_file_table_get_list (directory->details->file_table)));
 		}
 		
 		nemo_directory_unref (directory);
@@ -1268,7 +1295,7 @@ nemo_directory_notify_files_moved (GList *file_pairs)
 	NemoFile *file;
 	NemoDirectory *old_directory, *new_directory;
 	GHashTable *parent_directories;
-	GList *new_files_list, *unref_list;
+	GList *new_files_list, *unref_list, *moved_to_locations, *moved_from_locations;
 	GHashTable *added_lists, *changed_lists;
 	char *name;
 	NemoFileAttributes cancel_attributes;
@@ -1279,6 +1306,8 @@ nemo_directory_notify_files_moved (GList *file_pairs)
 	added_lists = g_hash_table_new (NULL, NULL);
 	changed_lists = g_hash_table_new (NULL, NULL);
 	unref_list = NULL;
+	moved_to_locations = NULL;
+	moved_from_locations = NULL;
 
 	/* Make a list of parent directories that will need their counts updated. */
 	parent_directories = g_hash_table_new (NULL, NULL);
@@ -1290,6 +1319,9 @@ nemo_directory_notify_files_moved (GList *file_pairs)
 		from_location = pair->from;
 		to_location = pair->to;
 
+		moved_from_locations = g_list_prepend (moved_from_locations, from_location);
+		moved_to_locations = g_list_prepend (moved_to_locations, to_location);
+
 		/* Handle overwriting a file. */
 		file = nemo_file_get_existing (to_location);
 		if (file != NULL) {
@@ -1362,6 +1394,11 @@ nemo_directory_notify_files_moved (GList *file_pairs)
 		}
 	}
 
+	nemo_search_engine_index_invalidate_removed (moved_from_locations);
+	nemo_search_engine_index_invalidate (moved_to_locations);
+	g_list_free (moved_from_locations);
+	g_list_free (moved_to_locations);
+
 	/* Now send out the changed and added signals for existing file objects. */
 	g_hash_table_foreach (changed_lists, call_files_changed_free_list, NULL);
 	g_hash_table_destroy (changed_lists);
@@ -1559,7 +1596,8 @@ is_tentative (gpointer data, gpointer callback_data)
 	 * will later be sent with the files_added signal, and a
 	 * user doing get_file_list + files_added monitoring will
 	 * then see the file twice */
-	return !file->details->got_file_info || !file->details->is_added;
+	return !file->details->got_file_info ||
+		!nemo_directory_file_is_added (file->details->directory, file);
 }
 
 GList *
@@ -1574,7 +1612,7 @@ real_get_file_list (NemoDirectory *directory)
 	GList *tentative_files, *non_tentative_files;
 
 	tentative_files = eel_g_list_partition
-		(g_list_copy (directory->details->file_list),
+		(nemo_file_table_get_list (directory->details->file_table),
 		 is_tentative, NULL, &non_tentative_files);
 	g_list_free (tentative_files);
 
@@ -1816,7 +1854,7 @@ nemo_self_check_directory (void)
 		gtk_main_iteration ();
 	}
 
-	EEL_CHECK_BOOLEAN_RESULT (directory->details->file_list == NULL, TRUE);
+	EEL_CHECK_INTEGER_RESULT (nemo_file_table_get_length (directory->details->file_table), 0);
 
 	EEL_CHECK_INTEGER_RESULT (g_hash_table_size (directories), 1);
 
@@ -24,6 +24,7 @@
 #include "nemo-file-changes-queue.h"
 
 #include "nemo-directory-notify.h"
+#include "nemo-file.h"
 
 typedef enum {
 	CHANGE_FILE_INITIAL,
@@ -47,8 +48,24 @@ typedef struct {
 	GList *head;
 	GList *tail;
 	GMutex mutex;
+
+	/* Counted to see how much coalescing saves */
+	guint64 n_received;
+	guint64 n_delivered;
 } NemoFileChangesQueue;
 
+/* A folder gets file changes delivered at most once per this interval,
+ * later changes wait until it is over. Only plain changes are held
+ * back, additions, removals and moves always go out right away.
+ */
+#define CHANGE_RATE_LIMIT_INTERVAL (250 * G_TIME_SPAN_MILLISECOND)
+
+/* Folder GFile -> time its files last had changes delivered */
+static GHashTable *directory_change_times;
+/* Set of GFiles whose changes wait for their folder's interval to pass */
+static GHashTable *deferred_changes;
+static guint deferred_changes_timeout_id;
+
 static NemoFileChangesQueue *
 nemo_file_changes_queue_new (void)
 {
@@ -82,7 +99,26 @@ nemo_file_changes_queue_add_common (NemoFileChangesQueue *queue,
 	queue->head = g_list_prepend (queue->head, new_item);
 	if (queue->tail == NULL)
 		queue->tail = queue->head;
+	queue->n_received++;
+
+	g_mutex_unlock (&queue->mutex);
+}
+
+void
+nemo_file_changes_queue_get_stats (guint64 *received,
+				   guint64 *delivered)
+{
+	NemoFileChangesQueue *queue;
 
+	queue = nemo_file_changes_queue_get ();
+
+	g_mutex_lock (&queue->mutex);
+	if (received != NULL) {
+		*received = queue->n_received;
+	}
+	if (delivered != NULL) {
+		*delivered = queue->n_delivered;
+	}
 	g_mutex_unlock (&queue->mutex);
 }
 
@@ -176,31 +212,298 @@ nemo_file_changes_queue_schedule_position_remove (GFile *location)
 	nemo_file_changes_queue_add_common (queue, new_item);
 }
 
-static NemoFileChange *
-nemo_file_changes_queue_get_change (NemoFileChangesQueue *queue)
+/* Returns all queued changes, oldest first */
+static GList *
+nemo_file_changes_queue_take_changes (NemoFileChangesQueue *queue)
 {
-	GList *new_tail;
-	NemoFileChange *result;
+	GList *result;
 
 	g_assert (queue != NULL);
-	
-	/* dequeue the tail item while locking down the list */
+
+	/* dequeue all items while locking down the list */
 	g_mutex_lock (&queue->mutex);
 
-	if (queue->tail == NULL) {
-		result = NULL;
-	} else {
-		new_tail = queue->tail->prev;
-		result = queue->tail->data;
-		queue->head = g_list_remove_link (queue->head,
-						  queue->tail);
-		g_list_free_1 (queue->tail);
-		queue->tail = new_tail;
+	result = queue->head;
+	queue->head = NULL;
+	queue->tail = NULL;
+
+	g_mutex_unlock (&queue->mutex);
+
+	return g_list_reverse (result);
+}
+
+static void
+nemo_file_change_free (NemoFileChange *change)
+{
+	g_object_unref (change->from);
+	if (change->kind == CHANGE_FILE_MOVED) {
+		g_object_unref (change->to);
+	}
+	g_free (change);
+}
+
+/* A move can be reported twice, by the operation that did it and by
+ * the monitors of the folders involved. Once it has been delivered,
+ * the source is unknown and the destination known; moving again
+ * would take the destination for a file being overwritten. Turns
+ * such moves into a change of the destination, which is also right
+ * for a file moved over a known one from a folder nobody looked at.
+ */
+static void
+check_move_already_done (NemoFileChange *change)
+{
+	NemoFile *from_file, *to_file;
+
+	from_file = nemo_file_get_existing (change->from);
+	if (from_file != NULL) {
+		nemo_file_unref (from_file);
+		return;
+	}
+
+	to_file = nemo_file_get_existing (change->to);
+	if (to_file == NULL) {
+		return;
 	}
+	nemo_file_unref (to_file);
+
+	g_object_unref (change->from);
+	change->kind = CHANGE_FILE_CHANGED;
+	change->from = change->to;
+	change->to = NULL;
+}
+
+/* Drops changes to a location that a later change to it makes
+ * redundant: repeated additions, changes and removals, changes right
+ * after the file was added, additions and changes of a file that is
+ * removed again, and the same move reported twice. Removing and then
+ * adding a file is a replacement, and both are kept. Moves and
+ * positions are never merged with anything around them.
+ */
+static GList *
+coalesce_changes (GList *changes)
+{
+	GHashTable *last_changes, *moves, *move_destinations;
+	GList *l, *next, *previous_link;
+	NemoFileChange *change, *previous;
+	gboolean drop_change, drop_previous;
+
+	/* location -> link of the last change to it that was kept */
+	last_changes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	/* source -> move from there */
+	moves = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	move_destinations = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+
+	for (l = changes; l != NULL; l = next) {
+		next = l->next;
+		change = l->data;
+
+		if (change->kind == CHANGE_FILE_MOVED) {
+			previous = g_hash_table_lookup (moves, change->from);
+			if (previous != NULL && g_file_equal (previous->to, change->to)) {
+				changes = g_list_delete_link (changes, l);
+				nemo_file_change_free (change);
+				continue;
+			}
+
+			/* Unless an earlier move in here is what will
+			 * make the source known.
+			 */
+			if (!g_hash_table_contains (move_destinations, change->from)) {
+				check_move_already_done (change);
+			}
+		}
+
+		switch (change->kind) {
+		case CHANGE_FILE_MOVED:
+			g_hash_table_replace (moves, change->from, change);
+			g_hash_table_add (move_destinations, change->to);
+			g_hash_table_remove (last_changes, change->to);
+			g_hash_table_remove (last_changes, change->from);
+			continue;
+		case CHANGE_POSITION_SET:
+		case CHANGE_POSITION_REMOVE:
+			g_hash_table_remove (last_changes, change->from);
+			continue;
+		default:
+			break;
+		}
 
+		previous_link = g_hash_table_lookup (last_changes, change->from);
+		previous = previous_link != NULL ? previous_link->data : NULL;
+
+		drop_change = FALSE;
+		drop_previous = FALSE;
+		if (previous != NULL) {
+			switch (change->kind) {
+			case CHANGE_FILE_ADDED:
+				drop_change = previous->kind == CHANGE_FILE_ADDED;
+				break;
+			case CHANGE_FILE_CHANGED:
+				drop_change = previous->kind == CHANGE_FILE_ADDED ||
+					previous->kind == CHANGE_FILE_CHANGED;
+				break;
+			case CHANGE_FILE_REMOVED:
+				drop_change = previous->kind == CHANGE_FILE_REMOVED;
+				drop_previous = previous->kind == CHANGE_FILE_ADDED ||
+					previous->kind == CHANGE_FILE_CHANGED;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (drop_change) {
+			changes = g_list_delete_link (changes, l);
+			nemo_file_change_free (change);
+			continue;
+		}
+
+		/* Replace the key too, it may belong to the previous change */
+		g_hash_table_replace (last_changes, change->from, l);
+
+		if (drop_previous) {
+			changes = g_list_delete_link (changes, previous_link);
+			nemo_file_change_free (previous);
+		}
+	}
+
+	g_hash_table_destroy (last_changes);
+	g_hash_table_destroy (moves);
+	g_hash_table_destroy (move_destinations);
+
+	return changes;
+}
+
+static gboolean
+deferred_changes_timeout_cb (gpointer user_data)
+{
+	NemoFileChangesQueue *queue;
+	NemoFileChange *change;
+	GHashTableIter iter;
+	GFile *location;
+
+	deferred_changes_timeout_id = 0;
+
+	queue = nemo_file_changes_queue_get ();
+
+	/* Not counted as received again */
+	g_mutex_lock (&queue->mutex);
+	g_hash_table_iter_init (&iter, deferred_changes);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &location, NULL)) {
+		change = g_new0 (NemoFileChange, 1);
+		change->kind = CHANGE_FILE_CHANGED;
+		change->from = g_object_ref (location);
+
+		queue->head = g_list_prepend (queue->head, change);
+		if (queue->tail == NULL) {
+			queue->tail = queue->head;
+		}
+	}
 	g_mutex_unlock (&queue->mutex);
 
-	return result;
+	g_hash_table_remove_all (deferred_changes);
+
+	nemo_file_changes_consume_changes (TRUE);
+
+	return FALSE;
+}
+
+static gboolean
+directory_change_time_expired (gpointer key,
+			       gpointer value,
+			       gpointer user_data)
+{
+	gint64 *now = user_data;
+
+	return *now - *(gint64 *) value >= CHANGE_RATE_LIMIT_INTERVAL;
+}
+
+/* Holds back changes to files in folders that had changes delivered
+ * less than CHANGE_RATE_LIMIT_INTERVAL ago, merging repeated ones.
+ */
+static GList *
+defer_rate_limited_changes (GList *changes)
+{
+	GHashTable *delivered_directories;
+	GHashTableIter iter;
+	GList *l, *next;
+	NemoFileChange *change;
+	GFile *parent;
+	gint64 now, *last_time;
+
+	if (directory_change_times == NULL) {
+		directory_change_times = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+								g_object_unref, g_free);
+		deferred_changes = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+							  g_object_unref, NULL);
+	}
+
+	now = g_get_monotonic_time ();
+	g_hash_table_foreach_remove (directory_change_times,
+				     directory_change_time_expired, &now);
+
+	delivered_directories = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+						       g_object_unref, NULL);
+
+	for (l = changes; l != NULL; l = next) {
+		next = l->next;
+		change = l->data;
+
+		if (change->kind == CHANGE_FILE_REMOVED ||
+		    change->kind == CHANGE_FILE_MOVED) {
+			/* Nothing left to change */
+			g_hash_table_remove (deferred_changes, change->from);
+			continue;
+		}
+
+		if (change->kind != CHANGE_FILE_CHANGED) {
+			continue;
+		}
+
+		parent = g_file_get_parent (change->from);
+		if (parent == NULL) {
+			continue;
+		}
+
+		if (g_hash_table_contains (directory_change_times, parent) ||
+		    g_hash_table_contains (deferred_changes, change->from)) {
+			g_hash_table_add (deferred_changes, g_object_ref (change->from));
+			changes = g_list_delete_link (changes, l);
+			nemo_file_change_free (change);
+			g_object_unref (parent);
+		} else {
+			g_hash_table_add (delivered_directories, parent);
+		}
+	}
+
+	/* The folders count from now on, not while walking the list, so
+	 * that all the changes that came in together go out together.
+	 */
+	g_hash_table_iter_init (&iter, delivered_directories);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &parent, NULL)) {
+		last_time = g_new (gint64, 1);
+		*last_time = now;
+		g_hash_table_replace (directory_change_times, g_object_ref (parent), last_time);
+	}
+	g_hash_table_destroy (delivered_directories);
+
+	if (g_hash_table_size (deferred_changes) > 0 &&
+	    deferred_changes_timeout_id == 0) {
+		deferred_changes_timeout_id =
+			g_timeout_add (CHANGE_RATE_LIMIT_INTERVAL / G_TIME_SPAN_MILLISECOND,
+				       deferred_changes_timeout_cb, NULL);
+	}
+
+	return changes;
+}
+
+static void
+count_delivered (NemoFileChangesQueue *queue,
+		 GList *list)
+{
+	g_mutex_lock (&queue->mutex);
+	queue->n_delivered += g_list_length (list);
+	g_mutex_unlock (&queue->mutex);
 }
 
 enum {
@@ -247,6 +550,7 @@ void
 nemo_file_changes_consume_changes (gboolean consume_all)
 {
 	NemoFileChange *change;
+	GList *queued, *next_change;
 	GList *additions, *changes, *deletions, *moves;
 	GList *position_set_requests;
 	GFilePair *pair;
@@ -263,6 +567,11 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 	position_set_requests = NULL;
 
 	queue = nemo_file_changes_queue_get();
+
+	queued = nemo_file_changes_queue_take_changes (queue);
+	queued = coalesce_changes (queued);
+	queued = defer_rate_limited_changes (queued);
+	next_change = queued;
 		
 	/* Consume changes from the queue, stuffing them into one of three lists,
 	 * keep doing it while the changes are of the same kind, then send them off.
@@ -270,7 +579,12 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 	 * arrived.
 	 */
 	for (chunk_count = 0; ; chunk_count++) {
-		change = nemo_file_changes_queue_get_change (queue);
+		if (next_change != NULL) {
+			change = next_change->data;
+			next_change = next_change->next;
+		} else {
+			change = NULL;
+		}
 
 		/* figure out if we need to flush the pending changes that we collected sofar */
 
@@ -312,24 +626,28 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 			
 			if (deletions != NULL) {
 				deletions = g_list_reverse (deletions);
+				count_delivered (queue, deletions);
 				nemo_directory_notify_files_removed (deletions);
 				g_list_free_full (deletions, g_object_unref);
 				deletions = NULL;
 			}
 			if (moves != NULL) {
 				moves = g_list_reverse (moves);
+				count_delivered (queue, moves);
 				nemo_directory_notify_files_moved (moves);
 				pairs_list_free (moves);
 				moves = NULL;
 			}
 			if (additions != NULL) {
 				additions = g_list_reverse (additions);
+				count_delivered (queue, additions);
 				nemo_directory_notify_files_added (additions);
 				g_list_free_full (additions, g_object_unref);
 				additions = NULL;
 			}
 			if (changes != NULL) {
 				changes = g_list_reverse (changes);
+				count_delivered (queue, changes);
 				nemo_directory_notify_files_changed (changes);
 				g_list_free_full (changes, g_object_unref);
 				changes = NULL;
@@ -337,6 +655,7 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 			if (position_set_requests != NULL) {
                 g_printerr ("length: %d\n", g_list_length (position_set_requests));
 				position_set_requests = g_list_reverse (position_set_requests);
+				count_delivered (queue, position_set_requests);
 				nemo_directory_schedule_position_set (position_set_requests);
 				position_set_list_free (position_set_requests);
 				position_set_requests = NULL;
@@ -345,6 +664,7 @@ nemo_file_changes_consume_changes (gboolean consume_all)
 
 		if (change == NULL) {
 			/* we are done */
+			g_list_free (queued);
 			return;
 		}
 		
@@ -38,5 +38,9 @@ void nemo_file_changes_queue_schedule_position_remove        (GFile      *locati
 
 void nemo_file_changes_consume_changes                       (gboolean    consume_all);
 
+/* Changes queued since startup, and how many were left after merging */
+void nemo_file_changes_queue_get_stats                       (guint64    *received,
+								  guint64    *delivered);
+
 
 #endif /* NEMO_FILE_CHANGES_QUEUE_H */
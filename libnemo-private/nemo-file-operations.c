@@ -34,7 +34,11 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdlib.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 
 #include "nemo-file-operations.h"
 
@@ -60,6 +64,7 @@
 #include "nemo-desktop-link-monitor.h"
 #include "nemo-global-preferences.h"
 #include "nemo-link.h"
+#include "nemo-local-copy.h"
 #include "nemo-desktop-utils.h"
 #include "nemo-trash-monitor.h"
 #include "nemo-file-utilities.h"
@@ -101,6 +106,8 @@ typedef struct {
 	gboolean delete_all;
 } CommonJob;
 
+typedef struct SourceScanner SourceScanner;
+
 typedef struct {
 	CommonJob common;
 	gboolean is_move;
@@ -114,6 +121,10 @@ typedef struct {
 	gchar *target_name;
 	NemoCopyCallback  done_callback;
 	gpointer done_callback_data;
+	/* Still counting the sources while we copy, or NULL */
+	SourceScanner *scanner;
+	/* What the free space was checked against */
+	goffset verified_size;
 } CopyMoveJob;
 
 typedef struct {
@@ -184,6 +195,11 @@ typedef struct {
 } TransferInfo;
 
 #define SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE 8
+
+/* How long a copy waits for the sources to be counted before it starts
+ * copying and lets the counting go on alongside.
+ */
+#define SCAN_HEAD_START_USEC (2 * G_TIME_SPAN_SECOND)
 #define NSEC_PER_MICROSEC 1000
 
 #define MAXIMUM_DISPLAYED_FILE_NAME_LENGTH 50
@@ -1615,6 +1631,283 @@ static void delete_file (CommonJob *job, GFile *file,
 			 TransferInfo *transfer_info,
 			 gboolean toplevel);
 
+/* Local folders are emptied by a few threads working on fds with
+ * openat() and unlinkat(), handing subfolders to each other while some
+ * of them are idle. Whatever they can't remove is left in place for
+ * delete_dir(), which then reports it like it always did.
+ */
+#define MAX_LOCAL_DELETE_THREADS 4
+
+typedef struct {
+	GMutex lock;
+	GCond cond;
+	gboolean done;
+	gint n_deleted;
+	GCancellable *cancellable;
+} LocalDelete;
+
+typedef struct DeleteNode DeleteNode;
+
+struct DeleteNode {
+	LocalDelete *local_delete;
+	DeleteNode *parent;
+	/* The folder is name inside parent_fd, a dup of the fd the parent
+	 * was read through, so it is found again even if the tree above
+	 * it is renamed in the meantime. The top folder is opened by its
+	 * path, with parent_fd set to AT_FDCWD.
+	 */
+	int parent_fd;
+	char *name;
+	/* The scan of this folder, plus one per subfolder handed off */
+	gint pending;
+	gint failed;
+};
+
+static GThreadPool *get_local_delete_pool (void);
+
+static DeleteNode *
+delete_node_new (LocalDelete *local_delete,
+		 DeleteNode *parent,
+		 int parent_fd,
+		 char *name)
+{
+	DeleteNode *node;
+
+	node = g_new0 (DeleteNode, 1);
+	node->local_delete = local_delete;
+	node->parent = parent;
+	node->parent_fd = parent_fd;
+	node->name = name;
+	node->pending = 1;
+
+	if (parent != NULL) {
+		g_atomic_int_inc (&parent->pending);
+	}
+
+	return node;
+}
+
+/* Removes a folder once it and everything handed off from it is done,
+ * and so on up the tree.
+ */
+static void
+delete_node_finish (DeleteNode *node)
+{
+	DeleteNode *parent;
+	LocalDelete *local_delete;
+
+	while (node != NULL &&
+	       g_atomic_int_dec_and_test (&node->pending)) {
+		parent = node->parent;
+		local_delete = node->local_delete;
+
+		if (parent != NULL) {
+			if (!g_atomic_int_get (&node->failed) &&
+			    unlinkat (node->parent_fd, node->name, AT_REMOVEDIR) == 0) {
+				g_atomic_int_inc (&local_delete->n_deleted);
+			} else {
+				g_atomic_int_set (&parent->failed, TRUE);
+			}
+		} else {
+			/* The folder itself is left to delete_dir() */
+			g_mutex_lock (&local_delete->lock);
+			local_delete->done = TRUE;
+			g_cond_signal (&local_delete->cond);
+			g_mutex_unlock (&local_delete->lock);
+		}
+
+		if (node->parent_fd >= 0) {
+			close (node->parent_fd);
+		}
+		g_free (node->name);
+		g_free (node);
+		node = parent;
+	}
+}
+
+/* Empties the folder open as dir_fd, which is closed afterwards.
+ * Subfolders are handed to the pool when node is set and there is room
+ * for them, and are emptied right here otherwise.
+ */
+static gboolean
+empty_dir_at (LocalDelete *local_delete,
+	      DeleteNode *node,
+	      int dir_fd)
+{
+	GThreadPool *pool;
+	DIR *dir;
+	struct dirent *entry;
+	struct stat statbuf;
+	gboolean is_dir, res;
+	int child_fd, parent_fd;
+
+	dir = fdopendir (dir_fd);
+	if (dir == NULL) {
+		close (dir_fd);
+		return FALSE;
+	}
+
+	pool = get_local_delete_pool ();
+	res = TRUE;
+
+	for (;;) {
+		if (g_cancellable_is_cancelled (local_delete->cancellable)) {
+			res = FALSE;
+			break;
+		}
+
+		errno = 0;
+		entry = readdir (dir);
+		if (entry == NULL) {
+			if (errno != 0) {
+				res = FALSE;
+			}
+			break;
+		}
+
+		if (strcmp (entry->d_name, ".") == 0 ||
+		    strcmp (entry->d_name, "..") == 0) {
+			continue;
+		}
+
+		if (entry->d_type == DT_UNKNOWN) {
+			is_dir = fstatat (dirfd (dir), entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0 &&
+				S_ISDIR (statbuf.st_mode);
+		} else {
+			is_dir = entry->d_type == DT_DIR;
+		}
+
+		if (!is_dir) {
+			if (unlinkat (dirfd (dir), entry->d_name, 0) == 0) {
+				g_atomic_int_inc (&local_delete->n_deleted);
+			} else {
+				res = FALSE;
+			}
+			continue;
+		}
+
+		if (node != NULL &&
+		    g_thread_pool_unprocessed (pool) < (guint) g_thread_pool_get_max_threads (pool)) {
+			parent_fd = fcntl (dirfd (dir), F_DUPFD_CLOEXEC, 0);
+			if (parent_fd >= 0) {
+				g_thread_pool_push (pool,
+						    delete_node_new (local_delete, node, parent_fd,
+								     g_strdup (entry->d_name)),
+						    NULL);
+				continue;
+			}
+		}
+
+		child_fd = openat (dirfd (dir), entry->d_name,
+				   O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		if (child_fd >= 0 &&
+		    empty_dir_at (local_delete, NULL, child_fd) &&
+		    unlinkat (dirfd (dir), entry->d_name, AT_REMOVEDIR) == 0) {
+			g_atomic_int_inc (&local_delete->n_deleted);
+		} else {
+			res = FALSE;
+		}
+	}
+
+	closedir (dir);
+
+	return res;
+}
+
+static void
+local_delete_thread_func (gpointer data,
+			  gpointer user_data)
+{
+	DeleteNode *node;
+	int fd;
+
+	node = data;
+
+	fd = openat (node->parent_fd, node->name,
+		     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0 ||
+	    !empty_dir_at (node->local_delete, node, fd)) {
+		g_atomic_int_set (&node->failed, TRUE);
+	}
+
+	delete_node_finish (node);
+}
+
+static GThreadPool *
+get_local_delete_pool (void)
+{
+	static gsize pool = 0;
+
+	if (g_once_init_enter (&pool)) {
+		GThreadPool *new_pool;
+
+		new_pool = g_thread_pool_new (local_delete_thread_func, NULL,
+					      CLAMP (g_get_num_processors (), 1, MAX_LOCAL_DELETE_THREADS),
+					      FALSE, NULL);
+		g_once_init_leave (&pool, (gsize) new_pool);
+	}
+
+	return (GThreadPool *) pool;
+}
+
+static void
+update_local_delete_progress (CommonJob *job,
+			      LocalDelete *local_delete,
+			      SourceInfo *source_info,
+			      TransferInfo *transfer_info)
+{
+	int n_deleted;
+
+	n_deleted = g_atomic_int_get (&local_delete->n_deleted);
+	g_atomic_int_add (&local_delete->n_deleted, -n_deleted);
+
+	if (n_deleted > 0) {
+		transfer_info->num_files += n_deleted;
+		report_delete_progress (job, source_info, transfer_info);
+	}
+}
+
+static void
+delete_dir_contents_locally (CommonJob *job,
+			     GFile *dir,
+			     SourceInfo *source_info,
+			     TransferInfo *transfer_info)
+{
+	LocalDelete local_delete;
+	char *path;
+	gint64 end_time;
+
+	path = g_file_get_path (dir);
+	if (path == NULL) {
+		return;
+	}
+
+	g_mutex_init (&local_delete.lock);
+	g_cond_init (&local_delete.cond);
+	local_delete.done = FALSE;
+	local_delete.n_deleted = 0;
+	local_delete.cancellable = job->cancellable;
+
+	g_thread_pool_push (get_local_delete_pool (),
+			    delete_node_new (&local_delete, NULL, AT_FDCWD, path), NULL);
+
+	g_mutex_lock (&local_delete.lock);
+	while (!local_delete.done) {
+		end_time = g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND;
+		if (!g_cond_wait_until (&local_delete.cond, &local_delete.lock, end_time)) {
+			g_mutex_unlock (&local_delete.lock);
+			update_local_delete_progress (job, &local_delete, source_info, transfer_info);
+			g_mutex_lock (&local_delete.lock);
+		}
+	}
+	g_mutex_unlock (&local_delete.lock);
+
+	update_local_delete_progress (job, &local_delete, source_info, transfer_info);
+
+	g_mutex_clear (&local_delete.lock);
+	g_cond_clear (&local_delete.cond);
+}
+
 static void
 delete_dir (CommonJob *job, GFile *dir,
 	    gboolean *skipped_file,
@@ -1632,6 +1925,11 @@ delete_dir (CommonJob *job, GFile *dir,
 	gboolean local_skipped_file;
 
 	local_skipped_file = FALSE;
+
+	/* Files the user chose to skip have to be looked at one by one */
+	if (toplevel && job->skip_files == NULL && g_file_is_native (dir)) {
+		delete_dir_contents_locally (job, dir, source_info, transfer_info);
+	}
 	
 	skip_error = should_skip_readdir_error (job, dir);
  retry:
@@ -2876,6 +3174,223 @@ scan_sources (GList *files,
 	report_count_progress (job, source_info);
 }
 
+/* Counts the sources of a copy in a thread of its own, so that copying
+ * big trees doesn't have to wait for all of them to be counted first.
+ * It never asks the user anything; the copy reports any errors itself
+ * when it gets to them.
+ */
+struct SourceScanner {
+	GThread *thread;
+	GCancellable *cancellable;
+	GList *files;
+
+	GMutex lock;
+	GCond cond;
+	int num_files;
+	goffset num_bytes;
+	gboolean done;
+};
+
+#define SCANNER_FLUSH_FILES 64
+
+static void
+source_scanner_add (SourceScanner *scanner,
+		    int num_files,
+		    goffset num_bytes)
+{
+	g_mutex_lock (&scanner->lock);
+	scanner->num_files += num_files;
+	scanner->num_bytes += num_bytes;
+	g_mutex_unlock (&scanner->lock);
+}
+
+static gpointer
+source_scanner_thread_func (gpointer user_data)
+{
+	SourceScanner *scanner;
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	GQueue dirs = G_QUEUE_INIT;
+	GFile *dir;
+	GList *l, *children;
+	int num_files;
+	goffset num_bytes;
+
+	scanner = user_data;
+
+	for (l = scanner->files; l != NULL; l = l->next) {
+		info = g_file_query_info (l->data,
+					  G_FILE_ATTRIBUTE_STANDARD_TYPE","
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  scanner->cancellable,
+					  NULL);
+		if (info == NULL) {
+			continue;
+		}
+
+		source_scanner_add (scanner, 1, g_file_info_get_size (info));
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			g_queue_push_tail (&dirs, g_object_ref (l->data));
+		}
+		g_object_unref (info);
+	}
+
+	/* Depth-first, in the order the copy goes */
+	while (!g_cancellable_is_cancelled (scanner->cancellable) &&
+	       (dir = g_queue_pop_head (&dirs)) != NULL) {
+		enumerator = g_file_enumerate_children (dir,
+							G_FILE_ATTRIBUTE_STANDARD_NAME","
+							G_FILE_ATTRIBUTE_STANDARD_TYPE","
+							G_FILE_ATTRIBUTE_STANDARD_SIZE,
+							G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+							scanner->cancellable,
+							NULL);
+		if (enumerator != NULL) {
+			num_files = 0;
+			num_bytes = 0;
+			children = NULL;
+			while ((info = g_file_enumerator_next_file (enumerator, scanner->cancellable, NULL)) != NULL) {
+				num_files += 1;
+				num_bytes += g_file_info_get_size (info);
+
+				if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+					children = g_list_prepend (children,
+								   g_file_get_child (dir, g_file_info_get_name (info)));
+				}
+				g_object_unref (info);
+
+				if (num_files >= SCANNER_FLUSH_FILES) {
+					source_scanner_add (scanner, num_files, num_bytes);
+					num_files = 0;
+					num_bytes = 0;
+				}
+			}
+			source_scanner_add (scanner, num_files, num_bytes);
+
+			/* The list is in reverse, so the first child ends
+			 * up at the head of the queue. */
+			for (l = children; l != NULL; l = l->next) {
+				g_queue_push_head (&dirs, l->data);
+			}
+			g_list_free (children);
+
+			g_file_enumerator_close (enumerator, NULL, NULL);
+			g_object_unref (enumerator);
+		}
+		g_object_unref (dir);
+	}
+
+	g_queue_foreach (&dirs, (GFunc) g_object_unref, NULL);
+	g_queue_clear (&dirs);
+
+	g_mutex_lock (&scanner->lock);
+	scanner->done = TRUE;
+	g_cond_broadcast (&scanner->cond);
+	g_mutex_unlock (&scanner->lock);
+
+	return NULL;
+}
+
+static SourceScanner *
+source_scanner_new (GList *files)
+{
+	SourceScanner *scanner;
+
+	scanner = g_new0 (SourceScanner, 1);
+	scanner->cancellable = g_cancellable_new ();
+	scanner->files = g_list_copy (files);
+	g_list_foreach (scanner->files, (GFunc) g_object_ref, NULL);
+	g_mutex_init (&scanner->lock);
+	g_cond_init (&scanner->cond);
+
+	scanner->thread = g_thread_new ("nemo-copy-scan",
+					source_scanner_thread_func,
+					scanner);
+
+	return scanner;
+}
+
+static void
+source_scanner_free (SourceScanner *scanner)
+{
+	g_cancellable_cancel (scanner->cancellable);
+	g_thread_join (scanner->thread);
+
+	g_list_free_full (scanner->files, g_object_unref);
+	g_object_unref (scanner->cancellable);
+	g_mutex_clear (&scanner->lock);
+	g_cond_clear (&scanner->cond);
+	g_free (scanner);
+}
+
+/* Copies what has been counted so far into source_info, and returns
+ * whether that is all of it.
+ */
+static gboolean
+source_scanner_sync (SourceScanner *scanner,
+		     SourceInfo *source_info)
+{
+	gboolean done;
+
+	g_mutex_lock (&scanner->lock);
+	source_info->num_files = scanner->num_files;
+	source_info->num_bytes = scanner->num_bytes;
+	done = scanner->done;
+	g_mutex_unlock (&scanner->lock);
+
+	return done;
+}
+
+/* Counts the sources like scan_sources() does, but gives up waiting
+ * after SCAN_HEAD_START_USEC. If the counting isn't done by then, the
+ * scanner is returned so the copy can start while it goes on.
+ */
+static SourceScanner *
+scan_sources_with_head_start (GList *files,
+			      SourceInfo *source_info,
+			      CommonJob *job,
+			      OpKind kind)
+{
+	SourceScanner *scanner;
+	gint64 deadline, wait_until;
+	gboolean done;
+
+	memset (source_info, 0, sizeof (SourceInfo));
+	source_info->op = kind;
+
+	report_count_progress (job, source_info);
+
+	scanner = source_scanner_new (files);
+	deadline = g_get_monotonic_time () + SCAN_HEAD_START_USEC;
+
+	g_mutex_lock (&scanner->lock);
+	while (!scanner->done && !job_aborted (job)) {
+		wait_until = MIN (deadline, g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+		if (!g_cond_wait_until (&scanner->cond, &scanner->lock, wait_until) &&
+		    wait_until == deadline) {
+			break;
+		}
+
+		source_info->num_files = scanner->num_files;
+		source_info->num_bytes = scanner->num_bytes;
+		g_mutex_unlock (&scanner->lock);
+		report_count_progress (job, source_info);
+		g_mutex_lock (&scanner->lock);
+	}
+	g_mutex_unlock (&scanner->lock);
+
+	done = source_scanner_sync (scanner, source_info);
+	report_count_progress (job, source_info);
+
+	if (done || job_aborted (job)) {
+		source_scanner_free (scanner);
+		return NULL;
+	}
+
+	return scanner;
+}
+
 static void
 verify_destination (CommonJob *job,
 		    GFile *dest,
@@ -3035,6 +3550,37 @@ verify_destination (CommonJob *job,
 	g_object_unref (fsinfo);
 }
 
+/* The free space was checked against what the scanner had counted
+ * when the copy started. Once everything is counted, check it again
+ * for what is left to copy. This can ask the user, so only call it
+ * between files, never while one is being copied.
+ */
+static void
+verify_remaining_space (CopyMoveJob *copy_job,
+			SourceInfo *source_info,
+			TransferInfo *transfer_info)
+{
+	GFile *dest;
+
+	if (copy_job->scanner != NULL ||
+	    source_info->num_bytes <= copy_job->verified_size) {
+		return;
+	}
+	copy_job->verified_size = source_info->num_bytes;
+
+	if (copy_job->destination) {
+		dest = g_object_ref (copy_job->destination);
+	} else {
+		dest = g_file_get_parent (copy_job->files->data);
+	}
+
+	verify_destination (&copy_job->common,
+			    dest,
+			    NULL,
+			    source_info->num_bytes - transfer_info->num_bytes);
+	g_object_unref (dest);
+}
+
 static void
 report_copy_progress (CopyMoveJob *copy_job,
 		      SourceInfo *source_info,
@@ -3059,6 +3605,14 @@ report_copy_progress (CopyMoveJob *copy_job,
 		return;
 	}
 	transfer_info->last_report_time = now;
+
+	/* Pick up what was counted since last time, the totals grow
+	 * until the scanner is done and the estimate settles. */
+	if (copy_job->scanner != NULL &&
+	    source_scanner_sync (copy_job->scanner, source_info)) {
+		source_scanner_free (copy_job->scanner);
+		copy_job->scanner = NULL;
+	}
 	
 	files_left = source_info->num_files - transfer_info->num_files;
 
@@ -3593,6 +4147,156 @@ create_dest_dir (CommonJob *job,
 	return CREATE_DEST_DIR_SUCCESS;
 }
 
+/* Small files are copied a batch at a time by a pool of threads, as
+ * for them the time goes into creating files rather than moving data.
+ */
+#define PARALLEL_COPY_MAX_SIZE (256 * 1024)
+#define PARALLEL_COPY_BATCH_SIZE 256
+#define MAX_PARALLEL_COPIES 16
+
+typedef struct {
+	GMutex lock;
+	GCond cond;
+	guint pending;
+} ParallelCopyBatch;
+
+typedef struct {
+	ParallelCopyBatch *batch;
+	GFile *src;
+	GFile *dest;
+	goffset size;
+	GFileCopyFlags flags;
+	GCancellable *cancellable;
+	gboolean copied;
+	GError *error;
+} ParallelCopy;
+
+static void
+parallel_copy_free (ParallelCopy *copy)
+{
+	g_object_unref (copy->src);
+	g_object_unref (copy->dest);
+	if (copy->error != NULL) {
+		g_error_free (copy->error);
+	}
+	g_free (copy);
+}
+
+static void
+parallel_copy_thread_func (gpointer data,
+			   gpointer user_data)
+{
+	ParallelCopy *copy;
+	ParallelCopyBatch *batch;
+	GError *error;
+	gboolean res;
+
+	copy = data;
+	batch = copy->batch;
+
+	error = NULL;
+	res = nemo_local_copy_file (copy->src, copy->dest,
+				    copy->flags,
+				    copy->cancellable,
+				    NULL, NULL,
+				    &error);
+
+	g_mutex_lock (&batch->lock);
+	copy->copied = res;
+	copy->error = error;
+	batch->pending--;
+	g_cond_signal (&batch->cond);
+	g_mutex_unlock (&batch->lock);
+}
+
+static GThreadPool *
+get_parallel_copy_pool (void)
+{
+	static gsize pool = 0;
+
+	if (g_once_init_enter (&pool)) {
+		GThreadPool *new_pool;
+
+		new_pool = g_thread_pool_new (parallel_copy_thread_func, NULL,
+					      CLAMP (g_get_num_processors (), 1, MAX_PARALLEL_COPIES),
+					      FALSE, NULL);
+		g_once_init_leave (&pool, (gsize) new_pool);
+	}
+
+	return (GThreadPool *) pool;
+}
+
+/* Copies are handed in reverse order, as they were prepended. Whatever
+ * the fast path couldn't copy goes through copy_move_file(), so that
+ * conflicts and errors get the usual dialogs.
+ */
+static void
+copy_files_in_parallel (CopyMoveJob *copy_job,
+			GList *copies,
+			GFile *dest_dir,
+			gboolean same_fs,
+			char **dest_fs_type,
+			SourceInfo *source_info,
+			TransferInfo *transfer_info,
+			gboolean *skipped_file,
+			gboolean readonly_source_fs)
+{
+	ParallelCopyBatch batch;
+	ParallelCopy *copy;
+	CommonJob *job;
+	GThreadPool *pool;
+	GList *l;
+
+	job = (CommonJob *)copy_job;
+	copies = g_list_reverse (copies);
+
+	if (!job_aborted (job)) {
+		g_mutex_init (&batch.lock);
+		g_cond_init (&batch.cond);
+		batch.pending = g_list_length (copies);
+
+		pool = get_parallel_copy_pool ();
+		for (l = copies; l != NULL; l = l->next) {
+			copy = l->data;
+			copy->batch = &batch;
+			g_thread_pool_push (pool, copy, NULL);
+		}
+
+		g_mutex_lock (&batch.lock);
+		while (batch.pending > 0) {
+			g_cond_wait (&batch.cond, &batch.lock);
+		}
+		g_mutex_unlock (&batch.lock);
+
+		g_mutex_clear (&batch.lock);
+		g_cond_clear (&batch.cond);
+
+		for (l = copies; l != NULL; l = l->next) {
+			copy = l->data;
+
+			if (copy->copied) {
+				transfer_info->num_files ++;
+				transfer_info->num_bytes += copy->size;
+				nemo_file_changes_queue_file_added (copy->dest);
+
+				if (job->undo_info != NULL) {
+					nemo_file_undo_info_ext_add_origin_target_pair (NEMO_FILE_UNDO_INFO_EXT (job->undo_info),
+											    copy->src, copy->dest);
+				}
+			} else if (!job_aborted (job) &&
+				   !IS_IO_ERROR (copy->error, CANCELLED)) {
+				copy_move_file (copy_job, copy->src, dest_dir, same_fs, FALSE, dest_fs_type,
+						source_info, transfer_info, NULL, NULL, FALSE, skipped_file,
+						readonly_source_fs);
+			}
+		}
+
+		report_copy_progress (copy_job, source_info, transfer_info);
+	}
+
+	g_list_free_full (copies, (GDestroyNotify) parallel_copy_free);
+}
+
 /* a return value of FALSE means retry, i.e.
  * the destination has changed and the source
  * is expected to re-try the preceeding
@@ -3623,6 +4327,10 @@ copy_move_directory (CopyMoveJob *copy_job,
 	gboolean local_skipped_file;
 	CommonJob *job;
 	GFileCopyFlags flags;
+	gboolean parallel;
+	GList *copies;
+	guint n_copies;
+	ParallelCopy *copy;
 
 	job = (CommonJob *)copy_job;
 	
@@ -3652,28 +4360,76 @@ copy_move_directory (CopyMoveJob *copy_job,
 
 	local_skipped_file = FALSE;
 	dest_fs_type = NULL;
+
+	/* Desktop files copied to the desktop need the extra care of
+	 * copy_move_file(), so those are done one at a time.
+	 */
+	parallel = !copy_job->is_move &&
+		g_file_is_native (src) && g_file_is_native (*dest) &&
+		(copy_job->desktop_location == NULL ||
+		 !g_file_equal (copy_job->desktop_location, *dest));
+	flags = (readonly_source_fs) ? G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_TARGET_DEFAULT_PERMS
+				     : G_FILE_COPY_NOFOLLOW_SYMLINKS;
 	
 	skip_error = should_skip_readdir_error (job, src);
  retry:
 	error = NULL;
 	enumerator = g_file_enumerate_children (src,
+						parallel ?
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+						G_FILE_ATTRIBUTE_STANDARD_SIZE :
 						G_FILE_ATTRIBUTE_STANDARD_NAME,
 						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 						job->cancellable,
 						&error);
 	if (enumerator) {
 		error = NULL;
+		copies = NULL;
+		n_copies = 0;
 
 		while (!job_aborted (job) &&
 		       (info = g_file_enumerator_next_file (enumerator, job->cancellable, skip_error?NULL:&error)) != NULL) {
+			verify_remaining_space (copy_job, source_info, transfer_info);
+			if (job_aborted (job)) {
+				g_object_unref (info);
+				break;
+			}
+
 			src_file = g_file_get_child (src,
 						     g_file_info_get_name (info));
-			copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
-					source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
-					readonly_source_fs);
+			if (parallel &&
+			    g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+			    g_file_info_get_size (info) <= PARALLEL_COPY_MAX_SIZE &&
+			    !should_skip_file (job, src_file)) {
+				copy = g_new0 (ParallelCopy, 1);
+				copy->src = g_object_ref (src_file);
+				copy->dest = get_target_file (src_file, *dest, dest_fs_type, same_fs);
+				copy->size = g_file_info_get_size (info);
+				copy->flags = flags;
+				copy->cancellable = job->cancellable;
+				copies = g_list_prepend (copies, copy);
+
+				if (++n_copies == PARALLEL_COPY_BATCH_SIZE) {
+					copy_files_in_parallel (copy_job, copies, *dest, same_fs, &dest_fs_type,
+								source_info, transfer_info, &local_skipped_file,
+								readonly_source_fs);
+					copies = NULL;
+					n_copies = 0;
+				}
+			} else {
+				copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
+						source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
+						readonly_source_fs);
+			}
 			g_object_unref (src_file);
 			g_object_unref (info);
 		}
+		if (copies != NULL) {
+			copy_files_in_parallel (copy_job, copies, *dest, same_fs, &dest_fs_type,
+						source_info, transfer_info, &local_skipped_file,
+						readonly_source_fs);
+		}
 		g_file_enumerator_close (enumerator, job->cancellable, NULL);
 		g_object_unref (enumerator);
 		
@@ -3763,8 +4519,6 @@ copy_move_directory (CopyMoveJob *copy_job,
 	}
 
 	if (create_dest) {
-		flags = (readonly_source_fs) ? G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_TARGET_DEFAULT_PERMS 
-					     : G_FILE_COPY_NOFOLLOW_SYMLINKS;
 		/* Ignore errors here. Failure to copy metadata is not a hard error */
 		g_file_copy_attributes (src, *dest,
 					flags,
@@ -4309,12 +5063,21 @@ copy_move_file (CopyMoveJob *copy_job,
 				   &pdata,
 				   &error);
 	} else {
-		res = g_file_copy (src, dest,
-				   flags,
-				   job->cancellable,
-				   copy_file_progress_callback,
-				   &pdata,
-				   &error);
+		res = nemo_local_copy_file (src, dest,
+					    flags,
+					    job->cancellable,
+					    copy_file_progress_callback,
+					    &pdata,
+					    &error);
+		if (!res && IS_IO_ERROR (error, NOT_SUPPORTED)) {
+			g_clear_error (&error);
+			res = g_file_copy (src, dest,
+					   flags,
+					   job->cancellable,
+					   copy_file_progress_callback,
+					   &pdata,
+					   &error);
+		}
 	}
 	
 	if (res) {
@@ -4630,6 +5393,11 @@ copy_files (CopyMoveJob *job,
 			dest = g_file_get_parent (src);
 			
 		}
+		verify_remaining_space (job, source_info, transfer_info);
+		if (job_aborted (common)) {
+			g_clear_object (&dest);
+		}
+
 		if (dest) {
 			skipped_file = FALSE;
 			copy_move_file (job, src, dest,
@@ -4698,10 +5466,10 @@ copy_job (GIOSchedulerJob *io_job,
 
     nemo_progress_info_start (common->progress);
 
-	scan_sources (job->files,
-		      &source_info,
-		      common,
-		      OP_KIND_COPY);
+	job->scanner = scan_sources_with_head_start (job->files,
+						     &source_info,
+						     common,
+						     OP_KIND_COPY);
 	if (job_aborted (common)) {
 		goto aborted;
 	}
@@ -4715,10 +5483,13 @@ copy_job (GIOSchedulerJob *io_job,
 		dest = g_file_get_parent (job->files->data);
 	}
 	
+	/* While still counting this is only what we know of so far, if
+	 * even that doesn't fit we can tell right away. */
 	verify_destination (&job->common,
 			    dest,
 			    &dest_fs_id,
 			    source_info.num_bytes);
+	job->verified_size = source_info.num_bytes;
 	g_object_unref (dest);
 	if (job_aborted (common)) {
 		goto aborted;
@@ -4732,6 +5503,11 @@ copy_job (GIOSchedulerJob *io_job,
 		    &source_info, &transfer_info);
 
  aborted:
+
+	if (job->scanner != NULL) {
+		source_scanner_free (job->scanner);
+		job->scanner = NULL;
+	}
 	
 	g_free (dest_fs_id);
 	
@@ -6953,6 +7729,39 @@ should_start_immediately (OpKind kind, gpointer op_data)
     return ret;
 }
 
+/* The files a job reads and the folder it writes to, so that the job
+ * queue can look up their filesystems and run jobs on different devices
+ * side by side.
+ */
+static void
+get_job_locations (OpKind     kind,
+                   gpointer   op_data,
+                   GList    **sources,
+                   GFile    **destination)
+{
+    *sources = NULL;
+    *destination = NULL;
+
+    switch (kind) {
+        case OP_KIND_MOVE:
+        case OP_KIND_COPY:
+        case OP_KIND_DUPE:
+            ;
+            CopyMoveJob *cjob = (CopyMoveJob *) op_data;
+            *sources = cjob->files;
+            *destination = cjob->destination;
+            break;
+        case OP_KIND_DELETE:
+        case OP_KIND_TRASH:
+            ;
+            DeleteJob *deljob = (DeleteJob *) op_data;
+            *sources = deljob->files;
+            break;
+        default:
+            break;
+    }
+}
+
 void
 add_job_to_job_queue (GIOSchedulerJobFunc job_func,
                                  gpointer user_data,
@@ -6961,16 +7770,21 @@ add_job_to_job_queue (GIOSchedulerJobFunc job_func,
                                   OpKind  kind)
 {
     gboolean start_immediately;
+    GList *sources;
+    GFile *destination;
 
     NemoJobQueue *job_queue = nemo_job_queue_get ();
 
     start_immediately = should_start_immediately (kind, user_data);
+    get_job_locations (kind, user_data, &sources, &destination);
 
     nemo_job_queue_add_new_job (job_queue,
                                 job_func,
                                 user_data,
                                 cancellable,
                                 info,
+                                sources,
+                                destination,
                                 start_immediately);
 }
 
@@ -137,15 +137,29 @@ struct NemoFileDetails
 
 	/* Mount for mountpoint or the references GMount for a "mountable" */
 	GMount *mount;
+
+	/* Slot in the file table of the directory. */
+	guint file_table_index;
+
+	/* Interned sort keys, computed on demand and dropped whenever
+	 * the file changes. See nemo_file_get_sort_key_q().
+	 */
+	const char *type_sort_key;
+	const char *detailed_type_sort_key;
+	const char *owner_sort_key;
 	
 	/* boolean fields: bitfield to save space, since there can be
            many NemoFile objects. */
 
-	eel_boolean_bit unconfirmed                   : 1;
+	/* Whether the file is unconfirmed, and whether files_added was
+	 * emitted for it, are kept in the file table of the directory.
+	 */
 	eel_boolean_bit is_gone                       : 1;
-	/* Set when emitting files_added on the directory to make sure we
-	   add a file, and only once */
-	eel_boolean_bit is_added                      : 1;
+
+	eel_boolean_bit got_type_sort_key             : 1;
+	eel_boolean_bit got_detailed_type_sort_key    : 1;
+	eel_boolean_bit got_owner_sort_key            : 1;
+
 	/* Set by the NemoDirectory while it's loading the file
 	 * list so the file knows not to do redundant I/O.
 	 */
@@ -257,6 +271,15 @@ gboolean      nemo_file_update_name                    (NemoFile           *file
 gboolean      nemo_file_update_metadata_from_info      (NemoFile           *file,
 							    GFileInfo              *info);
 
+/* Set a metadata value in the file's copy only, ahead of it being
+ * written out. Return TRUE if the value changed. */
+gboolean      nemo_file_set_metadata_in_memory         (NemoFile           *file,
+							    const char             *key,
+							    const char             *value);
+gboolean      nemo_file_set_metadata_list_in_memory    (NemoFile           *file,
+							    const char             *key,
+							    char                  **value);
+
 gboolean      nemo_file_update_name_and_directory      (NemoFile           *file,
 							    const char             *name,
 							    NemoDirectory      *directory);
@@ -118,6 +118,21 @@ nemo_file_queue_head (NemoFileQueue *queue)
 	return NEMO_FILE (queue->head->data);
 }
 
+NemoFile *
+nemo_file_queue_next (NemoFileQueue *queue,
+		      NemoFile *file)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (queue->item_to_link_map, file);
+
+	if (link == NULL || link->next == NULL) {
+		return NULL;
+	}
+
+	return NEMO_FILE (link->next->data);
+}
+
 gboolean
 nemo_file_queue_is_empty (NemoFileQueue *queue)
 {
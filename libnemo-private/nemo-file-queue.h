@@ -47,6 +47,10 @@ void               nemo_file_queue_remove   (NemoFileQueue *queue,
 /* Get the file at the head of the queue without removing or unrefing it. */
 NemoFile *     nemo_file_queue_head     (NemoFileQueue *queue);
 
+/* Get the file after the given one, or NULL, in constant time. */
+NemoFile *     nemo_file_queue_next     (NemoFileQueue *queue,
+						 NemoFile      *file);
+
 gboolean           nemo_file_queue_is_empty (NemoFileQueue *queue);
 
 #endif /* NEMO_FILE_CHANGES_QUEUE_H */
@@ -0,0 +1,286 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-file-table.c: The files of a directory, packed in an array.
+ 
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+  
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-file-table.h"
+
+#include <glib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 64
+
+#define WORD_INDEX(index) ((index) / 32)
+#define WORD_BIT(index) (((guint32) 1) << ((index) % 32))
+#define N_WORDS(slots) (((slots) + 31) / 32)
+
+struct NemoFileTable {
+	NemoFile **files;
+	guint size;      /* slots handed out so far */
+	guint capacity;
+	guint length;    /* slots holding a file */
+	GArray *free_slots;
+
+	guint32 *occupied;
+	guint32 *flags[NEMO_FILE_TABLE_N_FLAGS];
+};
+
+static guint
+count_bits (guint32 word)
+{
+	word = word - ((word >> 1) & 0x55555555);
+	word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+	return (((word + (word >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+static guint32 *
+resize_bitmap (guint32 *bitmap,
+	       guint old_capacity,
+	       guint new_capacity)
+{
+	bitmap = g_renew (guint32, bitmap, N_WORDS (new_capacity));
+	memset (bitmap + N_WORDS (old_capacity), 0,
+		(N_WORDS (new_capacity) - N_WORDS (old_capacity)) * sizeof (guint32));
+	return bitmap;
+}
+
+static void
+grow (NemoFileTable *table)
+{
+	guint new_capacity;
+	int i;
+
+	new_capacity = table->capacity == 0 ? INITIAL_CAPACITY : table->capacity * 2;
+
+	table->files = g_renew (NemoFile *, table->files, new_capacity);
+	table->occupied = resize_bitmap (table->occupied, table->capacity, new_capacity);
+	for (i = 0; i < NEMO_FILE_TABLE_N_FLAGS; i++) {
+		table->flags[i] = resize_bitmap (table->flags[i], table->capacity, new_capacity);
+	}
+
+	table->capacity = new_capacity;
+}
+
+NemoFileTable *
+nemo_file_table_new (void)
+{
+	NemoFileTable *table;
+
+	table = g_new0 (NemoFileTable, 1);
+	table->free_slots = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	return table;
+}
+
+void
+nemo_file_table_destroy (NemoFileTable *table)
+{
+	int i;
+
+	g_array_free (table->free_slots, TRUE);
+	g_free (table->files);
+	g_free (table->occupied);
+	for (i = 0; i < NEMO_FILE_TABLE_N_FLAGS; i++) {
+		g_free (table->flags[i]);
+	}
+	g_free (table);
+}
+
+guint
+nemo_file_table_add (NemoFileTable *table,
+		     NemoFile *file)
+{
+	guint index;
+	int i;
+
+	g_return_val_if_fail (file != NULL, 0);
+
+	if (table->free_slots->len > 0) {
+		index = g_array_index (table->free_slots, guint, table->free_slots->len - 1);
+		g_array_set_size (table->free_slots, table->free_slots->len - 1);
+	} else {
+		if (table->size == table->capacity) {
+			grow (table);
+		}
+		index = table->size++;
+	}
+
+	table->files[index] = file;
+	table->occupied[WORD_INDEX (index)] |= WORD_BIT (index);
+	for (i = 0; i < NEMO_FILE_TABLE_N_FLAGS; i++) {
+		table->flags[i][WORD_INDEX (index)] &= ~WORD_BIT (index);
+	}
+	table->length++;
+
+	return index;
+}
+
+void
+nemo_file_table_remove (NemoFileTable *table,
+			guint index)
+{
+	int i;
+
+	g_return_if_fail (index < table->size);
+	g_return_if_fail (table->files[index] != NULL);
+
+	table->files[index] = NULL;
+	table->occupied[WORD_INDEX (index)] &= ~WORD_BIT (index);
+	for (i = 0; i < NEMO_FILE_TABLE_N_FLAGS; i++) {
+		table->flags[i][WORD_INDEX (index)] &= ~WORD_BIT (index);
+	}
+	table->length--;
+
+	if (table->length == 0) {
+		/* Start packing from the front again. */
+		table->size = 0;
+		g_array_set_size (table->free_slots, 0);
+	} else {
+		g_array_append_val (table->free_slots, index);
+	}
+}
+
+NemoFile *
+nemo_file_table_get (NemoFileTable *table,
+		     guint index)
+{
+	if (index >= table->size) {
+		return NULL;
+	}
+
+	return table->files[index];
+}
+
+guint
+nemo_file_table_get_length (NemoFileTable *table)
+{
+	return table->length;
+}
+
+guint
+nemo_file_table_get_size (NemoFileTable *table)
+{
+	return table->size;
+}
+
+void
+nemo_file_table_foreach (NemoFileTable *table,
+			 GFunc func,
+			 gpointer user_data)
+{
+	NemoFile *file;
+	guint i;
+
+	/* Re-read size and slots each time around, func may remove
+	 * files or add new ones.
+	 */
+	for (i = 0; i < table->size; i++) {
+		file = table->files[i];
+		if (file != NULL) {
+			(* func) (file, user_data);
+		}
+	}
+}
+
+GList *
+nemo_file_table_get_list (NemoFileTable *table)
+{
+	GList *list;
+	guint i;
+
+	list = NULL;
+	for (i = table->size; i > 0; i--) {
+		if (table->files[i - 1] != NULL) {
+			list = g_list_prepend (list, table->files[i - 1]);
+		}
+	}
+
+	return list;
+}
+
+gboolean
+nemo_file_table_get_flag (NemoFileTable *table,
+			  guint index,
+			  NemoFileTableFlag flag)
+{
+	g_return_val_if_fail (index < table->size, FALSE);
+
+	return (table->flags[flag][WORD_INDEX (index)] & WORD_BIT (index)) != 0;
+}
+
+void
+nemo_file_table_set_flag (NemoFileTable *table,
+			  guint index,
+			  NemoFileTableFlag flag,
+			  gboolean value)
+{
+	g_return_if_fail (index < table->size);
+	g_return_if_fail (table->files[index] != NULL);
+
+	if (value) {
+		table->flags[flag][WORD_INDEX (index)] |= WORD_BIT (index);
+	} else {
+		table->flags[flag][WORD_INDEX (index)] &= ~WORD_BIT (index);
+	}
+}
+
+guint
+nemo_file_table_set_flag_all (NemoFileTable *table,
+			      NemoFileTableFlag flag,
+			      gboolean value)
+{
+	guint32 *bits, old;
+	guint changed, w;
+
+	changed = 0;
+	bits = table->flags[flag];
+	for (w = 0; w < N_WORDS (table->size); w++) {
+		old = bits[w];
+		bits[w] = value ? table->occupied[w] : 0;
+		changed += count_bits (old ^ bits[w]);
+	}
+
+	return changed;
+}
+
+int
+nemo_file_table_find_flag (NemoFileTable *table,
+			   NemoFileTableFlag flag,
+			   guint start)
+{
+	guint32 *bits, word;
+	guint w;
+
+	if (start >= table->size) {
+		return -1;
+	}
+
+	bits = table->flags[flag];
+	w = WORD_INDEX (start);
+	word = bits[w] & ~(WORD_BIT (start) - 1);
+	for (;;) {
+		if (word != 0) {
+			return w * 32 + g_bit_nth_lsf (word, -1);
+		}
+		if (++w >= N_WORDS (table->size)) {
+			return -1;
+		}
+		word = bits[w];
+	}
+}
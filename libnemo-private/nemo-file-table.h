@@ -0,0 +1,80 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-file-table.h: The files of a directory, packed in an array.
+ 
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+  
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_FILE_TABLE_H
+#define NEMO_FILE_TABLE_H
+
+#include <libnemo-private/nemo-file.h>
+
+/* Files are kept in slots of one array. A file keeps its slot for as
+ * long as it is in the table, and freed slots are reused by later
+ * additions, so adding and removing are constant time. Per-file
+ * flags are kept in bitmaps next to the array, so sweeps over all
+ * files with a flag set only touch a few words per 32 files.
+ */
+typedef struct NemoFileTable NemoFileTable;
+
+typedef enum {
+	NEMO_FILE_TABLE_FLAG_UNCONFIRMED,
+	NEMO_FILE_TABLE_FLAG_ADDED,
+	NEMO_FILE_TABLE_N_FLAGS
+} NemoFileTableFlag;
+
+NemoFileTable *nemo_file_table_new            (void);
+void           nemo_file_table_destroy        (NemoFileTable     *table);
+
+/* Returns the slot the file was put in. The table does not ref the file. */
+guint          nemo_file_table_add            (NemoFileTable     *table,
+					       NemoFile          *file);
+void           nemo_file_table_remove         (NemoFileTable     *table,
+					       guint              index);
+
+/* Returns NULL for free slots. */
+NemoFile *     nemo_file_table_get            (NemoFileTable     *table,
+					       guint              index);
+/* Number of files in the table. */
+guint          nemo_file_table_get_length     (NemoFileTable     *table);
+/* Number of slots; iterate from 0 to this and skip free slots. */
+guint          nemo_file_table_get_size       (NemoFileTable     *table);
+
+/* Calls func for each file. Files may be removed while iterating. */
+void           nemo_file_table_foreach        (NemoFileTable     *table,
+					       GFunc              func,
+					       gpointer           user_data);
+/* Returns a new list of the files, without adding refs. */
+GList *        nemo_file_table_get_list       (NemoFileTable     *table);
+
+gboolean       nemo_file_table_get_flag       (NemoFileTable     *table,
+					       guint              index,
+					       NemoFileTableFlag  flag);
+void           nemo_file_table_set_flag       (NemoFileTable     *table,
+					       guint              index,
+					       NemoFileTableFlag  flag,
+					       gboolean           value);
+/* Set or clear a flag on every file, returning how many files changed. */
+guint          nemo_file_table_set_flag_all   (NemoFileTable     *table,
+					       NemoFileTableFlag  flag,
+					       gboolean           value);
+/* Returns the first slot at or after start with the flag set, or -1. */
+int            nemo_file_table_find_flag      (NemoFileTable     *table,
+					       NemoFileTableFlag  flag,
+					       guint              start);
+
+#endif /* NEMO_FILE_TABLE_H */
@@ -155,6 +155,7 @@ static const char * nemo_file_peek_display_name (NemoFile *file);
 static const char * nemo_file_peek_display_name_collation_key (NemoFile *file);
 static void file_mount_unmounted (GMount *mount,  gpointer data);
 static void metadata_hash_free (GHashTable *hash);
+static void clear_sort_keys (NemoFile *file);
 
 G_DEFINE_TYPE_WITH_CODE (NemoFile, nemo_file, G_TYPE_OBJECT,
 			 G_IMPLEMENT_INTERFACE (NEMO_TYPE_FILE_INFO,
@@ -410,6 +411,82 @@ nemo_file_update_metadata_from_info (NemoFile *file,
 	return changed;
 }
 
+/* Stores a value the way it will be read back from the metadata store
+ * once it's written, or removes it for a NULL value. Takes ownership
+ * of the value. Returns TRUE if this changed anything.
+ */
+static gboolean
+set_metadata_value (NemoFile *file,
+		    guint id,
+		    gpointer value)
+{
+	gpointer old_value;
+	gboolean same;
+
+	if (file->details->metadata == NULL) {
+		if (value == NULL) {
+			return FALSE;
+		}
+		file->details->metadata = g_hash_table_new (NULL, NULL);
+	}
+
+	old_value = g_hash_table_lookup (file->details->metadata, GUINT_TO_POINTER (id));
+
+	if (old_value == NULL || value == NULL) {
+		same = old_value == value;
+	} else if (id & METADATA_ID_IS_LIST_MASK) {
+		same = eel_g_strv_equal ((char **)old_value, (char **)value);
+	} else {
+		same = strcmp ((char *)old_value, (char *)value) == 0;
+	}
+
+	if (same) {
+		foreach_metadata_free (GUINT_TO_POINTER (id), value, NULL);
+		return FALSE;
+	}
+
+	if (old_value != NULL) {
+		g_hash_table_remove (file->details->metadata, GUINT_TO_POINTER (id));
+		foreach_metadata_free (GUINT_TO_POINTER (id), old_value, NULL);
+	}
+	if (value != NULL) {
+		g_hash_table_insert (file->details->metadata, GUINT_TO_POINTER (id), value);
+	}
+
+	return TRUE;
+}
+
+gboolean
+nemo_file_set_metadata_in_memory (NemoFile *file,
+				  const char *key,
+				  const char *value)
+{
+	guint id;
+
+	id = nemo_metadata_get_id (key);
+	if (id == 0) {
+		return FALSE;
+	}
+
+	return set_metadata_value (file, id, g_strdup (value));
+}
+
+gboolean
+nemo_file_set_metadata_list_in_memory (NemoFile *file,
+				       const char *key,
+				       char **value)
+{
+	guint id;
+
+	id = nemo_metadata_get_id (key);
+	if (id == 0) {
+		return FALSE;
+	}
+
+	return set_metadata_value (file, id | METADATA_ID_IS_LIST_MASK,
+				   g_strdupv (value));
+}
+
 void
 nemo_file_clear_info (NemoFile *file)
 {
@@ -2130,7 +2207,7 @@ update_info_internal (NemoFile *file,
 		      GFileInfo *info,
 		      gboolean update_name)
 {
-	GList *node;
+	gboolean in_hash;
 	gboolean changed;
 	gboolean is_symlink, is_hidden, is_mountpoint;
 	gboolean has_permissions;
@@ -2538,7 +2615,7 @@ update_info_internal (NemoFile *file,
 		    strcmp (eel_ref_str_peek (file->details->name), name) != 0) {
 			changed = TRUE;
 
-			node = nemo_directory_begin_file_name_change
+			in_hash = nemo_directory_begin_file_name_change
 				(file->details->directory, file);
 			
 			eel_ref_str_unref (file->details->name);
@@ -2559,11 +2636,13 @@ update_info_internal (NemoFile *file,
 			}
 
 			nemo_directory_end_file_name_change
-				(file->details->directory, file, node);
+				(file->details->directory, file, in_hash);
 		}
 	}
 
 	if (changed) {
+		clear_sort_keys (file);
+
 		add_to_link_hash_table (file);
 		
 		update_links_if_target (file);
@@ -2591,7 +2670,7 @@ update_name_internal (NemoFile *file,
 		      const char *name,
 		      gboolean in_directory)
 {
-	GList *node;
+	gboolean in_hash;
 
 	g_assert (name != NULL);
 
@@ -2603,9 +2682,9 @@ update_name_internal (NemoFile *file,
 		return FALSE;
 	}
 	
-	node = NULL;
+	in_hash = FALSE;
 	if (in_directory) {
-		node = nemo_directory_begin_file_name_change
+		in_hash = nemo_directory_begin_file_name_change
 			(file->details->directory, file);
 	}
 	
@@ -2618,7 +2697,7 @@ update_name_internal (NemoFile *file,
 
 	if (in_directory) {
 		nemo_directory_end_file_name_change
-			(file->details->directory, file, node);
+			(file->details->directory, file, in_hash);
 	}
 
 	return TRUE;
@@ -2645,6 +2724,7 @@ nemo_file_update_name_and_directory (NemoFile *file,
 {
 	NemoDirectory *old_directory;
 	FileMonitors *monitors;
+	gboolean is_added;
 
 	g_return_val_if_fail (NEMO_IS_FILE (file), FALSE);
 	g_return_val_if_fail (NEMO_IS_DIRECTORY (file->details->directory), FALSE);
@@ -2670,6 +2750,7 @@ nemo_file_update_name_and_directory (NemoFile *file,
 	remove_from_link_hash_table (file);
 
 	monitors = nemo_directory_remove_file_monitors (old_directory, file);
+	is_added = nemo_directory_file_is_added (old_directory, file);
 	nemo_directory_remove_file (old_directory, file);
 
 	file->details->directory = nemo_directory_ref (new_directory);
@@ -2680,6 +2761,9 @@ nemo_file_update_name_and_directory (NemoFile *file,
 	}
 
 	nemo_directory_add_file (new_directory, file);
+	if (is_added) {
+		nemo_directory_set_file_is_added (new_directory, file);
+	}
 	nemo_directory_add_file_monitors (new_directory, file, monitors);
 
 	add_to_link_hash_table (file);
@@ -3019,19 +3103,83 @@ prepend_automatic_keywords (NemoFile *file,
 	return names;
 }
 
+static void
+clear_sort_keys (NemoFile *file)
+{
+	file->details->type_sort_key = NULL;
+	file->details->detailed_type_sort_key = NULL;
+	file->details->owner_sort_key = NULL;
+	file->details->got_type_sort_key = FALSE;
+	file->details->got_detailed_type_sort_key = FALSE;
+	file->details->got_owner_sort_key = FALSE;
+}
+
+static const char *
+intern_collation_key (char *string)
+{
+	const char *key;
+	char *collation_key;
+
+	if (string == NULL) {
+		return NULL;
+	}
+
+	collation_key = g_utf8_collate_key (string, -1);
+	key = g_intern_string (collation_key);
+	g_free (collation_key);
+	g_free (string);
+
+	return key;
+}
+
+static const char *
+get_type_sort_key (NemoFile *file, gboolean detailed)
+{
+	if (detailed) {
+		if (!file->details->got_detailed_type_sort_key) {
+			file->details->detailed_type_sort_key =
+				intern_collation_key (nemo_file_get_detailed_type_as_string (file));
+			file->details->got_detailed_type_sort_key = TRUE;
+		}
+		return file->details->detailed_type_sort_key;
+	}
+
+	if (!file->details->got_type_sort_key) {
+		file->details->type_sort_key =
+			intern_collation_key (nemo_file_get_type_as_string (file));
+		file->details->got_type_sort_key = TRUE;
+	}
+	return file->details->type_sort_key;
+}
+
+static const char *
+get_owner_sort_key (NemoFile *file)
+{
+	char *owner;
+
+	/* Owners sort with strcmp() like any other string attribute,
+	 * so the key is the string itself.
+	 */
+	if (!file->details->got_owner_sort_key) {
+		owner = nemo_file_get_owner_as_string (file, TRUE);
+		file->details->owner_sort_key = g_intern_string (owner);
+		file->details->got_owner_sort_key = TRUE;
+		g_free (owner);
+	}
+	return file->details->owner_sort_key;
+}
+
 static int
 compare_by_type (NemoFile *file_1, NemoFile *file_2, gboolean detailed)
 {
 	gboolean is_directory_1;
 	gboolean is_directory_2;
-	char *type_string_1;
-	char *type_string_2;
-	int result;
+	const char *type_key_1;
+	const char *type_key_2;
 
-	/* Directories go first. Then, if mime types are identical,
-	 * don't bother getting strings (for speed). This assumes
-	 * that the string is dependent entirely on the mime type,
-	 * which is true now but might not be later.
+	/* Directories go first. Other files compare by the cached
+	 * collation keys of their type strings, files without a type
+	 * string last.
 	 */
 	is_directory_1 = nemo_file_is_directory (file_1);
 	is_directory_2 = nemo_file_is_directory (file_2);
@@ -3048,32 +3196,29 @@ compare_by_type (NemoFile *file_1, NemoFile *file_2, gboolean detailed)
 		return +1;
 	}
 
-    if (detailed) {
-        type_string_1 = nemo_file_get_detailed_type_as_string (file_1);
-        type_string_2 = nemo_file_get_detailed_type_as_string (file_2);
-    } else {
-        type_string_1 = nemo_file_get_type_as_string (file_1);
-        type_string_2 = nemo_file_get_type_as_string (file_2);
-    }
+	/* The keys are interned collation keys of the type strings,
+	 * so identical types compare without touching the strings.
+	 */
+	type_key_1 = get_type_sort_key (file_1, detailed);
+	type_key_2 = get_type_sort_key (file_2, detailed);
 
-	if (type_string_1 == NULL || type_string_2 == NULL) {
-		if (type_string_1 != NULL) {
+	if (type_key_1 == NULL || type_key_2 == NULL) {
+		if (type_key_1 != NULL) {
 			return -1;
 		}
 
-		if (type_string_2 != NULL) {
+		if (type_key_2 != NULL) {
 			return 1;
 		}
 
 		return 0;
 	}
 
-	result = g_utf8_collate (type_string_1, type_string_2);
-
-	g_free (type_string_1);
-	g_free (type_string_2);
+	if (type_key_1 == type_key_2) {
+		return 0;
+	}
 
-	return result;
+	return strcmp (type_key_1, type_key_2);
 }
 
 static int
@@ -3345,6 +3490,96 @@ nemo_file_compare_for_sort_by_attribute     (NemoFile                   *file_1,
 }
 
 
+static Knowledge
+get_sort_time (NemoFile *file, NemoDateType type, guint64 *value)
+{
+	Knowledge known;
+	time_t time;
+
+	time = 0;
+	known = get_time (file, &time, type);
+
+	/* Bias the signed time so that it sorts as unsigned. */
+	*value = known == KNOWN ?
+		(guint64) (gint64) time ^ G_GUINT64_CONSTANT (0x8000000000000000) : 0;
+
+	return known;
+}
+
+/**
+ * nemo_file_get_sort_key_q:
+ * @file: A file object
+ * @attribute: The sort attribute
+ * @key: Return location for the sort key
+ *
+ * Fills in a key that orders @file for @attribute the same way
+ * nemo_file_compare_for_sort_by_attribute_q() does, leaving out the
+ * directories-first and path tie breakers. The key is only valid
+ * until the file changes.
+ *
+ * Return value: TRUE if @attribute has a precomputed key, FALSE if
+ * files have to be compared one pair at a time.
+ **/
+gboolean
+nemo_file_get_sort_key_q (NemoFile *file,
+			      GQuark attribute,
+			      NemoFileSortKey *key)
+{
+	Knowledge known;
+	goffset size;
+	guint count;
+
+	g_return_val_if_fail (NEMO_IS_FILE (file), FALSE);
+
+	/* Unknown things sort first, then unknowable things,
+	 * then known values in ascending order. See the compare_by_*
+	 * functions above.
+	 */
+	key->sort_order = file->details->sort_order;
+	key->group = 0;
+	key->value = 0;
+	key->collation_key = NULL;
+
+	if (attribute == attribute_size_q) {
+		if (nemo_file_is_directory (file)) {
+			known = get_item_count (file, &count);
+			key->group = UNKNOWN - known;
+			if (known == KNOWN) {
+				key->value = count;
+			}
+		} else {
+			known = get_size (file, &size);
+			key->group = UNKNOWN + 1 + UNKNOWN - known;
+			if (known == KNOWN) {
+				key->value = size;
+			}
+		}
+	} else if (attribute == attribute_type_q ||
+		   attribute == attribute_detailed_type_q) {
+		if (!nemo_file_is_directory (file)) {
+			key->collation_key = get_type_sort_key (file, attribute == attribute_detailed_type_q);
+			key->group = key->collation_key != NULL ? 1 : 2;
+		}
+	} else if (attribute == attribute_modification_date_q || attribute == attribute_date_modified_q) {
+		key->group = UNKNOWN - get_sort_time (file, NEMO_DATE_TYPE_MODIFIED, &key->value);
+	} else if (attribute == attribute_accessed_date_q || attribute == attribute_date_accessed_q) {
+		key->group = UNKNOWN - get_sort_time (file, NEMO_DATE_TYPE_ACCESSED, &key->value);
+	} else if (attribute == attribute_trashed_on_q) {
+		key->group = UNKNOWN - get_sort_time (file, NEMO_DATE_TYPE_TRASHED, &key->value);
+	} else if (attribute == attribute_owner_q) {
+		key->collation_key = get_owner_sort_key (file);
+		key->group = key->collation_key != NULL ? 1 : 0;
+	} else if (attribute == attribute_group_q) {
+		/* Group names are already unique strings. */
+		key->collation_key = eel_ref_str_peek (file->details->group);
+		key->group = key->collation_key != NULL ? 1 : 0;
+	} else {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 /**
  * nemo_file_compare_name:
  * @file: A file object
@@ -7288,6 +7523,8 @@ nemo_file_emit_changed (NemoFile *file)
 
 	g_assert (NEMO_IS_FILE (file));
 
+	clear_sort_keys (file);
+
 	/* Send out a signal. */
 	g_signal_emit (file, signals[CHANGED], 0, file);
 
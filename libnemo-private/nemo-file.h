@@ -425,6 +425,23 @@ int                     nemo_file_compare_for_sort_by_attribute_q   (NemoFile
 									 gboolean                        reversed);
 gboolean                nemo_file_is_date_sort_attribute_q          (GQuark                          attribute);
 
+/* Precomputed sort keys. For the attributes that have them, two files
+ * compare like their keys: by @sort_order, then by @group, then by
+ * @value, then by strcmp() of @collation_key. Collation keys are
+ * interned, so equal keys are the same pointer. Files with equal keys
+ * are ordered by nemo_file_compare_for_sort_by_attribute_q().
+ */
+typedef struct {
+	gint32 sort_order;
+	guint32 group;
+	guint64 value;
+	const char *collation_key;
+} NemoFileSortKey;
+
+gboolean                nemo_file_get_sort_key_q                    (NemoFile                   *file,
+									 GQuark                          attribute,
+									 NemoFileSortKey            *key);
+
 int                     nemo_file_compare_display_name              (NemoFile                   *file_1,
 									 const char                     *pattern);
 int                     nemo_file_compare_location                  (NemoFile                    *file_1,
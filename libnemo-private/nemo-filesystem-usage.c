@@ -0,0 +1,395 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/*
+   nemo-filesystem-usage.c: Cached filesystem usage, refreshed in the
+   background.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-filesystem-usage.h"
+
+#include <eel/eel-debug.h>
+#include <gio/gio.h>
+#include <string.h>
+
+/* Cached values younger than this are used without asking again */
+#define USAGE_REFRESH_INTERVAL (2 * G_USEC_PER_SEC)
+
+/* Queries taking longer than this are cancelled, the cached values
+ * are kept until the filesystem answers again.
+ */
+#define USAGE_QUERY_TIMEOUT_SECONDS 5
+
+#define USAGE_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_FILESYSTEM_SIZE "," \
+	G_FILE_ATTRIBUTE_FILESYSTEM_USED "," \
+	G_FILE_ATTRIBUTE_FILESYSTEM_FREE
+
+typedef struct {
+	NemoFilesystemUsage *usage;
+	char *uri;
+
+	GCancellable *cancellable;
+	guint timeout_id;
+	int queries_running;
+	gint64 refresh_time;
+	gboolean changed;
+	/* Dropped from the cache, freed once its queries are done */
+	gboolean forgotten;
+
+	gboolean have_usage;
+	guint64 size;
+	guint64 used;
+	guint64 free_space;
+	char *filesystem_id;
+} UsageEntry;
+
+struct NemoFilesystemUsageDetails {
+	GHashTable *entries; /* uri -> UsageEntry */
+};
+
+enum {
+	CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+static NemoFilesystemUsage *nemo_filesystem_usage = NULL;
+
+G_DEFINE_TYPE (NemoFilesystemUsage, nemo_filesystem_usage, G_TYPE_OBJECT)
+
+static void
+usage_entry_free (UsageEntry *entry)
+{
+	/* Entries are freed with the cache, which is kept alive while
+	 * queries are running, or by usage_entry_query_done.
+	 */
+	g_assert (entry->queries_running == 0);
+
+	if (entry->cancellable != NULL) {
+		g_object_unref (entry->cancellable);
+	}
+	g_free (entry->uri);
+	g_free (entry->filesystem_id);
+	g_free (entry);
+}
+
+static void
+usage_entry_query_done (UsageEntry *entry)
+{
+	NemoFilesystemUsage *usage;
+
+	entry->queries_running--;
+	if (entry->queries_running > 0) {
+		return;
+	}
+
+	if (entry->timeout_id != 0) {
+		g_source_remove (entry->timeout_id);
+		entry->timeout_id = 0;
+	}
+
+	entry->refresh_time = g_get_monotonic_time ();
+
+	usage = entry->usage;
+	if (entry->forgotten) {
+		usage_entry_free (entry);
+	} else if (entry->changed) {
+		entry->changed = FALSE;
+		g_signal_emit (usage, signals[CHANGED], 0, entry->uri);
+	}
+	g_object_unref (usage);
+}
+
+static void
+filesystem_info_callback (GObject *source_object,
+			  GAsyncResult *res,
+			  gpointer user_data)
+{
+	UsageEntry *entry;
+	GFileInfo *info;
+	GError *error;
+	guint64 size, used, free_space;
+	gboolean have_usage;
+
+	entry = user_data;
+
+	error = NULL;
+	info = g_file_query_filesystem_info_finish (G_FILE (source_object), res, &error);
+
+	if (info == NULL &&
+	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* Timed out, keep what we had */
+		g_error_free (error);
+		usage_entry_query_done (entry);
+		return;
+	}
+
+	have_usage = FALSE;
+	size = used = free_space = 0;
+	if (info != NULL) {
+		size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
+		used = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_USED);
+		free_space = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
+		have_usage = size > 0;
+		g_object_unref (info);
+	}
+	if (error != NULL) {
+		g_error_free (error);
+	}
+
+	if (have_usage != entry->have_usage ||
+	    size != entry->size ||
+	    used != entry->used ||
+	    free_space != entry->free_space) {
+		entry->have_usage = have_usage;
+		entry->size = size;
+		entry->used = used;
+		entry->free_space = free_space;
+		entry->changed = TRUE;
+	}
+
+	usage_entry_query_done (entry);
+}
+
+static void
+filesystem_id_callback (GObject *source_object,
+			GAsyncResult *res,
+			gpointer user_data)
+{
+	UsageEntry *entry;
+	GFileInfo *info;
+	const char *filesystem_id;
+
+	entry = user_data;
+
+	info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
+	if (info != NULL) {
+		filesystem_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+		if (g_strcmp0 (filesystem_id, entry->filesystem_id) != 0) {
+			g_free (entry->filesystem_id);
+			entry->filesystem_id = g_strdup (filesystem_id);
+			entry->changed = TRUE;
+		}
+		g_object_unref (info);
+	}
+
+	usage_entry_query_done (entry);
+}
+
+static gboolean
+query_timeout_callback (gpointer user_data)
+{
+	UsageEntry *entry;
+
+	entry = user_data;
+	entry->timeout_id = 0;
+
+	g_cancellable_cancel (entry->cancellable);
+
+	return FALSE;
+}
+
+static void
+usage_entry_refresh (UsageEntry *entry)
+{
+	GFile *location;
+
+	/* A filesystem that doesn't answer, like a stale network
+	 * mount, would otherwise tie up one more thread each time.
+	 */
+	if (entry->queries_running > 0) {
+		return;
+	}
+
+	if (entry->cancellable != NULL) {
+		g_object_unref (entry->cancellable);
+	}
+	entry->cancellable = g_cancellable_new ();
+	entry->queries_running = 2;
+	g_object_ref (entry->usage);
+
+	location = g_file_new_for_uri (entry->uri);
+	g_file_query_filesystem_info_async (location,
+					    USAGE_ATTRIBUTES,
+					    G_PRIORITY_DEFAULT,
+					    entry->cancellable,
+					    filesystem_info_callback,
+					    entry);
+	g_file_query_info_async (location,
+				 G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+				 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+				 G_PRIORITY_DEFAULT,
+				 entry->cancellable,
+				 filesystem_id_callback,
+				 entry);
+	g_object_unref (location);
+
+	entry->timeout_id = g_timeout_add_seconds (USAGE_QUERY_TIMEOUT_SECONDS,
+						   query_timeout_callback, entry);
+}
+
+static UsageEntry *
+get_entry (NemoFilesystemUsage *usage,
+	   const char *uri)
+{
+	UsageEntry *entry;
+
+	entry = g_hash_table_lookup (usage->details->entries, uri);
+	if (entry == NULL) {
+		entry = g_new0 (UsageEntry, 1);
+		entry->usage = usage;
+		entry->uri = g_strdup (uri);
+		g_hash_table_insert (usage->details->entries, entry->uri, entry);
+	}
+
+	if (entry->refresh_time == 0 ||
+	    g_get_monotonic_time () - entry->refresh_time > USAGE_REFRESH_INTERVAL) {
+		usage_entry_refresh (entry);
+	}
+
+	return entry;
+}
+
+gboolean
+nemo_filesystem_usage_lookup (NemoFilesystemUsage *usage,
+			      const char *uri,
+			      guint64 *size,
+			      guint64 *used,
+			      guint64 *free_space)
+{
+	UsageEntry *entry;
+
+	g_return_val_if_fail (NEMO_IS_FILESYSTEM_USAGE (usage), FALSE);
+	g_return_val_if_fail (uri != NULL, FALSE);
+
+	entry = get_entry (usage, uri);
+
+	if (size != NULL) {
+		*size = entry->size;
+	}
+	if (used != NULL) {
+		*used = entry->used;
+	}
+	if (free_space != NULL) {
+		*free_space = entry->free_space;
+	}
+
+	return entry->have_usage;
+}
+
+const char *
+nemo_filesystem_usage_get_filesystem_id (NemoFilesystemUsage *usage,
+					 const char *uri)
+{
+	g_return_val_if_fail (NEMO_IS_FILESYSTEM_USAGE (usage), NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	return get_entry (usage, uri)->filesystem_id;
+}
+
+/* Drops what is known about uri, so that a filesystem mounted there
+ * later doesn't show the values of the one that went away.
+ */
+void
+nemo_filesystem_usage_forget (NemoFilesystemUsage *usage,
+			      const char *uri)
+{
+	UsageEntry *entry;
+
+	g_return_if_fail (NEMO_IS_FILESYSTEM_USAGE (usage));
+	g_return_if_fail (uri != NULL);
+
+	entry = g_hash_table_lookup (usage->details->entries, uri);
+	if (entry == NULL) {
+		return;
+	}
+
+	g_hash_table_steal (usage->details->entries, uri);
+
+	if (entry->queries_running > 0) {
+		entry->forgotten = TRUE;
+		g_cancellable_cancel (entry->cancellable);
+	} else {
+		usage_entry_free (entry);
+	}
+}
+
+static void
+nemo_filesystem_usage_finalize (GObject *object)
+{
+	NemoFilesystemUsage *usage;
+
+	usage = NEMO_FILESYSTEM_USAGE (object);
+
+	g_hash_table_destroy (usage->details->entries);
+
+	G_OBJECT_CLASS (nemo_filesystem_usage_parent_class)->finalize (object);
+}
+
+static void
+nemo_filesystem_usage_class_init (NemoFilesystemUsageClass *klass)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = nemo_filesystem_usage_finalize;
+
+	signals[CHANGED] = g_signal_new
+		("changed",
+		 G_TYPE_FROM_CLASS (object_class),
+		 G_SIGNAL_RUN_LAST,
+		 G_STRUCT_OFFSET (NemoFilesystemUsageClass, changed),
+		 NULL, NULL,
+		 g_cclosure_marshal_VOID__STRING,
+		 G_TYPE_NONE, 1,
+		 G_TYPE_STRING);
+
+	g_type_class_add_private (object_class, sizeof (NemoFilesystemUsageDetails));
+}
+
+static void
+nemo_filesystem_usage_init (NemoFilesystemUsage *usage)
+{
+	usage->details = G_TYPE_INSTANCE_GET_PRIVATE (usage,
+						      NEMO_TYPE_FILESYSTEM_USAGE,
+						      NemoFilesystemUsageDetails);
+
+	usage->details->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 NULL,
+							 (GDestroyNotify) usage_entry_free);
+}
+
+static void
+unref_filesystem_usage (void)
+{
+	g_object_unref (nemo_filesystem_usage);
+}
+
+NemoFilesystemUsage *
+nemo_filesystem_usage_get (void)
+{
+	if (nemo_filesystem_usage == NULL) {
+		nemo_filesystem_usage = NEMO_FILESYSTEM_USAGE
+			(g_object_new (NEMO_TYPE_FILESYSTEM_USAGE, NULL));
+		eel_debug_call_at_shutdown (unref_filesystem_usage);
+	}
+
+	return nemo_filesystem_usage;
+}
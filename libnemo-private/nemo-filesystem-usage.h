@@ -0,0 +1,75 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+
+/*
+   nemo-filesystem-usage.h: Cached filesystem usage, refreshed in the
+   background.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_FILESYSTEM_USAGE_H
+#define NEMO_FILESYSTEM_USAGE_H
+
+#include <gio/gio.h>
+
+typedef struct NemoFilesystemUsage NemoFilesystemUsage;
+typedef struct NemoFilesystemUsageClass NemoFilesystemUsageClass;
+typedef struct NemoFilesystemUsageDetails NemoFilesystemUsageDetails;
+
+#define NEMO_TYPE_FILESYSTEM_USAGE nemo_filesystem_usage_get_type()
+#define NEMO_FILESYSTEM_USAGE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), NEMO_TYPE_FILESYSTEM_USAGE, NemoFilesystemUsage))
+#define NEMO_FILESYSTEM_USAGE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), NEMO_TYPE_FILESYSTEM_USAGE, NemoFilesystemUsageClass))
+#define NEMO_IS_FILESYSTEM_USAGE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NEMO_TYPE_FILESYSTEM_USAGE))
+#define NEMO_IS_FILESYSTEM_USAGE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), NEMO_TYPE_FILESYSTEM_USAGE))
+#define NEMO_FILESYSTEM_USAGE_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), NEMO_TYPE_FILESYSTEM_USAGE, NemoFilesystemUsageClass))
+
+struct NemoFilesystemUsage {
+	GObject object;
+	NemoFilesystemUsageDetails *details;
+};
+
+struct NemoFilesystemUsageClass {
+	GObjectClass parent_class;
+
+	/* Fresh values for uri arrived that differ from the cached ones */
+	void (* changed)			(NemoFilesystemUsage	*usage,
+						 const char		*uri);
+};
+
+GType			nemo_filesystem_usage_get_type		(void);
+
+NemoFilesystemUsage    *nemo_filesystem_usage_get		(void);
+
+/* These never block: they answer from the cache, and start refreshing
+ * it in the background when the cached values are a few seconds old.
+ * They return FALSE, or NULL, while nothing is known about uri yet.
+ */
+gboolean		nemo_filesystem_usage_lookup		(NemoFilesystemUsage	*usage,
+								 const char		*uri,
+								 guint64		*size,
+								 guint64		*used,
+								 guint64		*free_space);
+const char	       *nemo_filesystem_usage_get_filesystem_id	(NemoFilesystemUsage	*usage,
+								 const char		*uri);
+void			nemo_filesystem_usage_forget		(NemoFilesystemUsage	*usage,
+								 const char		*uri);
+
+#endif
@@ -192,6 +192,11 @@ typedef enum
 #define NEMO_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS "show-directory-item-counts"
 #define NEMO_PREFERENCES_SHOW_IMAGE_FILE_THUMBNAILS	"show-image-thumbnails"
 #define NEMO_PREFERENCES_IMAGE_FILE_THUMBNAIL_LIMIT	"thumbnail-limit"
+#define NEMO_PREFERENCES_THUMBNAIL_VIEWPORT_MARGIN	"thumbnail-viewport-margin"
+#define NEMO_PREFERENCES_ICON_CACHE_SIZE		"icon-cache-size"
+#define NEMO_PREFERENCES_INFO_REQUESTS_PER_FOLDER	"info-requests-per-folder"
+
+#define NEMO_PREFERENCES_SEARCH_INDEX_ROOTS "search-index-roots"
 
 typedef enum
 {
@@ -252,6 +257,7 @@ typedef enum
 
 /* File operations queue */
 #define NEMO_PREFERENCES_NEVER_QUEUE_FILE_OPS          "never-queue-file-ops"
+#define NEMO_PREFERENCES_FILE_OPS_PER_DEVICE           "file-ops-per-device"
 
 #define NEMO_PREFERENCES_CLICK_DOUBLE_PARENT_FOLDER    "click-double-parent-folder"
 
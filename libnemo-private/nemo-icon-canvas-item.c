@@ -180,6 +180,7 @@ static void     draw_pixbuf                          (GdkPixbuf
 						      cairo_t                       *cr,
 						      int                            x,
 						      int                            y);
+static PangoFontDescription *get_label_font_description (NemoIconCanvasItem *item);
 static PangoLayout *get_label_layout                 (PangoLayout                  **layout,
 						      NemoIconCanvasItem        *item,
 						      const char                    *text);
@@ -244,6 +245,7 @@ nemo_icon_canvas_item_finalize (GObject *object)
 	}
 
 	g_free (details->embedded_text);
+	g_free (NEMO_ICON_CANVAS_ITEM (object)->tooltip);
 
 	G_OBJECT_CLASS (nemo_icon_canvas_item_parent_class)->finalize (object);
 }
@@ -632,33 +634,47 @@ recompute_bounding_box (NemoIconCanvasItem *icon_item,
 			  &item->x2, &item->y2);
 }
 
+static void
+get_item_measure (const NemoIconCanvasItem *item,
+		  NemoIconCanvasItemMeasure *measure)
+{
+	get_scaled_icon_size ((NemoIconCanvasItem *) item,
+			      &measure->icon_width, &measure->icon_height);
+	measure->text_width = item->details->text_width;
+	measure->text_dx = item->details->text_dx;
+	measure->text_height = item->details->text_height;
+	measure->text_height_for_layout = item->details->text_height_for_layout;
+	measure->text_height_for_entire_text = item->details->text_height_for_entire_text;
+}
+
 static EelIRect
-compute_text_rectangle (const NemoIconCanvasItem *item,
-			EelIRect icon_rectangle,
-			gboolean canvas_coords,
-			NemoIconCanvasItemBoundsUsage usage)
+compute_text_rectangle_for_measure (EelCanvas *canvas,
+				    const NemoIconCanvasItemMeasure *measure,
+				    EelIRect icon_rectangle,
+				    gboolean canvas_coords,
+				    NemoIconCanvasItemBoundsUsage usage)
 {
 	EelIRect text_rectangle;
 	double pixels_per_unit;
 	double text_width, text_height, text_height_for_layout, text_height_for_entire_text, real_text_height, text_dx;
 
-	pixels_per_unit = EEL_CANVAS_ITEM (item)->canvas->pixels_per_unit;
+	pixels_per_unit = canvas->pixels_per_unit;
 	if (canvas_coords) {
-		text_width = item->details->text_width;
-		text_height = item->details->text_height;
-		text_height_for_layout = item->details->text_height_for_layout;
-		text_height_for_entire_text = item->details->text_height_for_entire_text;
-		text_dx = item->details->text_dx;
+		text_width = measure->text_width;
+		text_height = measure->text_height;
+		text_height_for_layout = measure->text_height_for_layout;
+		text_height_for_entire_text = measure->text_height_for_entire_text;
+		text_dx = measure->text_dx;
 	} else {
-		text_width = item->details->text_width / pixels_per_unit;
-		text_height = item->details->text_height / pixels_per_unit;
-		text_height_for_layout = item->details->text_height_for_layout / pixels_per_unit;
-		text_height_for_entire_text = item->details->text_height_for_entire_text / pixels_per_unit;
-		text_dx = item->details->text_dx / pixels_per_unit;
+		text_width = measure->text_width / pixels_per_unit;
+		text_height = measure->text_height / pixels_per_unit;
+		text_height_for_layout = measure->text_height_for_layout / pixels_per_unit;
+		text_height_for_entire_text = measure->text_height_for_entire_text / pixels_per_unit;
+		text_dx = measure->text_dx / pixels_per_unit;
 	}
 	
-	if (NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas)->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
-		if (!nemo_icon_container_is_layout_rtl (NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas))) {
+	if (NEMO_ICON_CONTAINER (canvas)->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
+		if (!nemo_icon_container_is_layout_rtl (NEMO_ICON_CONTAINER (canvas))) {
                 	text_rectangle.x0 = icon_rectangle.x1;
                 	text_rectangle.x1 = text_rectangle.x0 + text_dx + text_width;
 		} else {
@@ -708,6 +724,20 @@ compute_text_rectangle (const NemoIconCanvasItem *item,
 	return text_rectangle;
 }
 
+static EelIRect
+compute_text_rectangle (const NemoIconCanvasItem *item,
+			EelIRect icon_rectangle,
+			gboolean canvas_coords,
+			NemoIconCanvasItemBoundsUsage usage)
+{
+	NemoIconCanvasItemMeasure measure;
+
+	get_item_measure (item, &measure);
+
+	return compute_text_rectangle_for_measure (EEL_CANVAS_ITEM (item)->canvas, &measure,
+						   icon_rectangle, canvas_coords, usage);
+}
+
 static EelIRect
 get_current_canvas_bounds (EelCanvasItem *item)
 {
@@ -747,6 +777,11 @@ nemo_icon_canvas_item_update_bounds (NemoIconCanvasItem *item,
 	item->details->text_rect = compute_text_rectangle (item, item->details->canvas_rect,
 							   TRUE, BOUNDS_USAGE_FOR_DISPLAY);
 
+	if (item->user_data != NULL) {
+		nemo_icon_container_update_icon_index (NEMO_ICON_CONTAINER (canvas_item->canvas),
+						       item->user_data);
+	}
+
 	/* queue a redraw. */
 	eel_canvas_request_redraw (canvas_item->canvas,
 				   before.x0, before.y0,
@@ -867,55 +902,277 @@ prepare_pango_layout_width (NemoIconCanvasItem *item,
 	}
 }
 
-static void
-prepare_pango_layout_for_measure_entire_text (NemoIconCanvasItem *item,
-					      PangoLayout *layout)
+/* The pango_layout_set_height() value for measuring the entire text */
+static int
+get_layout_height_for_entire_text (NemoIconCanvasItem *item)
 {
 	NemoIconContainer *container;
 
-	prepare_pango_layout_width (item, layout);
-
 	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 
 	if (IS_COMPACT_VIEW (container)) {
-		pango_layout_set_height (layout, -1);
+		return -1;
 	} else {
-		pango_layout_set_height (layout, G_MININT);
+		return G_MININT;
 	}
 }
 
-static void
-prepare_pango_layout_for_draw (NemoIconCanvasItem *item,
-			       PangoLayout *layout)
+/* The pango_layout_set_height() value for the text as it is drawn */
+static int
+get_layout_height_for_draw (NemoIconCanvasItem *item)
 {
 	NemoIconCanvasItemDetails *details;
 	NemoIconContainer *container;
 	gboolean needs_highlight;
 
-	prepare_pango_layout_width (item, layout);
-
 	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 	details = item->details;
 
 	needs_highlight = details->is_highlighted_for_selection || details->is_highlighted_for_drop;
 
 	if (IS_COMPACT_VIEW (container)) {
-		pango_layout_set_height (layout, -1);
+		return -1;
 	} else if (needs_highlight ||
 		   details->is_prelit ||
 		   details->is_highlighted_as_keyboard_focus ||
 		   details->entire_text ||
 		   container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
 		/* VOODOO-TODO, cf. compute_text_rectangle() */
-		pango_layout_set_height (layout, G_MININT);
+		return G_MININT;
 	} else {
 		/* TODO? we might save some resources, when the re-layout is not neccessary in case
 		 * the layout height already fits into max. layout lines. But pango should figure this
 		 * out itself (which it doesn't ATM).
 		 */
-		pango_layout_set_height (layout,
-					 nemo_icon_container_get_max_layout_lines_for_pango (container));
+		return nemo_icon_container_get_max_layout_lines_for_pango (container);
+	}
+}
+
+static void
+prepare_pango_layout_for_draw (NemoIconCanvasItem *item,
+			       PangoLayout *layout)
+{
+	prepare_pango_layout_width (item, layout);
+	pango_layout_set_height (layout, get_layout_height_for_draw (item));
+}
+
+/* Sizes of laid out labels, shared by all items. Labels are measured
+ * again whenever anything about the view changes, a zoom or a resort
+ * for instance, and mostly come back with the same text, font and
+ * width, which makes this a lookup instead of a pango layout.
+ */
+typedef struct {
+	int width;
+	int height;
+	int dx;
+	int height_for_layout;
+} LabelSize;
+
+/* Once there are more than this, the cache starts over */
+#define LABEL_SIZE_CACHE_MAX_ENTRIES 50000
+
+static GHashTable *label_size_cache;
+
+/* Everything create_label_layout() and the measuring depend on. The
+ * font is either the font string of the container, or the font of
+ * the widget with the size offset of the zoom level. Lookups point
+ * into the item and the widget, only keys that go into the cache own
+ * copies.
+ */
+typedef struct {
+	const char *text;
+	const char *font;
+	const PangoFontDescription *base_font;
+	int font_size_offset;
+	const cairo_font_options_t *font_options;
+	double resolution;
+	int scale_factor;
+	int width;
+	int layout_height;
+	int max_layout_lines;
+	NemoIconLabelPosition label_position;
+	gboolean rtl;
+	PangoDirection base_dir;
+	guint hash;
+} LabelSizeKey;
+
+static void
+get_label_size_key (NemoIconCanvasItem *item,
+		    const char *text,
+		    int layout_height,
+		    int max_layout_lines,
+		    LabelSizeKey *key)
+{
+	NemoIconContainer *container;
+	EelCanvas *canvas;
+	PangoContext *context;
+	guint hash;
+
+	canvas = EEL_CANVAS_ITEM (item)->canvas;
+	container = NEMO_ICON_CONTAINER (canvas);
+	context = gtk_widget_get_pango_context (GTK_WIDGET (canvas));
+
+	/* Same choice as get_label_font_description() */
+	key->text = text;
+	key->font = container->details->font;
+	if (key->font != NULL) {
+		key->base_font = NULL;
+		key->font_size_offset = 0;
+	} else {
+		key->base_font = pango_context_get_font_description (context);
+		key->font_size_offset = container->details->font_size_table[container->details->zoom_level];
+	}
+	key->font_options = pango_cairo_context_get_font_options (context);
+	key->resolution = pango_cairo_context_get_resolution (context);
+	key->scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (canvas));
+	key->width = (int) floor (nemo_icon_canvas_item_get_max_text_width (item));
+	key->layout_height = layout_height;
+	key->max_layout_lines = max_layout_lines;
+	key->label_position = container->details->label_position;
+	key->rtl = nemo_icon_container_is_layout_rtl (container);
+	key->base_dir = pango_context_get_base_dir (context);
+
+	hash = g_str_hash (text);
+	hash = hash * 31 + (key->font != NULL ? g_str_hash (key->font) : 0);
+	hash = hash * 31 + (key->base_font != NULL ? pango_font_description_hash (key->base_font) : 0);
+	hash = hash * 31 + key->font_size_offset;
+	hash = hash * 31 + (key->font_options != NULL ? cairo_font_options_hash (key->font_options) : 0);
+	hash = hash * 31 + (guint) key->resolution;
+	hash = hash * 31 + key->scale_factor;
+	hash = hash * 31 + key->width;
+	hash = hash * 31 + key->layout_height;
+	hash = hash * 31 + key->max_layout_lines;
+	hash = hash * 31 + (key->label_position << 2 | key->rtl << 1 | (key->base_dir == PANGO_DIRECTION_RTL));
+	key->hash = hash;
+}
+
+static guint
+label_size_key_hash (gconstpointer key)
+{
+	return ((const LabelSizeKey *) key)->hash;
+}
+
+static gboolean
+label_size_key_equal (gconstpointer a,
+		      gconstpointer b)
+{
+	const LabelSizeKey *key_a = a;
+	const LabelSizeKey *key_b = b;
+
+	if (key_a->hash != key_b->hash ||
+	    key_a->font_size_offset != key_b->font_size_offset ||
+	    key_a->resolution != key_b->resolution ||
+	    key_a->scale_factor != key_b->scale_factor ||
+	    key_a->width != key_b->width ||
+	    key_a->layout_height != key_b->layout_height ||
+	    key_a->max_layout_lines != key_b->max_layout_lines ||
+	    key_a->label_position != key_b->label_position ||
+	    key_a->rtl != key_b->rtl ||
+	    key_a->base_dir != key_b->base_dir) {
+		return FALSE;
+	}
+
+	if (g_strcmp0 (key_a->font, key_b->font) != 0) {
+		return FALSE;
+	}
+
+	if (key_a->base_font != key_b->base_font &&
+	    (key_a->base_font == NULL || key_b->base_font == NULL ||
+	     !pango_font_description_equal (key_a->base_font, key_b->base_font))) {
+		return FALSE;
 	}
+
+	if (key_a->font_options != key_b->font_options &&
+	    (key_a->font_options == NULL || key_b->font_options == NULL ||
+	     !cairo_font_options_equal (key_a->font_options, key_b->font_options))) {
+		return FALSE;
+	}
+
+	return strcmp (key_a->text, key_b->text) == 0;
+}
+
+static LabelSizeKey *
+label_size_key_copy (const LabelSizeKey *key)
+{
+	LabelSizeKey *copy;
+
+	copy = g_slice_dup (LabelSizeKey, key);
+	copy->text = g_strdup (key->text);
+	copy->font = g_strdup (key->font);
+	if (key->base_font != NULL) {
+		copy->base_font = pango_font_description_copy (key->base_font);
+	}
+	if (key->font_options != NULL) {
+		copy->font_options = cairo_font_options_copy (key->font_options);
+	}
+
+	return copy;
+}
+
+static void
+label_size_key_free (gpointer data)
+{
+	LabelSizeKey *key = data;
+
+	g_free ((char *) key->text);
+	g_free ((char *) key->font);
+	if (key->base_font != NULL) {
+		pango_font_description_free ((PangoFontDescription *) key->base_font);
+	}
+	if (key->font_options != NULL) {
+		cairo_font_options_destroy ((cairo_font_options_t *) key->font_options);
+	}
+	g_slice_free (LabelSizeKey, key);
+}
+
+/* Measures text as a label layout with the given height would lay it
+ * out. height_for_layout is only computed when max_layout_lines is
+ * positive.
+ */
+static void
+measure_label_layout (NemoIconCanvasItem *item,
+		      PangoLayout **layout_cache,
+		      const char *text,
+		      int layout_height,
+		      int max_layout_lines,
+		      LabelSize *size_out)
+{
+	PangoLayout *layout;
+	LabelSize *size;
+	LabelSizeKey key;
+
+	if (label_size_cache == NULL) {
+		label_size_cache = g_hash_table_new_full (label_size_key_hash,
+							  label_size_key_equal,
+							  label_size_key_free,
+							  g_free);
+	}
+
+	get_label_size_key (item, text, layout_height, max_layout_lines, &key);
+	size = g_hash_table_lookup (label_size_cache, &key);
+	if (size != NULL) {
+		*size_out = *size;
+		return;
+	}
+
+	layout = get_label_layout (layout_cache, item, text);
+	prepare_pango_layout_width (item, layout);
+	pango_layout_set_height (layout, layout_height);
+
+	size = g_new0 (LabelSize, 1);
+	layout_get_full_size (layout, &size->width, &size->height, &size->dx);
+	if (max_layout_lines > 0) {
+		layout_get_size_for_layout (layout, max_layout_lines,
+					    size->height, &size->height_for_layout);
+	}
+	g_object_unref (layout);
+
+	if (g_hash_table_size (label_size_cache) >= LABEL_SIZE_CACHE_MAX_ENTRIES) {
+		g_hash_table_remove_all (label_size_cache);
+	}
+	g_hash_table_insert (label_size_cache, label_size_key_copy (&key), size);
+
+	*size_out = *size;
 }
 
 static void
@@ -925,8 +1182,7 @@ measure_label_text (NemoIconCanvasItem *item)
 	NemoIconContainer *container;
 	gint editable_height, editable_height_for_layout, editable_height_for_entire_text, editable_width, editable_dx;
 	gint additional_height, additional_width, additional_dx;
-	PangoLayout *editable_layout;
-	PangoLayout *additional_layout;
+	LabelSize size;
 	gboolean have_editable, have_additional;
 
 	/* check to see if the cached values are still valid; if so, there's
@@ -970,38 +1226,34 @@ measure_label_text (NemoIconCanvasItem *item)
 	additional_dx = 0;
 
 	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);	
-	editable_layout = NULL;
-	additional_layout = NULL;
 
 	if (have_editable) {
 		/* first, measure required text height: editable_height_for_entire_text
 		 * then, measure text height applicable for layout: editable_height_for_layout
 		 * next, measure actually displayed height: editable_height
 		 */
-		editable_layout = get_label_layout (&details->editable_text_layout, item, details->editable_text);
-
-		prepare_pango_layout_for_measure_entire_text (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      NULL,
-				      &editable_height_for_entire_text,
-				      NULL);
-		layout_get_size_for_layout (editable_layout,
-					    nemo_icon_container_get_max_layout_lines (container),
-					    editable_height_for_entire_text,
-					    &editable_height_for_layout);
+		measure_label_layout (item, &details->editable_text_layout, details->editable_text,
+				      get_layout_height_for_entire_text (item),
+				      nemo_icon_container_get_max_layout_lines (container),
+				      &size);
+		editable_height_for_entire_text = size.height;
+		editable_height_for_layout = size.height_for_layout;
 
-		prepare_pango_layout_for_draw (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      &editable_width,
-				      &editable_height,
-				      &editable_dx);
+		measure_label_layout (item, &details->editable_text_layout, details->editable_text,
+				      get_layout_height_for_draw (item), 0,
+				      &size);
+		editable_width = size.width;
+		editable_height = size.height;
+		editable_dx = size.dx;
 	}
 
 	if (have_additional) {
-		additional_layout = get_label_layout (&details->additional_text_layout, item, details->additional_text);
-		prepare_pango_layout_for_draw (item, additional_layout);
-		layout_get_full_size (additional_layout,
-				      &additional_width, &additional_height, &additional_dx);
+		measure_label_layout (item, &details->additional_text_layout, details->additional_text,
+				      get_layout_height_for_draw (item), 0,
+				      &size);
+		additional_width = size.width;
+		additional_height = size.height;
+		additional_dx = size.dx;
 	}
 
 	details->editable_text_height = editable_height;
@@ -1034,14 +1286,6 @@ measure_label_text (NemoIconCanvasItem *item)
 
 	/* extra to make it look nicer */
 	details->text_width += TEXT_BACK_PADDING_X*2;
-
-	if (editable_layout) {
-		g_object_unref (editable_layout);
-	}
-
-	if (additional_layout) {
-		g_object_unref (additional_layout);
-	}
 }
 
 static void
@@ -1230,6 +1474,47 @@ nemo_icon_canvas_item_set_is_visible (NemoIconCanvasItem       *item,
 	}
 }
 
+/* nemo_icon_canvas_item_reset
+ *
+ * Drop everything the item shows for its current icon, so the
+ * container can park it in its pool and later hand it to another icon.
+ */
+void
+nemo_icon_canvas_item_reset (NemoIconCanvasItem *item)
+{
+	NemoIconCanvasItemDetails *details;
+
+	g_return_if_fail (NEMO_IS_ICON_CANVAS_ITEM (item));
+
+	details = item->details;
+
+	nemo_icon_canvas_item_set_image (item, NULL);
+	g_object_set (item,
+		      "editable_text", NULL,
+		      "additional_text", NULL,
+		      "highlighted_for_selection", FALSE,
+		      "highlighted_as_keyboard_focus", FALSE,
+		      "highlighted_for_drop", FALSE,
+		      "highlighted_for_clipboard", FALSE,
+		      NULL);
+	nemo_icon_canvas_item_set_attach_points (item, NULL, 0);
+	nemo_icon_canvas_item_set_embedded_text (item, NULL);
+	nemo_icon_canvas_item_set_tooltip_text (item, NULL);
+
+	details->is_prelit = FALSE;
+	details->show_stretch_handles = FALSE;
+	details->is_renaming = FALSE;
+	details->entire_text = FALSE;
+
+	if (details->cursor_window != NULL) {
+		gdk_window_set_cursor (details->cursor_window, NULL);
+		g_clear_object (&details->cursor_window);
+	}
+
+	nemo_icon_canvas_item_set_is_visible (item, FALSE);
+	nemo_icon_canvas_item_invalidate_label (item);
+}
+
 void
 nemo_icon_canvas_item_invalidate_label (NemoIconCanvasItem     *item)
 {
@@ -1510,6 +1795,28 @@ nemo_icon_canvas_item_draw (EelCanvasItem *item,
 #define ZERO_WIDTH_SPACE "\xE2\x80\x8B"
 
 
+static PangoFontDescription *
+get_label_font_description (NemoIconCanvasItem *item)
+{
+	NemoIconContainer *container;
+	PangoContext *context;
+	PangoFontDescription *desc;
+
+	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+
+	if (container->details->font) {
+		desc = pango_font_description_from_string (container->details->font);
+	} else {
+		context = gtk_widget_get_pango_context (GTK_WIDGET (container));
+		desc = pango_font_description_copy (pango_context_get_font_description (context));
+		pango_font_description_set_size (desc,
+						 pango_font_description_get_size (desc) +
+						 container->details->font_size_table [container->details->zoom_level]);
+	}
+
+	return desc;
+}
+
 static PangoLayout *
 create_label_layout (NemoIconCanvasItem *item,
 		     const char *text)
@@ -1564,14 +1871,7 @@ create_label_layout (NemoIconCanvasItem *item,
 	pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
 
 	/* Create a font description */
-	if (container->details->font) {
-		desc = pango_font_description_from_string (container->details->font);
-	} else {
-		desc = pango_font_description_copy (pango_context_get_font_description (context));
-		pango_font_description_set_size (desc,
-						 pango_font_description_get_size (desc) +
-						 container->details->font_size_table [container->details->zoom_level]);
-	}
+	desc = get_label_font_description (item);
 	pango_layout_set_font_description (layout, desc);
 	pango_font_description_free (desc);
 	g_free (zeroified_text);
@@ -1812,72 +2112,118 @@ nemo_icon_canvas_item_bounds (EelCanvasItem *item,
 	*y2 = (int)details->y + total_rect->y1 + 1;
 }
 
+/* Get the bounds of an icon and its label relative to the icon's
+ * position, in world coordinates.
+ */
+static EelIRect
+compute_bounds_for_measure (EelCanvas *canvas,
+			    const NemoIconCanvasItemMeasure *measure,
+			    NemoIconCanvasItemBoundsUsage usage)
+{
+	EelIRect icon_rect, text_rect, total_rect;
+	double pixels_per_unit;
+
+	pixels_per_unit = canvas->pixels_per_unit;
+
+	icon_rect.x0 = 0;
+	icon_rect.y0 = 0;
+	icon_rect.x1 = measure->icon_width / pixels_per_unit;
+	icon_rect.y1 = measure->icon_height / pixels_per_unit;
+
+	text_rect = compute_text_rectangle_for_measure (canvas, measure, icon_rect, FALSE, usage);
+
+	eel_irect_union (&total_rect, &icon_rect, &text_rect);
+
+	return total_rect;
+}
+
 static void
 nemo_icon_canvas_item_ensure_bounds_up_to_date (NemoIconCanvasItem *icon_item)
 {
 	NemoIconCanvasItemDetails *details;
-	EelIRect icon_rect, icon_rect_raw;
-	EelIRect text_rect, text_rect_for_layout, text_rect_for_entire_text;
-	EelIRect total_rect, total_rect_for_layout, total_rect_for_entire_text;
-	EelCanvasItem *item;
-	double pixels_per_unit;
-    gint width, height;
+	NemoIconCanvasItemMeasure measure;
+	EelCanvas *canvas;
 	
 	details = icon_item->details;
-	item = EEL_CANVAS_ITEM (icon_item);
+	canvas = EEL_CANVAS_ITEM (icon_item)->canvas;
 
 	if (!details->bounds_cached) {
 		measure_label_text (icon_item);
+		get_item_measure (icon_item, &measure);
 
-		pixels_per_unit = EEL_CANVAS_ITEM (item)->canvas->pixels_per_unit;
+		details->bounds_cache = compute_bounds_for_measure (canvas, &measure, BOUNDS_USAGE_FOR_DISPLAY);
+		details->bounds_cache_for_layout = compute_bounds_for_measure (canvas, &measure, BOUNDS_USAGE_FOR_LAYOUT);
+		details->bounds_cache_for_entire_item = compute_bounds_for_measure (canvas, &measure, BOUNDS_USAGE_FOR_ENTIRE_ITEM);
+		details->bounds_cached = TRUE;
+	}
+}
+
+static EelDRect
+get_icon_rectangle_for_measure (EelCanvas *canvas,
+				const NemoIconCanvasItemMeasure *measure,
+				double x, double y)
+{
+	EelDRect rectangle;
 
-		/* Compute raw and scaled icon rectangle. */
-		icon_rect.x0 = 0;
-		icon_rect.y0 = 0;
-		icon_rect_raw.x0 = 0;
-		icon_rect_raw.y0 = 0;
+	rectangle.x0 = x;
+	rectangle.y0 = y;
+	rectangle.x1 = rectangle.x0 + measure->icon_width / canvas->pixels_per_unit;
+	rectangle.y1 = rectangle.y0 + measure->icon_height / canvas->pixels_per_unit;
+
+	return rectangle;
+}
 
-        get_scaled_icon_size (icon_item, &width, &height);
+static EelDRect
+get_text_rectangle_for_measure (EelCanvas *canvas,
+				const NemoIconCanvasItemMeasure *measure,
+				double x, double y,
+				gboolean for_layout)
+{
+	EelIRect icon_rectangle;
+	EelIRect text_rectangle;
+	EelDRect ret;
 
-        icon_rect_raw.x1 = icon_rect_raw.x0 + width;
-        icon_rect_raw.y1 = icon_rect_raw.y0 + height;
-        icon_rect.x1 = icon_rect_raw.x1 / pixels_per_unit;
-        icon_rect.y1 = icon_rect_raw.y1 / pixels_per_unit;
+	icon_rectangle.x0 = x;
+	icon_rectangle.y0 = y;
+	icon_rectangle.x1 = icon_rectangle.x0 + measure->icon_width / canvas->pixels_per_unit;
+	icon_rectangle.y1 = icon_rectangle.y0 + measure->icon_height / canvas->pixels_per_unit;
 
-		/* Compute text rectangle. */
-		text_rect = compute_text_rectangle (icon_item, icon_rect, FALSE, BOUNDS_USAGE_FOR_DISPLAY);
-		text_rect_for_layout = compute_text_rectangle (icon_item, icon_rect, FALSE, BOUNDS_USAGE_FOR_LAYOUT);
-		text_rect_for_entire_text = compute_text_rectangle (icon_item, icon_rect, FALSE, BOUNDS_USAGE_FOR_ENTIRE_ITEM);
+	text_rectangle = compute_text_rectangle_for_measure (canvas, measure, icon_rectangle, FALSE,
+							     for_layout ? BOUNDS_USAGE_FOR_LAYOUT : BOUNDS_USAGE_FOR_DISPLAY);
 
-		/* Compute total rectangle */
-		eel_irect_union (&total_rect, &icon_rect, &text_rect);
-		eel_irect_union (&total_rect_for_layout, &icon_rect, &text_rect_for_layout);
-		eel_irect_union (&total_rect_for_entire_text, &icon_rect, &text_rect_for_entire_text);
+	ret.x0 = text_rectangle.x0;
+	ret.y0 = text_rectangle.y0;
+	ret.x1 = text_rectangle.x1;
+	ret.y1 = text_rectangle.y1;
 
-		details->bounds_cache = total_rect;
-		details->bounds_cache_for_layout = total_rect_for_layout;
-		details->bounds_cache_for_entire_item = total_rect_for_entire_text;
-		details->bounds_cached = TRUE;
-	}
+	return ret;
+}
+
+/* Get the rectangle of the icon only, in canvas coordinates. */
+static void
+get_icon_canvas_rectangle_for_measure (EelCanvas *canvas,
+				       const NemoIconCanvasItemMeasure *measure,
+				       double x, double y,
+				       EelIRect *rect)
+{
+	eel_canvas_w2c (canvas, x, y, &rect->x0, &rect->y0);
+
+	rect->x1 = rect->x0 + measure->icon_width;
+	rect->y1 = rect->y0 + measure->icon_height;
 }
 
 /* Get the rectangle of the icon only, in world coordinates. */
 EelDRect
 nemo_icon_canvas_item_get_icon_rectangle (const NemoIconCanvasItem *item)
 {
+	NemoIconCanvasItemMeasure measure;
 	EelDRect rectangle;
-	double pixels_per_unit;
-    gint width, height;
 	
 	g_return_val_if_fail (NEMO_IS_ICON_CANVAS_ITEM (item), eel_drect_empty);
 
-	rectangle.x0 = item->details->x;
-	rectangle.y0 = item->details->y;
-
-	pixels_per_unit = EEL_CANVAS_ITEM (item)->canvas->pixels_per_unit;
-    get_scaled_icon_size (NEMO_ICON_CANVAS_ITEM (item), &width, &height);
-    rectangle.x1 = rectangle.x0 + width / pixels_per_unit;
-    rectangle.y1 = rectangle.y0 + height / pixels_per_unit;
+	get_item_measure (item, &measure);
+	rectangle = get_icon_rectangle_for_measure (EEL_CANVAS_ITEM (item)->canvas, &measure,
+						    item->details->x, item->details->y);
 
 	eel_canvas_item_i2w (EEL_CANVAS_ITEM (item),
 			     &rectangle.x0,
@@ -1893,32 +2239,17 @@ EelDRect
 nemo_icon_canvas_item_get_text_rectangle (NemoIconCanvasItem *item,
 					      gboolean for_layout)
 {
-	/* FIXME */
-	EelIRect icon_rectangle;
-	EelIRect text_rectangle;
+	NemoIconCanvasItemMeasure measure;
 	EelDRect ret;
-	double pixels_per_unit;
-    gint width, height;
 	
 	g_return_val_if_fail (NEMO_IS_ICON_CANVAS_ITEM (item), eel_drect_empty);
 
-	icon_rectangle.x0 = item->details->x;
-	icon_rectangle.y0 = item->details->y;
-
-	pixels_per_unit = EEL_CANVAS_ITEM (item)->canvas->pixels_per_unit;
-    get_scaled_icon_size (item, &width, &height);
-    icon_rectangle.x1 = icon_rectangle.x0 + width / pixels_per_unit;
-    icon_rectangle.y1 = icon_rectangle.y0 + height / pixels_per_unit;
-
 	measure_label_text (item);
+	get_item_measure (item, &measure);
 
-	text_rectangle = compute_text_rectangle (item, icon_rectangle, FALSE,
-						 for_layout ? BOUNDS_USAGE_FOR_LAYOUT : BOUNDS_USAGE_FOR_DISPLAY);
- 
-	ret.x0 = text_rectangle.x0;
-	ret.y0 = text_rectangle.y0;
-	ret.x1 = text_rectangle.x1;
-	ret.y1 = text_rectangle.y1;
+	ret = get_text_rectangle_for_measure (EEL_CANVAS_ITEM (item)->canvas, &measure,
+					      item->details->x, item->details->y,
+					      for_layout);
 
         eel_canvas_item_i2w (EEL_CANVAS_ITEM (item),
                              &ret.x0,
@@ -1936,21 +2267,108 @@ static void
 get_icon_canvas_rectangle (NemoIconCanvasItem *item,
 			   EelIRect *rect)
 {
-    gint width, height;
+	NemoIconCanvasItemMeasure measure;
 
 	g_assert (NEMO_IS_ICON_CANVAS_ITEM (item));
 	g_assert (rect != NULL);
 
-	eel_canvas_w2c (EEL_CANVAS_ITEM (item)->canvas,
-			item->details->x,
-			item->details->y,
-			&rect->x0,
-			&rect->y0);
-	
-    get_scaled_icon_size (item, &width, &height);
-	
-	rect->x1 = rect->x0 + width;
-    rect->y1 = rect->y0 + height;
+	get_item_measure (item, &measure);
+	get_icon_canvas_rectangle_for_measure (EEL_CANVAS_ITEM (item)->canvas, &measure,
+					       item->details->x, item->details->y,
+					       rect);
+}
+
+/* nemo_icon_canvas_item_get_measure
+ *
+ * Measure the item's label if needed and return the size of its
+ * image and label, so the container can keep the geometry of an icon
+ * after handing its item to another icon.
+ */
+void
+nemo_icon_canvas_item_get_measure (NemoIconCanvasItem *item,
+				   NemoIconCanvasItemMeasure *measure)
+{
+	g_return_if_fail (NEMO_IS_ICON_CANVAS_ITEM (item));
+	g_return_if_fail (measure != NULL);
+
+	measure_label_text (item);
+	get_item_measure (item, measure);
+}
+
+EelDRect
+nemo_icon_canvas_item_measure_get_icon_rectangle (EelCanvas *canvas,
+						  const NemoIconCanvasItemMeasure *measure,
+						  double x, double y)
+{
+	g_return_val_if_fail (EEL_IS_CANVAS (canvas), eel_drect_empty);
+	g_return_val_if_fail (measure != NULL, eel_drect_empty);
+
+	return get_icon_rectangle_for_measure (canvas, measure, x, y);
+}
+
+EelDRect
+nemo_icon_canvas_item_measure_get_text_rectangle (EelCanvas *canvas,
+						  const NemoIconCanvasItemMeasure *measure,
+						  double x, double y,
+						  gboolean for_layout)
+{
+	g_return_val_if_fail (EEL_IS_CANVAS (canvas), eel_drect_empty);
+	g_return_val_if_fail (measure != NULL, eel_drect_empty);
+
+	return get_text_rectangle_for_measure (canvas, measure, x, y, for_layout);
+}
+
+/* Same rounding as nemo_icon_canvas_item_get_bounds and friends, so an
+ * icon keeps its place when its item is released or recycled.
+ */
+void
+nemo_icon_canvas_item_measure_get_bounds (EelCanvas *canvas,
+					  const NemoIconCanvasItemMeasure *measure,
+					  double x, double y,
+					  NemoIconCanvasItemBoundsUsage usage,
+					  double *x1, double *y1, double *x2, double *y2)
+{
+	EelIRect total_rect;
+
+	g_return_if_fail (EEL_IS_CANVAS (canvas));
+	g_return_if_fail (measure != NULL);
+
+	total_rect = compute_bounds_for_measure (canvas, measure, usage);
+
+	if (x1 != NULL) {
+		*x1 = (int)x + total_rect.x0;
+	}
+	if (y1 != NULL) {
+		*y1 = (int)y + total_rect.y0;
+	}
+	if (x2 != NULL) {
+		*x2 = (int)x + total_rect.x1 + 1;
+	}
+	if (y2 != NULL) {
+		*y2 = (int)y + total_rect.y1 + 1;
+	}
+}
+
+gboolean
+nemo_icon_canvas_item_measure_hit_test_rectangle (EelCanvas *canvas,
+						  const NemoIconCanvasItemMeasure *measure,
+						  double x, double y,
+						  NemoIconCanvasItemBoundsUsage usage,
+						  EelIRect canvas_rect)
+{
+	EelIRect icon_rect, text_rect;
+
+	g_return_val_if_fail (EEL_IS_CANVAS (canvas), FALSE);
+	g_return_val_if_fail (measure != NULL, FALSE);
+
+	get_icon_canvas_rectangle_for_measure (canvas, measure, x, y, &icon_rect);
+	if (eel_irect_hits_irect (icon_rect, canvas_rect)) {
+		return TRUE;
+	}
+
+	text_rect = compute_text_rectangle_for_measure (canvas, measure, icon_rect,
+							TRUE, usage);
+	return eel_irect_hits_irect (text_rect, canvas_rect);
 }
 
 void
@@ -2261,6 +2679,11 @@ nemo_icon_canvas_item_accessible_idle_do_action (gpointer data)
 		g_free (ctx);
 		icon = item->user_data;
 
+		/* The item went back to the container's pool */
+		if (icon == NULL) {
+			continue;
+		}
+
 		switch (action_number) {
 		case ACTION_OPEN:
 			file_list.data = icon->data;
@@ -2488,6 +2911,9 @@ nemo_icon_canvas_item_accessible_get_image_description (AtkImage *image)
 			return NULL;
 		}
 		icon = item->user_data;
+		if (icon == NULL) {
+			return NULL;
+		}
 		container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 		description = nemo_icon_container_get_icon_description (container, icon->data);
 		g_free (priv->description);
@@ -2942,5 +3368,6 @@ nemo_icon_canvas_item_accessible_factory_class_init (NemoIconCanvasItemAccessibl
 void
 nemo_icon_canvas_item_set_tooltip_text            (NemoIconCanvasItem *item, const gchar *text)
 {
+    g_free (item->tooltip);
     item->tooltip = g_strdup (text);
 }
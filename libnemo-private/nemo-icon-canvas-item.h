@@ -64,6 +64,20 @@ typedef enum {
 	BOUNDS_USAGE_FOR_DISPLAY
 } NemoIconCanvasItemBoundsUsage;
 
+/* The size of an item's image and label, in canvas pixels. This is
+ * enough to place an icon and hit test it without an item, see
+ * nemo_icon_canvas_item_get_measure().
+ */
+typedef struct {
+	int icon_width;
+	int icon_height;
+	int text_width;
+	int text_dx;
+	int text_height;
+	int text_height_for_layout;
+	int text_height_for_entire_text;
+} NemoIconCanvasItemMeasure;
+
 /* GObject */
 GType       nemo_icon_canvas_item_get_type                 (void);
 
@@ -107,11 +121,33 @@ void        nemo_icon_canvas_item_update_bounds            (NemoIconCanvasItem
 								double i2w_dx, double i2w_dy);
 void        nemo_icon_canvas_item_set_is_visible           (NemoIconCanvasItem       *item,
 								gboolean                      visible);
+void        nemo_icon_canvas_item_reset                    (NemoIconCanvasItem       *item);
 /* whether the entire label text must be visible at all times */
 void        nemo_icon_canvas_item_set_entire_text          (NemoIconCanvasItem       *icon_item,
 								gboolean                      entire_text);
 void        nemo_icon_canvas_item_set_tooltip_text         (NemoIconCanvasItem *item, const gchar *text);
 
+/* geometry of an icon that has no item, at x, y in world coordinates */
+void        nemo_icon_canvas_item_get_measure              (NemoIconCanvasItem              *item,
+								NemoIconCanvasItemMeasure       *measure);
+EelDRect    nemo_icon_canvas_item_measure_get_icon_rectangle (EelCanvas                     *canvas,
+								  const NemoIconCanvasItemMeasure *measure,
+								  double x, double y);
+EelDRect    nemo_icon_canvas_item_measure_get_text_rectangle (EelCanvas                     *canvas,
+								  const NemoIconCanvasItemMeasure *measure,
+								  double x, double y,
+								  gboolean                       for_layout);
+void        nemo_icon_canvas_item_measure_get_bounds       (EelCanvas                       *canvas,
+								const NemoIconCanvasItemMeasure *measure,
+								double x, double y,
+								NemoIconCanvasItemBoundsUsage    usage,
+								double *x1, double *y1, double *x2, double *y2);
+gboolean    nemo_icon_canvas_item_measure_hit_test_rectangle (EelCanvas                     *canvas,
+								  const NemoIconCanvasItemMeasure *measure,
+								  double x, double y,
+								  NemoIconCanvasItemBoundsUsage    usage,
+								  EelIRect                       canvas_rect);
+
 G_END_DECLS
 
 #endif /* NEMO_ICON_CANVAS_ITEM_H */
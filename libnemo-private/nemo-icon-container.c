@@ -35,6 +35,7 @@
 #include "nemo-lib-self-check-functions.h"
 #include "nemo-selection-canvas-item.h"
 #include "nemo-desktop-utils.h"
+#include "nemo-thumbnails.h"
 #include <atk/atkaction.h>
 #include <eel/eel-accessibility.h>
 #include <eel/eel-vfs-extensions.h>
@@ -165,12 +166,9 @@ static void          end_renaming_mode                              (NemoIconCon
 								     gboolean               commit);
 static NemoIcon *get_icon_being_renamed                         (NemoIconContainer *container);
 static void          finish_adding_new_icons                        (NemoIconContainer *container);
-static inline void   icon_get_bounding_box                          (NemoIcon          *icon,
-								     int                   *x1_return,
-								     int                   *y1_return,
-								     int                   *x2_return,
-								     int                   *y2_return,
-								     NemoIconCanvasItemBoundsUsage usage);
+static void          icon_set_item_content                          (NemoIconContainer *container,
+								     NemoIcon          *icon,
+								     NemoIconCanvasItem *item);
 static gboolean      is_renaming                                    (NemoIconContainer *container);
 static gboolean      is_renaming_pending                            (NemoIconContainer *container);
 static void          process_pending_icon_to_rename                 (NemoIconContainer *container);
@@ -189,6 +187,9 @@ static GList *       nemo_icon_container_get_selected_icons (NemoIconContainer *
 static void          nemo_icon_container_update_visible_icons   (NemoIconContainer *container);
 static void          reveal_icon                                    (NemoIconContainer *container,
 								     NemoIcon *icon);
+static int           item_event_callback                            (EelCanvasItem         *item,
+								     GdkEvent              *event,
+								     gpointer               data);
 
 static void	     nemo_icon_container_set_rtl_positions (NemoIconContainer *container);
 static double	     get_mirror_x_position                     (NemoIconContainer *container,
@@ -266,6 +267,7 @@ enum {
 };
 
 typedef struct {
+	NemoIconContainer *container;
 	int **icon_grid;
 	int *grid_memory;
 	int num_rows;
@@ -290,6 +292,234 @@ tooltip_prefs_changed_callback (NemoIconContainer *container)
 
 /* Functions dealing with NemoIcons.  */
 
+/* Canvas items. On the desktop every icon has an item. Elsewhere only
+ * the icons in or near the visible area have one, see
+ * nemo_icon_container_update_visible_icons(). The other icons are laid
+ * out and hit tested with the measure of their image and label.
+ */
+
+static gboolean
+is_virtualized (NemoIconContainer *container)
+{
+	return !container->details->is_desktop;
+}
+
+/* Items of unpositioned icons stay at 0, 0, see icon_set_position(). */
+static double
+icon_get_item_x (const NemoIcon *icon)
+{
+	return icon->x != ICON_UNPOSITIONED_VALUE ? icon->x : 0;
+}
+
+static double
+icon_get_item_y (const NemoIcon *icon)
+{
+	return icon->y != ICON_UNPOSITIONED_VALUE ? icon->y : 0;
+}
+
+/* Measure an icon that has no item with a hidden item that is shared
+ * by all of them. Icons are measured unselected, see
+ * icon_get_measure_usage().
+ */
+static void
+icon_ensure_measure (NemoIconContainer *container,
+		     NemoIcon *icon)
+{
+	NemoIconContainerDetails *details;
+	NemoIconCanvasItem *item;
+
+	if (icon->item != NULL || icon->measure_valid) {
+		return;
+	}
+
+	details = container->details;
+
+	if (details->measure_item == NULL) {
+		details->measure_item = NEMO_ICON_CANVAS_ITEM
+			(eel_canvas_item_new (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
+					      nemo_icon_canvas_item_get_type (),
+					      "visible", FALSE,
+					      NULL));
+	}
+	item = details->measure_item;
+
+	icon_set_item_content (container, icon, item);
+	nemo_icon_canvas_item_get_measure (item, &icon->measure);
+	nemo_icon_canvas_item_reset (item);
+
+	icon->measure_valid = TRUE;
+}
+
+/* Selected labels, and labels that must show their entire text, are
+ * drawn in full rather than as they were measured.
+ */
+static NemoIconCanvasItemBoundsUsage
+icon_get_measure_usage (const NemoIcon *icon,
+			NemoIconCanvasItemBoundsUsage usage)
+{
+	if (usage == BOUNDS_USAGE_FOR_DISPLAY &&
+	    (icon->is_selected || icon->entire_text)) {
+		return BOUNDS_USAGE_FOR_ENTIRE_ITEM;
+	}
+
+	return usage;
+}
+
+static EelDRect
+icon_get_icon_rectangle (NemoIconContainer *container,
+			 NemoIcon *icon)
+{
+	if (icon->item != NULL) {
+		return nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+	}
+
+	icon_ensure_measure (container, icon);
+	return nemo_icon_canvas_item_measure_get_icon_rectangle (EEL_CANVAS (container),
+								 &icon->measure,
+								 icon_get_item_x (icon),
+								 icon_get_item_y (icon));
+}
+
+static EelDRect
+icon_get_text_rectangle (NemoIconContainer *container,
+			 NemoIcon *icon,
+			 gboolean for_layout)
+{
+	if (icon->item != NULL) {
+		return nemo_icon_canvas_item_get_text_rectangle (icon->item, for_layout);
+	}
+
+	icon_ensure_measure (container, icon);
+	return nemo_icon_canvas_item_measure_get_text_rectangle (EEL_CANVAS (container),
+								 &icon->measure,
+								 icon_get_item_x (icon),
+								 icon_get_item_y (icon),
+								 for_layout);
+}
+
+/* The bounds of the icon in world coordinates */
+static void
+icon_get_world_bounds (NemoIconContainer *container,
+		       NemoIcon *icon,
+		       EelDRect *bounds,
+		       NemoIconCanvasItemBoundsUsage usage)
+{
+	if (icon->item == NULL) {
+		icon_ensure_measure (container, icon);
+		nemo_icon_canvas_item_measure_get_bounds (EEL_CANVAS (container),
+							  &icon->measure,
+							  icon_get_item_x (icon),
+							  icon_get_item_y (icon),
+							  icon_get_measure_usage (icon, usage),
+							  &bounds->x0, &bounds->y0,
+							  &bounds->x1, &bounds->y1);
+	} else if (usage == BOUNDS_USAGE_FOR_DISPLAY) {
+		eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+					    &bounds->x0, &bounds->y0,
+					    &bounds->x1, &bounds->y1);
+	} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
+		nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
+								 &bounds->x0, &bounds->y0,
+								 &bounds->x1, &bounds->y1);
+	} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
+		nemo_icon_canvas_item_get_bounds_for_entire_item (icon->item,
+								      &bounds->x0, &bounds->y0,
+								      &bounds->x1, &bounds->y1);
+	} else {
+		g_assert_not_reached ();
+	}
+}
+
+static inline void
+icon_get_bounding_box (NemoIconContainer *container,
+		       NemoIcon *icon,
+		       int *x1_return, int *y1_return,
+		       int *x2_return, int *y2_return,
+		       NemoIconCanvasItemBoundsUsage usage)
+{
+	EelDRect bounds;
+
+	icon_get_world_bounds (container, icon, &bounds, usage);
+
+	if (x1_return != NULL) {
+		*x1_return = bounds.x0;
+	}
+
+	if (y1_return != NULL) {
+		*y1_return = bounds.y0;
+	}
+
+	if (x2_return != NULL) {
+		*x2_return = bounds.x1;
+	}
+
+	if (y2_return != NULL) {
+		*y2_return = bounds.y1;
+	}
+}
+
+static void
+icon_get_canvas_bounds (NemoIconContainer *container,
+			NemoIcon *icon,
+			EelIRect *bounds,
+			gboolean safety_pad)
+{
+	EelDRect world_rect;
+
+	icon_get_world_bounds (container, icon, &world_rect, BOUNDS_USAGE_FOR_DISPLAY);
+	if (safety_pad) {
+		world_rect.x0 -= ICON_PAD_LEFT + ICON_PAD_RIGHT;
+		world_rect.x1 += ICON_PAD_LEFT + ICON_PAD_RIGHT;
+
+		world_rect.y0 -= ICON_PAD_TOP + ICON_PAD_BOTTOM;
+		world_rect.y1 += ICON_PAD_TOP + ICON_PAD_BOTTOM;
+	}
+
+	eel_canvas_w2c (EEL_CANVAS (container),
+			world_rect.x0,
+			world_rect.y0,
+			&bounds->x0,
+			&bounds->y0);
+	eel_canvas_w2c (EEL_CANVAS (container),
+			world_rect.x1,
+			world_rect.y1,
+			&bounds->x1,
+			&bounds->y1);
+}
+
+static gboolean
+icon_hit_test_rectangle (NemoIconContainer *container,
+			 NemoIcon *icon,
+			 EelIRect canvas_rect)
+{
+	if (icon->item != NULL) {
+		return nemo_icon_canvas_item_hit_test_rectangle (icon->item, canvas_rect);
+	}
+
+	icon_ensure_measure (container, icon);
+	return nemo_icon_canvas_item_measure_hit_test_rectangle (EEL_CANVAS (container),
+								 &icon->measure,
+								 icon_get_item_x (icon),
+								 icon_get_item_y (icon),
+								 icon_get_measure_usage (icon, BOUNDS_USAGE_FOR_DISPLAY),
+								 canvas_rect);
+}
+
+EelDRect
+nemo_icon_container_get_icon_rectangle (NemoIconContainer *container,
+					NemoIcon *icon)
+{
+	return icon_get_icon_rectangle (container, icon);
+}
+
+gboolean
+nemo_icon_container_hit_test_icon (NemoIconContainer *container,
+				   NemoIcon *icon,
+				   EelIRect canvas_rect)
+{
+	return icon_hit_test_rectangle (container, icon, canvas_rect);
+}
+
 static gboolean
 clicked_on_text (NemoIconContainer *container,
                           NemoIcon *icon,
@@ -301,7 +531,7 @@ clicked_on_text (NemoIconContainer *container,
     double eventX, eventY;
     EelDRect icon_rect;
 
-    icon_rect = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+    icon_rect = icon_get_text_rectangle (container, icon, TRUE);
     eel_canvas_window_to_world (EEL_CANVAS (container), event->x, event->y, &eventX, &eventY);
 
     gboolean ret =  (eventX > icon_rect.x0) &&
@@ -323,7 +553,7 @@ clicked_on_icon (NemoIconContainer *container,
     double eventX, eventY;
     EelDRect icon_rect;
 
-    icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+    icon_rect = icon_get_icon_rectangle (container, icon);
     eel_canvas_window_to_world (EEL_CANVAS (container), event->x, event->y, &eventX, &eventY);
 
     gboolean ret =  (eventX > icon_rect.x0) &&
@@ -334,14 +564,6 @@ clicked_on_icon (NemoIconContainer *container,
     return ret;
 }
 
-static void
-icon_free (NemoIcon *icon)
-{
-	/* Destroy this canvas item; the parent will unref it. */
-	eel_canvas_item_destroy (EEL_CANVAS_ITEM (icon->item));
-	g_free (icon);
-}
-
 static gboolean
 icon_is_positioned (const NemoIcon *icon)
 {
@@ -351,10 +573,10 @@ icon_is_positioned (const NemoIcon *icon)
 
 /* x, y are the top-left coordinates of the icon. */
 static void
-icon_set_position (NemoIcon *icon,
+icon_set_position (NemoIconContainer *container,
+		   NemoIcon *icon,
 		   double x, double y)
 {	
-	NemoIconContainer *container;
 	double pixels_per_unit;	
 	int container_left, container_top, container_right, container_bottom;
 	int x1, x2, y1, y2;
@@ -363,13 +585,12 @@ icon_set_position (NemoIcon *icon,
 	int item_width, item_height;
 	int height_above, width_left;
 	int min_x, max_x, min_y, max_y;
+	gboolean was_positioned;
 
 	if (icon->x == x && icon->y == y) {
 		return;
 	}
 
-	container = NEMO_ICON_CONTAINER (EEL_CANVAS_ITEM (icon->item)->canvas);
-
 	if (icon == get_icon_being_renamed (container)) {
 		end_renaming_mode (container, TRUE);
 	}
@@ -389,12 +610,12 @@ icon_set_position (NemoIcon *icon,
 		container_right = container_left + container_width / pixels_per_unit;
 		container_bottom = container_top + container_height / pixels_per_unit;
 
-		icon_get_bounding_box (icon, &x1, &y1, &x2, &y2,
+		icon_get_bounding_box (container, icon, &x1, &y1, &x2, &y2,
 				       BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 		item_width = x2 - x1;
 		item_height = y2 - y1;
 
-		icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+		icon_bounds = icon_get_icon_rectangle (container, icon);
 
 		/* determine icon rectangle relative to item rectangle */
 		height_above = icon_bounds.y0 - y1;
@@ -409,6 +630,8 @@ icon_set_position (NemoIcon *icon,
 		y = CLAMP (y, min_y, max_y);
 	}
 
+	was_positioned = icon_is_positioned (icon);
+
 	if (icon->x == ICON_UNPOSITIONED_VALUE) {
 		icon->x = 0;
 	}
@@ -416,12 +639,22 @@ icon_set_position (NemoIcon *icon,
 		icon->y = 0;
 	}
 	
-	eel_canvas_item_move (EEL_CANVAS_ITEM (icon->item),
-				x - icon->x,
-				y - icon->y);
+	if (icon->item != NULL) {
+		eel_canvas_item_move (EEL_CANVAS_ITEM (icon->item),
+					x - icon->x,
+					y - icon->y);
+		if (!was_positioned) {
+			eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
+		}
+	}
 
 	icon->x = x;
 	icon->y = y;
+
+	/* Items update the index when the canvas updates them */
+	if (icon->item == NULL) {
+		nemo_icon_container_update_icon_index (container, icon);
+	}
 }
 
 static void
@@ -468,6 +701,10 @@ static void
 icon_raise (NemoIcon *icon)
 {
 	EelCanvasItem *item, *band;
+
+	if (icon->item == NULL) {
+		return;
+	}
 	
 	item = EEL_CANVAS_ITEM (icon->item);
 	band = NEMO_ICON_CONTAINER (item->canvas)->details->rubberband_info.selection_rectangle;
@@ -498,9 +735,14 @@ icon_toggle_selected (NemoIconContainer *container,
 	end_renaming_mode (container, TRUE);
 
 	icon->is_selected = !icon->is_selected;
-	eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
-			     "highlighted_for_selection", (gboolean) icon->is_selected,
-			     NULL);
+	if (icon->item != NULL) {
+		eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+				     "highlighted_for_selection", (gboolean) icon->is_selected,
+				     NULL);
+	} else if (icon_is_positioned (icon)) {
+		/* The label is drawn in full when selected */
+		nemo_icon_container_update_icon_index (container, icon);
+	}
 
 	/* If the icon is deselected, then get rid of the stretch handles.
 	 * No harm in doing the same if the item is newly selected.
@@ -544,41 +786,424 @@ icon_set_selected (NemoIconContainer *container,
 	return TRUE;
 }
 
-static inline void
-icon_get_bounding_box (NemoIcon *icon,
-		       int *x1_return, int *y1_return,
-		       int *x2_return, int *y2_return,
-		       NemoIconCanvasItemBoundsUsage usage)
+/* Spatial index. Icons are kept in the cells of a uniform grid that
+ * their canvas bounds touch. The index is updated together with the
+ * item bounds, or with the position of icons that have no item, so it
+ * is as current as hit testing the icons is.
+ */
+
+#define ICON_INDEX_CELL_SIZE 256
+
+static int
+icon_index_cell (int coordinate)
 {
-	double x1, y1, x2, y2;
+	if (coordinate >= 0) {
+		return coordinate / ICON_INDEX_CELL_SIZE;
+	}
+	return - ((- coordinate - 1) / ICON_INDEX_CELL_SIZE) - 1;
+}
 
-	if (usage == BOUNDS_USAGE_FOR_DISPLAY) {
-		eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-					    &x1, &y1, &x2, &y2);
-	} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-		nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
-								 &x1, &y1, &x2, &y2);
-	} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-		nemo_icon_canvas_item_get_bounds_for_entire_item (icon->item,
-								      &x1, &y1, &x2, &y2);
+/* Keys wrap around for huge canvases, which only adds candidates */
+static gpointer
+icon_index_key (int cell_x, int cell_y)
+{
+	return GUINT_TO_POINTER ((((guint) cell_x & 0xffff) << 16) | ((guint) cell_y & 0xffff));
+}
+
+static EelIRect
+icon_index_cells_for_rect (EelIRect canvas_rect)
+{
+	EelIRect cells;
+
+	cells.x0 = icon_index_cell (canvas_rect.x0);
+	cells.y0 = icon_index_cell (canvas_rect.y0);
+	cells.x1 = icon_index_cell (canvas_rect.x1);
+	cells.y1 = icon_index_cell (canvas_rect.y1);
+
+	return cells;
+}
+
+static void
+icon_index_remove (NemoIconContainer *container,
+		   NemoIcon *icon)
+{
+	GHashTable *index;
+	GList *cell;
+	gpointer key;
+	int x, y;
+
+	if (!icon->is_indexed) {
+		return;
+	}
+
+	index = container->details->icon_index;
+	for (x = icon->index_cells.x0; x <= icon->index_cells.x1; x++) {
+		for (y = icon->index_cells.y0; y <= icon->index_cells.y1; y++) {
+			key = icon_index_key (x, y);
+			cell = g_list_remove (g_hash_table_lookup (index, key), icon);
+			if (cell != NULL) {
+				g_hash_table_insert (index, key, cell);
+			} else {
+				g_hash_table_remove (index, key);
+			}
+		}
+	}
+
+	icon->is_indexed = FALSE;
+}
+
+static void
+icon_index_clear (NemoIconContainer *container)
+{
+	GHashTableIter iter;
+	gpointer cell;
+
+	g_hash_table_iter_init (&iter, container->details->icon_index);
+	while (g_hash_table_iter_next (&iter, NULL, &cell)) {
+		g_list_free (cell);
+	}
+	g_hash_table_remove_all (container->details->icon_index);
+}
+
+void
+nemo_icon_container_update_icon_index (NemoIconContainer *container,
+				       NemoIcon *icon)
+{
+	EelIRect bounds, cells;
+	GHashTable *index;
+	gpointer key;
+	int x, y;
+
+	if (!icon_is_positioned (icon)) {
+		icon_index_remove (container, icon);
+		return;
+	}
+
+	icon_get_canvas_bounds (container, icon, &bounds, FALSE);
+	cells = icon_index_cells_for_rect (bounds);
+
+	if (icon->is_indexed && eel_irect_equal (cells, icon->index_cells)) {
+		return;
+	}
+
+	icon_index_remove (container, icon);
+
+	index = container->details->icon_index;
+	for (x = cells.x0; x <= cells.x1; x++) {
+		for (y = cells.y0; y <= cells.y1; y++) {
+			key = icon_index_key (x, y);
+			g_hash_table_insert (index, key,
+					     g_list_prepend (g_hash_table_lookup (index, key), icon));
+		}
+	}
+
+	icon->index_cells = cells;
+	icon->is_indexed = TRUE;
+}
+
+/* Forget the measure of an icon that has no item. It is measured again
+ * when it is next laid out or looked up in the index.
+ */
+static void
+icon_invalidate_measure (NemoIconContainer *container,
+			 NemoIcon *icon)
+{
+	if (icon->item != NULL) {
+		return;
+	}
+
+	icon->measure_valid = FALSE;
+
+	if (icon->is_indexed) {
+		icon_index_remove (container, icon);
+		container->details->icon_index_dirty = TRUE;
+	}
+}
+
+/* Put the icons icon_invalidate_measure() took out back in the index */
+static void
+icon_index_flush (NemoIconContainer *container)
+{
+	GList *p;
+	NemoIcon *icon;
+
+	if (!container->details->icon_index_dirty) {
+		return;
+	}
+
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+
+		if (icon->item == NULL && !icon->is_indexed) {
+			nemo_icon_container_update_icon_index (container, icon);
+		}
+	}
+
+	container->details->icon_index_dirty = FALSE;
+}
+
+/* Returns the icons whose canvas bounds may touch canvas_rect. They
+ * still have to be hit tested. Free the list with g_list_free().
+ */
+GList *
+nemo_icon_container_get_icons_in_rect (NemoIconContainer *container,
+				       EelIRect canvas_rect)
+{
+	GHashTable *seen;
+	GList *result, *l;
+	EelIRect cells;
+	int x, y;
+
+	icon_index_flush (container);
+
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	result = NULL;
+
+	cells = icon_index_cells_for_rect (canvas_rect);
+	for (x = cells.x0; x <= cells.x1; x++) {
+		for (y = cells.y0; y <= cells.y1; y++) {
+			l = g_hash_table_lookup (container->details->icon_index,
+						 icon_index_key (x, y));
+			for (; l != NULL; l = l->next) {
+				if (!g_hash_table_contains (seen, l->data)) {
+					g_hash_table_add (seen, l->data);
+					result = g_list_prepend (result, l->data);
+				}
+			}
+		}
+	}
+
+	g_hash_table_destroy (seen);
+
+	return result;
+}
+
+/* Unless the container is a desktop, icons only keep their item while
+ * they are in or near the visible area, see
+ * nemo_icon_container_update_visible_icons(), or while the user works
+ * with them.
+ */
+
+/* How far beyond the visible area icons have an item, in pages */
+#define ITEM_VIEWPORT_MARGIN 1.0
+
+/* How many items are kept for icons that scroll into view */
+#define ITEM_POOL_MAX_SIZE 256
+
+static gboolean
+icon_needs_item (NemoIconContainer *container,
+		 NemoIcon *icon)
+{
+	NemoIconContainerDetails *details;
+
+	details = container->details;
+
+	return !is_virtualized (container)
+		|| icon == details->keyboard_focus
+		|| icon == details->stretch_icon
+		|| icon == details->drag_icon
+		|| icon == details->drop_target
+		|| (details->renaming && icon->is_selected);
+}
+
+/* Give a new item what its icon did without one. */
+static void
+icon_update_item_state (NemoIconContainer *container,
+			NemoIcon *icon)
+{
+	NemoIconContainerDetails *details;
+
+	details = container->details;
+
+	eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+			     "highlighted_for_selection", (gboolean) icon->is_selected,
+			     "highlighted_as_keyboard_focus", icon == details->keyboard_focus,
+			     "highlighted_for_clipboard", (gboolean) icon->is_highlighted_for_clipboard,
+			     NULL);
+	nemo_icon_canvas_item_set_entire_text (icon->item, icon->entire_text);
+}
+
+static void
+icon_ensure_item (NemoIconContainer *container,
+		  NemoIcon *icon)
+{
+	NemoIconContainerDetails *details;
+	EelCanvasItem *item, *band;
+
+	if (icon->item != NULL) {
+		return;
+	}
+
+	details = container->details;
+
+	if (!g_queue_is_empty (details->item_pool)) {
+		icon->item = g_queue_pop_head (details->item_pool);
 	} else {
-		g_assert_not_reached ();
+		icon->item = NEMO_ICON_CANVAS_ITEM
+			(eel_canvas_item_new (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
+					      nemo_icon_canvas_item_get_type (),
+					      "visible", FALSE,
+					      NULL));
+		g_signal_connect_object (icon->item, "event",
+					 G_CALLBACK (item_event_callback), container, 0);
 	}
+	icon->item->user_data = icon;
+	g_hash_table_add (details->icons_with_items, icon);
 
-	if (x1_return != NULL) {
-		*x1_return = x1;
+	item = EEL_CANVAS_ITEM (icon->item);
+	eel_canvas_item_move (item, icon_get_item_x (icon), icon_get_item_y (icon));
+
+	/* Make sure the icon is under the selection_rectangle */
+	band = details->rubberband_info.selection_rectangle;
+	if (band) {
+		eel_canvas_item_send_behind (item, band);
 	}
 
-	if (y1_return != NULL) {
-		*y1_return = y1;
+	nemo_icon_container_update_icon (container, icon);
+	icon_update_item_state (container, icon);
+
+	/* Otherwise it is shown once the icon is positioned */
+	if (icon_is_positioned (icon)) {
+		eel_canvas_item_show (item);
 	}
+}
 
-	if (x2_return != NULL) {
-		*x2_return = x2;
+/* Put the item back in the pool, or destroy it if the pool is full. */
+static void
+icon_drop_item (NemoIconContainer *container,
+		NemoIcon *icon)
+{
+	NemoIconContainerDetails *details;
+	NemoIconCanvasItem *item;
+
+	details = container->details;
+	item = icon->item;
+
+	icon->item = NULL;
+	g_hash_table_remove (details->icons_with_items, icon);
+
+	if (g_queue_get_length (details->item_pool) >= ITEM_POOL_MAX_SIZE) {
+		/* Destroy this canvas item; the parent will unref it. */
+		eel_canvas_item_destroy (EEL_CANVAS_ITEM (item));
+		return;
 	}
 
-	if (y2_return != NULL) {
-		*y2_return = y2;
+	nemo_icon_canvas_item_reset (item);
+	eel_canvas_item_hide (EEL_CANVAS_ITEM (item));
+	eel_canvas_item_move (EEL_CANVAS_ITEM (item),
+			      - icon_get_item_x (icon), - icon_get_item_y (icon));
+	item->user_data = NULL;
+
+	g_queue_push_head (details->item_pool, item);
+}
+
+/* Take the item away from an icon, keeping its measure to lay it out
+ * and hit test it.
+ */
+static void
+icon_release_item (NemoIconContainer *container,
+		   NemoIcon *icon)
+{
+	if (icon->is_selected || icon->entire_text) {
+		/* Drawn in full, see icon_get_measure_usage() */
+		icon->measure_valid = FALSE;
+	} else {
+		nemo_icon_canvas_item_get_measure (icon->item, &icon->measure);
+		icon->measure_valid = TRUE;
+	}
+
+	icon_drop_item (container, icon);
+
+	nemo_icon_container_update_icon_index (container, icon);
+}
+
+static void
+icon_free (NemoIconContainer *container,
+	   NemoIcon *icon)
+{
+	if (icon->item != NULL) {
+		icon_drop_item (container, icon);
+	}
+	g_free (icon);
+}
+
+/* Whether the entire label text must be visible at all times */
+static void
+icon_set_entire_text (NemoIconContainer *container,
+		      NemoIcon *icon,
+		      gboolean entire_text)
+{
+	if (!icon->entire_text == !entire_text) {
+		return;
+	}
+
+	icon->entire_text = entire_text;
+
+	if (icon->item != NULL) {
+		nemo_icon_canvas_item_set_entire_text (icon->item, entire_text);
+	} else if (icon_is_positioned (icon)) {
+		nemo_icon_container_update_icon_index (container, icon);
+	}
+}
+
+/* Get the visible area in world coordinates, and the area around it
+ * along the scroll direction in which icons have an item.
+ */
+static void
+get_item_viewport (NemoIconContainer *container,
+		   EelDRect *visible,
+		   EelDRect *near)
+{
+	GtkAdjustment *vadj, *hadj;
+	GtkAllocation allocation;
+	double page;
+
+	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
+	vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
+	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+
+	visible->x0 = gtk_adjustment_get_value (hadj);
+	visible->x1 = visible->x0 + allocation.width;
+	visible->y0 = gtk_adjustment_get_value (vadj);
+	visible->y1 = visible->y0 + allocation.height;
+
+	eel_canvas_c2w (EEL_CANVAS (container),
+			visible->x0, visible->y0, &visible->x0, &visible->y0);
+	eel_canvas_c2w (EEL_CANVAS (container),
+			visible->x1, visible->y1, &visible->x1, &visible->y1);
+
+	*near = *visible;
+	if (nemo_icon_container_is_layout_vertical (container)) {
+		page = (visible->x1 - visible->x0) * ITEM_VIEWPORT_MARGIN;
+		near->x0 -= page;
+		near->x1 += page;
+	} else {
+		page = (visible->y1 - visible->y0) * ITEM_VIEWPORT_MARGIN;
+		near->y0 -= page;
+		near->y1 += page;
+	}
+}
+
+/* Only the scroll direction matters, the icons are laid out to fit the
+ * other one.
+ */
+static gboolean
+icon_is_in_viewport (NemoIconContainer *container,
+		     NemoIcon *icon,
+		     const EelDRect *viewport)
+{
+	EelDRect bounds;
+
+	if (!icon_is_positioned (icon)) {
+		return FALSE;
+	}
+
+	icon_get_world_bounds (container, icon, &bounds, BOUNDS_USAGE_FOR_DISPLAY);
+
+	if (nemo_icon_container_is_layout_vertical (container)) {
+		return bounds.x1 >= viewport->x0 && bounds.x0 <= viewport->x1;
+	} else {
+		return bounds.y1 >= viewport->y0 && bounds.y0 <= viewport->y1;
 	}
 }
 
@@ -609,88 +1234,21 @@ nemo_icon_container_scroll (NemoIconContainer *container,
 	return gtk_adjustment_get_value (hadj) != old_h_value || gtk_adjustment_get_value (vadj) != old_v_value;
 }
 
-static void
-pending_icon_to_reveal_destroy_callback (NemoIconCanvasItem *item,
-					 NemoIconContainer *container)
-{
-	g_assert (NEMO_IS_ICON_CONTAINER (container));
-	g_assert (container->details->pending_icon_to_reveal != NULL);
-	g_assert (container->details->pending_icon_to_reveal->item == item);
-
-	container->details->pending_icon_to_reveal = NULL;
-}
-
 static NemoIcon*
 get_pending_icon_to_reveal (NemoIconContainer *container)
 {
 	return container->details->pending_icon_to_reveal;
 }
 
+/* icon_destroy() and nemo_icon_container_clear() forget the icon
+ * when it goes away.
+ */
 static void
 set_pending_icon_to_reveal (NemoIconContainer *container, NemoIcon *icon)
 {
-	NemoIcon *old_icon;
-	
-	old_icon = container->details->pending_icon_to_reveal;
-	
-	if (icon == old_icon) {
-		return;
-	}
-	
-	if (old_icon != NULL) {
-		g_signal_handlers_disconnect_by_func
-			(old_icon->item,
-			 G_CALLBACK (pending_icon_to_reveal_destroy_callback),
-			 container);
-	}
-	
-	if (icon != NULL) {
-		g_signal_connect (icon->item, "destroy",
-				  G_CALLBACK (pending_icon_to_reveal_destroy_callback),
-				  container);
-	}
-	
 	container->details->pending_icon_to_reveal = icon;
 }
 
-static void
-item_get_canvas_bounds (EelCanvasItem *item,
-			EelIRect *bounds,
-			gboolean safety_pad)
-{
-	EelDRect world_rect;
-	
-	eel_canvas_item_get_bounds (item,
-				    &world_rect.x0,
-				    &world_rect.y0,
-				    &world_rect.x1,
-				    &world_rect.y1);
-	eel_canvas_item_i2w (item->parent,
-			     &world_rect.x0,
-			     &world_rect.y0);
-	eel_canvas_item_i2w (item->parent,
-			     &world_rect.x1,
-			     &world_rect.y1);
-	if (safety_pad) {
-		world_rect.x0 -= ICON_PAD_LEFT + ICON_PAD_RIGHT;
-		world_rect.x1 += ICON_PAD_LEFT + ICON_PAD_RIGHT;
-
-		world_rect.y0 -= ICON_PAD_TOP + ICON_PAD_BOTTOM;
-		world_rect.y1 += ICON_PAD_TOP + ICON_PAD_BOTTOM;
-	}
-
-	eel_canvas_w2c (item->canvas,
-			world_rect.x0,
-			world_rect.y0,
-			&bounds->x0,
-			&bounds->y0);
-	eel_canvas_w2c (item->canvas,
-			world_rect.x1,
-			world_rect.y1,
-			&bounds->x1,
-			&bounds->y1);
-}
-
 static void
 icon_get_row_and_column_bounds (NemoIconContainer *container,
 				NemoIcon *icon,
@@ -701,7 +1259,7 @@ icon_get_row_and_column_bounds (NemoIconContainer *container,
 	NemoIcon *one_icon;
 	EelIRect one_bounds;
 
-	item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), bounds, safety_pad);
+	icon_get_canvas_bounds (container, icon, bounds, safety_pad);
 
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		one_icon = p->data;
@@ -711,13 +1269,13 @@ icon_get_row_and_column_bounds (NemoIconContainer *container,
 		}
 
 		if (compare_icons_horizontal (container, icon, one_icon) == 0) {
-			item_get_canvas_bounds (EEL_CANVAS_ITEM (one_icon->item), &one_bounds, safety_pad);
+			icon_get_canvas_bounds (container, one_icon, &one_bounds, safety_pad);
 			bounds->x0 = MIN (bounds->x0, one_bounds.x0);
 			bounds->x1 = MAX (bounds->x1, one_bounds.x1);
 		}
 
 		if (compare_icons_vertical (container, icon, one_icon) == 0) {
-			item_get_canvas_bounds (EEL_CANVAS_ITEM (one_icon->item), &one_bounds, safety_pad);
+			icon_get_canvas_bounds (container, one_icon, &one_bounds, safety_pad);
 			bounds->y0 = MIN (bounds->y0, one_bounds.y0);
 			bounds->y1 = MAX (bounds->y1, one_bounds.y1);
 		}
@@ -750,7 +1308,7 @@ reveal_icon (NemoIconContainer *container,
 		/* ensure that we reveal the entire row/column */
 		icon_get_row_and_column_bounds (container, icon, &bounds, TRUE);
 	} else {
-		item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds, TRUE);
+		icon_get_canvas_bounds (container, icon, &bounds, TRUE);
 	}
 	if (bounds.y0 < gtk_adjustment_get_value (vadj)) {
 		gtk_adjustment_set_value (vadj, bounds.y0);
@@ -843,7 +1401,8 @@ schedule_keyboard_icon_reveal (NemoIconContainer *container,
 static void
 clear_keyboard_focus (NemoIconContainer *container)
 {
-        if (container->details->keyboard_focus != NULL) {
+        if (container->details->keyboard_focus != NULL &&
+	    container->details->keyboard_focus->item != NULL) {
 		eel_canvas_item_set (EEL_CANVAS_ITEM (container->details->keyboard_focus->item),
 				       "highlighted_as_keyboard_focus", 0,
 				       NULL);
@@ -853,9 +1412,13 @@ clear_keyboard_focus (NemoIconContainer *container)
 }
 
 static void inline
-emit_atk_focus_tracker_notify (NemoIcon *icon)
+emit_atk_focus_tracker_notify (NemoIconContainer *container,
+			       NemoIcon *icon)
 {
-	AtkObject *atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
+	AtkObject *atk_object;
+
+	icon_ensure_item (container, icon);
+	atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
 	atk_focus_tracker_notify (atk_object);
 }
 
@@ -874,11 +1437,12 @@ set_keyboard_focus (NemoIconContainer *container,
 
 	container->details->keyboard_focus = icon;
 
+	icon_ensure_item (container, icon);
 	eel_canvas_item_set (EEL_CANVAS_ITEM (container->details->keyboard_focus->item),
 			       "highlighted_as_keyboard_focus", 1,
 			       NULL);
 
-	emit_atk_focus_tracker_notify (icon);
+	emit_atk_focus_tracker_notify (container, icon);
 }
 
 static void
@@ -894,109 +1458,60 @@ clear_keyboard_rubberband_start (NemoIconContainer *container)
 	container->details->keyboard_rubberband_start = NULL;
 }
 
-/* carbon-copy of eel_canvas_group_bounds(), but
- * for NemoIconContainerItems it returns the
- * bounds for the “entire item”.
+/* Like eel_canvas_group_bounds() on the canvas root, but for the
+ * positioned icons, whether they have an item or not.
  */
 static void
-get_icon_bounds_for_canvas_bounds (EelCanvasGroup *group,
-				   double *x1, double *y1,
-				   double *x2, double *y2,
-				   NemoIconCanvasItemBoundsUsage usage)
+get_all_icon_bounds (NemoIconContainer *container,
+		     double *x1, double *y1,
+		     double *x2, double *y2,
+		     NemoIconCanvasItemBoundsUsage usage)
 {
-	EelCanvasItem *child;
-	GList *list;
-	double tx1, ty1, tx2, ty2;
+	GList *p;
+	NemoIcon *icon;
+	EelDRect bounds;
 	double minx, miny, maxx, maxy;
-	int set;
-
-	/* Get the bounds of the first visible item */
+	gboolean set;
 
-	child = NULL; /* Unnecessary but eliminates a warning. */
+	/* FIXME bugzilla.gnome.org 42477: Do we have to do something about the rubberband
+	 * here? Any other non-icon items?
+	 */
 
+	/* If there are no positioned icons, return an empty bounding box */
+	minx = miny = maxx = maxy = 0.0;
 	set = FALSE;
 
-	for (list = group->item_list; list; list = list->next) {
-		child = list->data;
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
 
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child)) {
+		if (!icon_is_positioned (icon)) {
 			continue;
 		}
 
-		if (child->flags & EEL_CANVAS_ITEM_VISIBLE) {
-			set = TRUE;
-			if (!NEMO_IS_ICON_CANVAS_ITEM (child) ||
-			    usage == BOUNDS_USAGE_FOR_DISPLAY) {
-				eel_canvas_item_get_bounds (child, &minx, &miny, &maxx, &maxy);
-			} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-				nemo_icon_canvas_item_get_bounds_for_layout (NEMO_ICON_CANVAS_ITEM (child),
-										 &minx, &miny, &maxx, &maxy);
-			} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-				nemo_icon_canvas_item_get_bounds_for_entire_item (NEMO_ICON_CANVAS_ITEM (child),
-										      &minx, &miny, &maxx, &maxy);
-			} else {
-				g_assert_not_reached ();
-			}
-			break;
-		}
-	}
-
-	/* If there were no visible items, return an empty bounding box */
-
-	if (!set) {
-		*x1 = *y1 = *x2 = *y2 = 0.0;
-		return;
-	}
-
-	/* Now we can grow the bounds using the rest of the items */
-
-	list = list->next;
-
-	for (; list; list = list->next) {
-		child = list->data;
-
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child)) {
-			continue;
-		}
+		icon_get_world_bounds (container, icon, &bounds, usage);
 
-		if (!(child->flags & EEL_CANVAS_ITEM_VISIBLE))
+		if (!set) {
+			minx = bounds.x0;
+			miny = bounds.y0;
+			maxx = bounds.x1;
+			maxy = bounds.y1;
+			set = TRUE;
 			continue;
-
-		if (!NEMO_IS_ICON_CANVAS_ITEM (child) ||
-		    usage == BOUNDS_USAGE_FOR_DISPLAY) {
-			eel_canvas_item_get_bounds (child, &tx1, &ty1, &tx2, &ty2);
-		} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-			nemo_icon_canvas_item_get_bounds_for_layout (NEMO_ICON_CANVAS_ITEM (child),
-									 &tx1, &ty1, &tx2, &ty2);
-		} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-			nemo_icon_canvas_item_get_bounds_for_entire_item (NEMO_ICON_CANVAS_ITEM (child),
-									      &tx1, &ty1, &tx2, &ty2);
-		} else {
-			g_assert_not_reached ();
 		}
 
-		if (tx1 < minx)
-			minx = tx1;
+		if (bounds.x0 < minx)
+			minx = bounds.x0;
 
-		if (ty1 < miny)
-			miny = ty1;
+		if (bounds.y0 < miny)
+			miny = bounds.y0;
 
-		if (tx2 > maxx)
-			maxx = tx2;
+		if (bounds.x1 > maxx)
+			maxx = bounds.x1;
 
-		if (ty2 > maxy)
-			maxy = ty2;
+		if (bounds.y1 > maxy)
+			maxy = bounds.y1;
 	}
 
-	/* Make the bounds be relative to our parent's coordinate system */
-
-	if (EEL_CANVAS_ITEM (group)->parent) {
-		minx += group->xpos;
-		miny += group->ypos;
-		maxx += group->xpos;
-		maxy += group->ypos;
-	}
-	
 	if (x1 != NULL) {
 		*x1 = minx;
 	}
@@ -1014,19 +1529,6 @@ get_icon_bounds_for_canvas_bounds (EelCanvasGroup *group,
 	}
 }
 
-static void
-get_all_icon_bounds (NemoIconContainer *container,
-		     double *x1, double *y1,
-		     double *x2, double *y2,
-		     NemoIconCanvasItemBoundsUsage usage)
-{
-	/* FIXME bugzilla.gnome.org 42477: Do we have to do something about the rubberband
-	 * here? Any other non-icon items?
-	 */
-	get_icon_bounds_for_canvas_bounds (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
-					   x1, y1, x2, y2, usage);
-}
-
 /* Don't preserve visible white space the next time the scroll region
  * is recomputed when the container is not empty. */
 void
@@ -1199,10 +1701,98 @@ sort_icons (NemoIconContainer *container,
 	*icons = g_list_sort_with_data (*icons, compare_icons, container);
 }
 
+static void
+mark_icon_for_layout (NemoIconContainer *container,
+		      NemoIcon *icon)
+{
+	if (!icon->layout_dirty) {
+		icon->layout_dirty = TRUE;
+		container->details->n_layout_dirty++;
+	}
+}
+
+static void
+clear_icons_for_layout (NemoIconContainer *container)
+{
+	GList *p;
+
+	if (container->details->n_layout_dirty == 0) {
+		return;
+	}
+
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		((NemoIcon *) p->data)->layout_dirty = FALSE;
+	}
+	container->details->n_layout_dirty = 0;
+}
+
+/* Takes the icons marked for layout out of the sorted list, sorts
+ * them, and puts each back where a binary search over the rest says
+ * it belongs.
+ */
+static void
+resort_marked_icons (NemoIconContainer *container)
+{
+	GList *p, *next, *marked;
+	GPtrArray *links;
+	guint low, high, middle, start;
+
+	marked = NULL;
+	for (p = container->details->icons; p != NULL; p = next) {
+		next = p->next;
+		if (((NemoIcon *) p->data)->layout_dirty) {
+			container->details->icons = g_list_remove_link (container->details->icons, p);
+			marked = g_list_concat (p, marked);
+		}
+	}
+	sort_icons (container, &marked);
+
+	links = g_ptr_array_new ();
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		g_ptr_array_add (links, p);
+	}
+
+	start = 0;
+	while (marked != NULL) {
+		/* Find the first icon that sorts after this one */
+		low = start;
+		high = links->len;
+		while (low < high) {
+			middle = (low + high) / 2;
+			if (compare_icons (((GList *) g_ptr_array_index (links, middle))->data,
+					   marked->data, container) <= 0) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+
+		if (low == links->len) {
+			/* The rest goes at the end, in the order it has */
+			container->details->icons = g_list_concat (container->details->icons, marked);
+			break;
+		}
+
+		container->details->icons = g_list_insert_before (container->details->icons,
+								  g_ptr_array_index (links, low),
+								  marked->data);
+		marked = g_list_delete_link (marked, marked);
+		start = low;
+	}
+
+	g_ptr_array_free (links, TRUE);
+}
+
 static void
 resort (NemoIconContainer *container)
 {
-	sort_icons (container, &container->details->icons);
+	if (container->details->auto_layout &&
+	    !container->details->needs_full_layout &&
+	    container->details->n_layout_dirty > 0) {
+		resort_marked_icons (container);
+	} else {
+		sort_icons (container, &container->details->icons);
+	}
 }
 
 #if 0
@@ -1256,10 +1846,10 @@ lay_down_one_line (NemoIconContainer *container,
 		}
 
 		icon_set_position
-			(icon,
+			(container, icon,
 			 is_rtl ? get_mirror_x_position (container, icon, x + position->x_offset) : x + position->x_offset,
 			 y + y_offset);
-		nemo_icon_canvas_item_set_entire_text (icon->item, whole_text);
+		icon_set_entire_text (container, icon, whole_text);
 
 		icon->saved_ltr_x = is_rtl ? get_mirror_x_position (container, icon, icon->x) : icon->x;
 
@@ -1294,7 +1884,7 @@ lay_down_one_column (NemoIconContainer *container,
 		position = &g_array_index (positions, IconPositions, i++);
 
 		icon_set_position
-			(icon,
+			(container, icon,
 			 is_rtl ? get_mirror_x_position (container, icon, x + position->x_offset) : x + position->x_offset,
 			 y + position->y_offset);
 
@@ -1304,13 +1894,20 @@ lay_down_one_column (NemoIconContainer *container,
 	}
 }
 
+/* Lays out icons starting with a line at first_line_y. When
+ * incremental, this stops at the first line that starts with the same
+ * icon at the same place as before once no marked icons are left, as
+ * everything from there on is already in place.
+ */
 static void
-lay_down_icons_horizontal (NemoIconContainer *container,
-			   GList *icons,
-			   double start_y)
+lay_down_icons_horizontal_from (NemoIconContainer *container,
+				GList *icons,
+				double first_line_y,
+				gboolean incremental)
 {
 	GList *p, *line_start;
 	NemoIcon *icon;
+	gboolean was_dirty;
 	double canvas_width, y;
 	GArray *positions;
 	IconPositions *position;
@@ -1346,10 +1943,10 @@ lay_down_icons_horizontal (NemoIconContainer *container,
 		for (p = icons; p != NULL; p = p->next) {
 			icon = p->data;
 
-			icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+			icon_bounds = icon_get_icon_rectangle (container, icon);
 			max_icon_width = MAX (max_icon_width, ceil (icon_bounds.x1 - icon_bounds.x0));
 
-			text_bounds = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+			text_bounds = icon_get_text_rectangle (container, icon, TRUE);
 			max_text_width = MAX (max_text_width, ceil (text_bounds.x1 - text_bounds.x0));
 		}
 
@@ -1366,21 +1963,28 @@ lay_down_icons_horizontal (NemoIconContainer *container,
 
 	line_width = container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE ? ICON_PAD_LEFT : 0;
 	line_start = icons;
-	y = start_y + CONTAINER_PAD_TOP;
+	y = first_line_y;
 	i = 0;
+
+	icon = icons->data;
+	icon->starts_layout_line = TRUE;
+	icon->layout_line_y = y;
 	
 	max_height_above = 0;
 	max_height_below = 0;
 	for (p = icons; p != NULL; p = p->next) {
 		icon = p->data;
 
-		/* Assume it's only one level hierarchy to avoid costly affine calculations */
-		nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
-								 &bounds.x0, &bounds.y0,
-								 &bounds.x1, &bounds.y1);
+		was_dirty = icon->layout_dirty;
+		if (was_dirty) {
+			icon->layout_dirty = FALSE;
+			container->details->n_layout_dirty--;
+		}
+
+		icon_get_world_bounds (container, icon, &bounds, BOUNDS_USAGE_FOR_LAYOUT);
 
-		icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
-		text_bounds = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+		icon_bounds = icon_get_icon_rectangle (container, icon);
+		text_bounds = icon_get_text_rectangle (container, icon, TRUE);
 
         if (gridded_layout) {
            icon_width = ceil ((bounds.x1 - bounds.x0)/grid_width) * grid_width;
@@ -1409,14 +2013,27 @@ lay_down_icons_horizontal (NemoIconContainer *container,
 				/* Advance to next line. */
 				y += max_height_below + ICON_PAD_BOTTOM;
 			}
+
+			if (incremental && !was_dirty &&
+			    container->details->n_layout_dirty == 0 &&
+			    icon->starts_layout_line && icon->layout_line_y == y) {
+				line_start = NULL;
+				break;
+			}
 			
 			line_width = container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE ? ICON_PAD_LEFT : 0;
 			line_start = p;
 			i = 0;
+
+			icon->starts_layout_line = TRUE;
+			icon->layout_line_y = y;
 			
 			max_height_above = height_above;
 			max_height_below = height_below;
 		} else {
+			if (p != line_start) {
+				icon->starts_layout_line = FALSE;
+			}
 			if (height_above > max_height_above) {
 				max_height_above = height_above;
 			}
@@ -1462,7 +2079,62 @@ lay_down_icons_horizontal (NemoIconContainer *container,
 }
 
 static void
-get_max_icon_dimensions (GList *icon_start,
+lay_down_icons_horizontal (NemoIconContainer *container,
+			   GList *icons,
+			   double start_y)
+{
+	if (icons != NULL) {
+		lay_down_icons_horizontal_from (container, icons,
+						start_y + CONTAINER_PAD_TOP, FALSE);
+	}
+}
+
+/* Lays out again from the line of the first icon marked for layout.
+ * Returns FALSE if everything has to be laid out instead.
+ */
+static gboolean
+lay_down_marked_icons (NemoIconContainer *container)
+{
+	GList *p, *line_start;
+	NemoIcon *icon;
+
+	if (container->details->needs_full_layout ||
+	    container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE ||
+	    (container->details->layout_mode != NEMO_ICON_LAYOUT_L_R_T_B &&
+	     container->details->layout_mode != NEMO_ICON_LAYOUT_R_L_T_B)) {
+		return FALSE;
+	}
+
+	if (container->details->n_layout_dirty == 0) {
+		return TRUE;
+	}
+
+	line_start = NULL;
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+		if (icon->layout_dirty) {
+			break;
+		}
+		if (icon->starts_layout_line) {
+			line_start = p;
+		}
+	}
+
+	if (line_start == NULL) {
+		lay_down_icons_horizontal_from (container, container->details->icons,
+						CONTAINER_PAD_TOP, TRUE);
+	} else {
+		icon = line_start->data;
+		lay_down_icons_horizontal_from (container, line_start,
+						icon->layout_line_y, TRUE);
+	}
+
+	return TRUE;
+}
+
+static void
+get_max_icon_dimensions (NemoIconContainer *container,
+			 GList *icon_start,
 			 GList *icon_end,
 			 double *max_icon_width,
 			 double *max_icon_height,
@@ -1473,8 +2145,8 @@ get_max_icon_dimensions (GList *icon_start,
 	NemoIcon *icon;
 	EelDRect icon_bounds;
 	EelDRect text_bounds;
+	EelDRect bounds;
 	GList *p;
-	double y1, y2;
 
 	*max_icon_width = *max_text_width = 0.0;
 	*max_icon_height = *max_text_height = 0.0;
@@ -1484,18 +2156,16 @@ get_max_icon_dimensions (GList *icon_start,
 	for (p = icon_start; p != icon_end; p = p->next) {
 		icon = p->data;
 
-		icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+		icon_bounds = icon_get_icon_rectangle (container, icon);
 		*max_icon_width = MAX (*max_icon_width, ceil (icon_bounds.x1 - icon_bounds.x0));
 		*max_icon_height = MAX (*max_icon_height, ceil (icon_bounds.y1 - icon_bounds.y0));
 
-		text_bounds = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+		text_bounds = icon_get_text_rectangle (container, icon, TRUE);
 		*max_text_width = MAX (*max_text_width, ceil (text_bounds.x1 - text_bounds.x0));
 		*max_text_height = MAX (*max_text_height, ceil (text_bounds.y1 - text_bounds.y0));
 
-		nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
-								 NULL, &y1,
-								 NULL, &y2);
-		*max_bounds_height = MAX (*max_bounds_height, y2 - y1);
+		icon_get_world_bounds (container, icon, &bounds, BOUNDS_USAGE_FOR_LAYOUT);
+		*max_bounds_height = MAX (*max_bounds_height, bounds.y1 - bounds.y0);
 	}
 }
 
@@ -1546,7 +2216,7 @@ lay_down_icons_vertical (NemoIconContainer *container,
 	max_icon_height = max_text_height = 0.0;
 	max_bounds_height = 0.0;
 
-	get_max_icon_dimensions (icons, NULL,
+	get_max_icon_dimensions (container, icons, NULL,
 				 &max_icon_width, &max_icon_height,
 				 &max_text_width, &max_text_height,
 				 &max_bounds_height);
@@ -1601,8 +2271,8 @@ lay_down_icons_vertical (NemoIconContainer *container,
 			max_width_in_column = 0;
 		}
 
-		icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
-		text_bounds = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+		icon_bounds = icon_get_icon_rectangle (container, icon);
+		text_bounds = icon_get_text_rectangle (container, icon, TRUE);
 
 		max_width_in_column = MAX (max_width_in_column,
 					   ceil (icon_bounds.x1 - icon_bounds.x0) +
@@ -1649,7 +2319,7 @@ snap_position (NemoIconContainer *container,
 	EelDRect icon_position;
 	GtkAllocation allocation;
 	
-	icon_position = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+	icon_position = icon_get_icon_rectangle (container, icon);
 	icon_width = icon_position.x1 - icon_position.x0;
 	icon_height = icon_position.y1 - icon_position.y0;
 
@@ -1690,20 +2360,22 @@ snap_position (NemoIconContainer *container,
 }
 
 static int
-compare_icons_by_position (gconstpointer a, gconstpointer b)
+compare_icons_by_position (gconstpointer a, gconstpointer b, gpointer user_data)
 {
+	NemoIconContainer *container;
 	NemoIcon *icon_a, *icon_b;
 	int x1, y1, x2, y2;
 	int center_a;
 	int center_b;
 
+	container = NEMO_ICON_CONTAINER (user_data);
 	icon_a = (NemoIcon*)a;
 	icon_b = (NemoIcon*)b;
 
-	icon_get_bounding_box (icon_a, &x1, &y1, &x2, &y2,
+	icon_get_bounding_box (container, icon_a, &x1, &y1, &x2, &y2,
 			       BOUNDS_USAGE_FOR_DISPLAY);
 	center_a = x1 + (x2 - x1) / 2;
-	icon_get_bounding_box (icon_b, &x1, &y1, &x2, &y2,
+	icon_get_bounding_box (container, icon_b, &x1, &y1, &x2, &y2,
 			       BOUNDS_USAGE_FOR_DISPLAY);
 	center_b = x1 + (x2 - x1) / 2;
 
@@ -1735,6 +2407,7 @@ placement_grid_new (NemoIconContainer *container, gboolean tight)
 	}
 
 	grid = g_new0 (PlacementGrid, 1);
+	grid->container = container;
 	grid->tight = tight;
 	grid->num_columns = num_columns;
 	grid->num_rows = num_rows;
@@ -1828,7 +2501,7 @@ placement_grid_mark_icon (PlacementGrid *grid, NemoIcon *icon)
 	EelIRect icon_pos;
 	EelIRect grid_pos;
 	
-	icon_get_bounding_box (icon,
+	icon_get_bounding_box (grid->container, icon,
 			       &icon_pos.x0, &icon_pos.y0,
 			       &icon_pos.x1, &icon_pos.y1,
 			       BOUNDS_USAGE_FOR_LAYOUT);
@@ -1861,20 +2534,20 @@ find_empty_location (NemoIconContainer *container,
 	canvas_width  = CANVAS_WIDTH(container, allocation);
 	canvas_height = CANVAS_HEIGHT(container, allocation);
 
-	icon_get_bounding_box (icon,
+	icon_get_bounding_box (container, icon,
 			       &icon_position.x0, &icon_position.y0,
 			       &icon_position.x1, &icon_position.y1,
 			       BOUNDS_USAGE_FOR_LAYOUT);
 	icon_width = icon_position.x1 - icon_position.x0;
 	icon_height = icon_position.y1 - icon_position.y0;
 
-	icon_get_bounding_box (icon,
+	icon_get_bounding_box (container, icon,
 			       NULL, &icon_position.y0,
 			       NULL, &icon_position.y1,
 			       BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 	height_for_bound_check = icon_position.y1 - icon_position.y0;
 
-	pixbuf_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+	pixbuf_rect = icon_get_icon_rectangle (container, icon);
 	
 	/* Start the icon on a grid location */
 	snap_position (container, icon, &start_x, &start_y);
@@ -1930,8 +2603,9 @@ align_icons (NemoIconContainer *container)
 
 	unplaced_icons = g_list_copy (container->details->icons);
 	
-	unplaced_icons = g_list_sort (unplaced_icons, 
-				      compare_icons_by_position);
+	unplaced_icons = g_list_sort_with_data (unplaced_icons,
+						compare_icons_by_position,
+						container);
 
 	if (nemo_icon_container_is_layout_rtl (container)) {
 		unplaced_icons = g_list_reverse (unplaced_icons);
@@ -1954,7 +2628,7 @@ align_icons (NemoIconContainer *container)
 		find_empty_location (container, grid, 
 				     icon, x, y, &x, &y);
 
-		icon_set_position (icon, x, y);
+		icon_set_position (container, icon, x, y);
 		icon->saved_ltr_x = icon->x;
 		placement_grid_mark_icon (grid, icon);
 	}
@@ -1975,7 +2649,7 @@ get_mirror_x_position (NemoIconContainer *container, NemoIcon *icon, double x)
 	GtkAllocation allocation;
 
 	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
-	icon_bounds = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+	icon_bounds = icon_get_icon_rectangle (container, icon);
 
 	return CANVAS_WIDTH(container, allocation) - x - (icon_bounds.x1 - icon_bounds.x0);
 }
@@ -1994,7 +2668,7 @@ nemo_icon_container_set_rtl_positions (NemoIconContainer *container)
 	for (l = container->details->icons; l != NULL; l = l->next) {
 		icon = l->data;
 		x = get_mirror_x_position (container, icon, icon->saved_ltr_x);
-		icon_set_position (icon, x, icon->y);
+		icon_set_position (container, icon, x, icon->y);
 	}
 }
 
@@ -2026,7 +2700,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 		for (p = container->details->icons; p != NULL; p = p->next) {
 			icon = p->data;
 			if (icon_is_positioned (icon)) {
-				icon_set_position(icon, icon->saved_ltr_x, icon->y);
+				icon_set_position (container, icon, icon->saved_ltr_x, icon->y);
 				placed_icons = g_list_prepend (placed_icons, icon);
 			} else {
 				icon->x = 0;
@@ -2049,7 +2723,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 			for (p = unplaced_icons; p != NULL; p = p->next) {
 				icon = p->data;
 				
-				icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+				icon_rect = icon_get_icon_rectangle (container, icon);
 				
 				/* Start the icon in the first column */
 				x = DESKTOP_PAD_HORIZONTAL + (SNAP_SIZE_X / 2) - ((icon_rect.x1 - icon_rect.x0) / 2);
@@ -2061,7 +2735,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 						     x, y,
 						     &x, &y);
 
-				icon_set_position (icon, x, y);
+				icon_set_position (container, icon, x, y);
 				icon->saved_ltr_x = x;
 				placement_grid_mark_icon (grid, icon);
 			}
@@ -2092,18 +2766,18 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 			for (p = icons; p != NULL; p = p->next) {
 				icon = p->data;
 
-				icon_get_bounding_box (icon, &x1, &y1, &x2, &y2,
+				icon_get_bounding_box (container, icon, &x1, &y1, &x2, &y2,
 						       BOUNDS_USAGE_FOR_LAYOUT);
 				icon_width = x2 - x1;
 				icon_height = y2 - y1;
 
-				icon_get_bounding_box (icon, NULL, &y1, NULL, &y2,
+				icon_get_bounding_box (container, icon, NULL, &y1, NULL, &y2,
 						       BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 				icon_height_for_bound_check = y2 - y1;
 
 				if (should_snap) {
 					/* Snap the baseline to a grid position */
-					icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+					icon_rect = icon_get_icon_rectangle (container, icon);
 					baseline = y + (icon_rect.y1 - icon_rect.y0);
 					baseline = SNAP_CEIL_VERTICAL (baseline);
 					y = baseline - (icon_rect.y1 - icon_rect.y0);
@@ -2134,15 +2808,15 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 			/* Lay out column */
 			for (p = icons; p != NULL; p = p->next) {
 				icon = p->data;
-				icon_get_bounding_box (icon, &x1, &y1, &x2, &y2,
+				icon_get_bounding_box (container, icon, &x1, &y1, &x2, &y2,
 						       BOUNDS_USAGE_FOR_LAYOUT);
 				icon_height = y2 - y1;
 
-				icon_get_bounding_box (icon, NULL, &y1, NULL, &y2,
+				icon_get_bounding_box (container, icon, NULL, &y1, NULL, &y2,
 						       BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 				icon_height_for_bound_check = y2 - y1;
 				
-				icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+				icon_rect = icon_get_icon_rectangle (container, icon);
 
 				if (should_snap) {
 					baseline = y + (icon_rect.y1 - icon_rect.y0);
@@ -2158,7 +2832,7 @@ lay_down_icons_vertical_desktop (NemoIconContainer *container, GList *icons)
 					break;
 				}
 
-				icon_set_position (icon,
+				icon_set_position (container, icon,
 						   center_x - (icon_rect.x1 - icon_rect.x0) / 2,
 						   y);
 				
@@ -2220,8 +2894,14 @@ redo_layout_internal (NemoIconContainer *container)
 			resort (container);
 			container->details->needs_resort = FALSE;
 		}
-		lay_down_icons (container, container->details->icons, 0);
+		if (!lay_down_marked_icons (container)) {
+			lay_down_icons (container, container->details->icons, 0);
+		}
+		container->details->needs_full_layout = FALSE;
+	} else {
+		container->details->needs_full_layout = TRUE;
 	}
+	clear_icons_for_layout (container);
 
 	if (nemo_icon_container_is_layout_rtl (container)) {
 		nemo_icon_container_set_rtl_positions (container);
@@ -2255,9 +2935,24 @@ unschedule_redo_layout (NemoIconContainer *container)
 	}
 }
 
+/* Lays out only the icons marked with mark_icon_for_layout(), and
+ * whatever they push along, unless a full layout is pending anyway.
+ */
+static void
+schedule_partial_redo_layout (NemoIconContainer *container)
+{
+	if (container->details->idle_id == 0
+	    && container->details->has_been_allocated) {
+		container->details->idle_id = g_idle_add
+			(redo_layout_callback, container);
+	}
+}
+
 static void
 schedule_redo_layout (NemoIconContainer *container)
 {
+	container->details->needs_full_layout = TRUE;
+
 	if (container->details->idle_id == 0
 	    && container->details->has_been_allocated) {
 		container->details->idle_id = g_idle_add
@@ -2269,6 +2964,7 @@ static void
 redo_layout (NemoIconContainer *container)
 {
 	unschedule_redo_layout (container);
+	container->details->needs_full_layout = TRUE;
 	redo_layout_internal (container);
 }
 
@@ -2281,7 +2977,6 @@ reload_icon_positions (NemoIconContainer *container)
 	NemoIconPosition position;
 	EelDRect bounds;
 	double bottom;
-	EelCanvasItem *item;
 
 	g_assert (!container->details->auto_layout);
 
@@ -2301,19 +2996,9 @@ reload_icon_positions (NemoIconContainer *container)
 				 &position,
 				 &have_stored_position);
 		if (have_stored_position) {
-			icon_set_position (icon, position.x, position.y);
-			item = EEL_CANVAS_ITEM (icon->item);
-			nemo_icon_canvas_item_get_bounds_for_layout (icon->item,
-									 &bounds.x0,
-									 &bounds.y0,
-									 &bounds.x1,
-									 &bounds.y1);
-			eel_canvas_item_i2w (item->parent,
-					     &bounds.x0,
-					     &bounds.y0);
-			eel_canvas_item_i2w (item->parent,
-					     &bounds.x1,
-					     &bounds.y1);
+			icon_set_position (container, icon, position.x, position.y);
+			icon_get_world_bounds (container, icon, &bounds,
+					       BOUNDS_USAGE_FOR_LAYOUT);
 			if (bounds.y1 > bottom) {
 				bottom = bounds.y1;
 			}
@@ -2346,7 +3031,11 @@ invalidate_label_sizes (NemoIconContainer *container)
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
 
-		nemo_icon_canvas_item_invalidate_label_size (icon->item);		
+		if (icon->item != NULL) {
+			nemo_icon_canvas_item_invalidate_label_size (icon->item);
+		} else {
+			icon_invalidate_measure (container, icon);
+		}
 	}
 }
 
@@ -2360,7 +3049,11 @@ invalidate_labels (NemoIconContainer *container)
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
 
-		nemo_icon_canvas_item_invalidate_label (icon->item);		
+		if (icon->item != NULL) {
+			nemo_icon_canvas_item_invalidate_label (icon->item);
+		} else {
+			icon_invalidate_measure (container, icon);
+		}
 	}
 }
 
@@ -2405,7 +3098,7 @@ select_range (NemoIconContainer *container,
 	}
 	
 	if (selection_changed && icon2 != NULL) {
-		emit_atk_focus_tracker_notify (icon2);
+		emit_atk_focus_tracker_notify (container, icon2);
 	}
 	return selection_changed;
 }
@@ -2429,7 +3122,7 @@ select_one_unselect_others (NemoIconContainer *container,
 	}
 	
 	if (selection_changed && icon_to_select != NULL) {
-		emit_atk_focus_tracker_notify (icon_to_select);
+		emit_atk_focus_tracker_notify (container, icon_to_select);
 		reveal_icon (container, icon_to_select);
 	}
 	return selection_changed;
@@ -2477,10 +3170,21 @@ nemo_icon_container_move_icon (NemoIconContainer *container,
 		}
 
 		if (x != icon->x || y != icon->y) {
-			icon_set_position (icon, x, y);
+			icon_set_position (container, icon, x, y);
 			emit_signal = update_position;
 		}
 
+		if (icon->item == NULL) {
+			EelDRect visible, near;
+
+			get_item_viewport (container, &visible, &near);
+			if (icon_is_in_viewport (container, icon, &near)) {
+				icon_ensure_item (container, icon);
+				nemo_icon_canvas_item_set_is_visible
+					(icon->item, icon_is_in_viewport (container, icon, &visible));
+			}
+		}
+
 		icon->saved_ltr_x = nemo_icon_container_is_layout_rtl (container) ? get_mirror_x_position (container, icon, icon->x) : icon->x;
 	}
 	
@@ -2512,43 +3216,58 @@ rubberband_select (NemoIconContainer *container,
 		   const EelDRect *previous_rect,
 		   const EelDRect *current_rect)
 {
-	GList *p;
-	gboolean selection_changed, is_in, canvas_rect_calculated;
+	GList *icons, *p;
+	gboolean selection_changed, is_in;
 	NemoIcon *icon;
-	EelIRect canvas_rect;
+	EelIRect canvas_rect, band_rect;
 	EelCanvas *canvas;
 			
 	selection_changed = FALSE;
-	canvas_rect_calculated = FALSE;
 
-	for (p = container->details->icons; p != NULL; p = p->next) {
+	canvas = EEL_CANVAS (container);
+	eel_canvas_w2c (canvas,
+			current_rect->x0,
+			current_rect->y0,
+			&canvas_rect.x0,
+			&canvas_rect.y0);
+	eel_canvas_w2c (canvas,
+			current_rect->x1,
+			current_rect->y1,
+			&canvas_rect.x1,
+			&canvas_rect.y1);
+
+	/* Only icons under the band now or on the previous tick can
+	 * change, the others are as they were before rubberbanding.
+	 */
+	if (previous_rect != NULL) {
+		eel_canvas_w2c (canvas,
+				previous_rect->x0,
+				previous_rect->y0,
+				&band_rect.x0,
+				&band_rect.y0);
+		eel_canvas_w2c (canvas,
+				previous_rect->x1,
+				previous_rect->y1,
+				&band_rect.x1,
+				&band_rect.y1);
+		eel_irect_union (&band_rect, &band_rect, &canvas_rect);
+		icons = nemo_icon_container_get_icons_in_rect (container, band_rect);
+	} else {
+		icons = g_list_copy (container->details->icons);
+	}
+
+	for (p = icons; p != NULL; p = p->next) {
 		icon = p->data;
 		
-		if (!canvas_rect_calculated) {
-			/* Only do this calculation once, since all the canvas items
-			 * we are interating are in the same coordinate space
-			 */
-			canvas = EEL_CANVAS_ITEM (icon->item)->canvas;
-			eel_canvas_w2c (canvas,
-					current_rect->x0,
-					current_rect->y0,
-					&canvas_rect.x0,
-					&canvas_rect.y0);
-			eel_canvas_w2c (canvas,
-					current_rect->x1,
-					current_rect->y1,
-					&canvas_rect.x1,
-					&canvas_rect.y1);
-			canvas_rect_calculated = TRUE;
-		}
-		
-		is_in = nemo_icon_canvas_item_hit_test_rectangle (icon->item, canvas_rect);
+		is_in = icon_hit_test_rectangle (container, icon, canvas_rect);
 
 		selection_changed |= icon_set_selected
 			(container, icon,
 			 is_in ^ icon->was_selected_before_rubberband);
 	}
 
+	g_list_free (icons);
+
 	if (selection_changed) {
 		g_signal_emit (container,
 				 signals[SELECTION_CHANGED], 0);
@@ -2901,14 +3620,14 @@ compare_icons_horizontal (NemoIconContainer *container,
 	EelDRect world_rect;
 	int ax, bx;
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (container, icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 NULL);
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (container, icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2933,14 +3652,14 @@ compare_icons_vertical (NemoIconContainer *container,
 	EelDRect world_rect;
 	int ay, by;
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (container, icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 NULL,
 		 &ay);
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (container, icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2965,14 +3684,14 @@ compare_icons_horizontal_first (NemoIconContainer *container,
 	EelDRect world_rect;
 	int ax, ay, bx, by;
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (container, icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 &ay);
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (container, icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -3003,14 +3722,14 @@ compare_icons_vertical_first (NemoIconContainer *container,
 	EelDRect world_rect;
 	int ax, ay, bx, by;
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (container, icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 &ay);
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (container, icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -3077,14 +3796,14 @@ static int
 compare_with_start_row (NemoIconContainer *container,
 			NemoIcon *icon)
 {
-	EelCanvasItem *item;
+	EelIRect bounds;
 
-	item = EEL_CANVAS_ITEM (icon->item);
+	icon_get_canvas_bounds (container, icon, &bounds, FALSE);
 	
-	if (container->details->arrow_key_start_y < item->y1) {
+	if (container->details->arrow_key_start_y < bounds.y0) {
 		return -1;
 	}
-	if (container->details->arrow_key_start_y > item->y2) {
+	if (container->details->arrow_key_start_y > bounds.y1) {
 		return +1;
 	}
 	return 0;
@@ -3094,14 +3813,14 @@ static int
 compare_with_start_column (NemoIconContainer *container,
 			   NemoIcon *icon)
 {
-	EelCanvasItem *item;
+	EelIRect bounds;
 
-	item = EEL_CANVAS_ITEM (icon->item);
+	icon_get_canvas_bounds (container, icon, &bounds, FALSE);
 	
-	if (container->details->arrow_key_start_x < item->x1) {
+	if (container->details->arrow_key_start_x < bounds.x0) {
 		return -1;
 	}
-	if (container->details->arrow_key_start_x > item->x2) {
+	if (container->details->arrow_key_start_x > bounds.x1) {
 		return +1;
 	}
 	return 0;
@@ -3469,7 +4188,7 @@ closest_in_90_degrees (NemoIconContainer *container,
 	int *best_dist;
 
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (candidate->item);
+	world_rect = icon_get_icon_rectangle (container, candidate);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -3526,19 +4245,16 @@ closest_in_90_degrees (NemoIconContainer *container,
 }
 
 static EelDRect 
-get_rubberband (NemoIcon *icon1,
+get_rubberband (NemoIconContainer *container,
+		NemoIcon *icon1,
 		NemoIcon *icon2)
 {
 	EelDRect rect1;
 	EelDRect rect2;
 	EelDRect ret;
 
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon1->item),
-				    &rect1.x0, &rect1.y0, 
-				    &rect1.x1, &rect1.y1);
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon2->item),
-				    &rect2.x0, &rect2.y0, 
-				    &rect2.x1, &rect2.y1);
+	icon_get_world_bounds (container, icon1, &rect1, BOUNDS_USAGE_FOR_DISPLAY);
+	icon_get_world_bounds (container, icon2, &rect2, BOUNDS_USAGE_FOR_DISPLAY);
 
 	eel_drect_union (&ret, &rect1, &rect2);
 
@@ -3577,7 +4293,8 @@ keyboard_move_to (NemoIconContainer *container,
 		set_keyboard_focus (container, icon);
 
 		if (icon && container->details->keyboard_rubberband_start) {
-			rect = get_rubberband (container->details->keyboard_rubberband_start,
+			rect = get_rubberband (container,
+					       container->details->keyboard_rubberband_start,
 					       icon);
 			rubberband_select (container, NULL, &rect);
 		}
@@ -3661,7 +4378,7 @@ record_arrow_key_start (NemoIconContainer *container,
 {
 	EelDRect world_rect;
 
-	world_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
+	world_rect = icon_get_icon_rectangle (container, icon);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -4022,6 +4739,12 @@ destroy (GtkWidget *object)
 
         nemo_icon_container_clear (container);
 
+	/* The canvas root destroys the pooled and measuring items */
+	g_queue_clear (container->details->item_pool);
+	container->details->measure_item = NULL;
+
+	nemo_thumbnail_remove_viewport (container);
+
 	if (container->details->rubberband_info.timer_id != 0) {
 		g_source_remove (container->details->rubberband_info.timer_id);
 		container->details->rubberband_info.timer_id = 0;
@@ -4085,6 +4808,13 @@ finalize (GObject *object)
 	g_hash_table_destroy (details->icon_set);
 	details->icon_set = NULL;
 
+	icon_index_clear (NEMO_ICON_CONTAINER (object));
+	g_hash_table_destroy (details->icon_index);
+	details->icon_index = NULL;
+
+	g_hash_table_destroy (details->icons_with_items);
+	g_queue_free (details->item_pool);
+
 	g_free (details->font);
 
 	if (details->a11y_item_action_queue != NULL) {
@@ -4185,14 +4915,13 @@ get_prefered_width (GtkWidget *widget,
 		    gint      *minimum_size,
 		    gint      *natural_size)
 {
-	EelCanvasGroup *root;
 	double x1, x2;
 	int cx1, cx2;
 	int width;
 
-	root = eel_canvas_root (EEL_CANVAS (widget));
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (root),
-				    &x1, NULL, &x2, NULL);
+	/* Not all icons have an item, so the root bounds would fall short */
+	get_all_icon_bounds (NEMO_ICON_CONTAINER (widget),
+			     &x1, NULL, &x2, NULL, BOUNDS_USAGE_FOR_DISPLAY);
 	eel_canvas_w2c (EEL_CANVAS (widget), x1, 0, &cx1, NULL);
 	eel_canvas_w2c (EEL_CANVAS (widget), x2, 0, &cx2, NULL);
 
@@ -4210,14 +4939,13 @@ get_prefered_height (GtkWidget *widget,
 		     gint      *minimum_size,
 		     gint      *natural_size)
 {
-	EelCanvasGroup *root;
 	double y1, y2;
 	int cy1, cy2;
 	int height;
 
-	root = eel_canvas_root (EEL_CANVAS (widget));
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (root),
-				    NULL, &y1, NULL, &y2);
+	/* Not all icons have an item, so the root bounds would fall short */
+	get_all_icon_bounds (NEMO_ICON_CONTAINER (widget),
+			     NULL, &y1, NULL, &y2, BOUNDS_USAGE_FOR_DISPLAY);
 	eel_canvas_w2c (EEL_CANVAS (widget), 0, y1, NULL, &cy1);
 	eel_canvas_w2c (EEL_CANVAS (widget), 0, y2, NULL, &cy2);
 
@@ -4649,7 +5377,7 @@ update_stretch_at_idle (NemoIconContainer *container)
 			  stretch_state.icon_x, stretch_state.icon_y,
 			  &world_x, &world_y);
 
-	icon_set_position (icon, world_x, world_y);
+	icon_set_position (container, icon, world_x, world_y);
 	icon_set_size (container, icon, stretch_state.icon_size, FALSE, FALSE);
 
 	container->details->stretch_idle_id = 0;
@@ -4762,7 +5490,7 @@ undo_stretching (NemoIconContainer *container)
 	nemo_icon_canvas_item_set_show_stretch_handles
 		(stretched_icon->item, FALSE);
 	
-	icon_set_position (stretched_icon,
+	icon_set_position (container, stretched_icon,
 			   container->details->stretch_initial_x,
 			   container->details->stretch_initial_y);
 	icon_set_size (container,
@@ -6133,7 +6861,7 @@ update_selected (NemoIconContainer *container)
 	
 	for (node = container->details->icons; node != NULL; node = node->next) {
 		icon = node->data;
-		if (icon->is_selected) {
+		if (icon->is_selected && icon->item != NULL) {
 			eel_canvas_item_request_update (EEL_CANVAS_ITEM (icon->item));
 		}
 	}
@@ -6250,6 +6978,10 @@ nemo_icon_container_init (NemoIconContainer *container)
 	details = g_new0 (NemoIconContainerDetails, 1);
 
 	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->icon_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->icons_with_items = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->item_pool = g_queue_new ();
+	details->needs_full_layout = TRUE;
 	details->layout_timestamp = UNDEFINED_TIME;
 	details->zoom_level = NEMO_ZOOM_LEVEL_STANDARD;
 
@@ -6521,7 +7253,10 @@ item_event_callback (EelCanvasItem *item,
 	container = NEMO_ICON_CONTAINER (data);
 
 	icon = NEMO_ICON_CANVAS_ITEM (item)->user_data;
-	g_assert (icon != NULL);
+	if (icon == NULL) {
+		/* A pooled item without an icon */
+		return FALSE;
+	}
 
 	switch (event->type) {
 	case GDK_BUTTON_PRESS:
@@ -6567,6 +7302,7 @@ nemo_icon_container_clear (NemoIconContainer *container)
 	clear_keyboard_rubberband_start (container);
 	unschedule_keyboard_icon_reveal (container);
 	set_pending_icon_to_reveal (container, NULL);
+	details->pending_icon_to_rename = NULL;
 	details->stretch_icon = NULL;
 	details->drop_target = NULL;
 
@@ -6577,15 +7313,18 @@ nemo_icon_container_clear (NemoIconContainer *container)
 								       icon->data,
 								       icon);
 		}
-		icon_free (p->data);
+		icon_free (container, p->data);
 	}
 	g_list_free (details->icons);
 	details->icons = NULL;
 	g_list_free (details->new_icons);
 	details->new_icons = NULL;
+	details->n_layout_dirty = 0;
+	details->needs_full_layout = TRUE;
 	
  	g_hash_table_destroy (details->icon_set);
  	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	icon_index_clear (container);
  
 	nemo_icon_container_update_scroll_region (container);
 }
@@ -6603,6 +7342,7 @@ nemo_icon_container_get_first_visible_icon (NemoIconContainer *container)
 	NemoIcon *icon, *best_icon;
 	double x, y;
 	double x1, y1, x2, y2;
+	EelDRect bounds;
 	double *pos, best_pos;
 	double hadj_v, vadj_v, h_page_size;
 	gboolean better_icon;
@@ -6631,8 +7371,12 @@ nemo_icon_container_get_first_visible_icon (NemoIconContainer *container)
 		icon = l->data;
 
 		if (icon_is_positioned (icon)) {
-			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-						    &x1, &y1, &x2, &y2);
+			icon_get_world_bounds (container, icon, &bounds,
+					       BOUNDS_USAGE_FOR_DISPLAY);
+			x1 = bounds.x0;
+			y1 = bounds.y0;
+			x2 = bounds.x1;
+			y2 = bounds.y1;
 
 			compare_lt = FALSE;
 			if (nemo_icon_container_is_layout_vertical (container)) {
@@ -6699,7 +7443,7 @@ nemo_icon_container_scroll_to_icon (NemoIconContainer  *container,
 				/* ensure that we reveal the entire row/column */
 				icon_get_row_and_column_bounds (container, icon, &bounds, TRUE);
 			} else {
-				item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds, TRUE);
+				icon_get_canvas_bounds (container, icon, &bounds, TRUE);
 			}
 
 			if (nemo_icon_container_is_layout_vertical (container)) {
@@ -6785,6 +7529,10 @@ icon_destroy (NemoIconContainer *container,
 	details->new_icons = g_list_remove (details->new_icons, icon);
 	g_hash_table_remove (details->icon_set, icon->data);
 
+	if (icon->layout_dirty) {
+		details->n_layout_dirty--;
+	}
+
 	was_selected = icon->is_selected;
 
 	if (details->keyboard_focus == icon ||
@@ -6815,6 +7563,9 @@ icon_destroy (NemoIconContainer *container,
 	if (details->pending_icon_to_reveal == icon) {
 		set_pending_icon_to_reveal (container, NULL);
 	}
+	if (details->pending_icon_to_rename == icon) {
+		details->pending_icon_to_rename = NULL;
+	}
 	if (details->stretch_icon == icon) {
 		details->stretch_icon = NULL;
 	}
@@ -6824,7 +7575,8 @@ icon_destroy (NemoIconContainer *container,
 							       icon->data,
 							       icon);
 	}
-	icon_free (icon);
+	icon_index_remove (container, icon);
+	icon_free (container, icon);
 
 	if (was_selected) {
 		/* Coalesce multiple removals causing multiple selection_changed events */
@@ -6998,67 +7750,80 @@ nemo_icon_container_prioritize_thumbnailing (NemoIconContainer *container,
 	klass->prioritize_thumbnailing (container, icon->data);
 }
 
+/* Tells the thumbnailer which icons are visible, and which are close
+ * enough to them to be worth thumbnailing next.
+ */
+static void
+publish_thumbnail_viewport (NemoIconContainer *container,
+			    guint first_visible,
+			    guint last_visible)
+{
+	GList *node, *uris;
+	guint margin, first, index;
+
+	margin = nemo_thumbnail_get_viewport_margin ();
+	first = first_visible > margin ? first_visible - margin : 0;
+
+	uris = NULL;
+	for (node = g_list_nth (container->details->icons, first), index = first;
+	     node != NULL && index <= last_visible + margin;
+	     node = node->next, index++) {
+		uris = g_list_prepend (uris, nemo_icon_container_get_icon_uri (container, node->data));
+	}
+	uris = g_list_reverse (uris);
+
+	nemo_thumbnail_set_viewport (container, uris,
+				     first_visible - first,
+				     last_visible - first_visible + 1);
+
+	g_list_free_full (uris, g_free);
+}
+
 static void
 nemo_icon_container_update_visible_icons (NemoIconContainer *container)
 {
-	GtkAdjustment *vadj, *hadj;
-	double min_y, max_y;
-	double min_x, max_x;
-	double x0, y0, x1, y1;
+	EelDRect visible_rect, near_rect;
 	GList *node;
 	NemoIcon *icon;
 	gboolean visible;
-	GtkAllocation allocation;
-
-	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
-	vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
-	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+	guint index, first_visible, last_visible;
 
-	min_x = gtk_adjustment_get_value (hadj);
-	max_x = min_x + allocation.width;
-	
-	min_y = gtk_adjustment_get_value (vadj);
-	max_y = min_y + allocation.height;
+	get_item_viewport (container, &visible_rect, &near_rect);
 
-	eel_canvas_c2w (EEL_CANVAS (container),
-			min_x, min_y, &min_x, &min_y);
-	eel_canvas_c2w (EEL_CANVAS (container),
-			max_x, max_y, &max_x, &max_y);
-	
 	/* Do the iteration in reverse to get the render-order from top to
 	 * bottom for the prioritized thumbnails.
 	 */
+	index = g_list_length (container->details->icons);
+	first_visible = G_MAXUINT;
+	last_visible = 0;
 	for (node = g_list_last (container->details->icons); node != NULL; node = node->prev) {
 		icon = node->data;
+		index--;
 
-		if (icon_is_positioned (icon)) {
-			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-						    &x0,
-						    &y0,
-						    &x1,
-						    &y1);
-			eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-					     &x0,
-					     &y0);
-			eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-					     &x1,
-					     &y1);
-
-			if (nemo_icon_container_is_layout_vertical (container)) {
-				visible = x1 >= min_x && x0 <= max_x;
-			} else {
-				visible = y1 >= min_y && y0 <= max_y;
-			}
-
-			if (visible) {
-				nemo_icon_canvas_item_set_is_visible (icon->item, TRUE);
-				nemo_icon_container_prioritize_thumbnailing (container,
-										 icon);
-			} else {
+		if (!icon_is_in_viewport (container, icon, &near_rect)) {
+			if (icon->item != NULL && !icon_needs_item (container, icon)) {
+				icon_release_item (container, icon);
+			} else if (icon->item != NULL) {
 				nemo_icon_canvas_item_set_is_visible (icon->item, FALSE);
 			}
+			continue;
+		}
+
+		icon_ensure_item (container, icon);
+
+		visible = icon_is_in_viewport (container, icon, &visible_rect);
+		nemo_icon_canvas_item_set_is_visible (icon->item, visible);
+		if (visible) {
+			nemo_icon_container_prioritize_thumbnailing (container,
+								     icon);
+			first_visible = MIN (first_visible, index);
+			last_visible = MAX (last_visible, index);
 		}
 	}
+
+	if (first_visible != G_MAXUINT) {
+		publish_thumbnail_viewport (container, first_visible, last_visible);
+	}
 }
 
 static void
@@ -7079,9 +7844,13 @@ handle_hadjustment_changed (GtkAdjustment *adjustment,
 	}
 }
 
-void 
-nemo_icon_container_update_icon (NemoIconContainer *container,
-				     NemoIcon *icon)
+/* Set up an item to show the icon. This is either the icon's own item,
+ * or the one used to measure icons that have none.
+ */
+static void
+icon_set_item_content (NemoIconContainer *container,
+		       NemoIcon *icon,
+		       NemoIconCanvasItem *item)
 {
 	NemoIconContainerDetails *details;
 	guint icon_size;
@@ -7098,10 +7867,6 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
 	gboolean embedded_text_needs_loading;
 	gboolean has_open_window;
 	
-	if (icon == NULL) {
-		return;
-	}
-
 	details = container->details;
 
 	/* compute the maximum size based on the scale factor */
@@ -7142,7 +7907,7 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
 
 	g_object_unref (icon_info);
  
-	if (has_embedded_text_rect && embedded_text_needs_loading) {
+	if (has_embedded_text_rect && embedded_text_needs_loading && item == icon->item) {
 		icon->is_monitored = TRUE;
 		nemo_icon_container_start_monitor_top_left (container, icon->data, icon, large_embedded_text);
 	}
@@ -7158,16 +7923,17 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
     gboolean show_tooltip = (container->details->show_desktop_tooltips && is_desktop) ||
                             (container->details->show_icon_view_tooltips && !is_desktop);
 
-    if (show_tooltip) {
+    /* The item that measures icons never shows a tooltip */
+    if (show_tooltip && item == icon->item) {
         NemoFile *file = NEMO_FILE (icon->data);
         gchar *tooltip_text;
 
         tooltip_text = nemo_file_construct_tooltip (file, container->details->tooltip_flags);
 
-        nemo_icon_canvas_item_set_tooltip_text (icon->item, tooltip_text);
+        nemo_icon_canvas_item_set_tooltip_text (item, tooltip_text);
         g_free (tooltip_text);
     } else {
-        nemo_icon_canvas_item_set_tooltip_text (icon->item, "");
+        nemo_icon_canvas_item_set_tooltip_text (item, "");
     }
 
 	/* If name of icon being renamed was changed from elsewhere, end renaming mode. 
@@ -7175,22 +7941,23 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
 	 * with the new name, but that could cause timing problems if the user just
 	 * happened to be typing at that moment.
 	 */
-	if (icon == get_icon_being_renamed (container) &&
+	if (item == icon->item &&
+	    icon == get_icon_being_renamed (container) &&
 	    g_strcmp0 (editable_text,
-		       nemo_icon_canvas_item_get_editable_text (icon->item)) != 0) {
+		       nemo_icon_canvas_item_get_editable_text (item)) != 0) {
 		end_renaming_mode (container, FALSE);
 	}
 
-	eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+	eel_canvas_item_set (EEL_CANVAS_ITEM (item),
 			     "editable_text", editable_text,
 			     "additional_text", additional_text,
 			     "highlighted_for_drop", icon == details->drop_target,
 			     NULL);
 
-	nemo_icon_canvas_item_set_image (icon->item, pixbuf);
-	nemo_icon_canvas_item_set_attach_points (icon->item, attach_points, n_attach_points);
-	nemo_icon_canvas_item_set_embedded_text_rect (icon->item, &embedded_text_rect);
-	nemo_icon_canvas_item_set_embedded_text (icon->item, embedded_text);
+	nemo_icon_canvas_item_set_image (item, pixbuf);
+	nemo_icon_canvas_item_set_attach_points (item, attach_points, n_attach_points);
+	nemo_icon_canvas_item_set_embedded_text_rect (item, &embedded_text_rect);
+	nemo_icon_canvas_item_set_embedded_text (item, embedded_text);
 
 	/* Let the pixbufs go. */
 	g_object_unref (pixbuf);
@@ -7199,6 +7966,21 @@ nemo_icon_container_update_icon (NemoIconContainer *container,
 	g_free (additional_text);
 }
 
+void 
+nemo_icon_container_update_icon (NemoIconContainer *container,
+				     NemoIcon *icon)
+{
+	if (icon == NULL) {
+		return;
+	}
+
+	if (icon->item != NULL) {
+		icon_set_item_content (container, icon, icon->item);
+	} else {
+		icon_invalidate_measure (container, icon);
+	}
+}
+
 static gboolean
 assign_icon_position (NemoIconContainer *container,
 		      NemoIcon *icon)
@@ -7217,7 +7999,7 @@ assign_icon_position (NemoIconContainer *container,
 	icon->scale = position.scale;
 	if (!container->details->auto_layout) {
 		if (have_stored_position) {
-			icon_set_position (icon, position.x, position.y);
+			icon_set_position (container, icon, position.x, position.y);
 			icon->saved_ltr_x = icon->x;
 		} else {
 			return FALSE;
@@ -7230,10 +8012,9 @@ static void
 finish_adding_icon (NemoIconContainer *container,
 		    NemoIcon *icon)
 {
-	eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
-
-	g_signal_connect_object (icon->item, "event",
-				 G_CALLBACK (item_event_callback), container, 0);
+	if (icon->item != NULL) {
+		eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
+	}
 
 	g_signal_emit (container, signals[ICON_ADDED], 0, icon->data);
 }
@@ -7300,7 +8081,7 @@ finish_adding_new_icons (NemoIconContainer *container)
 			find_empty_location (container, grid, 
 					     icon, x, y, &x, &y);
 
-			icon_set_position (icon, x, y);
+			icon_set_position (container, icon, x, y);
 
 			position.x = icon->x;
 			position.y = icon->y;
@@ -7373,7 +8154,6 @@ nemo_icon_container_add (NemoIconContainer *container,
 {
 	NemoIconContainerDetails *details;
 	NemoIcon *icon;
-	EelCanvasItem *band, *item;
 	
 	g_return_val_if_fail (NEMO_IS_ICON_CONTAINER (container), FALSE);
 	g_return_val_if_fail (data != NULL, FALSE);
@@ -7384,7 +8164,9 @@ nemo_icon_container_add (NemoIconContainer *container,
 		return FALSE;
 	}
 
-	/* Create the new icon, including the canvas item. */
+	/* Create the new icon. Its canvas item is created once it is
+	 * close to the visible area, see icon_ensure_item().
+	 */
 	icon = g_new0 (NemoIcon, 1);
 	icon->data = data;
 	icon->x = ICON_UNPOSITIONED_VALUE;
@@ -7396,18 +8178,8 @@ nemo_icon_container_add (NemoIconContainer *container,
 	 */
 	icon->has_lazy_position = is_old_or_unknown_icon_data (container, data);
 	icon->scale = 1.0;
- 	icon->item = NEMO_ICON_CANVAS_ITEM
-		(eel_canvas_item_new (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
-				      nemo_icon_canvas_item_get_type (),
-				      "visible", FALSE,
-				      NULL));
-	icon->item->user_data = icon;
-
-	/* Make sure the icon is under the selection_rectangle */
-	item = EEL_CANVAS_ITEM (icon->item);
-	band = NEMO_ICON_CONTAINER (item->canvas)->details->rubberband_info.selection_rectangle;
-	if (band) {
-		eel_canvas_item_send_behind (item, band);
+	if (!is_virtualized (container)) {
+		icon_ensure_item (container, icon);
 	}
 	
 	/* Put it on both lists. */
@@ -7417,9 +8189,10 @@ nemo_icon_container_add (NemoIconContainer *container,
 	g_hash_table_insert (details->icon_set, data, icon);
 
 	details->needs_resort = TRUE;
+	mark_icon_for_layout (container, icon);
 
 	/* Run an idle function to add the icons. */
-	schedule_redo_layout (container);
+	schedule_partial_redo_layout (container);
 	
 	return TRUE;
 }
@@ -7450,6 +8223,7 @@ nemo_icon_container_remove (NemoIconContainer *container,
 				NemoIconData *data)
 {
 	NemoIcon *icon;
+	GList *link;
 
 	g_return_val_if_fail (NEMO_IS_ICON_CONTAINER (container), FALSE);
 	g_return_val_if_fail (data != NULL, FALSE);
@@ -7462,9 +8236,16 @@ nemo_icon_container_remove (NemoIconContainer *container,
 		return FALSE;
 	}
 
-    gtk_widget_set_tooltip_text (GTK_WIDGET (EEL_CANVAS_ITEM (icon->item)->canvas), "");
+    gtk_widget_set_tooltip_text (GTK_WIDGET (container), "");
+
+	/* The icons after this one move up to fill its place */
+	link = g_list_find (container->details->icons, icon);
+	if (link->next != NULL) {
+		mark_icon_for_layout (container, link->next->data);
+	}
+
 	icon_destroy (container, icon);
-	schedule_redo_layout (container);
+	schedule_partial_redo_layout (container);
 
 	g_signal_emit (container, signals[ICON_REMOVED], 0, icon);
 
@@ -7492,7 +8273,8 @@ nemo_icon_container_request_update (NemoIconContainer *container,
 	if (icon != NULL) {
 		nemo_icon_container_update_icon (container, icon);
 		container->details->needs_resort = TRUE;
-		schedule_redo_layout (container);
+		mark_icon_for_layout (container, icon);
+		schedule_partial_redo_layout (container);
 	}
 }
 
@@ -7962,6 +8744,7 @@ nemo_icon_container_show_stretch_handles (NemoIconContainer *container)
 		ungrab_stretch_icon (container);
 		emit_stretch_ended (container, details->stretch_icon);
 	}
+	icon_ensure_item (container, icon);
 	nemo_icon_canvas_item_set_show_stretch_handles (icon->item, TRUE);
 	details->stretch_icon = icon;
 	
@@ -8317,43 +9100,18 @@ nemo_icon_container_is_tighter_layout (NemoIconContainer *container)
    return container->details->tighter_layout;
 }
 
-static void
-pending_icon_to_rename_destroy_callback (NemoIconCanvasItem *item, NemoIconContainer *container)
-{
-	g_assert (container->details->pending_icon_to_rename != NULL);
-	g_assert (container->details->pending_icon_to_rename->item == item);
-	container->details->pending_icon_to_rename = NULL;
-}
-
 static NemoIcon*
 get_pending_icon_to_rename (NemoIconContainer *container)
 {
 	return container->details->pending_icon_to_rename;
 }
 
+/* icon_destroy() and nemo_icon_container_clear() forget the icon
+ * when it goes away.
+ */
 static void
 set_pending_icon_to_rename (NemoIconContainer *container, NemoIcon *icon)
 {
-	NemoIcon *old_icon;
-	
-	old_icon = container->details->pending_icon_to_rename;
-	
-	if (icon == old_icon) {
-		return;
-	}
-	
-	if (old_icon != NULL) {
-		g_signal_handlers_disconnect_by_func
-			(old_icon->item,
-			 G_CALLBACK (pending_icon_to_rename_destroy_callback),
-			 container);
-	}
-	
-	if (icon != NULL) {
-		g_signal_connect (icon->item, "destroy",
-				  G_CALLBACK (pending_icon_to_rename_destroy_callback), container);
-	}
-	
 	container->details->pending_icon_to_rename = icon;
 }
 
@@ -8432,6 +9190,9 @@ nemo_icon_container_start_renaming_selected_item (NemoIconContainer *container,
 	
 	set_pending_icon_to_rename (container, NULL);
 
+	/* The icon keeps its item while it is renamed, see icon_needs_item() */
+	icon_ensure_item (container, icon);
+
 	/* Make a copy of the original editable text for a later compare */
 	editable_text = nemo_icon_canvas_item_get_editable_text (icon->item);
 
@@ -8478,8 +9239,8 @@ nemo_icon_container_start_renaming_selected_item (NemoIconContainer *container,
 						 desc);
 	pango_font_description_free (desc);
 	
-	icon_rect = nemo_icon_canvas_item_get_icon_rectangle (icon->item);
-    text_rect = nemo_icon_canvas_item_get_text_rectangle (icon->item, TRUE);
+	icon_rect = icon_get_icon_rectangle (container, icon);
+    text_rect = icon_get_text_rectangle (container, icon, TRUE);
 
 	if (nemo_icon_container_is_layout_vertical (container) &&
 	    container->details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
@@ -8490,12 +9251,12 @@ nemo_icon_container_start_renaming_selected_item (NemoIconContainer *container,
 	}
 
 	if (details->label_position == NEMO_ICON_LABEL_POSITION_BESIDE) {
-		eel_canvas_w2c (EEL_CANVAS_ITEM (icon->item)->canvas,
+		eel_canvas_w2c (EEL_CANVAS (container),
 				text_rect.x0,
 				text_rect.y0,
 				&x, &y);
 	} else {
-		eel_canvas_w2c (EEL_CANVAS_ITEM (icon->item)->canvas,
+		eel_canvas_w2c (EEL_CANVAS (container),
 				(icon_rect.x0 + icon_rect.x1) / 2,
 				icon_rect.y1,
 				&x, &y);
@@ -8556,7 +9317,9 @@ end_renaming_mode (NemoIconContainer *container, gboolean commit)
 
 	/* We are not in renaming mode */
 	container->details->renaming = FALSE;
-	nemo_icon_canvas_item_set_renaming (icon->item, FALSE);
+	if (icon->item != NULL) {
+		nemo_icon_canvas_item_set_renaming (icon->item, FALSE);
+	}
 	
 	nemo_icon_container_unfreeze_updates (container);
 
@@ -8662,9 +9425,15 @@ nemo_icon_container_set_is_desktop (NemoIconContainer *container,
 
 	if (is_desktop) {
 		GtkStyleContext *context;
+		GList *l;
 
 		context = gtk_widget_get_style_context (GTK_WIDGET (container));
 		gtk_style_context_add_class (context, "nemo-desktop");
+
+		/* Desktop icons always have an item, see is_virtualized() */
+		for (l = container->details->icons; l != NULL; l = l->next) {
+			icon_ensure_item (container, l->data);
+		}
 	}
 }
 
@@ -8829,10 +9598,13 @@ nemo_icon_container_set_highlighted_for_clipboard (NemoIconContainer *container,
 	for (l = container->details->icons; l != NULL; l = l->next) {
 		icon = l->data;
 		highlighted_for_clipboard = (g_list_find (clipboard_icon_data, icon->data) != NULL);
+		icon->is_highlighted_for_clipboard = highlighted_for_clipboard;
 
-		eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
-				     "highlighted-for-clipboard", highlighted_for_clipboard,
-				     NULL);
+		if (icon->item != NULL) {
+			eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+					     "highlighted-for-clipboard", highlighted_for_clipboard,
+					     NULL);
+		}
 	}
 
 }
@@ -9006,8 +9778,9 @@ nemo_icon_container_accessible_icon_added_cb (NemoIconContainer *container,
 	icon = g_hash_table_lookup (container->details->icon_set, icon_data);
 	if (icon) {
 		atk_parent = ATK_OBJECT (data);
-		atk_child = atk_gobject_accessible_for_object 
-			(G_OBJECT (icon->item));
+		/* Icons away from the visible area have no item yet */
+		atk_child = icon->item != NULL ?
+			atk_gobject_accessible_for_object (G_OBJECT (icon->item)) : NULL;
 		index = g_list_index (container->details->icons, icon);
 		
 		g_signal_emit_by_name (atk_parent, "children_changed::add",
@@ -9028,8 +9801,9 @@ nemo_icon_container_accessible_icon_removed_cb (NemoIconContainer *container,
 	icon = g_hash_table_lookup (container->details->icon_set, icon_data);
 	if (icon) {
 		atk_parent = ATK_OBJECT (data);
-		atk_child = atk_gobject_accessible_for_object 
-			(G_OBJECT (icon->item));
+		/* Icons away from the visible area have no item yet */
+		atk_child = icon->item != NULL ?
+			atk_gobject_accessible_for_object (G_OBJECT (icon->item)) : NULL;
 		index = g_list_index (container->details->icons, icon);
 		
 		g_signal_emit_by_name (atk_parent, "children_changed::remove",
@@ -9099,13 +9873,17 @@ nemo_icon_container_accessible_ref_selection (AtkSelection *accessible,
 {
 	AtkObject *atk_object;
 	NemoIconContainerAccessiblePrivate *priv;
+	NemoIconContainer *container;
 	NemoIcon *icon;
 
+	container = NEMO_ICON_CONTAINER (gtk_accessible_get_widget (GTK_ACCESSIBLE (accessible)));
+
 	nemo_icon_container_accessible_update_selection (ATK_OBJECT (accessible));
 	priv = accessible_get_priv (ATK_OBJECT (accessible));
 
 	icon = g_list_nth_data (priv->selection, i);
 	if (icon) {
+		icon_ensure_item (container, icon);
 		atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
 		if (atk_object) {
 			g_object_ref (atk_object);
@@ -9273,6 +10051,7 @@ nemo_icon_container_accessible_ref_child (AtkObject *accessible, int i)
         
         icon = g_list_nth_data (container->details->icons, i);
         if (icon) {
+                icon_ensure_item (container, icon);
                 atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
                 g_object_ref (atk_object);
                 
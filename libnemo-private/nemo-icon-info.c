@@ -23,6 +23,7 @@
 #include "nemo-icon-info.h"
 #include "nemo-icon-names.h"
 #include "nemo-default-file-icon.h"
+#include "nemo-global-preferences.h"
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 
@@ -41,6 +42,10 @@ struct _NemoIconInfo
 	char *display_name;
     char *icon_name;
     gint orig_scale;
+
+	/* Where it is in the caches, while it is in one */
+	GList *lru_link;
+	gsize cache_size;
 };
 
 struct _NemoIconInfoClass
@@ -49,6 +54,7 @@ struct _NemoIconInfoClass
 };
 
 static void schedule_reap_cache (void);
+static void cache_icon_owner_changed (NemoIconInfo *icon);
 
 G_DEFINE_TYPE (NemoIconInfo,
 	       nemo_icon_info,
@@ -80,6 +86,7 @@ pixbuf_toggle_notify (gpointer      info,
 					    pixbuf_toggle_notify,
 					    info);
 		icon->last_use_time = g_get_monotonic_time ();
+		cache_icon_owner_changed (icon);
 		schedule_reap_cache ();
 	}
 }
@@ -193,6 +200,182 @@ static guint reap_cache_timeout = 0;
 
 static guint time_now;
 
+/* Both caches share one budget, charged with the size of the pixbufs.
+ * Icons whose pixbuf is still in use elsewhere wouldn't free anything
+ * if dropped, so they wait in cache_in_use until their pixbuf comes
+ * back. The others are in cache_lru, most recently used at the head,
+ * and are evicted from its tail.
+ */
+static GQueue cache_lru = G_QUEUE_INIT;
+static GQueue cache_in_use = G_QUEUE_INIT;
+static gsize cache_size = 0;
+static gsize cache_budget = 0;
+static guint evict_idle_id = 0;
+
+static guint64 cache_hits = 0;
+static guint64 cache_misses = 0;
+static guint64 cache_evictions = 0;
+
+typedef struct {
+	GHashTable *cache;
+	gpointer key;
+} CacheEntry;
+
+static void
+cache_budget_changed (void)
+{
+	cache_budget = (gsize) g_settings_get_int (nemo_preferences,
+						   NEMO_PREFERENCES_ICON_CACHE_SIZE) * 1024 * 1024;
+}
+
+static gsize
+get_cache_budget (void)
+{
+	static gboolean connected = FALSE;
+
+	if (!connected) {
+		connected = TRUE;
+		g_signal_connect_swapped (nemo_preferences,
+					  "changed::" NEMO_PREFERENCES_ICON_CACHE_SIZE,
+					  G_CALLBACK (cache_budget_changed), NULL);
+		cache_budget_changed ();
+	}
+
+	return cache_budget;
+}
+
+/* The queue an icon belongs in, going by sole_owner */
+static GQueue *
+cache_queue_for_icon (NemoIconInfo *icon)
+{
+	return icon->sole_owner ? &cache_lru : &cache_in_use;
+}
+
+/* Destroy notify of both caches, for whatever removes the icon */
+static void
+cache_entry_removed (NemoIconInfo *icon)
+{
+	CacheEntry *entry;
+
+	entry = icon->lru_link->data;
+	g_queue_delete_link (cache_queue_for_icon (icon), icon->lru_link);
+	icon->lru_link = NULL;
+	g_slice_free (CacheEntry, entry);
+
+	cache_size -= icon->cache_size;
+	icon->cache_size = 0;
+
+	g_object_unref (icon);
+}
+
+static void
+cache_icon_used (NemoIconInfo *icon)
+{
+	GQueue *queue;
+
+	cache_hits++;
+
+	queue = cache_queue_for_icon (icon);
+	g_queue_unlink (queue, icon->lru_link);
+	g_queue_push_head_link (queue, icon->lru_link);
+}
+
+static void
+evict_icons_over_budget (void)
+{
+	CacheEntry *entry;
+	gsize budget;
+
+	budget = get_cache_budget ();
+
+	while (cache_lru.tail != NULL && cache_size > budget) {
+		entry = cache_lru.tail->data;
+		cache_evictions++;
+		g_hash_table_remove (entry->cache, entry->key);
+	}
+}
+
+static gboolean
+evict_icons_idle (gpointer data)
+{
+	evict_idle_id = 0;
+	evict_icons_over_budget ();
+
+	return FALSE;
+}
+
+/* Move a cached icon between cache_lru and cache_in_use after
+ * sole_owner changed. This runs from the toggle notify of the pixbuf,
+ * so icons that can go now are evicted from an idle.
+ */
+static void
+cache_icon_owner_changed (NemoIconInfo *icon)
+{
+	if (icon->lru_link == NULL) {
+		return;
+	}
+
+	g_queue_unlink (icon->sole_owner ? &cache_in_use : &cache_lru,
+			icon->lru_link);
+	g_queue_push_head_link (cache_queue_for_icon (icon), icon->lru_link);
+
+	if (icon->sole_owner &&
+	    cache_size > get_cache_budget () &&
+	    evict_idle_id == 0) {
+		evict_idle_id = g_idle_add (evict_icons_idle, NULL);
+	}
+}
+
+/* Takes over the reference to icon */
+static void
+cache_icon_insert (GHashTable *cache,
+		   gpointer key,
+		   NemoIconInfo *icon)
+{
+	CacheEntry *entry;
+	GQueue *queue;
+
+	cache_misses++;
+
+	entry = g_slice_new (CacheEntry);
+	entry->cache = cache;
+	entry->key = key;
+
+	queue = cache_queue_for_icon (icon);
+	g_queue_push_head (queue, entry);
+	icon->lru_link = queue->head;
+
+	icon->cache_size = sizeof (NemoIconInfo);
+	if (icon->pixbuf != NULL) {
+		icon->cache_size += gdk_pixbuf_get_byte_length (icon->pixbuf);
+	}
+	cache_size += icon->cache_size;
+
+	g_hash_table_insert (cache, key, icon);
+
+	evict_icons_over_budget ();
+}
+
+void
+nemo_icon_info_get_cache_stats (guint64 *hits,
+				guint64 *misses,
+				guint64 *evictions,
+				gsize *size)
+{
+	if (hits != NULL) {
+		*hits = cache_hits;
+	}
+	if (misses != NULL) {
+		*misses = cache_misses;
+	}
+	if (evictions != NULL) {
+		*evictions = cache_evictions;
+	}
+	if (size != NULL) {
+		*size = cache_size;
+	}
+}
+
 static gboolean
 reap_old_icon (gpointer  key,
 	       gpointer  value,
@@ -204,6 +387,7 @@ reap_old_icon (gpointer  key,
 	if (icon->sole_owner) {
 		if (time_now - icon->last_use_time > 30 * MICROSEC_PER_SEC) {
 			/* This went unused 30 secs ago. reap */
+			cache_evictions++;
 			return TRUE;
 		} else {
 			/* We can reap this soon */
@@ -234,7 +418,7 @@ reap_cache (gpointer data)
 					     reap_old_icon,
 					     &reapable_icons_left);
 	}
-	
+
 	if (reapable_icons_left) {
 		return TRUE;
 	} else {
@@ -349,7 +533,7 @@ nemo_icon_info_lookup (GIcon *icon,
 				g_hash_table_new_full ((GHashFunc)loadable_icon_key_hash,
 						       (GEqualFunc)loadable_icon_key_equal,
 						       (GDestroyNotify) loadable_icon_key_free,
-						       (GDestroyNotify) g_object_unref);
+						       (GDestroyNotify) cache_entry_removed);
 		}
 		
 		lookup_key.icon = icon;
@@ -357,6 +541,7 @@ nemo_icon_info_lookup (GIcon *icon,
 
 		icon_info = g_hash_table_lookup (loadable_icon_cache, &lookup_key);
 		if (icon_info) {
+			cache_icon_used (icon_info);
 			return g_object_ref (icon_info);
 		}
 
@@ -375,10 +560,12 @@ nemo_icon_info_lookup (GIcon *icon,
 
 		icon_info = nemo_icon_info_new_for_pixbuf (pixbuf, scale);
 
+		/* The cache may let it go right away if it is over budget */
+		g_object_ref (icon_info);
 		key = loadable_icon_key_new (icon, size);
-		g_hash_table_insert (loadable_icon_cache, key, icon_info);
+		cache_icon_insert (loadable_icon_cache, key, icon_info);
 
-		return g_object_ref (icon_info);
+		return icon_info;
 	} else if (G_IS_THEMED_ICON (icon)) {
 		const char * const *names;
 		ThemedIconKey lookup_key;
@@ -392,7 +579,7 @@ nemo_icon_info_lookup (GIcon *icon,
 				g_hash_table_new_full ((GHashFunc)themed_icon_key_hash,
 						       (GEqualFunc)themed_icon_key_equal,
 						       (GDestroyNotify) themed_icon_key_free,
-						       (GDestroyNotify) g_object_unref);
+						       (GDestroyNotify) cache_entry_removed);
 		}
 		
 		names = g_themed_icon_get_names (G_THEMED_ICON (icon));
@@ -420,17 +607,19 @@ nemo_icon_info_lookup (GIcon *icon,
 		icon_info = g_hash_table_lookup (themed_icon_cache, &lookup_key);
 		if (icon_info) {
 			g_object_unref (gtkicon_info);
+			cache_icon_used (icon_info);
 			return g_object_ref (icon_info);
 		}
 		
 		icon_info = nemo_icon_info_new_for_icon_info (gtkicon_info, scale);
 		
+		g_object_ref (icon_info);
 		key = themed_icon_key_new (filename, size);
-		g_hash_table_insert (themed_icon_cache, key, icon_info);
+		cache_icon_insert (themed_icon_cache, key, icon_info);
 
 		g_object_unref (gtkicon_info);
 
-		return g_object_ref (icon_info);
+		return icon_info;
 	} else {
                 GdkPixbuf *pixbuf;
                 GtkIconInfo *gtk_icon_info;
@@ -503,6 +692,7 @@ nemo_icon_info_get_pixbuf_nodefault (NemoIconInfo  *icon)
 			g_object_add_toggle_ref (G_OBJECT (res),
 						 pixbuf_toggle_notify,
 						 icon);
+			cache_icon_owner_changed (icon);
 		}
 	}
 	
@@ -81,6 +81,10 @@ const char *          nemo_icon_info_get_display_name             (NemoIconInfo
 const char *          nemo_icon_info_get_used_name                (NemoIconInfo  *icon);
 
 void                  nemo_icon_info_clear_caches                 (void);
+void                  nemo_icon_info_get_cache_stats              (guint64           *hits,
+								       guint64           *misses,
+								       guint64           *evictions,
+								       gsize             *size);
 
 /* Relationship between zoom levels and icons sizes. */
 guint nemo_get_icon_size_for_zoom_level          (NemoZoomLevel  zoom_level);
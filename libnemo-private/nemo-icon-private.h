@@ -36,9 +36,16 @@ typedef struct {
 	/* Object represented by this icon. */
 	NemoIconData *data;
 
-	/* Canvas item for the icon. */
+	/* Canvas item for the icon. Unless the container is a desktop,
+	 * only icons in or near the visible area have one.
+	 */
 	NemoIconCanvasItem *item;
 
+	/* Size of the image and label, unselected, kept while the icon
+	 * has no item.
+	 */
+	NemoIconCanvasItemMeasure measure;
+
 	/* X/Y coordinates. */
 	double x, y;
 
@@ -59,6 +66,9 @@ typedef struct {
 	/* Whether this item was selected before rubberbanding. */
 	eel_boolean_bit was_selected_before_rubberband : 1;
 
+	/* Whether this item is highlighted as being in the clipboard. */
+	eel_boolean_bit is_highlighted_for_clipboard : 1;
+
 	/* Whether this item is visible in the view. */
 	eel_boolean_bit is_visible : 1;
 
@@ -66,6 +76,23 @@ typedef struct {
 	eel_boolean_bit is_monitored : 1;
 
 	eel_boolean_bit has_lazy_position : 1;
+
+	/* Whether this item is in the spatial index, and in which cells. */
+	eel_boolean_bit is_indexed : 1;
+	EelIRect index_cells;
+
+	/* Whether this item was added or changed since the last layout. */
+	eel_boolean_bit layout_dirty : 1;
+
+	/* Whether this item started a line in the last layout, and where. */
+	eel_boolean_bit starts_layout_line : 1;
+	double layout_line_y;
+
+	/* Whether measure is current, and whether the entire label text
+	 * must be visible, for when the icon has no item.
+	 */
+	eel_boolean_bit measure_valid : 1;
+	eel_boolean_bit entire_text : 1;
 } NemoIcon;
 
 
@@ -124,6 +151,21 @@ struct NemoIconContainerDetails {
 	GList *new_icons;
 	GHashTable *icon_set;
 
+	/* Icons by the grid cells their canvas bounds touch. */
+	GHashTable *icon_index;
+
+	/* Icons that have a canvas item, items that can be given to other
+	 * icons, and a hidden item used to measure icons without one.
+	 */
+	GHashTable *icons_with_items;
+	GQueue *item_pool;
+	NemoIconCanvasItem *measure_item;
+
+	/* Set when icons were taken out of the spatial index to be
+	 * measured again.
+	 */
+	gboolean icon_index_dirty;
+
 	/* Current icon for keyboard navigation. */
 	NemoIcon *keyboard_focus;
 	NemoIcon *keyboard_rubberband_start;
@@ -274,6 +316,10 @@ struct NemoIconContainerDetails {
 	eel_boolean_bit is_loading : 1;
 	eel_boolean_bit needs_resort : 1;
 
+	/* Unless set, only the icons marked layout_dirty need placing */
+	eel_boolean_bit needs_full_layout : 1;
+	guint n_layout_dirty;
+
 	eel_boolean_bit store_layout_timestamps : 1;
 	eel_boolean_bit store_layout_timestamps_when_finishing_new_icons : 1;
 	time_t layout_timestamp;
@@ -311,5 +357,14 @@ gboolean      nemo_icon_container_scroll                      (NemoIconContainer
 								   int                    delta_x,
 								   int                    delta_y);
 void          nemo_icon_container_update_scroll_region        (NemoIconContainer *container);
+void          nemo_icon_container_update_icon_index           (NemoIconContainer *container,
+								   NemoIcon          *icon);
+GList *       nemo_icon_container_get_icons_in_rect           (NemoIconContainer *container,
+								   EelIRect               canvas_rect);
+EelDRect      nemo_icon_container_get_icon_rectangle          (NemoIconContainer *container,
+								   NemoIcon          *icon);
+gboolean      nemo_icon_container_hit_test_icon               (NemoIconContainer *container,
+								   NemoIcon          *icon,
+								   EelIRect               canvas_rect);
 
 #endif /* NEMO_ICON_CONTAINER_PRIVATE_H */
@@ -25,10 +25,20 @@
 #include "nemo-global-preferences.h"
 
 struct _NemoJobQueuePriv {
-	GList *queued_jobs;
-    GList *running_jobs;
+	GQueue queued_jobs;
+	GQueue running_jobs;
+	/* NemoProgressInfo -> Job, for queued and running jobs */
+	GHashTable *jobs_by_info;
+	/* job user_data -> Job, to catch jobs that are added twice */
+	GHashTable *jobs_by_data;
+	/* device id -> number of running jobs using it */
+	GHashTable *device_jobs;
+	/* running jobs whose devices are unknown */
+	gint unknown_device_jobs;
     gulong pref_changed_id;
+    gulong per_device_changed_id;
     gboolean skip_queue;
+    gint max_per_device;
 };
 
 enum {
@@ -41,8 +51,21 @@ typedef struct {
     gpointer user_data;
     NemoProgressInfo *info;
     GCancellable *cancellable;
+    /* The filesystems the job reads or writes, NULL if unknown */
+    char **devices;
+    /* Link in queued_jobs or running_jobs */
+    GList link;
+    gboolean running;
+    /* devices are still being looked up */
+    gboolean resolving;
 } Job;
 
+typedef struct {
+    NemoProgressInfo *info;
+    GList *sources;
+    GFile *destination;
+} DeviceLookup;
+
 static NemoJobQueue *singleton = NULL;
 
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -50,20 +73,42 @@ static guint signals[LAST_SIGNAL] = { 0, };
 G_DEFINE_TYPE (NemoJobQueue, nemo_job_queue,
                G_TYPE_OBJECT);
 
+static void
+job_free (Job *job)
+{
+    g_strfreev (job->devices);
+    g_slice_free (Job, job);
+}
+
 static void
 nemo_job_queue_finalize (GObject *obj)
 {
 	NemoJobQueue *self = NEMO_JOB_QUEUE (obj);
+	GList *l, *next;
 
-	if (self->priv->queued_jobs != NULL) {
-		g_list_free_full (self->priv->queued_jobs, g_object_unref);
+	for (l = self->priv->queued_jobs.head; l != NULL; l = next) {
+		next = l->next;
+		job_free (l->data);
+	}
+	for (l = self->priv->running_jobs.head; l != NULL; l = next) {
+		next = l->next;
+		job_free (l->data);
 	}
 
+	g_hash_table_destroy (self->priv->jobs_by_info);
+	g_hash_table_destroy (self->priv->jobs_by_data);
+	g_hash_table_destroy (self->priv->device_jobs);
+
     if (self->priv->pref_changed_id != 0) {
         g_signal_handler_disconnect (nemo_preferences, self->priv->pref_changed_id);
         self->priv->pref_changed_id = 0;
     }
 
+    if (self->priv->per_device_changed_id != 0) {
+        g_signal_handler_disconnect (nemo_preferences, self->priv->per_device_changed_id);
+        self->priv->per_device_changed_id = 0;
+    }
+
 	G_OBJECT_CLASS (nemo_job_queue_parent_class)->finalize (obj);
 }
 
@@ -94,20 +139,37 @@ pref_changed_cb (NemoJobQueue *self)
                                                      NEMO_PREFERENCES_NEVER_QUEUE_FILE_OPS);
 }
 
+static void
+per_device_changed_cb (NemoJobQueue *self)
+{
+    self->priv->max_per_device = MAX (1, g_settings_get_int (nemo_preferences,
+                                                             NEMO_PREFERENCES_FILE_OPS_PER_DEVICE));
+
+    nemo_job_queue_start_next_job (self);
+}
+
 static void
 nemo_job_queue_init (NemoJobQueue *self)
 {
 	self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, NEMO_TYPE_JOB_QUEUE,
 						  NemoJobQueuePriv);
 
-    self->priv->queued_jobs = NULL;
-    self->priv->running_jobs = NULL;
+    g_queue_init (&self->priv->queued_jobs);
+    g_queue_init (&self->priv->running_jobs);
+    self->priv->jobs_by_info = g_hash_table_new (g_direct_hash, g_direct_equal);
+    self->priv->jobs_by_data = g_hash_table_new (g_direct_hash, g_direct_equal);
+    self->priv->device_jobs = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     g_free, NULL);
 
     self->priv->pref_changed_id = g_signal_connect_swapped (nemo_preferences,
                                                     "changed::" NEMO_PREFERENCES_NEVER_QUEUE_FILE_OPS,
                                                     G_CALLBACK (pref_changed_cb), self);
+    self->priv->per_device_changed_id = g_signal_connect_swapped (nemo_preferences,
+                                                    "changed::" NEMO_PREFERENCES_FILE_OPS_PER_DEVICE,
+                                                    G_CALLBACK (per_device_changed_cb), self);
 
     pref_changed_cb (self);
+    per_device_changed_cb (self);
 }
 
 static void
@@ -132,44 +194,233 @@ nemo_job_queue_class_init (NemoJobQueueClass *klass)
 	g_type_class_add_private (klass, sizeof (NemoJobQueuePriv));
 }
 
-static gint
-compare_info_func (gconstpointer a,
-                   gconstpointer b)
+static void
+charge_devices (NemoJobQueue *self,
+                Job          *job,
+                gint          delta)
 {
-    Job *job = (Job*) a;
-    return (job->info == b) ? 0 : 1;
+    gint i, count;
+
+    if (job->devices == NULL) {
+        self->priv->unknown_device_jobs += delta;
+        return;
+    }
+
+    for (i = 0; job->devices[i] != NULL; i++) {
+        count = GPOINTER_TO_INT (g_hash_table_lookup (self->priv->device_jobs, job->devices[i]));
+        count += delta;
+
+        if (count > 0)
+            g_hash_table_replace (self->priv->device_jobs,
+                                  g_strdup (job->devices[i]),
+                                  GINT_TO_POINTER (count));
+        else
+            g_hash_table_remove (self->priv->device_jobs, job->devices[i]);
+    }
 }
 
-static gint
-compare_job_data_func (gconstpointer a,
-                       gconstpointer b)
+/* A queued job may start when none of its devices already has
+ * max_per_device jobs on it. Jobs we know nothing about run alone,
+ * as all queued jobs used to.
+ */
+static gboolean
+job_can_start (NemoJobQueue *self,
+               Job          *job)
 {
-    Job *job = (Job*) a;
-    return (job->job_func == b) ? 0 : 1;
+    gint i, count;
+
+    if (job->resolving)
+        return FALSE;
+
+    if (job->devices == NULL)
+        return g_queue_is_empty (&self->priv->running_jobs);
+
+    if (self->priv->unknown_device_jobs > 0)
+        return FALSE;
+
+    for (i = 0; job->devices[i] != NULL; i++) {
+        count = GPOINTER_TO_INT (g_hash_table_lookup (self->priv->device_jobs, job->devices[i]));
+
+        if (count >= self->priv->max_per_device)
+            return FALSE;
+    }
+
+    return TRUE;
 }
 
 static void
 job_finished_cb (NemoJobQueue *self,
                  NemoProgressInfo *info)
 {
-    GList *ptr;
+    Job *job;
 
-    ptr = g_list_find_custom (self->priv->running_jobs, info, (GCompareFunc) compare_info_func);
-    if (!ptr)
-        ptr = g_list_find_custom (self->priv->queued_jobs, info, (GCompareFunc) compare_info_func);
+    job = g_hash_table_lookup (self->priv->jobs_by_info, info);
 
-    Job *job = ptr->data; 
+    if (job == NULL)
+        return;
 
-    self->priv->running_jobs = g_list_remove (self->priv->running_jobs, job);
-    self->priv->queued_jobs = g_list_remove (self->priv->queued_jobs, job);
+    g_hash_table_remove (self->priv->jobs_by_info, info);
+    g_hash_table_remove (self->priv->jobs_by_data, job->user_data);
 
-    g_slice_free (Job, job);
+    if (job->running) {
+        g_queue_unlink (&self->priv->running_jobs, &job->link);
+        charge_devices (self, job, -1);
+    } else {
+        g_queue_unlink (&self->priv->queued_jobs, &job->link);
+    }
+
+    g_signal_handlers_disconnect_by_func (info, job_finished_cb, self);
+
+    job_free (job);
 
     nemo_job_queue_start_next_job (self);
 }
 
 static void start_job (NemoJobQueue *self, Job *job);
 
+static void
+device_lookup_free (DeviceLookup *lookup)
+{
+    g_object_unref (lookup->info);
+    g_list_free_full (lookup->sources, g_object_unref);
+    g_clear_object (&lookup->destination);
+    g_slice_free (DeviceLookup, lookup);
+}
+
+static gboolean
+add_device (GPtrArray           *devices,
+            GFile               *location,
+            GFileQueryInfoFlags  flags,
+            GCancellable        *cancellable)
+{
+    GFileInfo *info;
+    const char *fs_id;
+    guint i;
+
+    info = g_file_query_info (location,
+                              G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                              flags,
+                              cancellable,
+                              NULL);
+
+    if (info == NULL)
+        return FALSE;
+
+    fs_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+
+    if (fs_id == NULL) {
+        g_object_unref (info);
+        return FALSE;
+    }
+
+    for (i = 0; i < devices->len; i++) {
+        if (g_strcmp0 (g_ptr_array_index (devices, i), fs_id) == 0)
+            break;
+    }
+
+    if (i == devices->len)
+        g_ptr_array_add (devices, g_strdup (fs_id));
+
+    g_object_unref (info);
+
+    return TRUE;
+}
+
+/* Runs in a worker thread, so that files nemo hasn't loaded yet don't
+ * cost a blocking query on the main loop. Returns NULL when some file
+ * can't be looked up, the job then runs alone.
+ */
+static void
+lookup_devices_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+    DeviceLookup *lookup = task_data;
+    GPtrArray *devices;
+    gboolean known = TRUE;
+    GList *l;
+
+    devices = g_ptr_array_new_with_free_func (g_free);
+
+    for (l = lookup->sources; l != NULL && known; l = l->next) {
+        known = add_device (devices, G_FILE (l->data),
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable);
+    }
+
+    if (known && lookup->destination != NULL) {
+        known = add_device (devices, lookup->destination,
+                            G_FILE_QUERY_INFO_NONE, cancellable);
+    }
+
+    if (!known || devices->len == 0) {
+        g_ptr_array_free (devices, TRUE);
+        g_task_return_pointer (task, NULL, NULL);
+        return;
+    }
+
+    g_ptr_array_add (devices, NULL);
+
+    g_task_return_pointer (task, g_ptr_array_free (devices, FALSE),
+                           (GDestroyNotify) g_strfreev);
+}
+
+static void
+lookup_devices_done (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+    NemoJobQueue *self = NEMO_JOB_QUEUE (source_object);
+    DeviceLookup *lookup;
+    char **devices;
+    Job *job;
+
+    lookup = g_task_get_task_data (G_TASK (res));
+    devices = g_task_propagate_pointer (G_TASK (res), NULL);
+
+    /* The job may have finished or been cancelled in the meantime */
+    job = g_hash_table_lookup (self->priv->jobs_by_info, lookup->info);
+
+    if (job == NULL || !job->resolving) {
+        g_strfreev (devices);
+        return;
+    }
+
+    /* A job that was started right away ran as unknown until now */
+    if (job->running)
+        charge_devices (self, job, -1);
+
+    job->devices = devices;
+    job->resolving = FALSE;
+
+    if (job->running)
+        charge_devices (self, job, 1);
+
+    nemo_job_queue_start_next_job (self);
+}
+
+static void
+lookup_devices (NemoJobQueue *self,
+                Job          *job,
+                GList        *sources,
+                GFile        *destination)
+{
+    DeviceLookup *lookup;
+    GTask *task;
+
+    lookup = g_slice_new0 (DeviceLookup);
+    lookup->info = g_object_ref (job->info);
+    lookup->sources = g_list_copy_deep (sources, (GCopyFunc) g_object_ref, NULL);
+    lookup->destination = destination != NULL ? g_object_ref (destination) : NULL;
+
+    job->resolving = TRUE;
+
+    task = g_task_new (self, job->cancellable, lookup_devices_done, NULL);
+    g_task_set_task_data (task, lookup, (GDestroyNotify) device_lookup_free);
+    g_task_run_in_thread (task, lookup_devices_thread);
+    g_object_unref (task);
+}
+
 NemoJobQueue *
 nemo_job_queue_get (void)
 {
@@ -182,9 +433,11 @@ nemo_job_queue_add_new_job (NemoJobQueue         *self,
                             gpointer              user_data,
                             GCancellable         *cancellable,
                             NemoProgressInfo     *info,
+                            GList                *sources,
+                            GFile                *destination,
                             gboolean              start_immediately)
 {
-	if (g_list_find_custom (self->priv->queued_jobs, user_data, (GCompareFunc) compare_job_data_func) != NULL) {
+	if (g_hash_table_contains (self->priv->jobs_by_data, user_data)) {
 		g_warning ("Adding the same file job object to the job queue");
 		return;
 	}
@@ -194,15 +447,20 @@ nemo_job_queue_add_new_job (NemoJobQueue         *self,
     new_job->user_data = user_data;
     new_job->cancellable = cancellable;
     new_job->info = info;
+    new_job->link.data = new_job;
 
-	self->priv->queued_jobs =
-		g_list_append (self->priv->queued_jobs, new_job);
+	g_queue_push_tail_link (&self->priv->queued_jobs, &new_job->link);
+	g_hash_table_insert (self->priv->jobs_by_info, info, new_job);
+	g_hash_table_insert (self->priv->jobs_by_data, user_data, new_job);
 
     nemo_progress_info_queue (info);
 
 	g_signal_connect_swapped (info, "finished",
                               G_CALLBACK (job_finished_cb), self);
 
+    if (sources != NULL)
+        lookup_devices (self, new_job, sources, destination);
+
     if (self->priv->skip_queue || start_immediately)
         start_job (self, new_job);
     else
@@ -214,7 +472,10 @@ nemo_job_queue_add_new_job (NemoJobQueue         *self,
 static void
 start_job (NemoJobQueue *self, Job *job)
 {
-    self->priv->queued_jobs = g_list_remove (self->priv->queued_jobs, job);
+    if (job->running)
+        return;
+
+    g_queue_unlink (&self->priv->queued_jobs, &job->link);
 
     g_io_scheduler_push_job (job->job_func,
                              job->user_data,
@@ -222,28 +483,61 @@ start_job (NemoJobQueue *self, Job *job)
                              0,
                              job->cancellable);
 
-    self->priv->running_jobs = g_list_append (self->priv->running_jobs, job);
+    job->running = TRUE;
+    g_queue_push_tail_link (&self->priv->running_jobs, &job->link);
+    charge_devices (self, job, 1);
 }
 
+/* Starts every queued job, in order, whose devices have room. Jobs
+ * behind one on unknown devices, or one whose devices are still being
+ * looked up, wait with it, so that it gets its turn first.
+ */
 void
 nemo_job_queue_start_next_job (NemoJobQueue *self)
 {
-    if (g_list_length (self->priv->running_jobs) == 0 && g_list_length (self->priv->queued_jobs) > 0)
-        start_job (self, self->priv->queued_jobs->data);
+    GList *l, *next;
+    Job *job;
+
+    for (l = self->priv->queued_jobs.head; l != NULL; l = next) {
+        next = l->next;
+        job = l->data;
+
+        if (job_can_start (self, job))
+            start_job (self, job);
+        else if (job->devices == NULL)
+            break;
+    }
 }
 
 void
 nemo_job_queue_start_job_by_info (NemoJobQueue     *self,
                                   NemoProgressInfo *info)
 {
-    GList *target = g_list_find_custom (self->priv->queued_jobs, info, (GCompareFunc) compare_info_func);
+    Job *target = g_hash_table_lookup (self->priv->jobs_by_info, info);
 
     if (target)
-        start_job (self, target->data);
+        start_job (self, target);
 }
 
+/* Returns the NemoProgressInfos of the queued jobs, then of the running
+ * ones. Free the list with g_list_free().
+ */
 GList *
 nemo_job_queue_get_all_jobs (NemoJobQueue *self)
 {
-	return self->priv->queued_jobs;
+    GList *infos = NULL;
+    GList *l;
+    Job *job;
+
+    for (l = self->priv->queued_jobs.head; l != NULL; l = l->next) {
+        job = l->data;
+        infos = g_list_prepend (infos, job->info);
+    }
+
+    for (l = self->priv->running_jobs.head; l != NULL; l = l->next) {
+        job = l->data;
+        infos = g_list_prepend (infos, job->info);
+    }
+
+    return g_list_reverse (infos);
 }
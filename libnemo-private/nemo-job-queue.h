@@ -62,6 +62,8 @@ void nemo_job_queue_add_new_job (NemoJobQueue *self,
                                  gpointer user_data,
                                  GCancellable *cancellable,
                                  NemoProgressInfo *info,
+                                 GList *sources,
+                                 GFile *destination,
                                  gboolean start_immediately);
 
 void nemo_job_queue_start_next_job (NemoJobQueue *self);
@@ -0,0 +1,359 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-local-copy.c: Copying regular files between local filesystems.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-local-copy.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#include <glib/gi18n.h>
+
+/* Bytes handed to the kernel in one call, so that cancelling and
+ * progress reports don't have to wait for a whole big file.
+ */
+#define KERNEL_COPY_CHUNK (8 * 1024 * 1024)
+
+/* Buffer for when the kernel can't copy for us */
+#define BUFFER_COPY_SIZE (1024 * 1024)
+#define BUFFER_COPY_ALIGNMENT 4096
+
+typedef enum {
+	COPY_METHOD_COPY_FILE_RANGE,
+	COPY_METHOD_SENDFILE,
+	COPY_METHOD_READ_WRITE
+} CopyMethod;
+
+static void
+set_error_from_errno (GError **error,
+		      int errsv,
+		      const char *format,
+		      GFile *file)
+{
+	char *name;
+
+	name = g_file_get_parse_name (file);
+	g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		     format, name, g_strerror (errsv));
+	g_free (name);
+}
+
+static void
+set_not_supported (GError **error)
+{
+	g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			     "Not a regular file between local folders");
+}
+
+static gssize
+copy_through_buffer (int source_fd,
+		     int dest_fd,
+		     char *buffer)
+{
+	gssize n_read, n_written, done;
+
+	do {
+		n_read = read (source_fd, buffer, BUFFER_COPY_SIZE);
+	} while (n_read < 0 && errno == EINTR);
+
+	if (n_read <= 0) {
+		return n_read;
+	}
+
+	for (done = 0; done < n_read; done += n_written) {
+		n_written = write (dest_fd, buffer + done, n_read - done);
+		if (n_written < 0) {
+			if (errno != EINTR) {
+				return -1;
+			}
+			n_written = 0;
+		}
+	}
+
+	return n_read;
+}
+
+/* Whether the kernel just can't do this kind of copy here, as opposed
+ * to the copy itself going wrong.
+ */
+static gboolean
+method_unsupported (int errsv)
+{
+	return errsv == ENOSYS || errsv == EXDEV ||
+		errsv == EINVAL || errsv == EOPNOTSUPP;
+}
+
+static gboolean
+copy_data (int source_fd,
+	   int dest_fd,
+	   goffset total_size,
+	   GFile *source,
+	   GCancellable *cancellable,
+	   GFileProgressCallback progress_callback,
+	   gpointer progress_callback_data,
+	   GError **error)
+{
+	CopyMethod method;
+	char *buffer;
+	goffset copied;
+	gssize n;
+	int errsv;
+
+#ifdef FICLONE
+	/* Sharing the data is the cheapest copy there is */
+	if (ioctl (dest_fd, FICLONE, source_fd) == 0) {
+		if (progress_callback != NULL) {
+			progress_callback (total_size, total_size, progress_callback_data);
+		}
+		return TRUE;
+	}
+#endif
+
+#if defined (HAVE_COPY_FILE_RANGE)
+	method = COPY_METHOD_COPY_FILE_RANGE;
+#elif defined (HAVE_SYS_SENDFILE_H)
+	method = COPY_METHOD_SENDFILE;
+#else
+	method = COPY_METHOD_READ_WRITE;
+#endif
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise (source_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = NULL;
+	copied = 0;
+
+	/* Go on until the end of the file rather than for total_size
+	 * bytes, in case the file changes while we copy it.
+	 */
+	for (;;) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			free (buffer);
+			return FALSE;
+		}
+
+		switch (method) {
+#ifdef HAVE_COPY_FILE_RANGE
+		case COPY_METHOD_COPY_FILE_RANGE:
+			n = copy_file_range (source_fd, NULL, dest_fd, NULL,
+					     KERNEL_COPY_CHUNK, 0);
+			break;
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+		case COPY_METHOD_SENDFILE:
+			n = sendfile (dest_fd, source_fd, NULL, KERNEL_COPY_CHUNK);
+			break;
+#endif
+		case COPY_METHOD_READ_WRITE:
+		default:
+			if (buffer == NULL &&
+			    posix_memalign ((void **) &buffer, BUFFER_COPY_ALIGNMENT,
+					    BUFFER_COPY_SIZE) != 0) {
+				buffer = NULL;
+				set_error_from_errno (error, ENOMEM,
+						      _("Error while copying \"%s\": %s"),
+						      source);
+				return FALSE;
+			}
+			method = COPY_METHOD_READ_WRITE;
+			n = copy_through_buffer (source_fd, dest_fd, buffer);
+			break;
+		}
+
+		if (n < 0) {
+			errsv = errno;
+
+			if (errsv == EINTR) {
+				continue;
+			}
+
+			/* Only switch before anything was written, the
+			 * file offsets are where we left them after that.
+			 */
+			if (copied == 0 &&
+			    method != COPY_METHOD_READ_WRITE &&
+			    method_unsupported (errsv)) {
+				method++;
+				continue;
+			}
+
+			set_error_from_errno (error, errsv,
+					      _("Error while copying \"%s\": %s"),
+					      source);
+			free (buffer);
+			return FALSE;
+		}
+
+		if (n == 0) {
+			/* Some files in sysfs, procfs or on FUSE mounts
+			 * look empty to the kernel copy, but not to read().
+			 */
+			if (copied == 0 && total_size > 0 &&
+			    method != COPY_METHOD_READ_WRITE) {
+				method = COPY_METHOD_READ_WRITE;
+				continue;
+			}
+			break;
+		}
+
+		copied += n;
+		if (progress_callback != NULL) {
+			progress_callback (copied, MAX (copied, total_size),
+					   progress_callback_data);
+		}
+	}
+
+	free (buffer);
+
+	return TRUE;
+}
+
+gboolean
+nemo_local_copy_file (GFile                  *source,
+		      GFile                  *destination,
+		      GFileCopyFlags          flags,
+		      GCancellable           *cancellable,
+		      GFileProgressCallback   progress_callback,
+		      gpointer                progress_callback_data,
+		      GError                **error)
+{
+	char *source_path, *dest_path;
+	int source_fd, dest_fd, errsv;
+	struct stat statbuf;
+	gboolean res;
+
+	if ((flags & (G_FILE_COPY_OVERWRITE | G_FILE_COPY_BACKUP)) != 0 ||
+	    !g_file_is_native (source) ||
+	    !g_file_is_native (destination)) {
+		set_not_supported (error);
+		return FALSE;
+	}
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		return FALSE;
+	}
+
+	res = FALSE;
+	source_fd = dest_fd = -1;
+	source_path = g_file_get_path (source);
+	dest_path = g_file_get_path (destination);
+
+	if (source_path == NULL || dest_path == NULL) {
+		set_not_supported (error);
+		goto out;
+	}
+
+	/* Symlinks, fifos and devices are left to g_file_copy(), which
+	 * knows how to copy them without following or blocking.
+	 */
+	source_fd = open (source_path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+	if (source_fd < 0) {
+		errsv = errno;
+		if (errsv == ELOOP) {
+			set_not_supported (error);
+		} else {
+			set_error_from_errno (error, errsv,
+					      _("Error opening file \"%s\": %s"),
+					      source);
+		}
+		goto out;
+	}
+
+	if (fstat (source_fd, &statbuf) != 0 ||
+	    !S_ISREG (statbuf.st_mode)) {
+		set_not_supported (error);
+		goto out;
+	}
+
+	dest_fd = open (dest_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+	if (dest_fd < 0) {
+		errsv = errno;
+		if (errsv == EEXIST) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+					     _("Target file already exists"));
+		} else if (errsv == EINVAL) {
+			/* Like GIO, so callers can pick a name the
+			 * filesystem accepts. */
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_FILENAME,
+				     _("Invalid filename \"%s\""), dest_path);
+		} else {
+			set_error_from_errno (error, errsv,
+					      _("Error opening file \"%s\": %s"),
+					      destination);
+		}
+		goto out;
+	}
+
+	if (!copy_data (source_fd, dest_fd, statbuf.st_size, source,
+			cancellable, progress_callback, progress_callback_data,
+			error)) {
+		goto remove_dest;
+	}
+
+	/* Network filesystems may only report write errors here */
+	res = close (dest_fd) == 0;
+	dest_fd = -1;
+	if (!res) {
+		set_error_from_errno (error, errno,
+				      _("Error writing to file \"%s\": %s"),
+				      destination);
+		goto remove_dest;
+	}
+
+	/* As g_file_copy() does, failing to copy the permissions and
+	 * the rest is not an error.
+	 */
+	g_file_copy_attributes (source, destination, flags, cancellable, NULL);
+
+	goto out;
+
+ remove_dest:
+	if (dest_fd >= 0) {
+		close (dest_fd);
+		dest_fd = -1;
+	}
+	unlink (dest_path);
+	res = FALSE;
+
+ out:
+	if (dest_fd >= 0) {
+		close (dest_fd);
+	}
+	if (source_fd >= 0) {
+		close (source_fd);
+	}
+	g_free (source_path);
+	g_free (dest_path);
+
+	return res;
+}
@@ -0,0 +1,46 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-local-copy.h: Copying regular files between local filesystems.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_LOCAL_COPY_H
+#define NEMO_LOCAL_COPY_H
+
+#include <gio/gio.h>
+
+/* Behaves like g_file_copy(), but lets the kernel do the work: the
+ * copy is a reflink where the filesystem can share the data, and is
+ * done with copy_file_range() or sendfile() otherwise, before falling
+ * back to reading and writing in large blocks.
+ *
+ * Only regular files between native locations are handled, and never
+ * with G_FILE_COPY_OVERWRITE or G_FILE_COPY_BACKUP. For anything else
+ * this fails with G_IO_ERROR_NOT_SUPPORTED before touching the
+ * destination, and the caller should use g_file_copy() instead.
+ *
+ * This is safe to call from several threads at once.
+ */
+gboolean nemo_local_copy_file (GFile                  *source,
+			       GFile                  *destination,
+			       GFileCopyFlags          flags,
+			       GCancellable           *cancellable,
+			       GFileProgressCallback   progress_callback,
+			       gpointer                progress_callback_data,
+			       GError                **error);
+
+#endif /* NEMO_LOCAL_COPY_H */
@@ -31,6 +31,17 @@
 
 #include <gio/gio.h>
 
+/* Have renames and moves reported as such rather than as a deletion
+ * and a creation, so that views keep the file and what they know
+ * about it. Moves in and out of the folder need GLib 2.46, before
+ * that only renames within it are paired up.
+ */
+#if GLIB_CHECK_VERSION (2, 46, 0)
+#define MONITOR_MOVES_FLAG G_FILE_MONITOR_WATCH_MOVES
+#else
+#define MONITOR_MOVES_FLAG G_FILE_MONITOR_SEND_MOVED
+#endif
+
 struct NemoMonitor {
 	GFileMonitor *monitor;
     GVolumeMonitor *volume_monitor;
@@ -105,14 +116,6 @@ dir_changed (GFileMonitor* monitor,
 	     GFileMonitorEvent event_type,
 	     gpointer user_data)
 {
-	char *uri, *to_uri;
-	
-	uri = g_file_get_uri (child);
-	to_uri = NULL;
-	if (other_file) {
-		to_uri = g_file_get_uri (other_file);
-	}
-
 	switch (event_type) {
 	default:
 	case G_FILE_MONITOR_EVENT_CHANGED:
@@ -128,6 +131,27 @@ dir_changed (GFileMonitor* monitor,
 	case G_FILE_MONITOR_EVENT_CREATED:
 		nemo_file_changes_queue_file_added (child);
 		break;
+	case G_FILE_MONITOR_EVENT_MOVED:
+#if GLIB_CHECK_VERSION (2, 46, 0)
+	case G_FILE_MONITOR_EVENT_RENAMED:
+	case G_FILE_MONITOR_EVENT_MOVED_OUT:
+#endif
+		/* Without the other end, the file is just gone from here */
+		if (other_file != NULL) {
+			nemo_file_changes_queue_file_moved (child, other_file);
+		} else {
+			nemo_file_changes_queue_file_removed (child);
+		}
+		break;
+#if GLIB_CHECK_VERSION (2, 46, 0)
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+		if (other_file != NULL) {
+			nemo_file_changes_queue_file_moved (other_file, child);
+		} else {
+			nemo_file_changes_queue_file_added (child);
+		}
+		break;
+#endif
 		
 	case G_FILE_MONITOR_EVENT_PRE_UNMOUNT:
 		/* TODO: Do something */
@@ -137,9 +161,6 @@ dir_changed (GFileMonitor* monitor,
 		break;
 	}
 
-	g_free (uri);
-	g_free (to_uri);
-
     schedule_call_consume_changes ();
 }
  
@@ -150,7 +171,9 @@ nemo_monitor_directory (GFile *location)
 	NemoMonitor *ret;
 
     ret = g_new0 (NemoMonitor, 1);
-	dir_monitor = g_file_monitor_directory (location, G_FILE_MONITOR_WATCH_MOUNTS, NULL, NULL);
+	dir_monitor = g_file_monitor_directory (location,
+					       G_FILE_MONITOR_WATCH_MOUNTS | MONITOR_MOVES_FLAG,
+					       NULL, NULL);
 
     if (dir_monitor != NULL) {
         ret->monitor = dir_monitor;
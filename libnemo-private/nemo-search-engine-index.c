@@ -0,0 +1,1432 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Nemo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nemo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * write to the Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+ * Boston, MA 02110-1335, USA.
+ *
+ */
+
+#include <config.h>
+#include "nemo-search-engine-index.h"
+#include "nemo-search-engine-simple.h"
+#include "nemo-search-matcher.h"
+#include "nemo-global-preferences.h"
+#include "nemo-file-utilities.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#define BATCH_SIZE 500
+
+/* Every folder is checked against its modification time this often.
+ * In between, only the folders that NemoDirectory saw change are read
+ * again.
+ */
+#define INDEX_FULL_UPDATE_INTERVAL (10 * 60) /* seconds */
+
+/* Folders that NemoDirectory saw change are read again this long
+ * after the first change, so that a burst of changes is one update.
+ */
+#define INDEX_DIRTY_UPDATE_DELAY 2 /* seconds */
+
+#define INDEX_MAGIC "NEMOIDX"
+#define INDEX_VERSION 1
+#define INDEX_NO_MIME_TYPE G_MAXUINT32
+
+#define INDEX_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+
+/* The index file, in host byte order: the header, the folders, the
+ * entries of all folders, the MIME types, and a pool of strings the
+ * tables refer to by offset. The entries of a folder are consecutive.
+ */
+typedef struct {
+	char magic[8];
+	guint32 version;
+	guint32 roots; /* the indexed folders, separated by newlines */
+	guint32 n_directories;
+	guint32 n_entries;
+	guint32 n_mime_types;
+	guint32 strings_size;
+	gint64 full_update_time;
+} IndexHeader;
+
+typedef struct {
+	guint32 path;
+	guint32 id;
+	guint32 first_entry;
+	guint32 n_entries;
+	gint64 mtime;
+} IndexDirectory;
+
+typedef struct {
+	guint32 name;
+	guint32 folded;
+	guint32 folded_length;
+	guint32 directory;
+	guint32 mime_type;
+	guint32 is_directory;
+} IndexEntry;
+
+typedef struct {
+	const IndexHeader *header;
+	const IndexDirectory *directories;
+	const IndexEntry *entries;
+	const guint32 *mime_types;
+	const char *strings;
+} IndexTables;
+
+/* The index shared by all engines. */
+typedef struct {
+	GMutex lock;
+
+	char **roots;
+	char *roots_key;
+	char *filename;
+
+	GMappedFile *mapped;
+	gint64 full_update_time;
+
+	GHashTable *dirty; /* paths of folders to read again */
+	GHashTable *updating_dirty; /* the ones the running update reads */
+	GHashTable *removed; /* paths of files and folders that went away */
+	GHashTable *updating_removed; /* the ones the running update drops */
+	gboolean updating;
+	guint update_timeout_id;
+} SearchIndex;
+
+static SearchIndex *search_index = NULL;
+
+/* Folders while the index is being updated. */
+typedef struct {
+	char *path;
+	char *id;
+	gint64 mtime;
+	GArray *entries; /* BuilderEntry */
+} BuilderDirectory;
+
+typedef struct {
+	char *name;
+	char *folded;
+	gsize folded_length;
+	const char *mime_type; /* interned */
+	gboolean is_directory;
+} BuilderEntry;
+
+typedef struct {
+	NemoSearchEngineIndex *engine;
+	GCancellable *cancellable;
+
+	GMappedFile *mapped;
+	char *location;
+	GHashTable *dirty; /* folders to read instead of using the index */
+	GHashTable *removed; /* what is under these is gone */
+	GList *mime_types;
+	NemoSearchMatcher *matcher;
+
+	gint n_hits;
+	GList *uri_hits;
+} IndexSearchData;
+
+struct NemoSearchEngineIndexDetails {
+	NemoQuery *query;
+
+	IndexSearchData *active_search;
+
+	/* Searches the index can't answer go here. */
+	NemoSearchEngine *fallback;
+	gboolean fallback_active;
+};
+
+G_DEFINE_TYPE (NemoSearchEngineIndex, nemo_search_engine_index,
+	       NEMO_TYPE_SEARCH_ENGINE);
+
+static gboolean
+path_is_in (const char *path, const char *folder)
+{
+	gsize length;
+
+	length = strlen (folder);
+	if (length > 0 && folder[length - 1] == '/') {
+		length--;
+	}
+
+	return strncmp (path, folder, length) == 0 &&
+		(path[length] == '\0' || path[length] == '/');
+}
+
+/* Whether @path or any folder above it is in @removed. */
+static gboolean
+path_is_removed (GHashTable *removed, const char *path)
+{
+	char *prefix, *slash;
+	gboolean found;
+
+	prefix = g_strdup (path);
+	found = FALSE;
+
+	while (!found) {
+		found = g_hash_table_contains (removed, prefix);
+
+		slash = strrchr (prefix, '/');
+		if (slash == NULL || slash == prefix) {
+			break;
+		}
+		*slash = '\0';
+	}
+
+	g_free (prefix);
+
+	return found;
+}
+
+/* The search trusts every offset and index in the file, so check them
+ * all once when it is loaded. The pool of strings ends with a NUL, so
+ * any offset into it is a terminated string.
+ */
+static gboolean
+index_check_tables (const IndexTables *tables)
+{
+	const IndexHeader *header;
+	const IndexDirectory *directory;
+	const IndexEntry *entry;
+	guint32 i;
+
+	header = tables->header;
+
+	for (i = 0; i < header->n_mime_types; i++) {
+		if (tables->mime_types[i] >= header->strings_size) {
+			return FALSE;
+		}
+	}
+
+	for (i = 0; i < header->n_directories; i++) {
+		directory = &tables->directories[i];
+		if (directory->path >= header->strings_size ||
+		    directory->id >= header->strings_size ||
+		    directory->first_entry > header->n_entries ||
+		    directory->n_entries > header->n_entries - directory->first_entry) {
+			return FALSE;
+		}
+	}
+
+	for (i = 0; i < header->n_entries; i++) {
+		entry = &tables->entries[i];
+		if (entry->name >= header->strings_size ||
+		    entry->folded >= header->strings_size ||
+		    entry->folded_length > header->strings_size - entry->folded - 1 ||
+		    entry->directory >= header->n_directories ||
+		    (entry->mime_type != INDEX_NO_MIME_TYPE &&
+		     entry->mime_type >= header->n_mime_types)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+index_get_tables (GMappedFile *mapped, const char *roots_key, IndexTables *tables)
+{
+	const char *contents;
+	gsize length, tables_size;
+	const IndexHeader *header;
+
+	contents = g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+
+	if (length < sizeof (IndexHeader)) {
+		return FALSE;
+	}
+
+	header = (const IndexHeader *) contents;
+	if (memcmp (header->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) != 0 ||
+	    header->version != INDEX_VERSION) {
+		return FALSE;
+	}
+
+	tables_size = sizeof (IndexHeader) +
+		(gsize) header->n_directories * sizeof (IndexDirectory) +
+		(gsize) header->n_entries * sizeof (IndexEntry) +
+		(gsize) header->n_mime_types * sizeof (guint32);
+	if (length != tables_size + header->strings_size ||
+	    header->strings_size == 0 ||
+	    contents[length - 1] != '\0') {
+		return FALSE;
+	}
+
+	tables->header = header;
+	tables->directories = (const IndexDirectory *) (header + 1);
+	tables->entries = (const IndexEntry *) (tables->directories + header->n_directories);
+	tables->mime_types = (const guint32 *) (tables->entries + header->n_entries);
+	tables->strings = (const char *) (tables->mime_types + header->n_mime_types);
+
+	if (header->roots >= header->strings_size ||
+	    strcmp (tables->strings + header->roots, roots_key) != 0) {
+		return FALSE;
+	}
+
+	return index_check_tables (tables);
+}
+
+static void
+builder_directory_free (BuilderDirectory *directory)
+{
+	BuilderEntry *entry;
+	guint i;
+
+	for (i = 0; i < directory->entries->len; i++) {
+		entry = &g_array_index (directory->entries, BuilderEntry, i);
+		g_free (entry->name);
+		g_free (entry->folded);
+	}
+	g_array_free (directory->entries, TRUE);
+	g_free (directory->path);
+	g_free (directory->id);
+	g_free (directory);
+}
+
+static BuilderDirectory *
+builder_directory_new (const char *path, const char *id, gint64 mtime)
+{
+	BuilderDirectory *directory;
+
+	directory = g_new0 (BuilderDirectory, 1);
+	directory->path = g_strdup (path);
+	directory->id = g_strdup (id);
+	directory->mtime = mtime;
+	directory->entries = g_array_new (FALSE, FALSE, sizeof (BuilderEntry));
+
+	return directory;
+}
+
+static BuilderDirectory *
+builder_directory_from_index (IndexTables *tables, const IndexDirectory *old)
+{
+	BuilderDirectory *directory;
+	const IndexEntry *old_entry;
+	BuilderEntry entry;
+	guint i;
+
+	directory = builder_directory_new (tables->strings + old->path,
+					   tables->strings + old->id,
+					   old->mtime);
+
+	for (i = 0; i < old->n_entries; i++) {
+		old_entry = &tables->entries[old->first_entry + i];
+
+		entry.name = g_strdup (tables->strings + old_entry->name);
+		entry.folded = g_strdup (tables->strings + old_entry->folded);
+		entry.folded_length = old_entry->folded_length;
+		entry.mime_type = old_entry->mime_type == INDEX_NO_MIME_TYPE ? NULL :
+			g_intern_string (tables->strings + tables->mime_types[old_entry->mime_type]);
+		entry.is_directory = old_entry->is_directory;
+
+		g_array_append_val (directory->entries, entry);
+	}
+
+	return directory;
+}
+
+static gboolean
+query_directory (GFile *location, gint64 *mtime, char **id)
+{
+	GFileInfo *info;
+
+	info = g_file_query_info (location,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_ID_FILE,
+				  0, NULL, NULL);
+	if (info == NULL) {
+		return FALSE;
+	}
+
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	if (id != NULL) {
+		*id = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE));
+	}
+	g_object_unref (info);
+
+	return TRUE;
+}
+
+static BuilderDirectory *
+builder_directory_read (const char *path, NemoSearchMatcher *folder)
+{
+	BuilderDirectory *directory;
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	GFile *location;
+	BuilderEntry entry;
+	const char *display_name, *folded;
+	gint64 mtime;
+	char *id;
+
+	location = g_file_new_for_path (path);
+
+	if (!query_directory (location, &mtime, &id)) {
+		g_object_unref (location);
+		return NULL;
+	}
+
+	directory = builder_directory_new (path, id, mtime);
+	g_free (id);
+
+	enumerator = g_file_enumerate_children (location, INDEX_ATTRIBUTES, 0, NULL, NULL);
+	g_object_unref (location);
+
+	if (enumerator == NULL) {
+		return directory;
+	}
+
+	while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL) {
+		display_name = g_file_info_get_display_name (info);
+
+		/* Same rules as the simple search engine. */
+		if (!g_file_info_get_is_hidden (info) && display_name != NULL) {
+			entry.name = g_strdup (g_file_info_get_name (info));
+			folded = nemo_search_matcher_fold (folder, display_name, &entry.folded_length);
+			entry.folded = g_strndup (folded, entry.folded_length);
+			entry.mime_type = g_intern_string (g_file_info_get_attribute_string
+							   (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
+			entry.is_directory = g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY;
+
+			g_array_append_val (directory->entries, entry);
+		}
+
+		g_object_unref (info);
+	}
+
+	g_object_unref (enumerator);
+
+	return directory;
+}
+
+static guint32
+add_string (GString *strings, const char *string)
+{
+	guint32 offset;
+
+	offset = strings->len;
+	g_string_append_len (strings, string != NULL ? string : "", string != NULL ? strlen (string) + 1 : 1);
+
+	return offset;
+}
+
+static gboolean
+index_write (const char *filename,
+	     const char *roots_key,
+	     GPtrArray *directories,
+	     gint64 full_update_time)
+{
+	IndexHeader header;
+	IndexDirectory index_directory;
+	IndexEntry index_entry;
+	BuilderDirectory *directory;
+	BuilderEntry *entry;
+	GArray *directory_table, *entry_table, *mime_table;
+	GHashTable *mime_indices;
+	GString *strings, *contents;
+	gpointer mime_index;
+	guint32 mime_type;
+	gboolean result;
+	guint i, j;
+
+	strings = g_string_new (NULL);
+	directory_table = g_array_new (FALSE, FALSE, sizeof (IndexDirectory));
+	entry_table = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+	mime_table = g_array_new (FALSE, FALSE, sizeof (guint32));
+	mime_indices = g_hash_table_new (NULL, NULL);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+	header.version = INDEX_VERSION;
+	header.roots = add_string (strings, roots_key);
+	header.full_update_time = full_update_time;
+
+	for (i = 0; i < directories->len; i++) {
+		directory = g_ptr_array_index (directories, i);
+
+		index_directory.path = add_string (strings, directory->path);
+		index_directory.id = add_string (strings, directory->id);
+		index_directory.first_entry = entry_table->len;
+		index_directory.n_entries = directory->entries->len;
+		index_directory.mtime = directory->mtime;
+		g_array_append_val (directory_table, index_directory);
+
+		for (j = 0; j < directory->entries->len; j++) {
+			entry = &g_array_index (directory->entries, BuilderEntry, j);
+
+			index_entry.name = add_string (strings, entry->name);
+			index_entry.folded = add_string (strings, entry->folded);
+			index_entry.folded_length = entry->folded_length;
+			index_entry.directory = i;
+			index_entry.is_directory = entry->is_directory;
+
+			index_entry.mime_type = INDEX_NO_MIME_TYPE;
+			if (entry->mime_type != NULL) {
+				/* Interned, so the pointer identifies the type. */
+				mime_index = g_hash_table_lookup (mime_indices, entry->mime_type);
+				if (mime_index == NULL) {
+					mime_type = add_string (strings, entry->mime_type);
+					g_array_append_val (mime_table, mime_type);
+					mime_index = GUINT_TO_POINTER (mime_table->len);
+					g_hash_table_insert (mime_indices, (gpointer) entry->mime_type, mime_index);
+				}
+				index_entry.mime_type = GPOINTER_TO_UINT (mime_index) - 1;
+			}
+
+			g_array_append_val (entry_table, index_entry);
+		}
+	}
+
+	result = FALSE;
+
+	if (strings->len < G_MAXUINT32) {
+		header.n_directories = directory_table->len;
+		header.n_entries = entry_table->len;
+		header.n_mime_types = mime_table->len;
+		header.strings_size = strings->len;
+
+		contents = g_string_sized_new (sizeof (header) +
+					       directory_table->len * sizeof (IndexDirectory) +
+					       entry_table->len * sizeof (IndexEntry) +
+					       mime_table->len * sizeof (guint32) +
+					       strings->len);
+		g_string_append_len (contents, (const char *) &header, sizeof (header));
+		g_string_append_len (contents, directory_table->data,
+				     directory_table->len * sizeof (IndexDirectory));
+		g_string_append_len (contents, entry_table->data,
+				     entry_table->len * sizeof (IndexEntry));
+		g_string_append_len (contents, mime_table->data,
+				     mime_table->len * sizeof (guint32));
+		g_string_append_len (contents, strings->str, strings->len);
+
+		result = g_file_set_contents (filename, contents->str, contents->len, NULL);
+
+		g_string_free (contents, TRUE);
+	}
+
+	g_hash_table_destroy (mime_indices);
+	g_array_free (mime_table, TRUE);
+	g_array_free (entry_table, TRUE);
+	g_array_free (directory_table, TRUE);
+	g_string_free (strings, TRUE);
+
+	return result;
+}
+
+static gboolean search_index_update_again_idle (gpointer user_data);
+
+static gpointer
+search_index_update_thread_func (gpointer user_data)
+{
+	SearchIndex *index;
+	GMappedFile *mapped, *new_mapped;
+	IndexTables tables;
+	GHashTable *dirty, *removed, *old_directories, *visited;
+	GPtrArray *directories;
+	GQueue paths = G_QUEUE_INIT;
+	BuilderDirectory *directory;
+	BuilderEntry *entry;
+	const IndexDirectory *old;
+	NemoSearchMatcher *folder;
+	GFile *location;
+	gboolean full, have_tables, changed_meanwhile;
+	gint64 full_update_time, mtime;
+	char **roots, *roots_key, *filename, *path;
+	guint i;
+
+	index = user_data;
+
+	g_mutex_lock (&index->lock);
+	mapped = index->mapped != NULL ? g_mapped_file_ref (index->mapped) : NULL;
+	dirty = index->dirty;
+	index->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	index->updating_dirty = dirty;
+	/* Reading the parents again drops what went away. */
+	removed = index->removed;
+	index->removed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	index->updating_removed = removed;
+	roots = g_strdupv (index->roots);
+	roots_key = g_strdup (index->roots_key);
+	filename = g_strdup (index->filename);
+	full_update_time = index->full_update_time;
+	g_mutex_unlock (&index->lock);
+
+	have_tables = mapped != NULL && index_get_tables (mapped, roots_key, &tables);
+
+	full = !have_tables ||
+		g_get_real_time () / G_USEC_PER_SEC - full_update_time > INDEX_FULL_UPDATE_INTERVAL;
+	if (full) {
+		full_update_time = g_get_real_time () / G_USEC_PER_SEC;
+	}
+
+	old_directories = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; have_tables && i < tables.header->n_directories; i++) {
+		g_hash_table_insert (old_directories,
+				     (gpointer) (tables.strings + tables.directories[i].path),
+				     (gpointer) &tables.directories[i]);
+	}
+
+	/* Only used to fold names. */
+	folder = nemo_search_matcher_new_for_text (NULL);
+
+	visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	directories = g_ptr_array_new_with_free_func ((GDestroyNotify) builder_directory_free);
+
+	for (i = 0; roots[i] != NULL; i++) {
+		g_queue_push_tail (&paths, g_strdup (roots[i]));
+	}
+
+	while ((path = g_queue_pop_head (&paths)) != NULL) {
+		directory = NULL;
+
+		/* Folders only change when files are added, removed or
+		 * renamed in them, which changes their modification
+		 * time. Reuse what the index has for all the others.
+		 */
+		old = g_hash_table_lookup (old_directories, path);
+		if (old != NULL && !g_hash_table_contains (dirty, path)) {
+			if (!full) {
+				directory = builder_directory_from_index (&tables, old);
+			} else {
+				location = g_file_new_for_path (path);
+				if (query_directory (location, &mtime, NULL) && mtime == old->mtime) {
+					directory = builder_directory_from_index (&tables, old);
+				}
+				g_object_unref (location);
+			}
+		}
+
+		if (directory == NULL) {
+			directory = builder_directory_read (path, folder);
+		}
+
+		g_free (path);
+
+		if (directory == NULL) {
+			continue;
+		}
+
+		/* Don't follow links into folders we have already seen. */
+		if (directory->id != NULL && directory->id[0] != '\0') {
+			if (g_hash_table_contains (visited, directory->id)) {
+				builder_directory_free (directory);
+				continue;
+			}
+			g_hash_table_add (visited, g_strdup (directory->id));
+		}
+
+		for (i = 0; i < directory->entries->len; i++) {
+			entry = &g_array_index (directory->entries, BuilderEntry, i);
+			if (entry->is_directory) {
+				g_queue_push_tail (&paths, g_build_filename (directory->path, entry->name, NULL));
+			}
+		}
+
+		g_ptr_array_add (directories, directory);
+	}
+
+	new_mapped = NULL;
+	if (index_write (filename, roots_key, directories, full_update_time)) {
+		new_mapped = g_mapped_file_new (filename, FALSE, NULL);
+		if (new_mapped != NULL &&
+		    !index_get_tables (new_mapped, roots_key, &tables)) {
+			g_mapped_file_unref (new_mapped);
+			new_mapped = NULL;
+		}
+	}
+
+	g_mutex_lock (&index->lock);
+	if (new_mapped != NULL && g_strcmp0 (roots_key, index->roots_key) == 0) {
+		if (index->mapped != NULL) {
+			g_mapped_file_unref (index->mapped);
+		}
+		index->mapped = new_mapped;
+		index->full_update_time = full_update_time;
+		new_mapped = NULL;
+	}
+	index->updating_dirty = NULL;
+	index->updating_removed = NULL;
+	index->updating = FALSE;
+	changed_meanwhile = g_hash_table_size (index->dirty) > 0;
+	g_mutex_unlock (&index->lock);
+
+	if (changed_meanwhile) {
+		g_idle_add (search_index_update_again_idle, index);
+	}
+
+	if (new_mapped != NULL) {
+		g_mapped_file_unref (new_mapped);
+	}
+
+	g_ptr_array_free (directories, TRUE);
+	g_hash_table_destroy (visited);
+	g_hash_table_destroy (old_directories);
+	g_hash_table_destroy (dirty);
+	g_hash_table_destroy (removed);
+	nemo_search_matcher_free (folder);
+	if (mapped != NULL) {
+		g_mapped_file_unref (mapped);
+	}
+	g_strfreev (roots);
+	g_free (roots_key);
+	g_free (filename);
+
+	return NULL;
+}
+
+static void
+search_index_update (SearchIndex *index)
+{
+	GThread *thread;
+	gboolean start;
+
+	g_mutex_lock (&index->lock);
+	start = !index->updating &&
+		(index->mapped == NULL ||
+		 g_hash_table_size (index->dirty) > 0 ||
+		 g_get_real_time () / G_USEC_PER_SEC - index->full_update_time > INDEX_FULL_UPDATE_INTERVAL);
+	if (start) {
+		index->updating = TRUE;
+	}
+	g_mutex_unlock (&index->lock);
+
+	if (start) {
+		thread = g_thread_new ("nemo-search-index", search_index_update_thread_func, index);
+		g_thread_unref (thread);
+	}
+}
+
+static gboolean
+search_index_update_timeout (gpointer user_data)
+{
+	SearchIndex *index;
+
+	index = user_data;
+	index->update_timeout_id = 0;
+
+	search_index_update (index);
+
+	return FALSE;
+}
+
+/* Folders changed while the last update ran */
+static gboolean
+search_index_update_again_idle (gpointer user_data)
+{
+	search_index_update (user_data);
+
+	return FALSE;
+}
+
+static void
+search_index_load (SearchIndex *index)
+{
+	GMappedFile *mapped;
+	IndexTables tables;
+
+	mapped = g_mapped_file_new (index->filename, FALSE, NULL);
+	if (mapped == NULL) {
+		return;
+	}
+
+	if (!index_get_tables (mapped, index->roots_key, &tables)) {
+		g_mapped_file_unref (mapped);
+		return;
+	}
+
+	index->mapped = mapped;
+	index->full_update_time = tables.header->full_update_time;
+}
+
+static char **
+get_index_roots (void)
+{
+	char **setting, **roots, *path;
+	GFile *location;
+	guint i, n;
+
+	setting = g_settings_get_strv (nemo_preferences, NEMO_PREFERENCES_SEARCH_INDEX_ROOTS);
+	roots = g_new0 (char *, g_strv_length (setting) + 1);
+
+	for (i = 0, n = 0; setting[i] != NULL; i++) {
+		location = NULL;
+		if (setting[i][0] == '~') {
+			path = g_build_filename (g_get_home_dir (), setting[i] + 1, NULL);
+			location = g_file_new_for_path (path);
+			g_free (path);
+		} else if (g_path_is_absolute (setting[i])) {
+			location = g_file_new_for_path (setting[i]);
+		}
+
+		/* Paths from GFile have no trailing or repeated slashes,
+		 * so they compare like the ones in the index.
+		 */
+		if (location != NULL) {
+			roots[n++] = g_file_get_path (location);
+			g_object_unref (location);
+		}
+	}
+
+	g_strfreev (setting);
+
+	return roots;
+}
+
+/* Returns the index for the configured folders, or NULL if there are
+ * none. Called from the main thread.
+ */
+static SearchIndex *
+search_index_get (void)
+{
+	SearchIndex *index;
+	char **roots, *roots_key, *directory;
+
+	roots = get_index_roots ();
+	if (roots[0] == NULL) {
+		g_strfreev (roots);
+		return NULL;
+	}
+
+	roots_key = g_strjoinv ("\n", roots);
+
+	if (search_index == NULL) {
+		index = g_new0 (SearchIndex, 1);
+		g_mutex_init (&index->lock);
+		index->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		index->removed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		directory = g_build_filename (g_get_user_cache_dir (), "nemo", NULL);
+		g_mkdir_with_parents (directory, DEFAULT_NEMO_DIRECTORY_MODE);
+		index->filename = g_build_filename (directory, "search-index", NULL);
+		g_free (directory);
+
+		index->roots = roots;
+		index->roots_key = roots_key;
+		search_index_load (index);
+
+		search_index = index;
+	} else if (strcmp (search_index->roots_key, roots_key) != 0) {
+		/* The folders changed, start over. */
+		index = search_index;
+		g_mutex_lock (&index->lock);
+		g_strfreev (index->roots);
+		g_free (index->roots_key);
+		index->roots = roots;
+		index->roots_key = roots_key;
+		if (index->mapped != NULL) {
+			g_mapped_file_unref (index->mapped);
+			index->mapped = NULL;
+		}
+		g_mutex_unlock (&index->lock);
+	} else {
+		g_strfreev (roots);
+		g_free (roots_key);
+	}
+
+	return search_index;
+}
+
+/* Returns the current index if it covers @path, NULL otherwise. */
+static GMappedFile *
+search_index_ref_mapped_for_path (SearchIndex *index, const char *path)
+{
+	GMappedFile *mapped;
+	guint i;
+
+	mapped = NULL;
+
+	g_mutex_lock (&index->lock);
+	if (index->mapped != NULL) {
+		for (i = 0; index->roots[i] != NULL; i++) {
+			if (path_is_in (path, index->roots[i])) {
+				mapped = g_mapped_file_ref (index->mapped);
+				break;
+			}
+		}
+	}
+	g_mutex_unlock (&index->lock);
+
+	return mapped;
+}
+
+static void
+add_paths_in (GHashTable *paths,
+	      GHashTable *from,
+	      const char *location,
+	      gboolean with_parents)
+{
+	GHashTableIter iter;
+	gpointer path;
+
+	g_hash_table_iter_init (&iter, from);
+	while (g_hash_table_iter_next (&iter, &path, NULL)) {
+		if (path_is_in (path, location) ||
+		    (with_parents && path_is_in (location, path))) {
+			g_hash_table_add (paths, g_strdup (path));
+		}
+	}
+}
+
+/* Returns the folders in @location the index is out of date for, or
+ * NULL if there are none.
+ */
+static GHashTable *
+search_index_get_dirty_paths (SearchIndex *index, const char *location)
+{
+	GHashTable *paths;
+
+	paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mutex_lock (&index->lock);
+	add_paths_in (paths, index->dirty, location, FALSE);
+	if (index->updating_dirty != NULL) {
+		add_paths_in (paths, index->updating_dirty, location, FALSE);
+	}
+	g_mutex_unlock (&index->lock);
+
+	if (g_hash_table_size (paths) == 0) {
+		g_hash_table_destroy (paths);
+		return NULL;
+	}
+
+	return paths;
+}
+
+/* Returns what went away in @location, or above it, since the index
+ * was written, or NULL if nothing did.
+ */
+static GHashTable *
+search_index_get_removed_paths (SearchIndex *index, const char *location)
+{
+	GHashTable *paths;
+
+	paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mutex_lock (&index->lock);
+	add_paths_in (paths, index->removed, location, TRUE);
+	if (index->updating_removed != NULL) {
+		add_paths_in (paths, index->updating_removed, location, TRUE);
+	}
+	g_mutex_unlock (&index->lock);
+
+	if (g_hash_table_size (paths) == 0) {
+		g_hash_table_destroy (paths);
+		return NULL;
+	}
+
+	return paths;
+}
+
+static void
+search_index_invalidate (GList *locations, gboolean removed)
+{
+	SearchIndex *index;
+	GFile *parent;
+	GList *l;
+	char *path;
+	gboolean dirty;
+	guint i;
+
+	index = search_index;
+	if (index == NULL) {
+		return;
+	}
+
+	dirty = FALSE;
+
+	g_mutex_lock (&index->lock);
+	for (l = locations; l != NULL; l = l->next) {
+		parent = g_file_get_parent (l->data);
+		path = parent != NULL ? g_file_get_path (parent) : NULL;
+
+		for (i = 0; path != NULL && index->roots[i] != NULL; i++) {
+			if (path_is_in (path, index->roots[i])) {
+				g_hash_table_add (index->dirty, path);
+				path = NULL;
+				dirty = TRUE;
+			}
+		}
+
+		g_free (path);
+		if (parent != NULL) {
+			g_object_unref (parent);
+		}
+
+		/* If it was a folder, the index still has everything in
+		 * and below it.
+		 */
+		path = removed ? g_file_get_path (l->data) : NULL;
+		for (i = 0; path != NULL && index->roots[i] != NULL; i++) {
+			if (path_is_in (path, index->roots[i])) {
+				g_hash_table_add (index->removed, path);
+				path = NULL;
+			}
+		}
+		g_free (path);
+	}
+	g_mutex_unlock (&index->lock);
+
+	/* Searches read these folders themselves until the index has
+	 * caught up.
+	 */
+	if (dirty && index->update_timeout_id == 0) {
+		index->update_timeout_id = g_timeout_add_seconds (INDEX_DIRTY_UPDATE_DELAY,
+								  search_index_update_timeout,
+								  index);
+	}
+}
+
+void
+nemo_search_engine_index_invalidate (GList *locations)
+{
+	search_index_invalidate (locations, FALSE);
+}
+
+void
+nemo_search_engine_index_invalidate_removed (GList *locations)
+{
+	search_index_invalidate (locations, TRUE);
+}
+
+static void
+finalize (GObject *object)
+{
+	NemoSearchEngineIndex *engine;
+
+	engine = NEMO_SEARCH_ENGINE_INDEX (object);
+
+	if (engine->details->query) {
+		g_object_unref (engine->details->query);
+		engine->details->query = NULL;
+	}
+
+	g_signal_handlers_disconnect_by_data (engine->details->fallback, engine);
+	g_object_unref (engine->details->fallback);
+
+	G_OBJECT_CLASS (nemo_search_engine_index_parent_class)->finalize (object);
+}
+
+static void
+index_search_data_free (IndexSearchData *data)
+{
+	g_mapped_file_unref (data->mapped);
+	g_object_unref (data->cancellable);
+	g_free (data->location);
+	if (data->dirty != NULL) {
+		g_hash_table_destroy (data->dirty);
+	}
+	if (data->removed != NULL) {
+		g_hash_table_destroy (data->removed);
+	}
+	g_list_free_full (data->mime_types, g_free);
+	nemo_search_matcher_free (data->matcher);
+	g_list_free_full (data->uri_hits, g_free);
+	g_free (data);
+}
+
+static gboolean
+search_thread_done_idle (gpointer user_data)
+{
+	IndexSearchData *data;
+
+	data = user_data;
+
+	if (!g_cancellable_is_cancelled (data->cancellable)) {
+		nemo_search_engine_finished (NEMO_SEARCH_ENGINE (data->engine));
+		data->engine->details->active_search = NULL;
+	}
+
+	index_search_data_free (data);
+
+	return FALSE;
+}
+
+typedef struct {
+	GList *uris;
+	IndexSearchData *thread_data;
+} SearchHits;
+
+static gboolean
+search_thread_add_hits_idle (gpointer user_data)
+{
+	SearchHits *hits;
+
+	hits = user_data;
+
+	if (!g_cancellable_is_cancelled (hits->thread_data->cancellable)) {
+		nemo_search_engine_hits_added (NEMO_SEARCH_ENGINE (hits->thread_data->engine),
+					       hits->uris);
+	}
+
+	g_list_free_full (hits->uris, g_free);
+	g_free (hits);
+
+	return FALSE;
+}
+
+static void
+send_batch (IndexSearchData *data)
+{
+	SearchHits *hits;
+
+	data->n_hits = 0;
+
+	if (data->uri_hits) {
+		hits = g_new (SearchHits, 1);
+		hits->uris = data->uri_hits;
+		hits->thread_data = data;
+		g_idle_add (search_thread_add_hits_idle, hits);
+	}
+	data->uri_hits = NULL;
+}
+
+static gboolean
+mime_type_matches (IndexSearchData *data, const char *mime_type)
+{
+	GList *l;
+
+	for (l = data->mime_types; l != NULL; l = l->next) {
+		if (g_content_type_equals (mime_type, l->data)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+add_hit (IndexSearchData *data, const char *path, const char *name)
+{
+	char *filename;
+
+	filename = g_build_filename (path, name, NULL);
+	data->uri_hits = g_list_prepend (data->uri_hits,
+					 g_filename_to_uri (filename, NULL, NULL));
+	g_free (filename);
+
+	if (++data->n_hits > BATCH_SIZE) {
+		send_batch (data);
+	}
+}
+
+/* Folders that changed since the index was written are read again,
+ * so that files that were just created are found.
+ */
+static void
+search_dirty_directories (IndexSearchData *data)
+{
+	NemoSearchMatcher *folder;
+	BuilderDirectory *directory;
+	BuilderEntry *entry;
+	GHashTableIter iter;
+	gpointer path;
+	guint i;
+
+	folder = nemo_search_matcher_new_for_text (NULL);
+
+	g_hash_table_iter_init (&iter, data->dirty);
+	while (g_hash_table_iter_next (&iter, &path, NULL) &&
+	       !g_cancellable_is_cancelled (data->cancellable)) {
+		directory = builder_directory_read (path, folder);
+		if (directory == NULL) {
+			continue;
+		}
+
+		for (i = 0; i < directory->entries->len; i++) {
+			entry = &g_array_index (directory->entries, BuilderEntry, i);
+
+			if (!nemo_search_matcher_matches_folded (data->matcher,
+								 entry->folded,
+								 entry->folded_length)) {
+				continue;
+			}
+
+			if (data->mime_types != NULL &&
+			    (entry->mime_type == NULL ||
+			     !mime_type_matches (data, entry->mime_type))) {
+				continue;
+			}
+
+			add_hit (data, directory->path, entry->name);
+		}
+
+		builder_directory_free (directory);
+	}
+
+	nemo_search_matcher_free (folder);
+}
+
+static gpointer
+search_thread_func (gpointer user_data)
+{
+	IndexSearchData *data;
+	IndexTables tables;
+	const IndexDirectory *directory;
+	const IndexEntry *entry;
+	gboolean *mime_type_hits;
+	const char *path;
+	guint i, j;
+
+	data = user_data;
+
+	/* The index was checked when it was loaded or written. */
+	tables.header = (const IndexHeader *) g_mapped_file_get_contents (data->mapped);
+	tables.directories = (const IndexDirectory *) (tables.header + 1);
+	tables.entries = (const IndexEntry *) (tables.directories + tables.header->n_directories);
+	tables.mime_types = (const guint32 *) (tables.entries + tables.header->n_entries);
+	tables.strings = (const char *) (tables.mime_types + tables.header->n_mime_types);
+
+	/* Decide once for every MIME type in the index. */
+	mime_type_hits = NULL;
+	if (data->mime_types != NULL) {
+		mime_type_hits = g_new0 (gboolean, tables.header->n_mime_types);
+		for (i = 0; i < tables.header->n_mime_types; i++) {
+			mime_type_hits[i] = mime_type_matches (data, tables.strings + tables.mime_types[i]);
+		}
+	}
+
+	for (i = 0; i < tables.header->n_directories; i++) {
+		if ((i & 0xff) == 0 && g_cancellable_is_cancelled (data->cancellable)) {
+			break;
+		}
+
+		directory = &tables.directories[i];
+		path = tables.strings + directory->path;
+		if (!path_is_in (path, data->location) ||
+		    (data->dirty != NULL && g_hash_table_contains (data->dirty, path)) ||
+		    (data->removed != NULL && path_is_removed (data->removed, path))) {
+			continue;
+		}
+
+		for (j = 0; j < directory->n_entries; j++) {
+			entry = &tables.entries[directory->first_entry + j];
+
+			if (!nemo_search_matcher_matches_folded (data->matcher,
+								 tables.strings + entry->folded,
+								 entry->folded_length)) {
+				continue;
+			}
+
+			if (mime_type_hits != NULL &&
+			    (entry->mime_type == INDEX_NO_MIME_TYPE ||
+			     !mime_type_hits[entry->mime_type])) {
+				continue;
+			}
+
+			add_hit (data, path, tables.strings + entry->name);
+		}
+	}
+
+	if (data->dirty != NULL) {
+		search_dirty_directories (data);
+	}
+	send_batch (data);
+
+	g_free (mime_type_hits);
+
+	g_idle_add (search_thread_done_idle, data);
+
+	return NULL;
+}
+
+static void
+fallback_hits_added (NemoSearchEngine *fallback, GList *hits, gpointer user_data)
+{
+	nemo_search_engine_hits_added (NEMO_SEARCH_ENGINE (user_data), hits);
+}
+
+static void
+fallback_hits_subtracted (NemoSearchEngine *fallback, GList *hits, gpointer user_data)
+{
+	nemo_search_engine_hits_subtracted (NEMO_SEARCH_ENGINE (user_data), hits);
+}
+
+static void
+fallback_finished (NemoSearchEngine *fallback, gpointer user_data)
+{
+	NemoSearchEngineIndex *engine;
+
+	engine = NEMO_SEARCH_ENGINE_INDEX (user_data);
+	engine->details->fallback_active = FALSE;
+
+	nemo_search_engine_finished (NEMO_SEARCH_ENGINE (engine));
+}
+
+static void
+fallback_error (NemoSearchEngine *fallback, const char *error_message, gpointer user_data)
+{
+	NemoSearchEngineIndex *engine;
+
+	engine = NEMO_SEARCH_ENGINE_INDEX (user_data);
+	engine->details->fallback_active = FALSE;
+
+	nemo_search_engine_error (NEMO_SEARCH_ENGINE (engine), error_message);
+}
+
+static void
+nemo_search_engine_index_start (NemoSearchEngine *engine)
+{
+	NemoSearchEngineIndex *index_engine;
+	IndexSearchData *data;
+	SearchIndex *index;
+	GMappedFile *mapped;
+	GThread *thread;
+	char *uri, *location;
+
+	index_engine = NEMO_SEARCH_ENGINE_INDEX (engine);
+
+	if (index_engine->details->active_search != NULL ||
+	    index_engine->details->fallback_active) {
+		return;
+	}
+
+	if (index_engine->details->query == NULL) {
+		return;
+	}
+
+	index = search_index_get ();
+
+	location = NULL;
+	uri = nemo_query_get_location (index_engine->details->query);
+	if (uri != NULL) {
+		location = g_filename_from_uri (uri, NULL, NULL);
+		g_free (uri);
+	} else {
+		location = g_strdup ("/");
+	}
+
+	mapped = NULL;
+	if (index != NULL) {
+		if (location != NULL) {
+			mapped = search_index_ref_mapped_for_path (index, location);
+		}
+		/* Answer from the index as it is, and bring it up to
+		 * date for the next search.
+		 */
+		search_index_update (index);
+	}
+
+	if (mapped == NULL) {
+		g_free (location);
+
+		nemo_search_engine_set_query (index_engine->details->fallback,
+					      index_engine->details->query);
+		index_engine->details->fallback_active = TRUE;
+		nemo_search_engine_start (index_engine->details->fallback);
+		return;
+	}
+
+	data = g_new0 (IndexSearchData, 1);
+	data->engine = index_engine;
+	data->cancellable = g_cancellable_new ();
+	data->mapped = mapped;
+	data->location = location;
+	data->dirty = search_index_get_dirty_paths (index, location);
+	data->removed = search_index_get_removed_paths (index, location);
+	data->mime_types = nemo_query_get_mime_types (index_engine->details->query);
+	data->matcher = nemo_search_matcher_new (index_engine->details->query);
+
+	thread = g_thread_new ("nemo-search-index-query", search_thread_func, data);
+	index_engine->details->active_search = data;
+
+	g_thread_unref (thread);
+}
+
+static void
+nemo_search_engine_index_stop (NemoSearchEngine *engine)
+{
+	NemoSearchEngineIndex *index_engine;
+
+	index_engine = NEMO_SEARCH_ENGINE_INDEX (engine);
+
+	if (index_engine->details->active_search != NULL) {
+		g_cancellable_cancel (index_engine->details->active_search->cancellable);
+		index_engine->details->active_search = NULL;
+	}
+
+	if (index_engine->details->fallback_active) {
+		nemo_search_engine_stop (index_engine->details->fallback);
+		index_engine->details->fallback_active = FALSE;
+	}
+}
+
+static void
+nemo_search_engine_index_set_query (NemoSearchEngine *engine, NemoQuery *query)
+{
+	NemoSearchEngineIndex *index_engine;
+
+	index_engine = NEMO_SEARCH_ENGINE_INDEX (engine);
+
+	if (query) {
+		g_object_ref (query);
+	}
+
+	if (index_engine->details->query) {
+		g_object_unref (index_engine->details->query);
+	}
+
+	index_engine->details->query = query;
+}
+
+static void
+nemo_search_engine_index_class_init (NemoSearchEngineIndexClass *class)
+{
+	GObjectClass *gobject_class;
+	NemoSearchEngineClass *engine_class;
+
+	gobject_class = G_OBJECT_CLASS (class);
+	gobject_class->finalize = finalize;
+
+	engine_class = NEMO_SEARCH_ENGINE_CLASS (class);
+	engine_class->set_query = nemo_search_engine_index_set_query;
+	engine_class->start = nemo_search_engine_index_start;
+	engine_class->stop = nemo_search_engine_index_stop;
+
+	g_type_class_add_private (class, sizeof (NemoSearchEngineIndexDetails));
+}
+
+static void
+nemo_search_engine_index_init (NemoSearchEngineIndex *engine)
+{
+	engine->details = G_TYPE_INSTANCE_GET_PRIVATE (engine, NEMO_TYPE_SEARCH_ENGINE_INDEX,
+						       NemoSearchEngineIndexDetails);
+
+	engine->details->fallback = nemo_search_engine_simple_new ();
+	g_signal_connect (engine->details->fallback, "hits-added",
+			  G_CALLBACK (fallback_hits_added), engine);
+	g_signal_connect (engine->details->fallback, "hits-subtracted",
+			  G_CALLBACK (fallback_hits_subtracted), engine);
+	g_signal_connect (engine->details->fallback, "finished",
+			  G_CALLBACK (fallback_finished), engine);
+	g_signal_connect (engine->details->fallback, "error",
+			  G_CALLBACK (fallback_error), engine);
+}
+
+NemoSearchEngine *
+nemo_search_engine_index_new (void)
+{
+	if (search_index_get () == NULL) {
+		return NULL;
+	}
+
+	return g_object_new (NEMO_TYPE_SEARCH_ENGINE_INDEX, NULL);
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Nemo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nemo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * write to the Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+ * Boston, MA 02110-1335, USA.
+ *
+ */
+
+#ifndef NEMO_SEARCH_ENGINE_INDEX_H
+#define NEMO_SEARCH_ENGINE_INDEX_H
+
+#include <gio/gio.h>
+#include <libnemo-private/nemo-search-engine.h>
+
+#define NEMO_TYPE_SEARCH_ENGINE_INDEX		(nemo_search_engine_index_get_type ())
+#define NEMO_SEARCH_ENGINE_INDEX(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), NEMO_TYPE_SEARCH_ENGINE_INDEX, NemoSearchEngineIndex))
+#define NEMO_SEARCH_ENGINE_INDEX_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), NEMO_TYPE_SEARCH_ENGINE_INDEX, NemoSearchEngineIndexClass))
+#define NEMO_IS_SEARCH_ENGINE_INDEX(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), NEMO_TYPE_SEARCH_ENGINE_INDEX))
+#define NEMO_IS_SEARCH_ENGINE_INDEX_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), NEMO_TYPE_SEARCH_ENGINE_INDEX))
+#define NEMO_SEARCH_ENGINE_INDEX_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), NEMO_TYPE_SEARCH_ENGINE_INDEX, NemoSearchEngineIndexClass))
+
+typedef struct NemoSearchEngineIndexDetails NemoSearchEngineIndexDetails;
+
+typedef struct NemoSearchEngineIndex {
+	NemoSearchEngine parent;
+	NemoSearchEngineIndexDetails *details;
+} NemoSearchEngineIndex;
+
+typedef struct {
+	NemoSearchEngineClass parent_class;
+} NemoSearchEngineIndexClass;
+
+GType          nemo_search_engine_index_get_type  (void);
+
+/* Returns NULL if no folders are configured for indexing. */
+NemoSearchEngine* nemo_search_engine_index_new       (void);
+
+/* Called for files that were added, removed or moved, so that their
+ * folders get read again on the next update of the index.
+ */
+void           nemo_search_engine_index_invalidate (GList *locations);
+/* Like nemo_search_engine_index_invalidate(), for files that were
+ * removed or moved away; searches leave out what the index has in
+ * and below them until it is updated.
+ */
+void           nemo_search_engine_index_invalidate_removed (GList *locations);
+
+#endif /* NEMO_SEARCH_ENGINE_INDEX_H */
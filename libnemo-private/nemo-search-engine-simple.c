@@ -23,6 +23,7 @@
 
 #include <config.h>
 #include "nemo-search-engine-simple.h"
+#include "nemo-search-matcher.h"
 
 #include <string.h>
 #include <glib.h>
@@ -30,21 +31,59 @@
 
 #define BATCH_SIZE 500
 
+/* Directory enumeration is mostly waiting for I/O, so use more crawler
+ * threads than CPUs; remote and network file systems benefit the most.
+ */
+#define SEARCH_THREADS_PER_CPU 2
+#define SEARCH_MAX_THREADS 16
+
+/* How often idle crawlers look at the cancellable, in microseconds. */
+#define SEARCH_IDLE_WAIT_USEC (100 * 1000)
+
+typedef struct SearchThreadData SearchThreadData;
+
+/* Every crawler owns a queue of directories. It takes work from the
+ * tail of its own queue, so it walks the tree depth first, and steals
+ * from the head of the others' queues, where the largest subtrees are.
+ */
 typedef struct {
+	SearchThreadData *data;
+	guint index;
+
+	GMutex lock;
+	GQueue directories; /* GFiles */
+
+	NemoSearchMatcher *matcher;
+
+	gint n_processed_files;
+	GList *uri_hits;
+} SearchWorker;
+
+struct SearchThreadData {
 	NemoSearchEngineSimple *engine;
 	GCancellable *cancellable;
 
 	GList *mime_types;
-	char **words;
 	GList *found_list;
 
-	GQueue *directories; /* GFiles */
+	GFile *location;
+
+	SearchWorker *workers;
+	guint n_workers;
+
+	/* Directories sitting in a queue, and directories either queued
+	 * or being visited. The search is done when the latter is 0.
+	 */
+	gint n_queued;
+	gint n_pending;
 
+	GMutex idle_lock;
+	GCond idle_cond;
+	gint n_idle;
+
+	GMutex visited_lock;
 	GHashTable *visited;
-	
-	gint n_processed_files;
-	GList *uri_hits;
-} SearchThreadData;
+};
 
 
 struct NemoSearchEngineSimpleDetails {
@@ -78,14 +117,18 @@ search_thread_data_new (NemoSearchEngineSimple *engine,
 			NemoQuery *query)
 {
 	SearchThreadData *data;
-	char *text, *lower, *normalized, *uri;
+	char *uri;
 	GFile *location;
+	guint i;
 	
 	data = g_new0 (SearchThreadData, 1);
 
 	data->engine = engine;
-	data->directories = g_queue_new ();
 	data->visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_mutex_init (&data->visited_lock);
+	g_mutex_init (&data->idle_lock);
+	g_cond_init (&data->idle_cond);
+
 	uri = nemo_query_get_location (query);
 	location = NULL;
 	if (uri != NULL) {
@@ -95,15 +138,18 @@ search_thread_data_new (NemoSearchEngineSimple *engine,
 	if (location == NULL) {
 		location = g_file_new_for_path ("/");
 	}
-	g_queue_push_tail (data->directories, location);
-	
-	text = nemo_query_get_text (query);
-	normalized = g_utf8_normalize (text, -1, G_NORMALIZE_NFD);
-	lower = g_utf8_strdown (normalized, -1);
-	data->words = g_strsplit (lower, " ", -1);
-	g_free (text);
-	g_free (lower);
-	g_free (normalized);
+	data->location = location;
+
+	data->n_workers = CLAMP (g_get_num_processors () * SEARCH_THREADS_PER_CPU,
+				 2, SEARCH_MAX_THREADS);
+	data->workers = g_new0 (SearchWorker, data->n_workers);
+	for (i = 0; i < data->n_workers; i++) {
+		data->workers[i].data = data;
+		data->workers[i].index = i;
+		g_mutex_init (&data->workers[i].lock);
+		g_queue_init (&data->workers[i].directories);
+		data->workers[i].matcher = nemo_search_matcher_new (query);
+	}
 
 	data->mime_types = nemo_query_get_mime_types (query);
 
@@ -115,14 +161,27 @@ search_thread_data_new (NemoSearchEngineSimple *engine,
 static void 
 search_thread_data_free (SearchThreadData *data)
 {
-	g_queue_foreach (data->directories,
-			 (GFunc)g_object_unref, NULL);
-	g_queue_free (data->directories);
+	SearchWorker *worker;
+	guint i;
+
+	for (i = 0; i < data->n_workers; i++) {
+		worker = &data->workers[i];
+		g_queue_foreach (&worker->directories,
+				 (GFunc)g_object_unref, NULL);
+		g_queue_clear (&worker->directories);
+		g_list_free_full (worker->uri_hits, g_free);
+		nemo_search_matcher_free (worker->matcher);
+		g_mutex_clear (&worker->lock);
+	}
+	g_free (data->workers);
+
+	g_object_unref (data->location);
 	g_hash_table_destroy (data->visited);
+	g_mutex_clear (&data->visited_lock);
+	g_mutex_clear (&data->idle_lock);
+	g_cond_clear (&data->idle_cond);
 	g_object_unref (data->cancellable);
-	g_strfreev (data->words);	
 	g_list_free_full (data->mime_types, g_free);
-	g_list_free_full (data->uri_hits, g_free);
 	g_free (data);
 }
 
@@ -168,19 +227,129 @@ search_thread_add_hits_idle (gpointer user_data)
 }
 
 static void
-send_batch (SearchThreadData *data)
+send_batch (SearchWorker *worker)
 {
 	SearchHits *hits;
 	
-	data->n_processed_files = 0;
+	worker->n_processed_files = 0;
 	
-	if (data->uri_hits) {
+	if (worker->uri_hits) {
 		hits = g_new (SearchHits, 1);
-		hits->uris = data->uri_hits;
-		hits->thread_data = data;
+		hits->uris = worker->uri_hits;
+		hits->thread_data = worker->data;
 		g_idle_add (search_thread_add_hits_idle, hits);
 	}
-	data->uri_hits = NULL;
+	worker->uri_hits = NULL;
+}
+
+/* Returns TRUE if the directory with this id had not been seen yet. */
+static gboolean
+mark_visited (SearchThreadData *data, const char *id)
+{
+	gboolean first;
+
+	g_mutex_lock (&data->visited_lock);
+	first = !g_hash_table_lookup_extended (data->visited, id, NULL, NULL);
+	if (first) {
+		g_hash_table_insert (data->visited, g_strdup (id), NULL);
+	}
+	g_mutex_unlock (&data->visited_lock);
+
+	return first;
+}
+
+static void
+push_directory (SearchWorker *worker, GFile *dir)
+{
+	SearchThreadData *data;
+
+	data = worker->data;
+
+	g_atomic_int_inc (&data->n_pending);
+
+	g_mutex_lock (&worker->lock);
+	g_queue_push_tail (&worker->directories, dir);
+	g_mutex_unlock (&worker->lock);
+
+	g_atomic_int_inc (&data->n_queued);
+
+	if (g_atomic_int_get (&data->n_idle) > 0) {
+		g_mutex_lock (&data->idle_lock);
+		g_cond_signal (&data->idle_cond);
+		g_mutex_unlock (&data->idle_lock);
+	}
+}
+
+static GFile *
+pop_directory (SearchWorker *worker)
+{
+	SearchThreadData *data;
+	SearchWorker *victim;
+	GFile *dir;
+	guint i;
+
+	data = worker->data;
+
+	g_mutex_lock (&worker->lock);
+	dir = g_queue_pop_tail (&worker->directories);
+	g_mutex_unlock (&worker->lock);
+
+	for (i = 1; dir == NULL && i < data->n_workers; i++) {
+		victim = &data->workers[(worker->index + i) % data->n_workers];
+
+		g_mutex_lock (&victim->lock);
+		dir = g_queue_pop_head (&victim->directories);
+		g_mutex_unlock (&victim->lock);
+	}
+
+	if (dir != NULL) {
+		g_atomic_int_add (&data->n_queued, -1);
+	}
+
+	return dir;
+}
+
+static void
+finish_directory (SearchWorker *worker)
+{
+	SearchThreadData *data;
+
+	data = worker->data;
+
+	if (g_atomic_int_dec_and_test (&data->n_pending)) {
+		/* That was the last one, let the idle crawlers go. */
+		g_mutex_lock (&data->idle_lock);
+		g_cond_broadcast (&data->idle_cond);
+		g_mutex_unlock (&data->idle_lock);
+	}
+}
+
+/* Waits until there is something to steal. Returns FALSE when the
+ * search is done or cancelled.
+ */
+static gboolean
+wait_for_directories (SearchWorker *worker)
+{
+	SearchThreadData *data;
+	gboolean more;
+	gint64 end_time;
+
+	data = worker->data;
+
+	g_mutex_lock (&data->idle_lock);
+	g_atomic_int_inc (&data->n_idle);
+	while (g_atomic_int_get (&data->n_queued) == 0 &&
+	       g_atomic_int_get (&data->n_pending) > 0 &&
+	       !g_cancellable_is_cancelled (data->cancellable)) {
+		end_time = g_get_monotonic_time () + SEARCH_IDLE_WAIT_USEC;
+		g_cond_wait_until (&data->idle_cond, &data->idle_lock, end_time);
+	}
+	g_atomic_int_add (&data->n_idle, -1);
+	more = g_atomic_int_get (&data->n_pending) > 0 &&
+		!g_cancellable_is_cancelled (data->cancellable);
+	g_mutex_unlock (&data->idle_lock);
+
+	return more;
 }
 
 #define STD_ATTRIBUTES \
@@ -191,19 +360,20 @@ send_batch (SearchThreadData *data)
 	G_FILE_ATTRIBUTE_ID_FILE
 
 static void
-visit_directory (GFile *dir, SearchThreadData *data)
+visit_directory (GFile *dir, SearchWorker *worker)
 {
+	SearchThreadData *data;
 	GFileEnumerator *enumerator;
 	GFileInfo *info;
 	GFile *child;
 	const char *mime_type, *display_name;
-	char *lower_name, *normalized;
 	gboolean hit;
-	int i;
 	GList *l;
 	const char *id;
 	gboolean visited;
 
+	data = worker->data;
+
 	enumerator = g_file_enumerate_children (dir,
 						data->mime_types != NULL ?
 						STD_ATTRIBUTES ","
@@ -227,18 +397,7 @@ visit_directory (GFile *dir, SearchThreadData *data)
 			goto next;
 		}
 		
-		normalized = g_utf8_normalize (display_name, -1, G_NORMALIZE_NFD);
-		lower_name = g_utf8_strdown (normalized, -1);
-		g_free (normalized);
-		
-		hit = TRUE;
-		for (i = 0; data->words[i] != NULL; i++) {
-			if (strstr (lower_name, data->words[i]) == NULL) {
-				hit = FALSE;
-				break;
-			}
-		}
-		g_free (lower_name);
+		hit = nemo_search_matcher_matches (worker->matcher, display_name);
 		
 		if (hit && data->mime_types) {
 			mime_type = g_file_info_get_content_type (info);
@@ -255,28 +414,23 @@ visit_directory (GFile *dir, SearchThreadData *data)
 		child = g_file_get_child (dir, g_file_info_get_name (info));
 		
 		if (hit) {
-			data->uri_hits = g_list_prepend (data->uri_hits, g_file_get_uri (child));
+			worker->uri_hits = g_list_prepend (worker->uri_hits, g_file_get_uri (child));
 		}
 		
-		data->n_processed_files++;
-		if (data->n_processed_files > BATCH_SIZE) {
-			send_batch (data);
+		worker->n_processed_files++;
+		if (worker->n_processed_files > BATCH_SIZE) {
+			send_batch (worker);
 		}
 
 		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
 			id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
 			visited = FALSE;
 			if (id) {
-				if (g_hash_table_lookup_extended (data->visited,
-								  id, NULL, NULL)) {
-					visited = TRUE;
-				} else {
-					g_hash_table_insert (data->visited, g_strdup (id), NULL);
-				}
+				visited = !mark_visited (data, id);
 			}
 			
 			if (!visited) {
-				g_queue_push_tail (data->directories, g_object_ref (child));
+				push_directory (worker, g_object_ref (child));
 			}
 		}
 		
@@ -289,33 +443,66 @@ visit_directory (GFile *dir, SearchThreadData *data)
 }
 
 
+static gpointer
+search_worker_func (gpointer user_data)
+{
+	SearchWorker *worker;
+	SearchThreadData *data;
+	GFile *dir;
+
+	worker = user_data;
+	data = worker->data;
+
+	do {
+		while (!g_cancellable_is_cancelled (data->cancellable) &&
+		       (dir = pop_directory (worker)) != NULL) {
+			visit_directory (dir, worker);
+			g_object_unref (dir);
+			finish_directory (worker);
+		}
+	} while (wait_for_directories (worker));
+
+	send_batch (worker);
+
+	return NULL;
+}
+
 static gpointer 
 search_thread_func (gpointer user_data)
 {
 	SearchThreadData *data;
-	GFile *dir;
+	GThread **threads;
 	GFileInfo *info;
 	const char *id;
+	guint i;
 
 	data = user_data;
 
 	/* Insert id for toplevel directory into visited */
-	dir = g_queue_peek_head (data->directories);
-	info = g_file_query_info (dir, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
+	info = g_file_query_info (data->location, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
 	if (info) {
 		id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
 		if (id) {
-			g_hash_table_insert (data->visited, g_strdup (id), NULL);
+			mark_visited (data, id);
 		}
 		g_object_unref (info);
 	}
-	
-	while (!g_cancellable_is_cancelled (data->cancellable) &&
-	       (dir = g_queue_pop_head (data->directories)) != NULL) {
-		visit_directory (dir, data);
-		g_object_unref (dir);
+
+	push_directory (&data->workers[0], g_object_ref (data->location));
+
+	/* This thread is the first crawler. */
+	threads = g_new0 (GThread *, data->n_workers);
+	for (i = 1; i < data->n_workers; i++) {
+		threads[i] = g_thread_new ("nemo-search-simple", search_worker_func,
+					   &data->workers[i]);
+	}
+
+	search_worker_func (&data->workers[0]);
+
+	for (i = 1; i < data->n_workers; i++) {
+		g_thread_join (threads[i]);
 	}
-	send_batch (data);
+	g_free (threads);
 
 	g_idle_add (search_thread_done_idle, data);
 	
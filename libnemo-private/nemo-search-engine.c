@@ -24,6 +24,7 @@
 #include <config.h>
 #include "nemo-search-engine.h"
 #include "nemo-search-engine-simple.h"
+#include "nemo-search-engine-index.h"
 
 #ifdef ENABLE_TRACKER
 #include "nemo-search-engine-tracker.h"
@@ -102,6 +103,11 @@ nemo_search_engine_new (void)
 		return engine;
 	}
 #endif
+
+	engine = nemo_search_engine_index_new ();
+	if (engine) {
+		return engine;
+	}
 	
 	engine = nemo_search_engine_simple_new ();
 	return engine;
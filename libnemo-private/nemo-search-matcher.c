@@ -0,0 +1,321 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-search-matcher.c: Matching file names against the words of a query.
+ 
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+  
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <config.h>
+#include "nemo-search-matcher.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+struct NemoSearchMatcher {
+	char **words;
+	gsize *word_lengths;
+	guint n_words;
+
+	/* TRUE if no word has non-ASCII characters, so they can only
+	 * match ASCII names.
+	 */
+	gboolean ascii_words;
+
+	GString *folded;
+	GArray *chars; /* gunichar */
+};
+
+static gboolean
+is_letter (gunichar c)
+{
+	switch (g_unichar_type (c)) {
+	case G_UNICODE_LOWERCASE_LETTER:
+	case G_UNICODE_MODIFIER_LETTER:
+	case G_UNICODE_OTHER_LETTER:
+	case G_UNICODE_TITLECASE_LETTER:
+	case G_UNICODE_UPPERCASE_LETTER:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* Decomposes and lowercases @name into the folded buffer. This is
+ * g_utf8_normalize (G_NORMALIZE_NFD) followed by g_utf8_strdown(),
+ * including its context rule for the final sigma but not the Turkish
+ * and Lithuanian rules for I and J it only applies in those locales,
+ * and it reuses the scratch buffers of the matcher instead of
+ * allocating.
+ */
+static void
+fold_utf8 (NemoSearchMatcher *matcher, const char *name)
+{
+	gunichar decomposition[G_UNICHAR_MAX_DECOMPOSITION_LENGTH];
+	gunichar *chars, c;
+	gsize n, i, j;
+	gint class;
+
+	g_array_set_size (matcher->chars, 0);
+	for (; *name != '\0'; name = g_utf8_next_char (name)) {
+		n = g_unichar_fully_decompose (g_utf8_get_char (name), FALSE,
+					       decomposition, G_UNICHAR_MAX_DECOMPOSITION_LENGTH);
+		g_array_append_vals (matcher->chars, decomposition, n);
+	}
+
+	/* Canonical ordering: sort each run of combining marks by
+	 * combining class. The runs are short.
+	 */
+	chars = (gunichar *) matcher->chars->data;
+	n = matcher->chars->len;
+	for (i = 1; i < n; i++) {
+		c = chars[i];
+		class = g_unichar_combining_class (c);
+		if (class == 0) {
+			continue;
+		}
+		for (j = i; j > 0 && g_unichar_combining_class (chars[j - 1]) > class; j--) {
+			chars[j] = chars[j - 1];
+		}
+		chars[j] = c;
+	}
+
+	g_string_truncate (matcher->folded, 0);
+	for (i = 0; i < n; i++) {
+		c = chars[i];
+		if (c == 0x03A3) {
+			/* Capital sigma becomes a final sigma unless a
+			 * letter follows, like in g_utf8_strdown().
+			 */
+			c = i + 1 < n && is_letter (chars[i + 1]) ? 0x03C3 : 0x03C2;
+		} else {
+			c = g_unichar_tolower (c);
+		}
+		g_string_append_unichar (matcher->folded, c);
+	}
+}
+
+/* Lowercases @name into the folded buffer. Returns FALSE if @name is
+ * not plain ASCII, in which case the buffer holds garbage.
+ */
+static gboolean
+fold_ascii (NemoSearchMatcher *matcher, const char *name, gsize length)
+{
+	char *out;
+	gsize i;
+
+	g_string_set_size (matcher->folded, length);
+	out = matcher->folded->str;
+	i = 0;
+
+#ifdef __SSE2__
+	{
+		const __m128i before_a = _mm_set1_epi8 ('A' - 1);
+		const __m128i after_z = _mm_set1_epi8 ('Z' + 1);
+		const __m128i case_bit = _mm_set1_epi8 (0x20);
+		__m128i block, upper;
+
+		for (; i + 16 <= length; i += 16) {
+			block = _mm_loadu_si128 ((const __m128i *) (name + i));
+			if (_mm_movemask_epi8 (block) != 0) {
+				return FALSE;
+			}
+			upper = _mm_and_si128 (_mm_cmpgt_epi8 (block, before_a),
+					       _mm_cmplt_epi8 (block, after_z));
+			block = _mm_add_epi8 (block, _mm_and_si128 (upper, case_bit));
+			_mm_storeu_si128 ((__m128i *) (out + i), block);
+		}
+	}
+#endif
+
+	for (; i < length; i++) {
+		if ((guchar) name[i] >= 0x80) {
+			return FALSE;
+		}
+		out[i] = g_ascii_tolower (name[i]);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+is_ascii (const char *string)
+{
+	for (; *string != '\0'; string++) {
+		if ((guchar) *string >= 0x80) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+find_word (const char *haystack, gsize haystack_length,
+	   const char *word, gsize word_length)
+{
+	gsize i, inner_length;
+
+	if (word_length > haystack_length) {
+		return FALSE;
+	}
+
+	/* The first and last characters were compared already. */
+	inner_length = word_length > 2 ? word_length - 2 : 0;
+	i = 0;
+
+#ifdef __SSE2__
+	{
+		const __m128i first = _mm_set1_epi8 (word[0]);
+		const __m128i last = _mm_set1_epi8 (word[word_length - 1]);
+		__m128i block_first, block_last;
+		guint mask;
+		gint bit;
+
+		/* Look for the first and the last character of the word
+		 * at 16 positions at once, and only compare the rest
+		 * where both are in place.
+		 */
+		for (; i + word_length - 1 + 16 <= haystack_length; i += 16) {
+			block_first = _mm_loadu_si128 ((const __m128i *) (haystack + i));
+			block_last = _mm_loadu_si128 ((const __m128i *) (haystack + i + word_length - 1));
+			mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+								 _mm_cmpeq_epi8 (last, block_last)));
+			for (bit = g_bit_nth_lsf (mask, -1); bit >= 0; bit = g_bit_nth_lsf (mask, bit)) {
+				if (memcmp (haystack + i + bit + 1, word + 1, inner_length) == 0) {
+					return TRUE;
+				}
+			}
+		}
+	}
+#endif
+
+	for (; i + word_length <= haystack_length; i++) {
+		if (haystack[i] == word[0] &&
+		    haystack[i + word_length - 1] == word[word_length - 1] &&
+		    memcmp (haystack + i + 1, word + 1, inner_length) == 0) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+NemoSearchMatcher *
+nemo_search_matcher_new_for_text (const char *text)
+{
+	NemoSearchMatcher *matcher;
+	char **words;
+	guint i;
+
+	matcher = g_new0 (NemoSearchMatcher, 1);
+	matcher->folded = g_string_sized_new (256);
+	matcher->chars = g_array_sized_new (FALSE, FALSE, sizeof (gunichar), 256);
+
+	fold_utf8 (matcher, text != NULL ? text : "");
+	words = g_strsplit (matcher->folded->str, " ", -1);
+
+	/* Empty words, from repeated spaces, match everything. */
+	matcher->words = g_new0 (char *, g_strv_length (words) + 1);
+	matcher->word_lengths = g_new0 (gsize, g_strv_length (words) + 1);
+	matcher->ascii_words = TRUE;
+	for (i = 0; words[i] != NULL; i++) {
+		if (words[i][0] == '\0') {
+			g_free (words[i]);
+			continue;
+		}
+		matcher->words[matcher->n_words] = words[i];
+		matcher->word_lengths[matcher->n_words] = strlen (words[i]);
+		if (!is_ascii (words[i])) {
+			matcher->ascii_words = FALSE;
+		}
+		matcher->n_words++;
+	}
+	g_free (words);
+
+	return matcher;
+}
+
+NemoSearchMatcher *
+nemo_search_matcher_new (NemoQuery *query)
+{
+	NemoSearchMatcher *matcher;
+	char *text;
+
+	text = nemo_query_get_text (query);
+	matcher = nemo_search_matcher_new_for_text (text);
+	g_free (text);
+
+	return matcher;
+}
+
+void
+nemo_search_matcher_free (NemoSearchMatcher *matcher)
+{
+	g_strfreev (matcher->words);
+	g_free (matcher->word_lengths);
+	g_string_free (matcher->folded, TRUE);
+	g_array_free (matcher->chars, TRUE);
+	g_free (matcher);
+}
+
+gboolean
+nemo_search_matcher_matches_folded (NemoSearchMatcher *matcher,
+				    const char *folded,
+				    gsize length)
+{
+	guint i;
+
+	for (i = 0; i < matcher->n_words; i++) {
+		if (!find_word (folded, length,
+				matcher->words[i], matcher->word_lengths[i])) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+const char *
+nemo_search_matcher_fold (NemoSearchMatcher *matcher,
+			  const char *name,
+			  gsize *length)
+{
+	if (!fold_ascii (matcher, name, strlen (name))) {
+		fold_utf8 (matcher, name);
+	}
+
+	*length = matcher->folded->len;
+	return matcher->folded->str;
+}
+
+gboolean
+nemo_search_matcher_matches (NemoSearchMatcher *matcher,
+			     const char *name)
+{
+	if (fold_ascii (matcher, name, strlen (name))) {
+		if (!matcher->ascii_words) {
+			return FALSE;
+		}
+	} else {
+		fold_utf8 (matcher, name);
+	}
+
+	return nemo_search_matcher_matches_folded (matcher,
+						   matcher->folded->str,
+						   matcher->folded->len);
+}
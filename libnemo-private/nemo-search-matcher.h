@@ -0,0 +1,51 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   nemo-search-matcher.h: Matching file names against the words of a query.
+ 
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+  
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#ifndef NEMO_SEARCH_MATCHER_H
+#define NEMO_SEARCH_MATCHER_H
+
+#include <libnemo-private/nemo-query.h>
+
+/* A name matches if it contains every word of the query text, after
+ * both have been decomposed and lowercased. The matcher keeps scratch
+ * buffers, so matching doesn't allocate once it has seen a few names,
+ * but it also means a matcher must only be used by one thread at a
+ * time.
+ */
+typedef struct NemoSearchMatcher NemoSearchMatcher;
+
+NemoSearchMatcher *nemo_search_matcher_new     (NemoQuery         *query);
+NemoSearchMatcher *nemo_search_matcher_new_for_text (const char   *text);
+void               nemo_search_matcher_free    (NemoSearchMatcher *matcher);
+gboolean           nemo_search_matcher_matches (NemoSearchMatcher *matcher,
+						const char        *name);
+
+/* For callers that keep names around: fold a name once, and match the
+ * folded name later. The returned string belongs to the matcher and
+ * is only valid until it is used again.
+ */
+const char *       nemo_search_matcher_fold    (NemoSearchMatcher *matcher,
+						const char        *name,
+						gsize             *length);
+gboolean           nemo_search_matcher_matches_folded (NemoSearchMatcher *matcher,
+						       const char        *folded,
+						       gsize              length);
+
+#endif /* NEMO_SEARCH_MATCHER_H */
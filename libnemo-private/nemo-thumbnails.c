@@ -73,35 +73,72 @@ typedef struct {
 	char *mime_type;
 	time_t original_file_mtime;
     gint throttle_count;
+	gboolean in_progress;
+	gboolean cancelled;
+	/* Distance in items from the nearest viewport, see
+	   nemo_thumbnail_set_viewport (). */
+	guint distance;
+	gboolean seen_in_viewport;
+	gboolean parked;
 } NemoThumbnailInfo;
 
+/* The items a view shows and those within the margin around them,
+   mapped to their distance from the visible ones. Only used from the
+   main thread. */
+typedef struct {
+	gconstpointer viewer;
+	GHashTable *distances;
+} NemoThumbnailViewport;
+
+#define DISTANCE_UNKNOWN G_MAXUINT
+
 /*
  * Thumbnail thread state.
  */
 
-/* The id of the idle handler used to start the thumbnail thread, or 0 if no
+/* Upper bound for the number of thumbnail threads, no matter how many
+   cores there are. Most thumbnailers are separate processes, so more
+   threads than this mostly adds disk contention. */
+#define MAX_THUMBNAIL_THREADS 8
+
+/* The id of the idle handler used to start thumbnail threads, or 0 if no
    idle handler is currently registered. */
 static guint thumbnail_thread_starter_id = 0;
 
 /* Our mutex used when accessing data shared between the main thread and the
-   thumbnail thread, i.e. the thumbnail_thread_is_running flag and the
-   thumbnails_to_make list. */
+   thumbnail threads, i.e. the n_thumbnail_threads counter and the
+   thumbnails_to_make and thumbnails_in_progress lists. */
 static pthread_mutex_t thumbnails_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-/* A flag to indicate whether a thumbnail thread is running, so we don't
-   start more than one. Lock thumbnails_mutex when accessing this. */
-static volatile gboolean thumbnail_thread_is_running = FALSE;
+/* The number of thumbnail threads currently running, so we don't start
+   more than max_thumbnail_threads. Lock thumbnails_mutex when accessing
+   this. */
+static volatile guint n_thumbnail_threads = 0;
 
 /* The list of NemoThumbnailInfo structs containing information about the
-   thumbnails we are making. Lock thumbnails_mutex when accessing this. */
+   thumbnails we are waiting to make. Lock thumbnails_mutex when accessing
+   this. */
 static volatile GQueue thumbnails_to_make = G_QUEUE_INIT;
 
-/* Quickly check if uri is in thumbnails_to_make list */
+/* The thumbnails that some thread is making right now. They are moved here
+   from thumbnails_to_make, so the main thread doesn't add them again while
+   they are being created. Lock thumbnails_mutex when accessing this. */
+static volatile GQueue thumbnails_in_progress = G_QUEUE_INIT;
+
+/* Thumbnails that were scrolled out of every view. They are not made
+   until they come back into view. Lock thumbnails_mutex when accessing
+   this. */
+static volatile GQueue thumbnails_parked = G_QUEUE_INIT;
+
+/* Quickly find the list node of a uri, which is either in thumbnails_to_make,
+   thumbnails_in_progress or thumbnails_parked depending on info->in_progress
+   and info->parked. */
 static GHashTable *thumbnails_to_make_hash = NULL;
 
-/* The currently thumbnailed icon. it also exists in the thumbnails_to_make list
- * to avoid adding it again. Lock thumbnails_mutex when accessing this. */
-static NemoThumbnailInfo *currently_thumbnailing = NULL;
+/* The NemoThumbnailViewports of all views, and the idle handler that
+   reorders the queue after one of them changed. */
+static GList *viewports = NULL;
+static guint reorder_queue_id = 0;
 
 static GnomeDesktopThumbnailFactory *thumbnail_factory = NULL;
 
@@ -151,8 +188,29 @@ get_thumbnail_factory (void)
 }
 
 
+static guint
+get_max_thumbnail_threads (void)
+{
+	static guint max_threads = 0;
+
+	if (max_threads == 0) {
+		max_threads = CLAMP (g_get_num_processors (), 1, MAX_THUMBNAIL_THREADS);
+	}
+
+	return max_threads;
+}
+
+/* Whether another thumbnail thread would have something to do.
+   Lock thumbnails_mutex when calling this. */
+static gboolean
+thumbnail_thread_needed (void)
+{
+	return n_thumbnail_threads < get_max_thumbnail_threads () &&
+		n_thumbnail_threads < g_queue_get_length ((GQueue *)&thumbnails_to_make);
+}
+
 /* This function is added as a very low priority idle function to start the
-   thread to create any needed thumbnails. It is added with a very low priority
+   threads to create any needed thumbnails. It is added with a very low priority
    so that it doesn't delay showing the directory in the icon/list views.
    We want to show the files in the directory as quickly as possible. */
 static gboolean
@@ -166,29 +224,50 @@ thumbnail_thread_starter_cb (gpointer data)
 		thumbnail_factory = get_thumbnail_factory ();
 	}
 
-	/* We create the thread in the detached state, as we don't need/want
-	   to join with it at any point. */
+	/* We create the threads in the detached state, as we don't need/want
+	   to join with them at any point. */
 	pthread_attr_init (&thread_attributes);
 	pthread_attr_setdetachstate (&thread_attributes,
 				     PTHREAD_CREATE_DETACHED);
 
+	pthread_mutex_lock (&thumbnails_mutex);
+
+	/* Start one thread per waiting thumbnail, up to the number of cores.
+	   Threads exit on their own once the queue runs dry. */
+	while (thumbnail_thread_needed ()) {
 #ifdef DEBUG_THUMBNAILS
-	g_message ("(Main Thread) Creating thumbnails thread\n");
+		g_message ("(Main Thread) Creating thumbnails thread %u\n",
+			   n_thumbnail_threads);
 #endif
-	/* We set a flag to indicate the thread is running, so we don't create
-	   a new one. We don't need to lock a mutex here, as the thumbnail
-	   thread isn't running yet. And we know we won't create the thread
-	   twice, as we also check thumbnail_thread_starter_id before
-	   scheduling this idle function. */
-	thumbnail_thread_is_running = TRUE;
-	pthread_create (&thumbnail_thread, &thread_attributes,
-			thumbnail_thread_start, NULL);
+		if (pthread_create (&thumbnail_thread, &thread_attributes,
+				    thumbnail_thread_start, NULL) != 0) {
+			break;
+		}
+		n_thumbnail_threads++;
+	}
 
 	thumbnail_thread_starter_id = 0;
 
+	pthread_mutex_unlock (&thumbnails_mutex);
+
+	pthread_attr_destroy (&thread_attributes);
+
 	return FALSE;
 }
 
+/* If not all thumbnail threads are running, and we haven't scheduled an
+   idle function to start them up, do that now. We don't want to start
+   them until all the other work is done, so the GUI will be updated as
+   quickly as possible. Lock thumbnails_mutex when calling this. */
+static void
+schedule_thumbnail_threads (void)
+{
+	if (thumbnail_thread_needed () &&
+	    thumbnail_thread_starter_id == 0) {
+		thumbnail_thread_starter_id = g_idle_add_full (G_PRIORITY_LOW, thumbnail_thread_starter_cb, NULL, NULL);
+	}
+}
+
 static GdkPixbuf *
 nemo_get_thumbnail_frame (void)
 {
@@ -237,6 +316,7 @@ nemo_thumbnail_frame_image (GdkPixbuf **pixbuf)
 void
 nemo_thumbnail_remove_from_queue (const char *file_uri)
 {
+	NemoThumbnailInfo *info;
 	GList *node;
 	
 #ifdef DEBUG_THUMBNAILS
@@ -250,11 +330,19 @@ nemo_thumbnail_remove_from_queue (const char *file_uri)
 
 	if (thumbnails_to_make_hash) {
 		node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
-		
-		if (node && node->data != currently_thumbnailing) {
+		info = node ? node->data : NULL;
+
+		if (info && info->in_progress) {
+			/* The thread making it frees it once it is done, we
+			   only make sure it isn't made a second time. */
+			info->cancelled = TRUE;
+		} else if (info) {
 			g_hash_table_remove (thumbnails_to_make_hash, file_uri);
-			free_thumbnail_info (node->data);
-			g_queue_delete_link ((GQueue *)&thumbnails_to_make, node);
+			g_queue_delete_link (info->parked ?
+					     (GQueue *)&thumbnails_parked :
+					     (GQueue *)&thumbnails_to_make,
+					     node);
+			free_thumbnail_info (info);
 		}
 	}
 	
@@ -271,6 +359,7 @@ nemo_thumbnail_remove_from_queue (const char *file_uri)
 void
 nemo_thumbnail_prioritize (const char *file_uri)
 {
+	NemoThumbnailInfo *info;
 	GList *node;
 
 #ifdef DEBUG_THUMBNAILS
@@ -284,8 +373,14 @@ nemo_thumbnail_prioritize (const char *file_uri)
 
 	if (thumbnails_to_make_hash) {
 		node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
-		
-		if (node && node->data != currently_thumbnailing) {
+		info = node ? node->data : NULL;
+
+		if (info && info->parked) {
+			g_queue_unlink ((GQueue *)&thumbnails_parked, node);
+			info->parked = FALSE;
+			g_queue_push_head_link ((GQueue *)&thumbnails_to_make, node);
+			schedule_thumbnail_threads ();
+		} else if (info && !info->in_progress) {
 			g_queue_unlink ((GQueue *)&thumbnails_to_make, node);
 			g_queue_push_head_link ((GQueue *)&thumbnails_to_make, node);
 		}
@@ -301,6 +396,221 @@ nemo_thumbnail_prioritize (const char *file_uri)
 	pthread_mutex_unlock (&thumbnails_mutex);
 }
 
+static NemoThumbnailViewport *
+find_viewport (gconstpointer viewer)
+{
+	NemoThumbnailViewport *viewport;
+	GList *l;
+
+	for (l = viewports; l != NULL; l = l->next) {
+		viewport = l->data;
+		if (viewport->viewer == viewer) {
+			return viewport;
+		}
+	}
+
+	return NULL;
+}
+
+static guint
+lookup_distance (const char *file_uri)
+{
+	NemoThumbnailViewport *viewport;
+	gpointer value;
+	guint distance;
+	GList *l;
+
+	distance = DISTANCE_UNKNOWN;
+	for (l = viewports; l != NULL; l = l->next) {
+		viewport = l->data;
+		value = g_hash_table_lookup (viewport->distances, file_uri);
+		if (value != NULL) {
+			distance = MIN (distance, GPOINTER_TO_UINT (value) - 1);
+		}
+	}
+
+	return distance;
+}
+
+static gint
+compare_by_distance (gconstpointer a,
+		     gconstpointer b,
+		     gpointer user_data)
+{
+	const NemoThumbnailInfo *info_a = a;
+	const NemoThumbnailInfo *info_b = b;
+
+	if (info_a->distance < info_b->distance) {
+		return -1;
+	}
+	if (info_a->distance > info_b->distance) {
+		return 1;
+	}
+	return 0;
+}
+
+/* Sorts the queue by distance from the nearest viewport. Requests that
+   were in view once but have been scrolled beyond the margin of every
+   view are parked until they come back, and dropped once the last view
+   is gone; requests no view has shown yet just go to the end. */
+static gboolean
+reorder_queue_cb (gpointer data)
+{
+	NemoThumbnailInfo *info;
+	NemoFile *file;
+	GList *node, *next, *dropped;
+
+	reorder_queue_id = 0;
+	dropped = NULL;
+
+	pthread_mutex_lock (&thumbnails_mutex);
+
+	/*********************************
+	 * MUTEX LOCKED
+	 *********************************/
+
+	/* Bring back what scrolled into view again. Without any views
+	   left nothing will, so forget the parked requests, and below
+	   those that were only wanted by the views that went away; a
+	   view that shows those files later asks for them again. */
+	for (node = thumbnails_parked.head; node != NULL; node = next) {
+		next = node->next;
+		info = node->data;
+
+		if (viewports == NULL) {
+#ifdef DEBUG_THUMBNAILS
+			g_message ("(Main Thread) Dropping parked thumbnail: %s\n",
+				   info->image_uri);
+#endif
+			g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+			g_queue_delete_link ((GQueue *)&thumbnails_parked, node);
+			dropped = g_list_prepend (dropped, info);
+		} else if (lookup_distance (info->image_uri) != DISTANCE_UNKNOWN) {
+			g_queue_unlink ((GQueue *)&thumbnails_parked, node);
+			info->parked = FALSE;
+			g_queue_push_tail_link ((GQueue *)&thumbnails_to_make, node);
+		}
+	}
+
+	for (node = thumbnails_to_make.head; node != NULL; node = next) {
+		next = node->next;
+		info = node->data;
+
+		info->distance = lookup_distance (info->image_uri);
+		if (info->distance != DISTANCE_UNKNOWN) {
+			info->seen_in_viewport = TRUE;
+		} else if (info->seen_in_viewport && viewports == NULL) {
+			g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+			g_queue_delete_link ((GQueue *)&thumbnails_to_make, node);
+			dropped = g_list_prepend (dropped, info);
+		} else if (info->seen_in_viewport) {
+#ifdef DEBUG_THUMBNAILS
+			g_message ("(Main Thread) Parking thumbnail: %s\n",
+				   info->image_uri);
+#endif
+			g_queue_unlink ((GQueue *)&thumbnails_to_make, node);
+			info->parked = TRUE;
+			g_queue_push_tail_link ((GQueue *)&thumbnails_parked, node);
+		}
+	}
+
+	/* This is a stable sort, so requests at the same distance keep
+	   their order. */
+	g_queue_sort ((GQueue *)&thumbnails_to_make, compare_by_distance, NULL);
+
+	schedule_thumbnail_threads ();
+
+	/*********************************
+	 * MUTEX UNLOCKED
+	 *********************************/
+
+	pthread_mutex_unlock (&thumbnails_mutex);
+
+	for (node = dropped; node != NULL; node = node->next) {
+		info = node->data;
+		file = nemo_file_get_existing_by_uri (info->image_uri);
+		if (file != NULL) {
+			nemo_file_set_is_thumbnailing (file, FALSE);
+			nemo_file_unref (file);
+		}
+		free_thumbnail_info (info);
+	}
+	g_list_free (dropped);
+
+	return FALSE;
+}
+
+static void
+schedule_reorder_queue (void)
+{
+	if (reorder_queue_id == 0) {
+		reorder_queue_id = g_idle_add (reorder_queue_cb, NULL);
+	}
+}
+
+guint
+nemo_thumbnail_get_viewport_margin (void)
+{
+	return g_settings_get_int (nemo_preferences,
+				   NEMO_PREFERENCES_THUMBNAIL_VIEWPORT_MARGIN);
+}
+
+void
+nemo_thumbnail_set_viewport (gconstpointer  viewer,
+			     GList         *file_uris,
+			     guint          first_visible,
+			     guint          n_visible)
+{
+	NemoThumbnailViewport *viewport;
+	guint i, distance;
+	GList *l;
+
+	viewport = find_viewport (viewer);
+	if (viewport == NULL) {
+		viewport = g_new0 (NemoThumbnailViewport, 1);
+		viewport->viewer = viewer;
+		viewport->distances = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free, NULL);
+		viewports = g_list_prepend (viewports, viewport);
+	} else {
+		g_hash_table_remove_all (viewport->distances);
+	}
+
+	for (l = file_uris, i = 0; l != NULL; l = l->next, i++) {
+		if (i < first_visible) {
+			distance = first_visible - i;
+		} else if (i < first_visible + n_visible) {
+			distance = 0;
+		} else {
+			distance = i - (first_visible + n_visible) + 1;
+		}
+
+		/* Stored off by one, so that visible items aren't NULL */
+		g_hash_table_replace (viewport->distances,
+				      g_strdup (l->data),
+				      GUINT_TO_POINTER (distance + 1));
+	}
+
+	schedule_reorder_queue ();
+}
+
+void
+nemo_thumbnail_remove_viewport (gconstpointer viewer)
+{
+	NemoThumbnailViewport *viewport;
+
+	viewport = find_viewport (viewer);
+	if (viewport == NULL) {
+		return;
+	}
+
+	viewports = g_list_remove (viewports, viewport);
+	g_hash_table_destroy (viewport->distances);
+	g_free (viewport);
+
+	schedule_reorder_queue ();
+}
+
 
 /***************************************************************************
  * Thumbnail Thread Functions.
@@ -434,6 +744,7 @@ nemo_create_thumbnail (NemoFile *file, gint throttle_count)
 	info->image_uri = nemo_file_get_uri (file);
 	info->mime_type = nemo_file_get_mime_type (file);
     info->throttle_count = MIN (10, throttle_count);
+	info->distance = DISTANCE_UNKNOWN;
 	
 	/* Hopefully the NemoFile will already have the image file mtime,
 	   so we can just use that. Otherwise we have to get it ourselves. */
@@ -475,13 +786,9 @@ nemo_create_thumbnail (NemoFile *file, gint throttle_count)
 		g_hash_table_insert (thumbnails_to_make_hash,
 				     info->image_uri,
 				     node);
-		/* If the thumbnail thread isn't running, and we haven't
-		   scheduled an idle function to start it up, do that now.
-		   We don't want to start it until all the other work is done,
-		   so the GUI will be updated as quickly as possible.*/
-		if (thumbnail_thread_is_running == FALSE &&
-		    thumbnail_thread_starter_id == 0) {
-			thumbnail_thread_starter_id = g_idle_add_full (G_PRIORITY_LOW, thumbnail_thread_starter_cb, NULL, NULL);
+		schedule_thumbnail_threads ();
+		if (viewports != NULL) {
+			schedule_reorder_queue ();
 		}
 	} else {
 #ifdef DEBUG_THUMBNAILS
@@ -491,6 +798,15 @@ nemo_create_thumbnail (NemoFile *file, gint throttle_count)
 		/* The file in the queue might need a new original mtime */
 		existing_info = existing->data;
 		existing_info->original_file_mtime = info->original_file_mtime;
+		/* It is wanted again after all */
+		existing_info->cancelled = FALSE;
+		if (existing_info->parked) {
+			g_queue_unlink ((GQueue *)&thumbnails_parked, existing);
+			existing_info->parked = FALSE;
+			g_queue_push_tail_link ((GQueue *)&thumbnails_to_make, existing);
+			schedule_thumbnail_threads ();
+			schedule_reorder_queue ();
+		}
 		free_thumbnail_info (info);
 	}   
 
@@ -504,7 +820,9 @@ nemo_create_thumbnail (NemoFile *file, gint throttle_count)
 	pthread_mutex_unlock (&thumbnails_mutex);
 }
 
-/* thumbnail_thread is invoked as a separate thread to to make thumbnails. */
+/* thumbnail_thread is invoked as a separate thread to to make thumbnails.
+   Several of these run at once, each taking the next thumbnail off the
+   head of the queue. */
 static gpointer
 thumbnail_thread_start (gpointer data)
 {
@@ -526,41 +844,49 @@ thumbnail_thread_start (gpointer data)
 		 * MUTEX LOCKED
 		 *********************************/
 
-		/* Pop the last thumbnail we just made off the head of the
-		   list and free it. I did this here so we only have to lock
-		   the mutex once per thumbnail, rather than once before
-		   creating it and once after.
-		   Don't pop the thumbnail off the queue if the original file
-		   mtime of the request changed. Then we need to redo the thumbnail.
+		/* Drop the last thumbnail we just made and free it. I did
+		   this here so we only have to lock the mutex once per
+		   thumbnail, rather than once before creating it and once
+		   after.
+		   If the original file mtime of the request changed we put
+		   it back on the head of the queue. Then we need to redo the
+		   thumbnail, unless it was cancelled meanwhile.
 		*/
-		if (currently_thumbnailing &&
-		    currently_thumbnailing->original_file_mtime == current_orig_mtime) {
-			g_assert (info == currently_thumbnailing);
+		if (info != NULL) {
 			node = g_hash_table_lookup (thumbnails_to_make_hash, info->image_uri);
-			g_assert (node != NULL);
-			g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
-			free_thumbnail_info (info);
-			g_queue_delete_link ((GQueue *)&thumbnails_to_make, node);
+			g_assert (node != NULL && node->data == info);
+			g_queue_unlink ((GQueue *)&thumbnails_in_progress, node);
+			info->in_progress = FALSE;
+
+			if (info->original_file_mtime != current_orig_mtime &&
+			    !info->cancelled) {
+				g_queue_push_head_link ((GQueue *)&thumbnails_to_make, node);
+			} else {
+				g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+				free_thumbnail_info (info);
+				g_list_free_1 (node);
+			}
+			info = NULL;
 		}
-		currently_thumbnailing = NULL;
 
-		/* If there are no more thumbnails to make, reset the
-		   thumbnail_thread_is_running flag, unlock the mutex, and
-		   exit the thread. */
+		/* If there are no more thumbnails to make, decrease the
+		   thread count, unlock the mutex, and exit the thread. */
 		if (g_queue_is_empty ((GQueue *)&thumbnails_to_make)) {
 #ifdef DEBUG_THUMBNAILS
 			g_message ("(Thumbnail Thread) Exiting\n");
 #endif
-			thumbnail_thread_is_running = FALSE;
+			n_thumbnail_threads--;
 			pthread_mutex_unlock (&thumbnails_mutex);
 			pthread_exit (NULL);
 		}
 
-		/* Get the next one to make. We leave it on the list until it
-		   is created so the main thread doesn't add it again while we
-		   are creating it. */
-		info = g_queue_peek_head ((GQueue *)&thumbnails_to_make);
-		currently_thumbnailing = info;
+		/* Get the next one to make. We keep it in the hash table
+		   until it is created so the main thread doesn't add it again
+		   while we are creating it. */
+		node = g_queue_pop_head_link ((GQueue *)&thumbnails_to_make);
+		g_queue_push_tail_link ((GQueue *)&thumbnails_in_progress, node);
+		info = node->data;
+		info->in_progress = TRUE;
 		current_orig_mtime = info->original_file_mtime;
 		/*********************************
 		 * MUTEX UNLOCKED
@@ -43,6 +43,17 @@ void       nemo_thumbnail_frame_image           (GdkPixbuf **pixbuf);
 void       nemo_thumbnail_remove_from_queue     (const char   *file_uri);
 void       nemo_thumbnail_prioritize            (const char   *file_uri);
 
+/* Viewport handling. Views pass the uris of their visible items and of
+ * those within nemo_thumbnail_get_viewport_margin () items around them,
+ * in display order; the visible ones start at first_visible.
+ */
+guint      nemo_thumbnail_get_viewport_margin   (void);
+void       nemo_thumbnail_set_viewport          (gconstpointer  viewer,
+						 GList         *file_uris,
+						 guint          first_visible,
+						 guint          n_visible);
+void       nemo_thumbnail_remove_viewport       (gconstpointer  viewer);
+
 gboolean   nemo_thumbnail_factory_check_status          (void);
 
 #endif /* NEMO_THUMBNAILS_H */
@@ -127,7 +127,8 @@ vfs_are_all_files_seen (NemoDirectory *directory)
 {
 	g_assert (NEMO_IS_VFS_DIRECTORY (directory));
 	
-	return directory->details->directory_loaded;
+	return directory->details->directory_loaded &&
+		g_queue_is_empty (&directory->details->pending_file_info);
 }
 
 static gboolean
@@ -136,7 +137,7 @@ vfs_is_not_empty (NemoDirectory *directory)
 	g_assert (NEMO_IS_VFS_DIRECTORY (directory));
 	g_assert (nemo_directory_is_anyone_monitoring_file_list (directory));
 
-	return directory->details->file_list != NULL;
+	return nemo_file_table_get_length (directory->details->file_table) > 0;
 }
 
 static void
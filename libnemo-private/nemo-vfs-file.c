@@ -29,7 +29,9 @@
 #include "nemo-directory-notify.h"
 #include "nemo-directory-private.h"
 #include "nemo-file-private.h"
+#include <eel/eel-debug.h>
 #include <glib/gi18n.h>
+#include <string.h>
 
 G_DEFINE_TYPE (NemoVFSFile, nemo_vfs_file, NEMO_TYPE_FILE);
 
@@ -82,6 +84,125 @@ vfs_file_check_if_ready (NemoFile *file,
 		 file_attributes);
 }
 
+/* Metadata is written out in batches: what is set on a file is
+ * collected into one GFileInfo, and the files whose metadata was set
+ * within METADATA_WRITE_DELAY_MSEC are written together. The file's
+ * copy of the metadata is updated right away, so there is no need to
+ * read the info back after writing.
+ */
+#define METADATA_WRITE_DELAY_MSEC 100
+
+typedef struct {
+	GFileInfo *info;
+	gboolean changed;
+} MetadataWrite;
+
+/* A batch on its way to the store. Each one gets a new serial, so
+ * that what comes back from an older write doesn't win over a newer
+ * one that is still in flight.
+ */
+typedef struct {
+	NemoFile *file;
+	GFileInfo *info;
+	guint serial;
+} MetadataWriteInFlight;
+
+static GHashTable *metadata_writes = NULL; /* NemoFile -> MetadataWrite */
+static guint metadata_writes_id = 0;
+
+/* NemoFile -> (attribute -> serial of the latest write in flight) */
+static GHashTable *metadata_serials = NULL;
+static guint metadata_write_serial = 0;
+
+static void
+metadata_write_free (MetadataWrite *write)
+{
+	g_object_unref (write->info);
+	g_free (write);
+}
+
+static void
+metadata_write_in_flight_free (MetadataWriteInFlight *in_flight)
+{
+	nemo_file_unref (in_flight->file);
+	g_object_unref (in_flight->info);
+	g_free (in_flight);
+}
+
+static void
+remember_metadata_serials (MetadataWriteInFlight *in_flight)
+{
+	GHashTable *serials;
+	char **attrs;
+	int i;
+
+	if (metadata_serials == NULL) {
+		metadata_serials = g_hash_table_new_full (NULL, NULL,
+							  (GDestroyNotify) nemo_file_unref,
+							  (GDestroyNotify) g_hash_table_destroy);
+	}
+
+	serials = g_hash_table_lookup (metadata_serials, in_flight->file);
+	if (serials == NULL) {
+		serials = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (metadata_serials, nemo_file_ref (in_flight->file), serials);
+	}
+
+	attrs = g_file_info_list_attributes (in_flight->info, "metadata");
+	for (i = 0; attrs[i] != NULL; i++) {
+		g_hash_table_insert (serials, g_strdup (attrs[i]),
+				     GUINT_TO_POINTER (in_flight->serial));
+	}
+	g_strfreev (attrs);
+}
+
+static gboolean
+is_latest_metadata_write (MetadataWriteInFlight *in_flight,
+			  const char *attribute)
+{
+	GHashTable *serials;
+
+	serials = NULL;
+	if (metadata_serials != NULL) {
+		serials = g_hash_table_lookup (metadata_serials, in_flight->file);
+	}
+
+	return serials != NULL &&
+		GPOINTER_TO_UINT (g_hash_table_lookup (serials, attribute)) == in_flight->serial;
+}
+
+/* Drops the serials of a write that is done, unless a newer write of
+ * the same attribute went out after it.
+ */
+static void
+forget_metadata_serials (MetadataWriteInFlight *in_flight)
+{
+	GHashTable *serials;
+	char **attrs;
+	int i;
+
+	if (metadata_serials == NULL) {
+		return;
+	}
+
+	serials = g_hash_table_lookup (metadata_serials, in_flight->file);
+	if (serials == NULL) {
+		return;
+	}
+
+	attrs = g_file_info_list_attributes (in_flight->info, "metadata");
+	for (i = 0; attrs[i] != NULL; i++) {
+		if (is_latest_metadata_write (in_flight, attrs[i])) {
+			g_hash_table_remove (serials, attrs[i]);
+		}
+	}
+	g_strfreev (attrs);
+
+	if (g_hash_table_size (serials) == 0) {
+		g_hash_table_remove (metadata_serials, in_flight->file);
+	}
+}
+
 static void
 set_metadata_get_info_callback (GObject *source_object,
 				GAsyncResult *res,
@@ -107,34 +228,250 @@ set_metadata_get_info_callback (GObject *source_object,
 	}
 }
 
+/* The file's copy of the metadata may have been read from the store
+ * again while the write was on its way, so put the written values
+ * back, except those that were set again since, whether that newer
+ * value is still waiting or already on its way too.
+ */
+static gboolean
+apply_written_metadata (MetadataWriteInFlight *in_flight)
+{
+	NemoFile *file;
+	GFileInfo *info;
+	MetadataWrite *pending;
+	char **attrs;
+	const char *key;
+	gboolean changed;
+	int i;
+
+	file = in_flight->file;
+	info = in_flight->info;
+
+	pending = NULL;
+	if (metadata_writes != NULL) {
+		pending = g_hash_table_lookup (metadata_writes, file);
+	}
+
+	changed = FALSE;
+	attrs = g_file_info_list_attributes (info, "metadata");
+	for (i = 0; attrs[i] != NULL; i++) {
+		if ((pending != NULL &&
+		     g_file_info_has_attribute (pending->info, attrs[i])) ||
+		    !is_latest_metadata_write (in_flight, attrs[i])) {
+			continue;
+		}
+
+		key = attrs[i] + strlen ("metadata::");
+		switch (g_file_info_get_attribute_type (info, attrs[i])) {
+		case G_FILE_ATTRIBUTE_TYPE_STRING:
+			if (nemo_file_set_metadata_in_memory
+			    (file, key, g_file_info_get_attribute_string (info, attrs[i]))) {
+				changed = TRUE;
+			}
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_STRINGV:
+			if (nemo_file_set_metadata_list_in_memory
+			    (file, key, g_file_info_get_attribute_stringv (info, attrs[i]))) {
+				changed = TRUE;
+			}
+			break;
+		default:
+			/* Unset */
+			if (nemo_file_set_metadata_in_memory (file, key, NULL)) {
+				changed = TRUE;
+			}
+			break;
+		}
+	}
+	g_strfreev (attrs);
+
+	return changed;
+}
+
 static void
 set_metadata_callback (GObject *source_object,
 		       GAsyncResult *result,
 		       gpointer callback_data)
 {
-	NemoFile *file;
+	MetadataWriteInFlight *in_flight;
+	GFileInfo *info;
 	GError *error;
 	gboolean res;
 
-	file = callback_data;
+	in_flight = callback_data;
 
+	info = NULL;
 	error = NULL;
 	res = g_file_set_attributes_finish (G_FILE (source_object),
 					    result,
-					    NULL,
+					    &info,
 					    &error);
 
 	if (res) {
+		if (apply_written_metadata (in_flight)) {
+			nemo_file_changed (in_flight->file);
+		}
+	} else {
+		/* Our copy is ahead of what got stored, read it back */
 		g_file_query_info_async (G_FILE (source_object),
 					 NEMO_FILE_DEFAULT_ATTRIBUTES,
 					 0,
 					 G_PRIORITY_DEFAULT,
 					 NULL,
-					 set_metadata_get_info_callback, file);
-	} else {
-		nemo_file_unref (file);
+					 set_metadata_get_info_callback,
+					 nemo_file_ref (in_flight->file));
 		g_error_free (error);
 	}
+
+	forget_metadata_serials (in_flight);
+	metadata_write_in_flight_free (in_flight);
+
+	if (info != NULL) {
+		g_object_unref (info);
+	}
+}
+
+static gboolean
+flush_metadata_writes (gpointer data)
+{
+	GHashTable *writes, *changed_files;
+	GHashTableIter iter;
+	gpointer key, value;
+	NemoFile *file;
+	NemoDirectory *directory;
+	MetadataWrite *write;
+	MetadataWriteInFlight *in_flight;
+	GFile *location;
+	GList *files;
+
+	metadata_writes_id = 0;
+	writes = metadata_writes;
+	metadata_writes = NULL;
+
+	/* NemoDirectory -> list of NemoFile */
+	changed_files = g_hash_table_new (NULL, NULL);
+
+	g_hash_table_iter_init (&iter, writes);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		file = key;
+		write = value;
+
+		if (!nemo_file_is_gone (file)) {
+			in_flight = g_new (MetadataWriteInFlight, 1);
+			in_flight->file = nemo_file_ref (file);
+			in_flight->info = g_object_ref (write->info);
+			in_flight->serial = ++metadata_write_serial;
+			remember_metadata_serials (in_flight);
+
+			location = nemo_file_get_location (file);
+			g_file_set_attributes_async (location,
+						     write->info,
+						     0,
+						     G_PRIORITY_DEFAULT,
+						     NULL,
+						     set_metadata_callback,
+						     in_flight);
+			g_object_unref (location);
+		}
+
+		if (!write->changed) {
+			continue;
+		}
+
+		if (nemo_file_is_self_owned (file)) {
+			nemo_file_changed (file);
+		} else {
+			directory = file->details->directory;
+			files = g_hash_table_lookup (changed_files, directory);
+			g_hash_table_insert (changed_files, directory,
+					     g_list_prepend (files, file));
+		}
+	}
+
+	/* One change notification per directory */
+	g_hash_table_iter_init (&iter, changed_files);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		nemo_directory_emit_change_signals (key, value);
+		g_list_free (value);
+	}
+	g_hash_table_destroy (changed_files);
+
+	g_hash_table_destroy (writes);
+
+	return FALSE;
+}
+
+/* The main loop is gone by then, so what is still waiting is written
+ * right here rather than lost.
+ */
+static void
+flush_metadata_writes_at_shutdown (void)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	NemoFile *file;
+	MetadataWrite *write;
+	GFile *location;
+
+	if (metadata_writes_id != 0) {
+		g_source_remove (metadata_writes_id);
+		metadata_writes_id = 0;
+	}
+
+	if (metadata_writes != NULL) {
+		g_hash_table_iter_init (&iter, metadata_writes);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			file = key;
+			write = value;
+
+			if (!nemo_file_is_gone (file)) {
+				location = nemo_file_get_location (file);
+				g_file_set_attributes_from_info (location, write->info,
+								 0, NULL, NULL);
+				g_object_unref (location);
+			}
+		}
+
+		g_hash_table_destroy (metadata_writes);
+		metadata_writes = NULL;
+	}
+
+	if (metadata_serials != NULL) {
+		g_hash_table_destroy (metadata_serials);
+		metadata_serials = NULL;
+	}
+}
+
+static MetadataWrite *
+get_metadata_write (NemoFile *file)
+{
+	static gboolean flush_at_shutdown = FALSE;
+	MetadataWrite *write;
+
+	if (!flush_at_shutdown) {
+		eel_debug_call_at_shutdown (flush_metadata_writes_at_shutdown);
+		flush_at_shutdown = TRUE;
+	}
+
+	if (metadata_writes == NULL) {
+		metadata_writes = g_hash_table_new_full (NULL, NULL,
+							 (GDestroyNotify) nemo_file_unref,
+							 (GDestroyNotify) metadata_write_free);
+	}
+
+	write = g_hash_table_lookup (metadata_writes, file);
+	if (write == NULL) {
+		write = g_new0 (MetadataWrite, 1);
+		write->info = g_file_info_new ();
+		g_hash_table_insert (metadata_writes, nemo_file_ref (file), write);
+	}
+
+	if (metadata_writes_id == 0) {
+		metadata_writes_id = g_timeout_add (METADATA_WRITE_DELAY_MSEC,
+						    flush_metadata_writes, NULL);
+	}
+
+	return write;
 }
 
 static void
@@ -142,33 +479,25 @@ vfs_file_set_metadata (NemoFile           *file,
 		       const char             *key,
 		       const char             *value)
 {
-	GFileInfo *info;
-	GFile *location;
+	MetadataWrite *write;
 	char *gio_key;
 
-	info = g_file_info_new ();
+	write = get_metadata_write (file);
 	
 	gio_key = g_strconcat ("metadata::", key, NULL);
 	if (value != NULL) {
-		g_file_info_set_attribute_string (info, gio_key, value);
+		g_file_info_set_attribute_string (write->info, gio_key, value);
 	} else {
 		/* Unset the key */
-		g_file_info_set_attribute (info, gio_key,
+		g_file_info_set_attribute (write->info, gio_key,
 					   G_FILE_ATTRIBUTE_TYPE_INVALID,
 					   NULL);
 	}
 	g_free (gio_key);
 
-	location = nemo_file_get_location (file);
-	g_file_set_attributes_async (location,
-				     info,
-				     0,
-				     G_PRIORITY_DEFAULT,
-				     NULL,
-				     set_metadata_callback,
-				     nemo_file_ref (file));
-	g_object_unref (location);
-	g_object_unref (info);
+	if (nemo_file_set_metadata_in_memory (file, key, value)) {
+		write->changed = TRUE;
+	}
 }
 
 static void
@@ -176,26 +505,18 @@ vfs_file_set_metadata_as_list (NemoFile           *file,
 			       const char             *key,
 			       char                  **value)
 {
-	GFile *location;
-	GFileInfo *info;
+	MetadataWrite *write;
 	char *gio_key;
 
-	info = g_file_info_new ();
+	write = get_metadata_write (file);
 
 	gio_key = g_strconcat ("metadata::", key, NULL);
-	g_file_info_set_attribute_stringv (info, gio_key, value);
+	g_file_info_set_attribute_stringv (write->info, gio_key, value);
 	g_free (gio_key);
 
-	location = nemo_file_get_location (file);
-	g_file_set_attributes_async (location,
-				     info,
-				     0,
-				     G_PRIORITY_DEFAULT,
-				     NULL,
-				     set_metadata_callback,
-				     nemo_file_ref (file));
-	g_object_unref (info);
-	g_object_unref (location);
+	if (nemo_file_set_metadata_list_in_memory (file, key, value)) {
+		write->changed = TRUE;
+	}
 }
 
 static gboolean
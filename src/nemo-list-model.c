@@ -719,6 +719,256 @@ nemo_list_model_compare_func (NemoListModel *model,
 	return result;
 }
 
+/* Sorting by key: every row gets a 128 bit key that orders it the way
+ * nemo_list_model_file_entry_compare_func() does, up to ties. The keys
+ * are radix sorted, and only rows with equal keys are compared pair by
+ * pair. String keys are replaced by their rank among the distinct
+ * (interned) keys, which are few for the columns that have them.
+ */
+typedef struct {
+	guint64 high;
+	guint64 low;
+	const char *collation_key;
+	FileEntry *file_entry;
+} SortKeyEntry;
+
+#define SORT_KEY_HAS_FILE        (G_GUINT64_CONSTANT (1) << 63)
+#define SORT_KEY_NOT_DIRECTORY   (G_GUINT64_CONSTANT (1) << 62)
+#define SORT_KEY_REVERSIBLE_MASK (SORT_KEY_NOT_DIRECTORY - 1)
+#define SORT_KEY_ORDER_SHIFT     24
+#define SORT_KEY_GROUP_MASK      ((1 << SORT_KEY_ORDER_SHIFT) - 1)
+
+#define SORT_KEY_DIGIT(entry, pass) \
+	(((pass) < 8 ? (entry).low : (entry).high) >> (((pass) % 8) * 8) & 0xff)
+
+static void
+radix_sort_keys (SortKeyEntry *entries, SortKeyEntry *scratch, int length)
+{
+	SortKeyEntry *from, *to, *tmp;
+	guint count[256];
+	guint offset, n;
+	int pass, i;
+
+	from = entries;
+	to = scratch;
+
+	for (pass = 0; pass < 16; pass++) {
+		memset (count, 0, sizeof (count));
+		for (i = 0; i < length; i++) {
+			count[SORT_KEY_DIGIT (from[i], pass)]++;
+		}
+
+		/* Most high digits are the same for every row. */
+		if (count[SORT_KEY_DIGIT (from[0], pass)] == (guint) length) {
+			continue;
+		}
+
+		offset = 0;
+		for (i = 0; i < 256; i++) {
+			n = count[i];
+			count[i] = offset;
+			offset += n;
+		}
+		for (i = 0; i < length; i++) {
+			to[count[SORT_KEY_DIGIT (from[i], pass)]++] = from[i];
+		}
+
+		tmp = from;
+		from = to;
+		to = tmp;
+	}
+
+	if (from != entries) {
+		memcpy (entries, from, length * sizeof (SortKeyEntry));
+	}
+}
+
+static int
+collation_key_compare_func (gconstpointer a,
+			    gconstpointer b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+rank_collation_keys (SortKeyEntry *entries, int length, gboolean reversed)
+{
+	GHashTable *ranks;
+	GPtrArray *keys;
+	guint i;
+
+	ranks = g_hash_table_new (NULL, NULL);
+	keys = g_ptr_array_new ();
+
+	for (i = 0; i < (guint) length; i++) {
+		if (entries[i].collation_key != NULL &&
+		    !g_hash_table_contains (ranks, entries[i].collation_key)) {
+			g_hash_table_insert (ranks, (gpointer) entries[i].collation_key, NULL);
+			g_ptr_array_add (keys, (gpointer) entries[i].collation_key);
+		}
+	}
+
+	g_ptr_array_sort (keys, collation_key_compare_func);
+	for (i = 0; i < keys->len; i++) {
+		g_hash_table_insert (ranks, g_ptr_array_index (keys, i), GUINT_TO_POINTER (i));
+	}
+
+	for (i = 0; i < (guint) length; i++) {
+		if (entries[i].collation_key != NULL) {
+			entries[i].low = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, entries[i].collation_key));
+			if (reversed) {
+				entries[i].low = ~entries[i].low;
+			}
+		}
+	}
+
+	g_ptr_array_free (keys, TRUE);
+	g_hash_table_destroy (ranks);
+}
+
+static int
+sort_key_entry_compare_func (gconstpointer a,
+			     gconstpointer b,
+			     gpointer      user_data)
+{
+	return nemo_list_model_file_entry_compare_func (((SortKeyEntry *) a)->file_entry,
+							((SortKeyEntry *) b)->file_entry,
+							user_data);
+}
+
+static gboolean
+nemo_list_model_get_sort_key (NemoListModel *model,
+			      FileEntry *file_entry,
+			      SortKeyEntry *entry)
+{
+	NemoFileSortKey key;
+	gboolean reversed;
+	guint64 high;
+
+	entry->file_entry = file_entry;
+	entry->collation_key = NULL;
+	entry->high = 0;
+	entry->low = 0;
+
+	/* The dummy row goes first. */
+	if (file_entry->file == NULL) {
+		return TRUE;
+	}
+
+	if (!nemo_file_get_sort_key_q (file_entry->file,
+				       model->details->sort_attribute,
+				       &key)) {
+		return FALSE;
+	}
+
+	reversed = (model->details->order == GTK_SORT_DESCENDING);
+
+	high = (guint64) ((guint32) key.sort_order ^ 0x80000000) << SORT_KEY_ORDER_SHIFT |
+		(key.group & SORT_KEY_GROUP_MASK);
+	if (reversed) {
+		high = ~high & SORT_KEY_REVERSIBLE_MASK;
+	}
+	entry->high = SORT_KEY_HAS_FILE | high;
+	if (model->details->sort_directories_first &&
+	    !nemo_file_is_directory (file_entry->file)) {
+		entry->high |= SORT_KEY_NOT_DIRECTORY;
+	}
+
+	entry->low = reversed ? ~key.value : key.value;
+	entry->collation_key = key.collation_key;
+
+	return TRUE;
+}
+
+/* Like nemo_list_model_file_entry_compare_func(), but looks at the
+ * precomputed keys first. Used to insert and move single rows.
+ */
+static int
+nemo_list_model_file_entry_compare_by_key_func (gconstpointer a,
+						gconstpointer b,
+						gpointer      user_data)
+{
+	NemoListModel *model;
+	SortKeyEntry key_a, key_b;
+	int result;
+
+	model = (NemoListModel *)user_data;
+
+	if (((FileEntry *)a)->file == NULL || ((FileEntry *)b)->file == NULL ||
+	    !nemo_list_model_get_sort_key (model, (FileEntry *)a, &key_a) ||
+	    !nemo_list_model_get_sort_key (model, (FileEntry *)b, &key_b)) {
+		return nemo_list_model_file_entry_compare_func (a, b, user_data);
+	}
+
+	if (key_a.high != key_b.high) {
+		return key_a.high < key_b.high ? -1 : 1;
+	}
+	if (key_a.low != key_b.low) {
+		return key_a.low < key_b.low ? -1 : 1;
+	}
+	if (key_a.collation_key != key_b.collation_key &&
+	    key_a.collation_key != NULL && key_b.collation_key != NULL) {
+		result = strcmp (key_a.collation_key, key_b.collation_key);
+		return model->details->order == GTK_SORT_DESCENDING ? -result : result;
+	}
+
+	return nemo_list_model_file_entry_compare_func (a, b, user_data);
+}
+
+static gboolean
+nemo_list_model_sort_by_key (NemoListModel *model, GSequence *files)
+{
+	SortKeyEntry *entries;
+	GSequenceIter *ptr, *end;
+	gboolean has_collation_keys;
+	int length, start, i;
+
+	length = g_sequence_get_length (files);
+	has_collation_keys = FALSE;
+
+	entries = g_new (SortKeyEntry, 2 * length);
+
+	for (ptr = g_sequence_get_begin_iter (files), i = 0;
+	     !g_sequence_iter_is_end (ptr);
+	     ptr = g_sequence_iter_next (ptr), i++) {
+		if (!nemo_list_model_get_sort_key (model, g_sequence_get (ptr), &entries[i])) {
+			g_free (entries);
+			return FALSE;
+		}
+		has_collation_keys |= (entries[i].collation_key != NULL);
+	}
+
+	if (has_collation_keys) {
+		rank_collation_keys (entries, length,
+				     model->details->order == GTK_SORT_DESCENDING);
+	}
+
+	radix_sort_keys (entries, entries + length, length);
+
+	/* Break ties the slow way. */
+	for (start = 0; start < length; start = i) {
+		for (i = start + 1; i < length; i++) {
+			if (entries[i].high != entries[start].high ||
+			    entries[i].low != entries[start].low) {
+				break;
+			}
+		}
+		if (i - start > 1) {
+			g_qsort_with_data (entries + start, i - start, sizeof (SortKeyEntry),
+					   sort_key_entry_compare_func, model);
+		}
+	}
+
+	end = g_sequence_get_end_iter (files);
+	for (i = 0; i < length; i++) {
+		g_sequence_move (entries[i].file_entry->ptr, end);
+	}
+
+	g_free (entries);
+
+	return TRUE;
+}
+
 static void
 nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTreePath *path)
 {
@@ -752,7 +1002,9 @@ nemo_list_model_sort_file_entries (NemoListModel *model, GSequence *files, GtkTr
 	}
 
 	/* sort */
-	g_sequence_sort (files, nemo_list_model_file_entry_compare_func, model);
+	if (!nemo_list_model_sort_by_key (model, files)) {
+		g_sequence_sort (files, nemo_list_model_file_entry_compare_func, model);
+	}
 
 	/* generate new order */
 	new_order = g_new (int, length);
@@ -1019,7 +1271,7 @@ nemo_list_model_add_file (NemoListModel *model, NemoFile *file,
         file_entry->ptr = g_sequence_append (files, file_entry);
     else
         file_entry->ptr = g_sequence_insert_sorted (files, file_entry,
-                                                    nemo_list_model_file_entry_compare_func, model);
+                                                    nemo_list_model_file_entry_compare_by_key_func, model);
 
 	g_hash_table_insert (parent_hash, file, file_entry->ptr);
 	
@@ -1079,7 +1331,7 @@ nemo_list_model_file_changed (NemoListModel *model, NemoFile *file,
 	pos_before = g_sequence_iter_get_position (ptr);
 
     if (!model->details->temp_unsorted)
-        g_sequence_sort_changed (ptr, nemo_list_model_file_entry_compare_func, model);
+        g_sequence_sort_changed (ptr, nemo_list_model_file_entry_compare_by_key_func, model);
 
 	pos_after = g_sequence_iter_get_position (ptr);
 
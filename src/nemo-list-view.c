@@ -59,6 +59,7 @@
 #include <libnemo-private/nemo-module.h>
 #include <libnemo-private/nemo-tree-view-drag-dest.h>
 #include <libnemo-private/nemo-clipboard.h>
+#include <libnemo-private/nemo-thumbnails.h>
 
 #define DEBUG_FLAG NEMO_DEBUG_LIST_VIEW
 #include <libnemo-private/nemo-debug.h>
@@ -109,6 +110,8 @@ struct NemoListViewDetails {
 
 	gulong clipboard_handler_id;
 
+	guint thumbnail_viewport_id;
+
 	GQuark last_sort_attr;
 
     gboolean tooltip_flags;
@@ -2083,6 +2086,172 @@ get_icon_scale_callback (NemoListModel *model,
    return gtk_widget_get_scale_factor (GTK_WIDGET (view->details->tree_view));
 }
 
+/* Steps to the next row the tree view shows, descending into expanded
+ * folders.
+ */
+static gboolean
+get_next_shown_row (NemoListView *view,
+		    GtkTreeIter  *iter)
+{
+	GtkTreeModel *model;
+	GtkTreeIter tmp, parent;
+	GtkTreePath *path;
+	gboolean expanded;
+
+	model = GTK_TREE_MODEL (view->details->model);
+
+	path = gtk_tree_model_get_path (model, iter);
+	expanded = gtk_tree_view_row_expanded (view->details->tree_view, path);
+	gtk_tree_path_free (path);
+
+	if (expanded && gtk_tree_model_iter_children (model, &tmp, iter)) {
+		*iter = tmp;
+		return TRUE;
+	}
+
+	for (;;) {
+		tmp = *iter;
+		if (gtk_tree_model_iter_next (model, &tmp)) {
+			*iter = tmp;
+			return TRUE;
+		}
+		if (!gtk_tree_model_iter_parent (model, &parent, iter)) {
+			return FALSE;
+		}
+		*iter = parent;
+	}
+}
+
+static gboolean
+get_previous_shown_row (NemoListView *view,
+			GtkTreeIter  *iter)
+{
+	GtkTreeModel *model;
+	GtkTreeIter tmp, child, parent;
+	GtkTreePath *path;
+	gboolean expanded;
+	int n_children;
+
+	model = GTK_TREE_MODEL (view->details->model);
+
+	tmp = *iter;
+	if (!gtk_tree_model_iter_previous (model, &tmp)) {
+		if (!gtk_tree_model_iter_parent (model, &parent, iter)) {
+			return FALSE;
+		}
+		*iter = parent;
+		return TRUE;
+	}
+
+	/* Go down to the last row shown inside the previous one */
+	for (;;) {
+		path = gtk_tree_model_get_path (model, &tmp);
+		expanded = gtk_tree_view_row_expanded (view->details->tree_view, path);
+		gtk_tree_path_free (path);
+
+		n_children = gtk_tree_model_iter_n_children (model, &tmp);
+		if (!expanded || n_children == 0 ||
+		    !gtk_tree_model_iter_nth_child (model, &child, &tmp, n_children - 1)) {
+			break;
+		}
+		tmp = child;
+	}
+
+	*iter = tmp;
+	return TRUE;
+}
+
+/* Tells the thumbnailer which rows are visible, and which are close
+ * enough to them to be worth thumbnailing next.
+ */
+static gboolean
+publish_thumbnail_viewport_callback (gpointer data)
+{
+	NemoListView *view;
+	GtkTreeModel *model;
+	GtkTreePath *start, *end, *path;
+	GtkTreeIter iter;
+	NemoFile *file;
+	GList *uris;
+	guint margin, i, n_uris, n_after, first_visible, n_visible;
+	gboolean in_range, past_end;
+
+	view = NEMO_LIST_VIEW (data);
+	view->details->thumbnail_viewport_id = 0;
+
+	if (!gtk_tree_view_get_visible_range (view->details->tree_view, &start, &end)) {
+		return FALSE;
+	}
+
+	model = GTK_TREE_MODEL (view->details->model);
+	margin = nemo_thumbnail_get_viewport_margin ();
+
+	if (!gtk_tree_model_get_iter (model, &iter, start)) {
+		gtk_tree_path_free (start);
+		gtk_tree_path_free (end);
+		return FALSE;
+	}
+
+	for (i = 0; i < margin && get_previous_shown_row (view, &iter); i++) {
+		;
+	}
+
+	uris = NULL;
+	n_uris = n_after = first_visible = n_visible = 0;
+	in_range = FALSE;
+	do {
+		path = gtk_tree_model_get_path (model, &iter);
+		if (!in_range && gtk_tree_path_compare (path, start) >= 0) {
+			in_range = TRUE;
+			first_visible = n_uris;
+		}
+		past_end = gtk_tree_path_compare (path, end) > 0;
+		gtk_tree_path_free (path);
+
+		if (past_end && n_after++ >= margin) {
+			break;
+		}
+
+		/* The dummy rows of folders being loaded have no file */
+		gtk_tree_model_get (model, &iter,
+				    NEMO_LIST_MODEL_FILE_COLUMN, &file,
+				    -1);
+		if (file != NULL) {
+			uris = g_list_prepend (uris, nemo_file_get_uri (file));
+			n_uris++;
+			if (in_range && !past_end) {
+				n_visible++;
+			}
+			nemo_file_unref (file);
+		}
+	} while (get_next_shown_row (view, &iter));
+	uris = g_list_reverse (uris);
+
+	nemo_thumbnail_set_viewport (view, uris, first_visible, n_visible);
+
+	g_list_free_full (uris, g_free);
+	gtk_tree_path_free (start);
+	gtk_tree_path_free (end);
+
+	return FALSE;
+}
+
+static void
+schedule_publish_thumbnail_viewport (NemoListView *view)
+{
+	if (view->details->thumbnail_viewport_id == 0) {
+		view->details->thumbnail_viewport_id =
+			g_idle_add (publish_thumbnail_viewport_callback, view);
+	}
+}
+
+static void
+vadjustment_changed_callback (GtkAdjustment *adjustment,
+			      gpointer       callback_data)
+{
+	schedule_publish_thumbnail_viewport (NEMO_LIST_VIEW (callback_data));
+}
+
 static void
 create_and_set_up_tree_view (NemoListView *view)
 {
@@ -2314,6 +2483,14 @@ create_and_set_up_tree_view (NemoListView *view)
 	gtk_widget_show (GTK_WIDGET (view->details->tree_view));
 	gtk_container_add (GTK_CONTAINER (view), GTK_WIDGET (view->details->tree_view));
 
+	/* Scrolling as well as rows coming and going change what is visible */
+	g_signal_connect_object (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (view)),
+				 "value-changed",
+				 G_CALLBACK (vadjustment_changed_callback), view, 0);
+	g_signal_connect_object (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (view)),
+				 "changed",
+				 G_CALLBACK (vadjustment_changed_callback), view, 0);
+
         atk_obj = gtk_widget_get_accessible (GTK_WIDGET (view->details->tree_view));
         atk_object_set_name (atk_obj, _("List View"));
 
@@ -3539,6 +3716,13 @@ nemo_list_view_dispose (GObject *object)
 		list_view->details->clipboard_handler_id = 0;
 	}
 
+	if (list_view->details->thumbnail_viewport_id != 0) {
+		g_source_remove (list_view->details->thumbnail_viewport_id);
+		list_view->details->thumbnail_viewport_id = 0;
+	}
+
+	nemo_thumbnail_remove_viewport (list_view);
+
     G_OBJECT_CLASS (nemo_list_view_parent_class)->dispose (object);
 }
 
@@ -38,6 +38,7 @@
 #include <libnemo-private/nemo-file.h>
 #include <libnemo-private/nemo-file-utilities.h>
 #include <libnemo-private/nemo-file-operations.h>
+#include <libnemo-private/nemo-filesystem-usage.h>
 #include <libnemo-private/nemo-trash-monitor.h>
 #include <libnemo-private/nemo-icon-names.h>
 #include <libnemo-private/nemo-cell-renderer-disk.h>
@@ -623,69 +624,47 @@ sidebar_update_restore_selection (NemoPlacesSidebar *sidebar,
 	}
 }
 
+/* Returns -1, and an empty tooltip_info, while the usage isn't known
+ * yet; the sidebar gets updated when it arrives.
+ */
 static gint
-get_disk_full (GFile *file, gchar **tooltip_info)
-{
-    GFileInfo *info = g_file_query_filesystem_info (file,
-                                                    "filesystem::*",
-                                                    NULL,
-                                                    NULL);
-        guint64 k_used, k_total, k_free;
-        gint df_percent;
-        float fraction;
-        int prefix;
-        gchar *free_string;
-
-        k_used = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_USED);
-        k_total = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
-        k_free = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-        fraction = ((float) k_used / (float) k_total) * 100.0;
-        df_percent = (gint) rintf(fraction);
-
-        prefix = g_settings_get_enum (nemo_preferences, NEMO_PREFERENCES_SIZE_PREFIXES);
-        free_string = g_format_size_full (k_free, prefix);
-
-        *tooltip_info = g_strdup_printf (_("Free space: %s"), free_string);
-        g_free (free_string);
-        if (info != NULL)
-            g_object_unref (info);
-        return (df_percent > -1 && df_percent < 101) ? df_percent : 0;
+get_disk_full (const gchar *uri, gchar **tooltip_info)
+{
+    guint64 k_used, k_total, k_free;
+    gint df_percent;
+    float fraction;
+    int prefix;
+    gchar *free_string;
+
+    if (!nemo_filesystem_usage_lookup (nemo_filesystem_usage_get (), uri,
+                                       &k_total, &k_used, &k_free)) {
+        *tooltip_info = g_strdup ("");
+        return -1;
+    }
+
+    fraction = ((float) k_used / (float) k_total) * 100.0;
+    df_percent = (gint) rintf(fraction);
+
+    prefix = g_settings_get_enum (nemo_preferences, NEMO_PREFERENCES_SIZE_PREFIXES);
+    free_string = g_format_size_full (k_free, prefix);
+
+    *tooltip_info = g_strdup_printf (_("Free space: %s"), free_string);
+    g_free (free_string);
+
+    return (df_percent > -1 && df_percent < 101) ? df_percent : 0;
 }
 
 static gboolean
 home_on_different_fs (const gchar *home_uri)
 {
-    GFile *home = g_file_new_for_uri (home_uri);
-    GFile *root = g_file_new_for_uri ("file:///");
-    GFileInfo *home_info, *root_info;
+    NemoFilesystemUsage *usage;
     const gchar *home_id, *root_id;
-    gboolean res;
-
-    res = FALSE;
-    home_info = g_file_query_info (home,
-                                   G_FILE_ATTRIBUTE_ID_FILESYSTEM,
-                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                   NULL, NULL);
-    root_info = g_file_query_info (root,
-                                   G_FILE_ATTRIBUTE_ID_FILESYSTEM,
-                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                   NULL, NULL);
-
-    if (home_info && root_info) {
-        home_id = g_file_info_get_attribute_string (home_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-        root_id = g_file_info_get_attribute_string (root_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-        res = g_strcmp0 (home_id, root_id) != 0;
-        g_object_unref (home_info);
-        g_object_unref (root_info);
-    } else {
-        if (home_info)
-            g_object_unref (home_info);
-        if (root_info)
-            g_object_unref (root_info);
-    }
-    g_object_unref (home);
-    g_object_unref (root);
-    return res;
+
+    usage = nemo_filesystem_usage_get ();
+    home_id = nemo_filesystem_usage_get_filesystem_id (usage, home_uri);
+    root_id = nemo_filesystem_usage_get_filesystem_id (usage, "file:///");
+
+    return home_id != NULL && root_id != NULL && strcmp (home_id, root_id) != 0;
 }
 
 static gboolean
@@ -770,15 +749,16 @@ update_places (NemoPlacesSidebar *sidebar)
     /* home folder */
     mount_uri = nemo_get_home_directory_uri ();
     icon = get_gicon (mount_uri);
-    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+    full = get_disk_full (mount_uri, &tooltip_info);
     tooltip = g_strdup_printf (_("Open your personal folder\n%s"), tooltip_info);
+    g_strchomp (tooltip);
     g_free (tooltip_info);
     cat_iter = add_place (sidebar, PLACES_BUILT_IN,
                            SECTION_COMPUTER,
                            _("Home"), icon,
                            mount_uri, NULL, NULL, NULL, 0,
                            tooltip,
-                           full, home_on_different_fs (mount_uri),
+                           MAX (full, 0), full >= 0 && home_on_different_fs (mount_uri),
                            cat_iter);
     g_object_unref (icon);
     sidebar->top_bookend_uri = g_strdup (mount_uri);
@@ -854,15 +834,16 @@ update_places (NemoPlacesSidebar *sidebar)
     /* file system root */
     mount_uri = "file:///"; /* No need to strdup */
     icon = g_themed_icon_new (NEMO_ICON_FILESYSTEM);
-    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+    full = get_disk_full (mount_uri, &tooltip_info);
     tooltip = g_strdup_printf (_("Open the contents of the File System\n%s"), tooltip_info);
+    g_strchomp (tooltip);
     g_free (tooltip_info);
     cat_iter = add_place (sidebar, PLACES_BUILT_IN,
                            SECTION_COMPUTER,
                            _("File System"), icon,
                            mount_uri, NULL, NULL, NULL, 0,
                            tooltip,
-                           full, TRUE,
+                           MAX (full, 0), full >= 0,
                            cat_iter);
     g_object_unref (icon);
     g_free (tooltip);
@@ -997,18 +978,19 @@ update_places (NemoPlacesSidebar *sidebar)
                     root = g_mount_get_default_location (mount);
                     mount_uri = g_file_get_uri (root);
                     name = g_mount_get_name (mount);
-                    full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+                    full = get_disk_full (mount_uri, &tooltip_info);
                     tooltip = g_strdup_printf (_("%s (%s)\n%s"),
                                                g_file_get_parse_name (root),
                                                g_volume_get_identifier (volume,
                                                                         G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE),
                                                tooltip_info);
+                    g_strchomp (tooltip);
                     g_free (tooltip_info);
                     cat_iter = add_place (sidebar, PLACES_MOUNTED_VOLUME,
                                            SECTION_DEVICES,
                                            name, icon, mount_uri,
                                            drive, volume, mount, 0, tooltip,
-                                           full, TRUE,
+                                           MAX (full, 0), full >= 0,
                                            cat_iter);
                     g_object_unref (root);
                     g_object_unref (mount);
@@ -1096,17 +1078,19 @@ update_places (NemoPlacesSidebar *sidebar)
             icon = g_mount_get_icon (mount);
             root = g_mount_get_default_location (mount);
             mount_uri = g_file_get_uri (root);
-            full = get_disk_full (g_file_new_for_uri (mount_uri), &tooltip_info);
+            full = get_disk_full (mount_uri, &tooltip_info);
             tooltip = g_strdup_printf (_("%s\n%s"),
                                        g_file_get_parse_name (root),
                                        tooltip_info);
+            g_strchomp (tooltip);
             g_free (tooltip_info);
             g_object_unref (root);
             name = g_mount_get_name (mount);
             cat_iter = add_place (sidebar, PLACES_MOUNTED_VOLUME,
                                    SECTION_DEVICES,
                                    name, icon, mount_uri,
-                                   NULL, volume, mount, 0, tooltip, full, TRUE,
+                                   NULL, volume, mount, 0, tooltip,
+                                   MAX (full, 0), full >= 0,
                                    cat_iter);
             g_object_unref (mount);
             g_object_unref (icon);
@@ -1215,6 +1199,15 @@ mount_removed_callback (GVolumeMonitor *volume_monitor,
 			GMount *mount,
 			NemoPlacesSidebar *sidebar)
 {
+	GFile *root;
+	char *uri;
+
+	root = g_mount_get_default_location (mount);
+	uri = g_file_get_uri (root);
+	nemo_filesystem_usage_forget (nemo_filesystem_usage_get (), uri);
+	g_free (uri);
+	g_object_unref (root);
+
 	update_places_on_idle (sidebar);
 }
 
@@ -3847,6 +3840,19 @@ bookmarks_editing_canceled (GtkCellRenderer       *cell,
 	g_object_set (cell, "editable", FALSE, NULL);
 }
 
+static void
+filesystem_usage_changed_cb (NemoFilesystemUsage *usage,
+			     const char          *uri,
+			     gpointer             data)
+{
+	NemoPlacesSidebar *sidebar;
+
+	sidebar = NEMO_PLACES_SIDEBAR (data);
+
+	/* Fresh disk usage arrived, show it */
+	update_places_on_idle (sidebar);
+}
+
 static void
 trash_state_changed_cb (NemoTrashMonitor *trash_monitor,
 			gboolean             state,
@@ -4436,6 +4442,8 @@ nemo_places_sidebar_set_parent_window (NemoPlacesSidebar *sidebar,
 				 G_CALLBACK (drive_connected_callback), sidebar, 0);
 	g_signal_connect_object (sidebar->volume_monitor, "drive_changed",
 				 G_CALLBACK (drive_changed_callback), sidebar, 0);
+	g_signal_connect_object (nemo_filesystem_usage_get (), "changed",
+				 G_CALLBACK (filesystem_usage_changed_cb), sidebar, 0);
 
 	g_signal_connect_swapped (nemo_preferences, "changed::" NEMO_PREFERENCES_ALWAYS_USE_BROWSER,
 				  G_CALLBACK (bookmarks_popup_menu_detach_cb), sidebar);
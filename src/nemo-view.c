@@ -3581,10 +3581,37 @@ sort_files (NemoView *view, GList **list)
 	
 }
 
+/* Sorts @files and merges them into the already sorted @list, so a
+ * directory that keeps growing while earlier files are still pending
+ * doesn't get the whole pending list re-sorted for every batch.
+ */
+static GList *
+merge_files (NemoView *view, GList *list, GList *files)
+{
+	GList *merged, *node;
+
+	sort_files (view, &files);
+
+	merged = NULL;
+	while (list != NULL && files != NULL) {
+		if (compare_files_cover (files->data, list->data, view) < 0) {
+			node = files;
+			files = g_list_remove_link (files, node);
+		} else {
+			node = list;
+			list = g_list_remove_link (list, node);
+		}
+		merged = g_list_concat (node, merged);
+	}
+	merged = g_list_reverse (merged);
+
+	return g_list_concat (merged, list != NULL ? list : files);
+}
+
 /* Go through all the new added and changed files.
  * Put any that are not ready to load in the non_ready_files hash table.
- * Add all the rest to the old_added_files and old_changed_files lists.
- * Sort the old_*_files lists if anything was added to them.
+ * Merge all the rest into the sorted old_added_files and
+ * old_changed_files lists.
  */
 static void
 process_new_files (NemoView *view)
@@ -3602,8 +3629,8 @@ process_new_files (NemoView *view)
 
 	non_ready_files = view->details->non_ready_files;
 
-	old_added_files = view->details->old_added_files;
-	old_changed_files = view->details->old_changed_files;
+	old_added_files = NULL;
+	old_changed_files = NULL;
 
 	/* Newly added files go into the old_added_files list if they're
 	 * ready, and into the hash table if they're not.
@@ -3652,18 +3679,19 @@ process_new_files (NemoView *view)
 	}
 	file_and_directory_list_free (new_changed_files);
 
-	/* If any files were added to old_added_files, then resort it. */
-	if (old_added_files != view->details->old_added_files) {
-		view->details->old_added_files = old_added_files;
-		sort_files (view, &view->details->old_added_files);
+	/* The pending lists only decide the order in which files are
+	 * handed to the view, which sorts them itself on insertion. So
+	 * a pending file whose attributes changed again may stay where
+	 * it was, and only the new files need sorting.
+	 */
+	if (old_added_files != NULL) {
+		view->details->old_added_files =
+			merge_files (view, view->details->old_added_files, old_added_files);
 	}
 
-	/* Resort old_changed_files too, since file attributes
-	 * relevant to sorting could have changed.
-	 */
-	if (old_changed_files != view->details->old_changed_files) {
-		view->details->old_changed_files = old_changed_files;
-		sort_files (view, &view->details->old_changed_files);
+	if (old_changed_files != NULL) {
+		view->details->old_changed_files =
+			merge_files (view, view->details->old_changed_files, old_changed_files);
 	}
 
 }
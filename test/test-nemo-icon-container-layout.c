@@ -0,0 +1,309 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libnemo-private/nemo-global-preferences.h>
+#include <libnemo-private/nemo-icon-container.h>
+#include <libnemo-private/nemo-icon-info.h>
+#include <libnemo-private/nemo-icon-private.h>
+
+/* Measures what laying out the icon view costs after adding one icon
+ * to a big container, at the end of the sort order and in the middle,
+ * after an icon changed without changing its size, and after removing
+ * the icon that starts a line and the last icon. After each
+ * step, the positions the partial layout left are checked against the
+ * ones a full layout of the same icons gives.
+ *
+ * Usage: test-nemo-icon-container-layout [number of icons]
+ */
+
+typedef NemoIconContainer TestContainer;
+typedef NemoIconContainerClass TestContainerClass;
+
+static GType test_container_get_type (void);
+
+G_DEFINE_TYPE (TestContainer, test_container, NEMO_TYPE_ICON_CONTAINER)
+
+static NemoIconInfo *
+test_container_get_icon_images (NemoIconContainer *container,
+				NemoIconData *data,
+				int icon_size,
+				char **embedded_text,
+				gboolean for_drag_accept,
+				gboolean need_large_embeddded_text,
+				gboolean *embedded_text_needs_loading,
+				gboolean *has_window_open)
+{
+	return nemo_icon_info_lookup_from_name ("text-x-generic", icon_size,
+						gtk_widget_get_scale_factor (GTK_WIDGET (container)));
+}
+
+static void
+test_container_get_icon_text (NemoIconContainer *container,
+			      NemoIconData *data,
+			      char **editable_text,
+			      char **additional_text,
+			      gboolean include_invisible)
+{
+	if (editable_text != NULL) {
+		*editable_text = g_strdup ((const char *) data);
+	}
+	if (additional_text != NULL) {
+		*additional_text = NULL;
+	}
+}
+
+static int
+test_container_compare_icons (NemoIconContainer *container,
+			      NemoIconData *icon_a,
+			      NemoIconData *icon_b)
+{
+	return strcmp ((const char *) icon_a, (const char *) icon_b);
+}
+
+static void
+test_container_do_nothing (NemoIconContainer *container)
+{
+}
+
+static void
+test_container_start_monitor_top_left (NemoIconContainer *container,
+				       NemoIconData *data,
+				       gconstpointer client,
+				       gboolean large_text)
+{
+}
+
+static void
+test_container_stop_monitor_top_left (NemoIconContainer *container,
+				      NemoIconData *data,
+				      gconstpointer client)
+{
+}
+
+static void
+test_container_prioritize_thumbnailing (NemoIconContainer *container,
+					NemoIconData *data)
+{
+}
+
+static void
+test_container_init (TestContainer *container)
+{
+}
+
+static void
+test_container_class_init (TestContainerClass *klass)
+{
+	klass->get_icon_images = test_container_get_icon_images;
+	klass->get_icon_text = test_container_get_icon_text;
+	klass->compare_icons = test_container_compare_icons;
+	klass->compare_icons_by_name = test_container_compare_icons;
+	klass->freeze_updates = test_container_do_nothing;
+	klass->unfreeze_updates = test_container_do_nothing;
+	klass->start_monitor_top_left = test_container_start_monitor_top_left;
+	klass->stop_monitor_top_left = test_container_stop_monitor_top_left;
+	klass->prioritize_thumbnailing = test_container_prioritize_thumbnailing;
+}
+
+static void
+flush_events (void)
+{
+	while (gtk_events_pending ()) {
+		gtk_main_iteration ();
+	}
+}
+
+static double
+time_layout (NemoIconContainer *container)
+{
+	gint64 start;
+
+	start = g_get_monotonic_time ();
+	nemo_icon_container_layout_now (container);
+
+	return (g_get_monotonic_time () - start) / 1000.0;
+}
+
+typedef struct {
+	double x, y;
+} Position;
+
+/* Returns FALSE if a full layout puts any icon somewhere else than the
+ * partial layout before it did.
+ */
+static gboolean
+matches_full_layout (NemoIconContainer *container,
+		     const char *step)
+{
+	GHashTable *positions;
+	Position *position;
+	NemoIcon *icon;
+	GList *p;
+	gboolean matches;
+
+	positions = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+		position = g_new (Position, 1);
+		position->x = icon->x;
+		position->y = icon->y;
+		g_hash_table_insert (positions, icon->data, position);
+	}
+
+	/* Sorts and lays out everything from scratch */
+	nemo_icon_container_sort (container);
+	flush_events ();
+
+	matches = TRUE;
+	for (p = container->details->icons; p != NULL; p = p->next) {
+		icon = p->data;
+		position = g_hash_table_lookup (positions, icon->data);
+		if (position == NULL ||
+		    position->x != icon->x || position->y != icon->y) {
+			g_printerr ("%s: \"%s\" was laid out at %.0f,%.0f, a full layout puts it at %.0f,%.0f\n",
+				    step, (const char *) icon->data,
+				    position != NULL ? position->x : -1,
+				    position != NULL ? position->y : -1,
+				    icon->x, icon->y);
+			matches = FALSE;
+			break;
+		}
+	}
+
+	g_hash_table_destroy (positions);
+
+	return matches;
+}
+
+/* The first icon of the second line */
+static NemoIconData *
+find_line_start (NemoIconContainer *container)
+{
+	NemoIcon *first, *icon;
+	GList *p;
+
+	first = container->details->icons->data;
+	for (p = container->details->icons->next; p != NULL; p = p->next) {
+		icon = p->data;
+		if (icon->x == first->x) {
+			return icon->data;
+		}
+	}
+
+	return NULL;
+}
+
+/* Returns FALSE if icons away from the visible area have a canvas item */
+static gboolean
+has_items_near_viewport (NemoIconContainer *container,
+			 const char *step)
+{
+	NemoIcon *first, *last;
+	guint n_items, n_icons;
+
+	first = g_list_first (container->details->icons)->data;
+	last = g_list_last (container->details->icons)->data;
+	n_items = g_hash_table_size (container->details->icons_with_items);
+	n_icons = g_list_length (container->details->icons);
+
+	g_print ("%s: %u of %u icons have an item\n", step, n_items, n_icons);
+
+	/* A window shows a few hundred icons at most */
+	if (n_icons < 10000) {
+		return TRUE;
+	}
+	if (n_items * 10 > n_icons) {
+		g_printerr ("%s: too many icons have an item\n", step);
+		return FALSE;
+	}
+	if ((first->item != NULL) == (last->item != NULL)) {
+		g_printerr ("%s: the first and the last icon both %s an item\n",
+			    step, first->item != NULL ? "have" : "lack");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int
+main (int argc, char* argv[])
+{
+	NemoIconContainer *container;
+	GtkWidget *window, *scrolled;
+	GtkAdjustment *vadj;
+	NemoIconData *data;
+	char *last;
+	int n_icons, i;
+	gboolean ok;
+
+	test_init (&argc, &argv);
+	nemo_global_preferences_init ();
+
+	n_icons = argc > 1 ? atoi (argv[1]) : 30000;
+
+	window = test_window_new ("Layout", 0);
+	gtk_window_set_default_size (GTK_WINDOW (window), 1000, 800);
+	scrolled = gtk_scrolled_window_new (NULL, NULL);
+	gtk_container_add (GTK_CONTAINER (window), scrolled);
+
+	container = g_object_new (test_container_get_type (), NULL);
+	nemo_icon_container_set_auto_layout (container, TRUE);
+	gtk_container_add (GTK_CONTAINER (scrolled), GTK_WIDGET (container));
+
+	gtk_widget_show_all (window);
+	flush_events ();
+
+	/* Leave every other name free, to insert in the middle later */
+	for (i = 0; i < n_icons; i++) {
+		nemo_icon_container_add (container,
+					 (NemoIconData *) g_strdup_printf ("file-%08d", i * 2));
+	}
+	g_print ("Layout of %d icons: %.1f ms\n", n_icons, time_layout (container));
+	flush_events ();
+	ok = has_items_near_viewport (container, "Initial layout");
+
+	vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
+	gtk_adjustment_set_value (vadj, gtk_adjustment_get_upper (vadj));
+	flush_events ();
+	ok = has_items_near_viewport (container, "Scrolled to the end") && ok;
+
+	last = g_strdup ("zz-last");
+	nemo_icon_container_add (container, (NemoIconData *) last);
+	g_print ("Adding one icon at the end: %.2f ms\n", time_layout (container));
+	flush_events ();
+	ok = matches_full_layout (container, "Adding one icon at the end") && ok;
+
+	/* An odd number sorts between two of the names above */
+	nemo_icon_container_add (container,
+				 (NemoIconData *) g_strdup_printf ("file-%08d", n_icons | 1));
+	g_print ("Adding one icon in the middle: %.2f ms\n", time_layout (container));
+	flush_events ();
+	ok = matches_full_layout (container, "Adding one icon in the middle") && ok;
+
+	nemo_icon_container_request_update (container, (NemoIconData *) last);
+	g_print ("Updating one icon: %.2f ms\n", time_layout (container));
+	flush_events ();
+	ok = matches_full_layout (container, "Updating one icon") && ok;
+
+	data = find_line_start (container);
+	if (data != NULL) {
+		nemo_icon_container_remove (container, data);
+		g_print ("Removing the icon that starts a line: %.2f ms\n", time_layout (container));
+		flush_events ();
+		ok = matches_full_layout (container, "Removing the icon that starts a line") && ok;
+		g_free (data);
+	}
+
+	data = g_list_last (container->details->icons)->data;
+	nemo_icon_container_remove (container, data);
+	g_print ("Removing the last icon: %.2f ms\n", time_layout (container));
+	flush_events ();
+	ok = matches_full_layout (container, "Removing the last icon") && ok;
+	g_free (data);
+
+	gtk_widget_destroy (window);
+
+	return ok ? 0 : 1;
+}
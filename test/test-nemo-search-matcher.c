@@ -0,0 +1,159 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   test-nemo-search-matcher.c: Compares the search matcher with the old
+   way of matching file names.
+ 
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+  
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+  
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin Street - Suite 500,
+   Boston, MA 02110-1335, USA.
+*/
+
+#include <libnemo-private/nemo-search-matcher.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Compares NemoSearchMatcher with the normalize, strdown and strstr
+ * matching the simple search engine used to do for every file.
+ *
+ * Usage: test-nemo-search-matcher [query [number of names]]
+ */
+
+static const char *stems[] = {
+	"Report", "IMG_", "holiday", "Invoice-", "notes", "Übersicht",
+	"café menu", "résumé", "build.log.", "Screenshot from ", "Ελληνικά",
+	"main", "README", "backup-", "Straße", "ΟΔΥΣΣΕΥΣ", "ΣΑΣ ΟΔΟΣ"
+};
+
+static const char *extensions[] = {
+	".txt", ".jpg", ".png", ".pdf", ".c", ".h", ".tar.gz", "", ".odt"
+};
+
+static char *
+old_fold (const char *name)
+{
+	char *normalized, *lower_name;
+
+	normalized = g_utf8_normalize (name, -1, G_NORMALIZE_NFD);
+	lower_name = g_utf8_strdown (normalized, -1);
+	g_free (normalized);
+
+	return lower_name;
+}
+
+static gboolean
+old_matches (char **words, const char *name)
+{
+	char *lower_name;
+	gboolean hit;
+	int i;
+
+	lower_name = old_fold (name);
+
+	hit = TRUE;
+	for (i = 0; words[i] != NULL; i++) {
+		if (strstr (lower_name, words[i]) == NULL) {
+			hit = FALSE;
+			break;
+		}
+	}
+	g_free (lower_name);
+
+	return hit;
+}
+
+static char **
+old_words (const char *text)
+{
+	char *lower;
+	char **words;
+
+	lower = old_fold (text);
+	words = g_strsplit (lower, " ", -1);
+	g_free (lower);
+
+	return words;
+}
+
+int
+main (int argc, char* argv[])
+{
+	NemoSearchMatcher *matcher;
+	const char *text, *folded;
+	char **names, **words, *old_folded;
+	gsize length;
+	guint n_names, i, old_hits, new_hits, mismatches;
+	gint64 start, old_time, new_time;
+
+	text = argc > 1 ? argv[1] : "report 2";
+	n_names = argc > 2 ? atoi (argv[2]) : 1000000;
+
+	names = g_new0 (char *, n_names + 1);
+	for (i = 0; i < n_names; i++) {
+		names[i] = g_strdup_printf ("%s%u%s",
+					    stems[i % G_N_ELEMENTS (stems)],
+					    i,
+					    extensions[i % G_N_ELEMENTS (extensions)]);
+	}
+
+	words = old_words (text);
+	old_hits = 0;
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_names; i++) {
+		old_hits += old_matches (words, names[i]);
+	}
+	old_time = g_get_monotonic_time () - start;
+
+	matcher = nemo_search_matcher_new_for_text (text);
+	new_hits = 0;
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_names; i++) {
+		new_hits += nemo_search_matcher_matches (matcher, names[i]);
+	}
+	new_time = g_get_monotonic_time () - start;
+
+	mismatches = 0;
+	for (i = 0; i < n_names; i++) {
+		if (old_matches (words, names[i]) !=
+		    nemo_search_matcher_matches (matcher, names[i])) {
+			if (mismatches++ < 10) {
+				g_print ("mismatch: %s\n", names[i]);
+			}
+		}
+
+		/* The folded names must be the same too, whatever the
+		 * query happens to look for.
+		 */
+		old_folded = old_fold (names[i]);
+		folded = nemo_search_matcher_fold (matcher, names[i], &length);
+		if (strcmp (old_folded, folded) != 0) {
+			if (mismatches++ < 10) {
+				g_print ("folded differently: %s\n", names[i]);
+			}
+		}
+		g_free (old_folded);
+	}
+
+	g_print ("query \"%s\", %u names\n", text, n_names);
+	g_print ("normalize+strdown+strstr: %u hits, %.1f ns/name\n",
+		 old_hits, (double) old_time * 1000 / n_names);
+	g_print ("NemoSearchMatcher:        %u hits, %.1f ns/name\n",
+		 new_hits, (double) new_time * 1000 / n_names);
+	g_print ("%u mismatches\n", mismatches);
+
+	nemo_search_matcher_free (matcher);
+	g_strfreev (words);
+	g_strfreev (names);
+
+	return mismatches == 0 ? 0 : 1;
+}